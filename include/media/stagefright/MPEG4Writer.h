@@ -23,6 +23,9 @@
 #include <media/stagefright/MediaWriter.h>
 #include <utils/List.h>
 #include <utils/threads.h>
+#include <utils/Vector.h>
+
+struct iovec;
 
 namespace android {
 
@@ -71,6 +74,7 @@ protected:
 
 private:
     class Track;
+    friend struct MPEG4WriterPeer;  // tests
 
     int  mFd;
     status_t mInitCheck;
@@ -98,6 +102,36 @@ private:
     int32_t mStartTimeOffsetMs;
     int mHFRRatio;
 
+    // Fragmented output (kKeyFragmentDurationUs): an init segment (ftyp +
+    // moov without samples) followed by one moof + mdat per buffered
+    // fragment, and a trailing mfra for random access.
+    bool mFragmented;
+    int64_t mFragmentDurationUs;
+    bool mInitSegmentWritten;
+    uint32_t mFragmentSequenceNumber;
+
+    // Sample data is staged in mWriteBuffer and handed to the file system
+    // with writev() in multiples of its block size, so that small samples
+    // and NAL length prefixes do not cost a write() each and no write
+    // straddles a block boundary of the file needlessly.
+    uint8_t *mWriteBuffer;
+    size_t mWriteBufferSize;
+    size_t mWriteBufferLength;
+    size_t mBlockSize;
+    bool mPreallocated;
+    off64_t mPreallocatedEnd;       // space reserved with fallocate() so far
+    off64_t mPreallocationLimit;    // never reserve past this, 0 if disabled
+
+    // Sample tables of long recordings are spilled to an unlinked temporary
+    // file in the directory named by "media.stagefright.mp4-spill-dir",
+    // if set. mSpillFd is opened on first use. After a failed write
+    // mSpillDisabled is set, but mSpillFd stays open until release() so
+    // the runs already spilled can be read back.
+    Mutex mSpillLock;
+    int mSpillFd;
+    bool mSpillDisabled;
+    off64_t mSpillOffset;
+
     Mutex mLock;
 
     List<Track *> mTracks;
@@ -110,16 +144,35 @@ private:
     size_t numTracks();
     int64_t estimateMoovBoxSize(int32_t bitRate);
 
+    // Per-sample information needed for the 'trun' box of a fragment.
+    struct FragmentSampleInfo {
+        uint32_t mSize;
+        uint32_t mDurationTicks;
+        int32_t  mCttsOffsetTicks;
+        bool     mIsSync;
+    };
+
     struct Chunk {
         Track               *mTrack;        // Owner
         int64_t             mTimeStampUs;   // Timestamp of the 1st sample
         List<MediaBuffer *> mSamples;       // Sample data
 
+        // Fragmented output only: one entry per sample in mSamples and
+        // the decoding time of the first sample in track timescale.
+        Vector<FragmentSampleInfo> mSampleInfos;
+        int64_t             mBaseDecodeTimeTicks;
+
+        // Fragmented output only: the movie's start time, taken under
+        // mLock when the chunk is picked for writing.
+        int64_t             mMoovStartTimeUs;
+
         // Convenient constructor
-        Chunk(): mTrack(NULL), mTimeStampUs(0) {}
+        Chunk(): mTrack(NULL), mTimeStampUs(0), mBaseDecodeTimeTicks(0),
+                 mMoovStartTimeUs(0) {}
 
         Chunk(Track *track, int64_t timeUs, List<MediaBuffer *> samples)
-            : mTrack(track), mTimeStampUs(timeUs), mSamples(samples) {
+            : mTrack(track), mTimeStampUs(timeUs), mSamples(samples),
+              mBaseDecodeTimeTicks(0), mMoovStartTimeUs(0) {
         }
 
     };
@@ -133,6 +186,9 @@ private:
         // Max time interval between neighboring chunks
         int64_t mMaxInterChunkDurUs;
 
+        // Fragmented output: the track had no fragment when the init
+        // segment was written, it is left out of the file.
+        bool mExcluded;
     };
 
     bool            mIsFirstChunk;
@@ -160,6 +216,16 @@ private:
     // Actually write the given chunk to the file.
     void writeChunkToFile(Chunk* chunk);
 
+    // Fragmented output: write the moof and the mdat header for the given
+    // chunk, preceded by the init segment if that is not written yet.
+    void writeFragmentHeader(Chunk *chunk);
+
+    // Fragmented output: whether the init segment can be written. It waits
+    // for a fragment from every track, but only for so long, tracks that
+    // have none by then are excluded.
+    bool isInitSegmentReady_l();
+    void excludeTracksWithoutChunks_l();
+
     // Adjust other track media clock (presumably wall clock)
     // based on audio track media clock with the drift time.
     int64_t mDriftTimeUs;
@@ -182,16 +248,37 @@ private:
 
     // Acquire lock before calling these methods
     off64_t addSample_l(MediaBuffer *buffer);
-    off64_t addLengthPrefixedSample_l(MediaBuffer *buffer);
+
+    // Append the given sample data at mOffset, staging it in mWriteBuffer
+    // as needed. The data may be released as soon as this returns.
+    void writeSampleData_l(const struct iovec *iov, int iovcnt);
+
+    // Write out whatever is staged in mWriteBuffer. Must be called before
+    // anything else is written to or seeked in the file.
+    void flushWriteBuffer_l();
+
+    void allocateWriteBuffer();
+    void preallocateFile_l(off64_t offset);
+
+    // Sample table spilling, see mSpillFd.
+    bool canSpillSampleTables();
+    // Returns the offset of the data in the spill file, -1 on error.
+    off64_t spillSampleTableData(const void *data, size_t size);
+    void readSpilledSampleTableData(off64_t offset, void *data, size_t size);
+    void closeSpillFile();
 
     bool exceedsFileSizeLimit();
     bool use32BitFileOffset() const;
     bool exceedsFileDurationLimit();
     bool isFileStreamable() const;
+    bool isFragmented() const { return mFragmented; }
+    int64_t fragmentDurationUs() const { return mFragmentDurationUs; }
     void trackProgressStatus(size_t trackId, int64_t timeUs, status_t err = OK);
     void writeCompositionMatrix(int32_t degrees);
     void writeMvhdBox(int64_t durationUs);
     void writeMoovBox(int64_t durationUs);
+    void writeMvexBox();
+    void writeMfraBox();
     void writeFtypBox(MetaData *param);
     void writeUdtaBox();
     void writeGeoDataBox();
@@ -20,10 +20,12 @@
 
 #include <media/stagefright/MediaBuffer.h>
 #include <utils/Errors.h>
+#include <utils/List.h>
 #include <utils/threads.h>
 
 namespace android {
 
+struct AMessage;
 class MediaBuffer;
 class MetaData;
 
@@ -35,19 +37,59 @@ public:
     void add_buffer(MediaBuffer *buffer);
 
     // Blocks until a buffer is available and returns it to the caller,
-    // the returned buffer will have a reference count of 1.
+    // the returned buffer will have a reference count of 1. Free buffers
+    // of the smallest size class are handed out first, not the first one
+    // added, so groups mixing buffer sizes get the smallest free one.
     status_t acquire_buffer(MediaBuffer **buffer);
 
+    // If "nonBlocking" is true and no suitable buffer is free, returns
+    // WOULD_BLOCK immediately. If "requestedSize" is > 0 only buffers
+    // of at least that size are considered, buffers of the smallest
+    // size class that can satisfy the request are preferred.
+    status_t acquire_buffer(
+            MediaBuffer **buffer, bool nonBlocking, size_t requestedSize = 0);
+
+    // Posts "notify" once a buffer is available (right away if one already
+    // is), to be used together with a non-blocking acquire_buffer().
+    void notifyWhenBufferAvailable(const sp<AMessage> &notify);
+
 protected:
     virtual void signalBufferReturned(MediaBuffer *buffer);
 
 private:
     friend class MediaBuffer;
 
+    enum {
+        kNumSizeClasses = 32,
+    };
+
+    // Buffers are kept in append-only lists per size class (floor of
+    // log2 of the buffer size) and are claimed by atomically bumping
+    // their reference count from 0 to 1, acquiring and returning a
+    // buffer does not take mLock unless somebody is waiting.
+    struct SizeClass {
+        MediaBuffer *mFirstBuffer;
+        MediaBuffer *mLastBuffer;
+
+        // Advisory, the buffer most recently returned to this class.
+        MediaBuffer *mFreeHint;
+    };
+
     Mutex mLock;
     Condition mCondition;
 
-    MediaBuffer *mFirstBuffer, *mLastBuffer;
+    SizeClass mSizeClasses[kNumSizeClasses];
+    size_t mMaxBufferSize;
+
+    volatile int32_t mNumWaiters;
+    List<sp<AMessage> > mNotifications;
+
+    static size_t SizeClassIndex(size_t size);
+
+    static bool Claim(MediaBuffer *buffer, size_t requestedSize);
+    bool tryAcquire(MediaBuffer **out, size_t requestedSize);
+    bool hasFreeBuffer() const;
+    void postNotifications_l();
 
     MediaBufferGroup(const MediaBufferGroup &);
     MediaBufferGroup &operator=(const MediaBufferGroup &);
@@ -109,6 +109,10 @@ enum {
     kKey64BitFileOffset   = 'fobt',  // int32_t (bool)
     kKey2ByteNalLength    = '2NAL',  // int32_t (bool)
 
+    // Set this key to author a fragmented MP4 file, with a movie
+    // fragment for each track every so many microseconds
+    kKeyFragmentDurationUs = 'frgd',  // int64_t
+
     // Identify the file output format for authoring
     // Please see <media/mediarecorder.h> for the supported
     // file output formats.
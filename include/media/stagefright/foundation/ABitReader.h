@@ -28,8 +28,39 @@ namespace android {
 struct ABitReader {
     ABitReader(const uint8_t *data, size_t size);
 
-    uint32_t getBits(size_t n);
-    void skipBits(size_t n);
+    inline uint32_t getBits(size_t n) {
+        if (n > 0 && n <= 32 && n <= mNumBitsLeft) {
+            uint32_t result = mReservoir >> (64 - n);
+            mReservoir <<= n;
+            mNumBitsLeft -= n;
+            return result;
+        }
+
+        return getBitsSlow(n);
+    }
+
+    // Returns the next "n" (<= 32) bits without consuming them.
+    inline uint32_t peekBits(size_t n) const {
+        if (n > 0 && n <= 32 && n <= mNumBitsLeft) {
+            return mReservoir >> (64 - n);
+        }
+
+        return peekBitsSlow(n);
+    }
+
+    inline void skipBits(size_t n) {
+        if (n < mNumBitsLeft) {
+            mReservoir <<= n;
+            mNumBitsLeft -= n;
+            return;
+        }
+
+        skipBitsSlow(n);
+    }
+
+    // Unsigned and signed Exp-Golomb codes, ue(v) and se(v).
+    uint32_t getUE();
+    int32_t getSE();
 
     void putBits(uint32_t x, size_t n);
 
@@ -41,11 +72,15 @@ private:
     const uint8_t *mData;
     size_t mSize;
 
-    uint32_t mReservoir;  // left-aligned bits
+    uint64_t mReservoir;  // left-aligned bits
     size_t mNumBitsLeft;
 
     void fillReservoir();
 
+    uint32_t getBitsSlow(size_t n);
+    uint32_t peekBitsSlow(size_t n) const;
+    void skipBitsSlow(size_t n);
+
     DISALLOW_EVIL_CONSTRUCTORS(ABitReader);
 };
 
@@ -42,6 +42,16 @@ struct ABuffer : public RefBase {
 
     void setRange(size_t offset, size_t size);
 
+    // Returns a buffer referring to "size" bytes starting at "offset"
+    // within the current range, without copying. The slice keeps the
+    // underlying storage alive, data appended to this buffer afterwards
+    // never overwrites bytes visible through a live slice.
+    sp<ABuffer> slice(size_t offset, size_t size);
+
+    // Appends "size" bytes to the current range, reusing spare capacity
+    // when possible and growing the allocation otherwise.
+    void append(const void *data, size_t size);
+
     void setInt32Data(int32_t data) { mInt32Data = data; }
     int32_t int32Data() const { return mInt32Data; }
 
@@ -51,18 +61,36 @@ protected:
     virtual ~ABuffer();
 
 private:
+    struct SharedStorage;
+
     sp<AMessage> mFarewell;
     sp<AMessage> mMeta;
 
+    // Set once this buffer has been sliced, and on every slice, so that
+    // its strong count tells whether slices are alive. Owns the allocation
+    // from then on if the memory was owned by this buffer.
+    sp<SharedStorage> mStorage;
+
+    // A slice of a buffer wrapping external memory keeps that buffer
+    // (and therefore its farewell message) alive instead.
+    sp<ABuffer> mParent;
+
     void *mData;
     size_t mCapacity;
     size_t mRangeOffset;
     size_t mRangeLength;
 
+    // End of the bytes handed out through slice(), relative to base().
+    // append() may still write past it without copying first.
+    size_t mSlicedEnd;
+
     int32_t mInt32Data;
 
     bool mOwnsData;
 
+    bool isShared() const;
+    void reallocate(size_t capacity);
+
     DISALLOW_EVIL_CONSTRUCTORS(ABuffer);
 };
 
@@ -57,6 +57,10 @@
 #include <media/MemoryLeakTrackUtil.h>
 #include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/AudioPlayer.h>
+#include <media/stagefright/FileSource.h>
+#include <media/stagefright/MediaExtractor.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
 #include <media/stagefright/foundation/ADebug.h>
 
 #include <system/audio.h>
@@ -81,6 +85,7 @@
 #include "HDCP.h"
 #include "HTTPBase.h"
 #include "RemoteDisplay.h"
+#include "SoftAudioBatchDecoder.h"
 #ifdef QCOM_DIRECTTRACK
 #define DEFAULT_SAMPLE_RATE 44100
 #endif
@@ -1268,6 +1273,68 @@ Exit:
     return status;
 }
 
+// Decodes the first audio track of the file straight into the heap with a
+// software decoder, which is far cheaper than playing it into an AudioCache.
+// Fails for anything SoftAudioBatchDecoder can't handle, the caller then
+// falls back to a player.
+static status_t batchDecode(int fd, int64_t offset, int64_t length,
+                            uint32_t *pSampleRate, int* pNumChannels,
+                            audio_format_t* pFormat,
+                            const sp<IMemoryHeap>& heap, size_t *pSize)
+{
+    DataSource::RegisterDefaultSniffers();
+
+    sp<DataSource> dataSource = new FileSource(dup(fd), offset, length);
+    if (dataSource->initCheck() != OK) {
+        return NO_INIT;
+    }
+
+    sp<MediaExtractor> extractor = MediaExtractor::Create(dataSource);
+    if (extractor == NULL) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    // Leave protected content to the player, which knows how to deal with it.
+    sp<MetaData> fileMeta = extractor->getMetaData();
+    int32_t isDRM;
+    if (extractor->getDrmFlag() || (fileMeta != NULL
+            && fileMeta->findInt32(kKeyIsDRM, &isDRM) && isDRM)) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    for (size_t i = 0; i < extractor->countTracks(); ++i) {
+        sp<MetaData> meta = extractor->getTrackMetaData(i);
+
+        const char *mime;
+        if (meta == NULL || !meta->findCString(kKeyMIMEType, &mime)
+                || strncasecmp(mime, "audio/", 6)) {
+            continue;
+        }
+
+        sp<MediaSource> track = extractor->getTrack(i);
+        if (track == NULL) {
+            return ERROR_UNSUPPORTED;
+        }
+
+        size_t size;
+        int32_t sampleRate, numChannels;
+        status_t err = SoftAudioBatchDecoder::Decode(
+                track, heap->getBase(), heap->getSize(),
+                &size, &sampleRate, &numChannels);
+        if (err != OK) {
+            return err;
+        }
+
+        *pSize = size;
+        *pSampleRate = sampleRate;
+        *pNumChannels = numChannels;
+        *pFormat = AUDIO_FORMAT_PCM_16_BIT;
+        return OK;
+    }
+
+    return ERROR_UNSUPPORTED;
+}
+
 status_t MediaPlayerService::decode(int fd, int64_t offset, int64_t length,
                                        uint32_t *pSampleRate, int* pNumChannels,
                                        audio_format_t* pFormat,
@@ -1277,6 +1344,14 @@ status_t MediaPlayerService::decode(int fd, int64_t offset, int64_t length,
     sp<MediaPlayerBase> player;
     status_t status = BAD_VALUE;
 
+    if (batchDecode(fd, offset, length, pSampleRate, pNumChannels, pFormat,
+                    heap, pSize) == NO_ERROR) {
+        ALOGV("batch decoded size %zu sampleRate=%u, channelCount = %d",
+              *pSize, *pSampleRate, *pNumChannels);
+        ::close(fd);
+        return NO_ERROR;
+    }
+
     player_type playerType = MediaPlayerFactory::getPlayerType(NULL /* client */,
                                                                fd,
                                                                offset,
@@ -501,6 +501,22 @@ status_t StagefrightRecorder::setParamInterleaveDuration(int32_t durationUs) {
     return OK;
 }
 
+// If durationUs > 0, MPEG4 output is written as a fragmented file with
+// one movie fragment (moof + mdat) per track every durationUs
+status_t StagefrightRecorder::setParamFragmentDuration(int32_t durationUs) {
+    ALOGV("setParamFragmentDuration: %d", durationUs);
+    if (durationUs < 0) {
+        return BAD_VALUE;
+    }
+    if (durationUs > 0 && durationUs < 500000) {  // 500 ms
+        // Fragment headers would make up a significant portion of the file
+        ALOGE("Fragment duration is too small: %d us", durationUs);
+        return BAD_VALUE;
+    }
+    mFragmentDurationUs = durationUs;
+    return OK;
+}
+
 // If seconds <  0, only the first frame is I frame, and rest are all P frames
 // If seconds == 0, all frames are encoded as I frames. No P frames
 // If seconds >  0, it is the time spacing (seconds) between 2 neighboring I frames
@@ -656,6 +672,11 @@ status_t StagefrightRecorder::setParameter(
         if (safe_strtoi32(value.string(), &durationUs)) {
             return setParamInterleaveDuration(durationUs);
         }
+    } else if (key == "param-fragment-duration-us") {
+        int32_t durationUs;
+        if (safe_strtoi32(value.string(), &durationUs)) {
+            return setParamFragmentDuration(durationUs);
+        }
     } else if (key == "param-movie-time-scale") {
         int32_t timeScale;
         if (safe_strtoi32(value.string(), &timeScale)) {
@@ -1798,6 +1819,9 @@ void StagefrightRecorder::setupMPEG4MetaData(int64_t startTimeUs, int32_t totalB
     (*meta)->setInt32(kKeyFileType, mOutputFormat);
     (*meta)->setInt32(kKeyBitRate, totalBitRate);
     (*meta)->setInt32(kKey64BitFileOffset, mUse64BitFileOffset);
+    if (mFragmentDurationUs > 0) {
+        (*meta)->setInt64(kKeyFragmentDurationUs, mFragmentDurationUs);
+    }
     if (mMovieTimeScale > 0) {
         (*meta)->setInt32(kKeyTimeScale, mMovieTimeScale);
     }
@@ -1955,6 +1979,7 @@ status_t StagefrightRecorder::reset() {
     mAudioBitRate  = 12200;
 #endif
     mInterleaveDurationUs = 0;
+    mFragmentDurationUs = 0;
     mIFramesIntervalSec = 1;
     mAudioSourceNode = 0;
     mUse64BitFileOffset = false;
@@ -2024,6 +2049,8 @@ status_t StagefrightRecorder::dump(
     result.append(buffer);
     snprintf(buffer, SIZE, "     Interleave duration (us): %d\n", mInterleaveDurationUs);
     result.append(buffer);
+    snprintf(buffer, SIZE, "     Fragment duration (us): %d\n", mFragmentDurationUs);
+    result.append(buffer);
     snprintf(buffer, SIZE, "     Progress notification: %lld us\n", mTrackEveryTimeDurationUs);
     result.append(buffer);
     snprintf(buffer, SIZE, "   Audio\n");
@@ -35,6 +35,7 @@ LOCAL_SRC_FILES:=                         \
         CameraSourceTimeLapse.cpp         \
         ClockEstimator.cpp                \
         DataSource.cpp                    \
+        DiskCachedSource.cpp              \
         DRMExtractor.cpp                  \
         ESDS.cpp                          \
         FileSource.cpp                    \
@@ -42,6 +43,7 @@ LOCAL_SRC_FILES:=                         \
         HTTPBase.cpp                      \
         JPEGSource.cpp                    \
         MP3Extractor.cpp                  \
+        MP3FrameIndexSeeker.cpp           \
         MPEG2TSWriter.cpp                 \
         MPEG4Extractor.cpp                \
         MPEG4Writer.cpp                   \
@@ -63,6 +65,7 @@ LOCAL_SRC_FILES:=                         \
         SampleIterator.cpp                \
         SampleTable.cpp                   \
         SkipCutBuffer.cpp                 \
+        SoftAudioBatchDecoder.cpp         \
         StagefrightMediaScanner.cpp       \
         StagefrightMetadataRetriever.cpp  \
         SurfaceMediaSource.cpp            \
@@ -222,6 +225,11 @@ ifeq ($(BOARD_USE_TI_DUCATI_H264_PROFILE), true)
 LOCAL_CFLAGS += -DUSE_TI_DUCATI_H264_PROFILE
 endif
 
+# Preallocate recordings with fallocate64() when the C library provides it.
+ifeq ($(TARGET_HAS_FALLOCATE), true)
+LOCAL_CFLAGS += -DHAVE_FALLOCATE
+endif
+
 ifdef DOLBY_UDC
   LOCAL_CFLAGS += -DDOLBY_UDC
 endif #DOLBY_UDC
@@ -27,6 +27,7 @@
 #include <dlfcn.h>
 
 #include "include/AwesomePlayer.h"
+#include "include/DiskCachedSource.h"
 #include "include/DRMExtractor.h"
 #include "include/SoftwareRenderer.h"
 #include "include/NuCachedSource2.h"
@@ -2819,8 +2820,20 @@ status_t AwesomePlayer::finishSetDataSource_l() {
         NuCachedSource2::RemoveCacheSpecificHeaders(
                 &mUriHeaders, &cacheConfig, &disconnectAtHighwatermark);
 
+        bool useDiskCache = !isWidevineStreaming && !(mFlags & INCOGNITO);
+        sp<HTTPBase> connectingSource = mConnectingDataSource;
+        String8 uri = mUri;
+        KeyedVector<String8, String8> uriHeaders = mUriHeaders;
+
         mLock.unlock();
         status_t err = mConnectingDataSource->connect(mUri, &mUriHeaders);
+
+        // Opening the cache entry touches the disk, don't hold the lock.
+        sp<HTTPBase> diskCachedSource;
+        if (err == OK && useDiskCache) {
+            diskCachedSource = DiskCachedSource::Wrap(
+                    connectingSource, uri.string(), &uriHeaders);
+        }
         mLock.lock();
 
         if (err != OK) {
@@ -2830,6 +2843,10 @@ status_t AwesomePlayer::finishSetDataSource_l() {
             return err;
         }
 
+        if (diskCachedSource != NULL) {
+            mConnectingDataSource = diskCachedSource;
+        }
+
         if (!isWidevineStreaming) {
             // The widevine extractor does its own caching.
 
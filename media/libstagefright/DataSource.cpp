@@ -22,6 +22,7 @@
 
 #include "include/AACExtractor.h"
 #include "include/DRMExtractor.h"
+#include "include/DiskCachedSource.h"
 #include "include/FLACExtractor.h"
 #include "include/HTTPBase.h"
 #include "include/MP3Extractor.h"
@@ -265,7 +266,24 @@ sp<DataSource> DataSource::CreateFromURI(
     } else if (!strncasecmp("http://", uri, 7)
             || !strncasecmp("https://", uri, 8)
             || isWidevine) {
-        sp<HTTPBase> httpSource = HTTPBase::Create();
+        // The browser is in "incognito" mode, neither log the URL nor
+        // keep the content on disk.
+        bool incognito = false;
+        KeyedVector<String8, String8> strippedHeaders;
+        if (headers != NULL) {
+            ssize_t index = headers->indexOfKey(String8("x-hide-urls-from-log"));
+            if (index >= 0) {
+                incognito = true;
+
+                // This isn't something that should be passed to the server.
+                strippedHeaders = *headers;
+                strippedHeaders.removeItemsAt(index);
+                headers = &strippedHeaders;
+            }
+        }
+
+        sp<HTTPBase> httpSource = HTTPBase::Create(
+                incognito ? HTTPBase::kFlagIncognito : 0);
 
         String8 tmp;
         if (isWidevine) {
@@ -280,6 +298,10 @@ sp<DataSource> DataSource::CreateFromURI(
         }
 
         if (!isWidevine) {
+            if (!incognito) {
+                httpSource = DiskCachedSource::Wrap(httpSource, uri, headers);
+            }
+
             String8 cacheConfig;
             bool disconnectAtHighwatermark;
             if (headers != NULL) {
@@ -0,0 +1,623 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "DiskCachedSource"
+#include <utils/Log.h>
+
+#include "include/DiskCachedSource.h"
+
+#include <cutils/properties.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaErrors.h>
+#include <utils/Vector.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace android {
+
+static const uint32_t kCacheFileMagic = 0x44435331;  // 'DCS1'
+static const uint32_t kCacheFileVersion = 3;
+
+struct DiskCachedSource::Header {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mBlockSize;
+    uint32_t mReserved;
+    uint64_t mContentSize;
+    uint64_t mURIHash;
+    uint64_t mHeadersHash;
+    char mValidator[kMaxValidatorLength];
+
+    // The hash only names the file, the full URI tells colliding
+    // resources apart.
+    char mURI[kMaxURILength];
+};
+
+struct CacheEntry {
+    String8 mPath;
+    time_t mLastUseTime;
+    off64_t mSize;
+};
+
+static int CompareCacheEntries(const CacheEntry *a, const CacheEntry *b) {
+    if (a->mLastUseTime < b->mLastUseTime) {
+        return -1;
+    } else if (a->mLastUseTime > b->mLastUseTime) {
+        return 1;
+    }
+    return 0;
+}
+
+// static
+sp<HTTPBase> DiskCachedSource::Wrap(
+        const sp<HTTPBase> &source, const char *uri,
+        const KeyedVector<String8, String8> *headers) {
+    char dir[PROPERTY_VALUE_MAX];
+    if (!property_get("media.stagefright.disk-cache-dir", dir, NULL)
+            || dir[0] == '\0') {
+        return source;
+    }
+
+    String8 validator;
+    if (source->getCacheValidator(&validator) != OK
+            || validator.length() >= kMaxValidatorLength) {
+        // Without a validator we can't tell whether a cached copy is
+        // still current.
+        ALOGV("resource has no usable validator, not caching.");
+        return source;
+    }
+
+    off64_t maxCacheSize = kDefaultMaxCacheSizeMB * 1024ll * 1024ll;
+
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.stagefright.disk-cache-size", value, NULL)) {
+        int sizeMB = atoi(value);
+        if (sizeMB > 0) {
+            maxCacheSize = sizeMB * 1024ll * 1024ll;
+        }
+    }
+
+    sp<DiskCachedSource> cachedSource = new DiskCachedSource(source);
+
+    if (cachedSource->openCacheFile(
+                dir, uri, HashHeaders(headers), validator, maxCacheSize) != OK) {
+        return source;
+    }
+
+    return cachedSource;
+}
+
+DiskCachedSource::DiskCachedSource(const sp<HTTPBase> &source)
+    : mSource(source),
+      mFd(-1),
+      mContentSize(0),
+      mNumBlocks(0),
+      mIndex(NULL),
+      mIndexSize(0),
+      mDataOffset(0),
+      mFetchBuffer(NULL) {
+}
+
+DiskCachedSource::~DiskCachedSource() {
+    closeCacheFile_l();
+
+    delete[] mFetchBuffer;
+    mFetchBuffer = NULL;
+}
+
+status_t DiskCachedSource::openCacheFile(
+        const char *dir, const char *uri, uint64_t headersHash,
+        const String8 &validator, off64_t maxCacheSize) {
+    off64_t contentSize;
+    if (mSource->getSize(&contentSize) != OK || contentSize <= 0) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    if (contentSize > maxCacheSize / 2) {
+        ALOGV("content too large (%lld bytes), not caching.", contentSize);
+        return ERROR_UNSUPPORTED;
+    }
+
+    if (strlen(uri) >= kMaxURILength) {
+        ALOGV("URI too long, not caching.");
+        return ERROR_UNSUPPORTED;
+    }
+
+    size_t numBlocks = (contentSize + kBlockSize - 1) / kBlockSize;
+    size_t bitmapSize = (numBlocks + 7) / 8;
+    size_t indexSize =
+        kHeaderSize + ((bitmapSize + kHeaderSize - 1) / kHeaderSize) * kHeaderSize;
+
+    uint64_t uriHash = HashURI(uri);
+    String8 path = String8::format(
+            "%s/%016llx-%016llx.cache", dir, uriHash, headersHash);
+
+    EvictEntries(dir, maxCacheSize, indexSize + contentSize, path);
+
+    int fd = open(path.string(), O_LARGEFILE | O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        ALOGW("unable to open cache file (%s)", strerror(errno));
+        return -errno;
+    }
+
+    // Another instance is already playing this resource, leave the
+    // entry to it.
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return -EBUSY;
+    }
+
+    bool valid = false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0
+            && st.st_size == (off64_t)indexSize + contentSize) {
+        Header header;
+        if (pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)) {
+            header.mValidator[kMaxValidatorLength - 1] = '\0';
+            header.mURI[kMaxURILength - 1] = '\0';
+
+            valid = header.mMagic == kCacheFileMagic
+                && header.mVersion == kCacheFileVersion
+                && header.mBlockSize == kBlockSize
+                && header.mContentSize == (uint64_t)contentSize
+                && header.mURIHash == uriHash
+                && header.mHeadersHash == headersHash
+                && !strcmp(header.mValidator, validator.string())
+                && !strcmp(header.mURI, uri);
+        }
+    }
+
+    if (!valid) {
+        // Truncating to zero first discards stale blocks, the file is then
+        // extended sparsely to its final size.
+        if (ftruncate(fd, 0) != 0
+                || ftruncate(fd, indexSize + contentSize) != 0) {
+            ALOGW("unable to size cache file (%s)", strerror(errno));
+            close(fd);
+            unlink(path.string());
+            return ERROR_IO;
+        }
+    }
+
+    void *index = mmap(
+            NULL, indexSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (index == MAP_FAILED) {
+        ALOGW("unable to map cache index (%s)", strerror(errno));
+        close(fd);
+        return ERROR_IO;
+    }
+
+    if (!valid) {
+        Header *header = static_cast<Header *>(index);
+        header->mVersion = kCacheFileVersion;
+        header->mBlockSize = kBlockSize;
+        header->mReserved = 0;
+        header->mContentSize = contentSize;
+        header->mURIHash = uriHash;
+        header->mHeadersHash = headersHash;
+        strlcpy(header->mValidator, validator.string(), kMaxValidatorLength);
+        strlcpy(header->mURI, uri, kMaxURILength);
+
+        // Written last so that a partially initialized header never
+        // validates.
+        header->mMagic = kCacheFileMagic;
+    } else {
+        ALOGI("reusing cache entry for resource (%lld bytes)", contentSize);
+    }
+
+    // The modification time drives LRU eviction.
+    utimes(path.string(), NULL);
+
+    mFd = fd;
+    mContentSize = contentSize;
+    mNumBlocks = numBlocks;
+    mIndex = index;
+    mIndexSize = indexSize;
+    mDataOffset = indexSize;
+
+    return OK;
+}
+
+void DiskCachedSource::closeCacheFile_l() {
+    if (mIndex != NULL) {
+        munmap(mIndex, mIndexSize);
+        mIndex = NULL;
+    }
+
+    if (mFd >= 0) {
+        close(mFd);
+        mFd = -1;
+    }
+}
+
+bool DiskCachedSource::isBlockCached_l(size_t block) const {
+    CHECK_LT(block, mNumBlocks);
+
+    const uint8_t *bitmap = (const uint8_t *)mIndex + kHeaderSize;
+    return bitmap[block / 8] & (1 << (block % 8));
+}
+
+void DiskCachedSource::markBlockCached_l(size_t block) {
+    CHECK_LT(block, mNumBlocks);
+
+    uint8_t *bitmap = (uint8_t *)mIndex + kHeaderSize;
+    bitmap[block / 8] |= 1 << (block % 8);
+}
+
+ssize_t DiskCachedSource::readAt(off64_t offset, void *data, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mFd < 0) {
+        return readFromSource_l(offset, data, size);
+    }
+
+    if (offset < 0) {
+        return ERROR_MALFORMED;
+    }
+
+    if (offset >= mContentSize) {
+        return 0;
+    }
+
+    if (offset + (off64_t)size > mContentSize) {
+        size = mContentSize - offset;
+    }
+
+    size_t lastRequestedBlock = (offset + size - 1) / kBlockSize;
+
+    size_t copied = 0;
+    while (copied < size) {
+        if (mFd < 0) {
+            // Caching was disabled after an I/O error.
+            ssize_t n = readFromSource_l(
+                    offset + copied, (uint8_t *)data + copied, size - copied);
+
+            if (n < 0) {
+                return copied > 0 ? (ssize_t)copied : n;
+            }
+            return copied + n;
+        }
+
+        off64_t pos = offset + copied;
+
+        // Find the run of blocks starting at "pos" that are either all
+        // cached or all missing.
+        size_t firstBlock = pos / kBlockSize;
+        bool cached = isBlockCached_l(firstBlock);
+
+        size_t lastBlock = firstBlock;
+        while (lastBlock < lastRequestedBlock
+                && isBlockCached_l(lastBlock + 1) == cached
+                && (cached || lastBlock + 1 - firstBlock < kMaxBlocksPerFetch)) {
+            ++lastBlock;
+        }
+
+        off64_t runEnd = (off64_t)(lastBlock + 1) * kBlockSize;
+        if (runEnd > offset + (off64_t)size) {
+            runEnd = offset + size;
+        }
+
+        size_t length = runEnd - pos;
+
+        ssize_t n;
+        if (cached) {
+            n = readCachedBlocks_l(
+                    firstBlock, lastBlock, pos, (uint8_t *)data + copied, length);
+        } else {
+            n = fetchBlocks_l(
+                    firstBlock, lastBlock, pos, (uint8_t *)data + copied, length);
+        }
+
+        if (n <= 0) {
+            return copied > 0 ? (ssize_t)copied : n;
+        }
+
+        copied += n;
+
+        if ((size_t)n < length) {
+            break;
+        }
+    }
+
+    return copied;
+}
+
+ssize_t DiskCachedSource::readCachedBlocks_l(
+        size_t firstBlock, size_t lastBlock,
+        off64_t offset, void *data, size_t size) {
+    ssize_t n = pread64(mFd, data, size, mDataOffset + offset);
+
+    if (n != (ssize_t)size) {
+        ALOGW("failed to read cached blocks %d-%d (%s)",
+             firstBlock, lastBlock, n < 0 ? strerror(errno) : "short read");
+
+        closeCacheFile_l();
+
+        return readFromSource_l(offset, data, size);
+    }
+
+    return n;
+}
+
+ssize_t DiskCachedSource::fetchBlocks_l(
+        size_t firstBlock, size_t lastBlock,
+        off64_t offset, void *data, size_t size) {
+    CHECK_LT(lastBlock - firstBlock, (size_t)kMaxBlocksPerFetch);
+
+    uint8_t *buffer = mFetchBuffer;
+    mFetchBuffer = NULL;
+
+    if (buffer == NULL) {
+        buffer = new uint8_t[kMaxBlocksPerFetch * kBlockSize];
+    }
+
+    off64_t start = (off64_t)firstBlock * kBlockSize;
+    off64_t end = (off64_t)(lastBlock + 1) * kBlockSize;
+    if (end > mContentSize) {
+        end = mContentSize;
+    }
+
+    size_t total = end - start;
+    size_t filled = 0;
+    ssize_t err = OK;
+
+    // Don't hold up readers of cached blocks while we're on the network.
+    mLock.unlock();
+
+    while (filled < total) {
+        ssize_t n = mSource->readAt(
+                start + filled, buffer + filled, total - filled);
+
+        if (n < 0) {
+            err = n;
+            break;
+        } else if (n == 0) {
+            break;
+        }
+
+        filled += n;
+    }
+
+    mLock.lock();
+
+    // Only persist complete blocks, the last block of the content is
+    // complete once we reached the end.
+    size_t numBlocks = filled / kBlockSize;
+    size_t persisted = numBlocks * kBlockSize;
+    if (start + (off64_t)filled == mContentSize && persisted < filled) {
+        ++numBlocks;
+        persisted = filled;
+    }
+
+    // Caching may have been disabled by another reader meanwhile.
+    if (numBlocks > 0 && mFd >= 0) {
+        ssize_t n = pwrite64(mFd, buffer, persisted, mDataOffset + start);
+
+        if (n != (ssize_t)persisted || fdatasync(mFd) != 0) {
+            ALOGW("failed to write cache blocks (%s), disabling cache",
+                 (n < 0 || n == (ssize_t)persisted)
+                    ? strerror(errno) : "short write");
+
+            closeCacheFile_l();
+        } else {
+            // The bitmap is mapped and may reach the disk at any time, the
+            // blocks are only marked once their data is synced so that a
+            // crash never leaves a block marked that holds no data.
+            for (size_t i = 0; i < numBlocks; ++i) {
+                markBlockCached_l(firstBlock + i);
+            }
+        }
+    }
+
+    size_t delta = offset - start;
+    size_t copy = 0;
+    if (delta < filled) {
+        copy = filled - delta;
+        if (copy > size) {
+            copy = size;
+        }
+
+        memcpy(data, buffer + delta, copy);
+    }
+
+    if (mFetchBuffer == NULL) {
+        mFetchBuffer = buffer;
+    } else {
+        delete[] buffer;
+    }
+
+    return filled > 0 ? (ssize_t)copy : err;
+}
+
+ssize_t DiskCachedSource::readFromSource_l(
+        off64_t offset, void *data, size_t size) {
+    mLock.unlock();
+    ssize_t n = mSource->readAt(offset, data, size);
+    mLock.lock();
+
+    return n;
+}
+
+status_t DiskCachedSource::connect(
+        const char *uri,
+        const KeyedVector<String8, String8> *headers,
+        off64_t offset) {
+    return mSource->connect(uri, headers, offset);
+}
+
+void DiskCachedSource::disconnect() {
+    mSource->disconnect();
+}
+
+status_t DiskCachedSource::initCheck() const {
+    return mSource->initCheck();
+}
+
+status_t DiskCachedSource::getSize(off64_t *size) {
+    return mSource->getSize(size);
+}
+
+uint32_t DiskCachedSource::flags() {
+    return mSource->flags();
+}
+
+status_t DiskCachedSource::reconnectAtOffset(off64_t offset) {
+    return mSource->reconnectAtOffset(offset);
+}
+
+bool DiskCachedSource::estimateBandwidth(int32_t *bandwidth_bps) {
+    return mSource->estimateBandwidth(bandwidth_bps);
+}
+
+status_t DiskCachedSource::getEstimatedBandwidthKbps(int32_t *kbps) {
+    return mSource->getEstimatedBandwidthKbps(kbps);
+}
+
+status_t DiskCachedSource::setBandwidthStatCollectFreq(int32_t freqMs) {
+    return mSource->setBandwidthStatCollectFreq(freqMs);
+}
+
+status_t DiskCachedSource::getCacheValidator(String8 *validator) {
+    return mSource->getCacheValidator(validator);
+}
+
+sp<DecryptHandle> DiskCachedSource::DrmInitialization(const char *mime) {
+    return mSource->DrmInitialization(mime);
+}
+
+void DiskCachedSource::getDrmInfo(
+        sp<DecryptHandle> &handle, DrmManagerClient **client) {
+    mSource->getDrmInfo(handle, client);
+}
+
+String8 DiskCachedSource::getUri() {
+    return mSource->getUri();
+}
+
+String8 DiskCachedSource::getMIMEType() const {
+    return mSource->getMIMEType();
+}
+
+// static
+uint64_t DiskCachedSource::HashURI(const char *uri) {
+    // 64-bit FNV-1a.
+    uint64_t hash = 0xcbf29ce484222325ull;
+    while (*uri != '\0') {
+        hash ^= (uint8_t)*uri++;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// static
+uint64_t DiskCachedSource::HashHeaders(
+        const KeyedVector<String8, String8> *headers) {
+    if (headers == NULL || headers->isEmpty()) {
+        return 0;
+    }
+
+    // 64-bit FNV-1a over "name: value\n" of every header, the keyed
+    // vector keeps them sorted by name.
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < headers->size(); ++i) {
+        String8 line = String8::format(
+                "%s: %s\n",
+                headers->keyAt(i).string(), headers->valueAt(i).string());
+
+        for (const char *s = line.string(); *s != '\0'; ++s) {
+            hash ^= (uint8_t)*s;
+            hash *= 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+// static
+void DiskCachedSource::EvictEntries(
+        const char *dir, off64_t maxCacheSize, off64_t bytesNeeded,
+        const String8 &skipPath) {
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        return;
+    }
+
+    Vector<CacheEntry> entries;
+    off64_t totalSize = 0;
+
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if (len < 6 || strcmp(&de->d_name[len - 6], ".cache")) {
+            continue;
+        }
+
+        CacheEntry entry;
+        entry.mPath = String8::format("%s/%s", dir, de->d_name);
+
+        if (entry.mPath == skipPath) {
+            // Already accounted for in "bytesNeeded".
+            continue;
+        }
+
+        struct stat st;
+        if (stat(entry.mPath.string(), &st) != 0) {
+            continue;
+        }
+
+        // Entries are sparse, count the blocks actually allocated.
+        entry.mSize = (off64_t)st.st_blocks * 512;
+        entry.mLastUseTime = st.st_mtime;
+
+        totalSize += entry.mSize;
+        entries.push(entry);
+    }
+
+    closedir(d);
+
+    entries.sort(CompareCacheEntries);
+
+    for (size_t i = 0;
+            i < entries.size() && totalSize + bytesNeeded > maxCacheSize; ++i) {
+        const CacheEntry &entry = entries.itemAt(i);
+
+        int fd = open(entry.mPath.string(), O_RDWR);
+        if (fd < 0) {
+            continue;
+        }
+
+        // Skip entries that are currently in use.
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            ALOGV("evicting %s", entry.mPath.string());
+
+            unlink(entry.mPath.string());
+            totalSize -= entry.mSize;
+        }
+
+        close(fd);
+    }
+}
+
+}  // namespace android
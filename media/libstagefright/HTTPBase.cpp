@@ -135,6 +135,10 @@ status_t HTTPBase::setBandwidthStatCollectFreq(int32_t freqMs) {
     return OK;
 }
 
+status_t HTTPBase::getCacheValidator(String8 *validator) {
+    return ERROR_UNSUPPORTED;
+}
+
 void HTTPBase::setUID(uid_t uid) {
     mUIDValid = true;
     mUID = uid;
@@ -22,6 +22,7 @@
 
 #include "include/avc_utils.h"
 #include "include/ID3.h"
+#include "include/MP3FrameIndexSeeker.h"
 #include "include/VBRISeeker.h"
 #include "include/XINGSeeker.h"
 
@@ -331,6 +332,10 @@ MP3Extractor::MP3Extractor(
         // result in an extra 1152 samples being output. The real first frame to
         // decode is after the XING/VBRI frame, so skip there.
         mFirstFramePos += frame_size;
+    } else {
+        // Without a table of contents, index the frames ourselves.
+        mSeeker = MP3FrameIndexSeeker::CreateFromSource(
+                mDataSource, mFirstFramePos, mFixedHeader);
     }
 
     int64_t durationUs;
@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MP3FrameIndexSeeker"
+#include <utils/Log.h>
+
+#include "include/MP3FrameIndexSeeker.h"
+
+#include "include/avc_utils.h"
+
+#include <cutils/properties.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/Utils.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace android {
+
+// Same as in MP3Extractor: everything but protection, bitrate, padding,
+// private bits, mode, mode extension, copyright, original and emphasis
+// must match the first frame.
+static const uint32_t kMask = 0xfffe0c00;
+
+static const uint32_t kIndexMagic = 'MP3I';
+static const uint32_t kIndexVersion = 1;
+
+// Number of bytes hashed at the start and at the end of the file to tell
+// files apart.
+static const size_t kHashedBytes = 4096;
+
+// A walk runs to completion even after the extractor is gone, so that the
+// index gets saved. The media scanner opens files in quick succession,
+// only this many walks run at a time, files opened meanwhile are not
+// indexed.
+static const int kMaxNumWalks = 2;
+
+static Mutex gWalkLock;
+static int gNumWalks = 0;
+
+struct IndexHeader {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint64_t mKey;
+    uint32_t mFixedHeader;
+    uint32_t mFramesPerEntry;
+    uint32_t mNumFrames;
+    uint32_t mNumEntries;
+};
+
+static bool IsFrameHeader(
+        uint32_t header, uint32_t fixedHeader, size_t *frameSize) {
+    return (header & kMask) == (fixedHeader & kMask)
+        && GetMPEGAudioFrameSize(header, frameSize);
+}
+
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size) {
+    // 64 bit FNV-1a
+    const uint8_t *ptr = (const uint8_t *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= ptr[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// static
+sp<MP3FrameIndexSeeker> MP3FrameIndexSeeker::CreateFromSource(
+        const sp<DataSource> &source,
+        off64_t first_frame_pos, uint32_t fixed_header) {
+    char dir[PROPERTY_VALUE_MAX];
+    if (!property_get("media.stagefright.mp3-index-dir", dir, NULL)) {
+        return NULL;
+    }
+
+    // Walking a network stream would download all of it.
+    off64_t fileSize;
+    if ((source->flags() & DataSource::kIsCachingDataSource)
+            || source->getSize(&fileSize) != OK
+            || fileSize - first_frame_pos > 0xffffffffll) {
+        return NULL;
+    }
+
+    size_t frameSize;
+    int sampleRate;
+    int samplesPerFrame;
+    if (!GetMPEGAudioFrameSize(
+                fixed_header, &frameSize, &sampleRate, NULL, NULL,
+                &samplesPerFrame)) {
+        return NULL;
+    }
+
+    uint64_t key = 0xcbf29ce484222325ull;
+    key = HashBytes(key, &fileSize, sizeof(fileSize));
+    key = HashBytes(key, &first_frame_pos, sizeof(first_frame_pos));
+    key = HashBytes(key, &fixed_header, sizeof(fixed_header));
+
+    uint8_t data[kHashedBytes];
+    ssize_t n = source->readAt(first_frame_pos, data, sizeof(data));
+    if (n > 0) {
+        key = HashBytes(key, data, n);
+    }
+    off64_t tailPos = fileSize - (off64_t)sizeof(data);
+    n = source->readAt(tailPos > 0 ? tailPos : 0, data, sizeof(data));
+    if (n > 0) {
+        key = HashBytes(key, data, n);
+    }
+
+    sp<MP3FrameIndexSeeker> seeker = new MP3FrameIndexSeeker;
+    seeker->mDataSource = source;
+    seeker->mFirstFramePos = first_frame_pos;
+    seeker->mFixedHeader = fixed_header;
+    seeker->mSampleRate = sampleRate;
+    seeker->mSamplesPerFrame = samplesPerFrame;
+    seeker->mIndexPath = String8::format("%s/%016llx.mp3idx", dir, key);
+    seeker->mKey = key;
+
+    if (seeker->loadIndex()) {
+        ALOGV("loaded index of %d frames from %s",
+                seeker->mNumFrames, seeker->mIndexPath.string());
+        return seeker;
+    }
+
+    {
+        Mutex::Autolock autoLock(gWalkLock);
+        if (gNumWalks >= kMaxNumWalks) {
+            ALOGV("%d walks in progress, not indexing", gNumWalks);
+            return NULL;
+        }
+        ++gNumWalks;
+    }
+
+    // The thread holds on to the seeker until it is done.
+    seeker->incStrong(seeker.get());
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    int err = pthread_create(&thread, &attr, ThreadWrapper, seeker.get());
+    pthread_attr_destroy(&attr);
+
+    if (err != 0) {
+        seeker->decStrong(seeker.get());
+
+        Mutex::Autolock autoLock(gWalkLock);
+        --gNumWalks;
+        return NULL;
+    }
+
+    return seeker;
+}
+
+MP3FrameIndexSeeker::MP3FrameIndexSeeker()
+    : mFirstFramePos(0),
+      mFixedHeader(0),
+      mSampleRate(0),
+      mSamplesPerFrame(0),
+      mKey(0),
+      mNumFrames(0),
+      mComplete(false) {
+}
+
+MP3FrameIndexSeeker::~MP3FrameIndexSeeker() {
+}
+
+int64_t MP3FrameIndexSeeker::framesToUs(int64_t numFrames) const {
+    return numFrames * mSamplesPerFrame * 1000000ll / mSampleRate;
+}
+
+bool MP3FrameIndexSeeker::getDuration(int64_t *durationUs) {
+    Mutex::Autolock autoLock(mLock);
+    if (!mComplete) {
+        return false;
+    }
+
+    *durationUs = framesToUs(mNumFrames);
+    return true;
+}
+
+bool MP3FrameIndexSeeker::getOffsetForTime(int64_t *timeUs, off64_t *pos) {
+    Mutex::Autolock autoLock(mLock);
+    if (mOffsets.isEmpty()) {
+        return false;
+    }
+
+    int64_t frame =
+        *timeUs * mSampleRate / (1000000ll * mSamplesPerFrame);
+    if (frame < 0) {
+        frame = 0;
+    }
+
+    size_t entry = frame / kFramesPerEntry;
+    if (entry >= mOffsets.size()) {
+        if (!mComplete) {
+            return false;
+        }
+        entry = mOffsets.size() - 1;
+    }
+
+    *pos = mFirstFramePos + mOffsets.itemAt(entry);
+    *timeUs = framesToUs((int64_t)entry * kFramesPerEntry);
+
+    return true;
+}
+
+bool MP3FrameIndexSeeker::loadIndex() {
+    int fd = open(mIndexPath.string(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    IndexHeader header;
+    bool success = false;
+    if (read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)
+            && header.mMagic == kIndexMagic
+            && header.mVersion == kIndexVersion
+            && header.mKey == mKey
+            && header.mFixedHeader == mFixedHeader
+            && header.mFramesPerEntry == kFramesPerEntry
+            && header.mNumEntries
+                == (header.mNumFrames + kFramesPerEntry - 1) / kFramesPerEntry) {
+        Vector<uint32_t> offsets;
+        offsets.insertAt(0, 0, header.mNumEntries);
+        size_t size = header.mNumEntries * sizeof(uint32_t);
+        if (read(fd, offsets.editArray(), size) == (ssize_t)size) {
+            Mutex::Autolock autoLock(mLock);
+            mOffsets = offsets;
+            mNumFrames = header.mNumFrames;
+            mComplete = true;
+            success = true;
+        }
+    }
+
+    close(fd);
+
+    if (!success) {
+        ALOGW("discarding invalid index %s", mIndexPath.string());
+        unlink(mIndexPath.string());
+    }
+
+    return success;
+}
+
+void MP3FrameIndexSeeker::saveIndex() {
+    IndexHeader header;
+    header.mMagic = kIndexMagic;
+    header.mVersion = kIndexVersion;
+    header.mKey = mKey;
+    header.mFixedHeader = mFixedHeader;
+    header.mFramesPerEntry = kFramesPerEntry;
+    header.mNumFrames = mNumFrames;
+    header.mNumEntries = mOffsets.size();
+
+    // Write to a temporary file first, others must never see a partial index.
+    String8 tmpPath = mIndexPath;
+    tmpPath.append(".tmp");
+
+    int fd = open(tmpPath.string(), O_CREAT | O_TRUNC | O_WRONLY,
+            S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        ALOGW("unable to create %s: %s", tmpPath.string(), strerror(errno));
+        return;
+    }
+
+    size_t size = mOffsets.size() * sizeof(uint32_t);
+    bool success =
+        write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)
+        && write(fd, mOffsets.array(), size) == (ssize_t)size;
+    close(fd);
+
+    if (!success || rename(tmpPath.string(), mIndexPath.string()) < 0) {
+        ALOGW("unable to write %s", mIndexPath.string());
+        unlink(tmpPath.string());
+    }
+}
+
+// static
+void *MP3FrameIndexSeeker::ThreadWrapper(void *me) {
+    MP3FrameIndexSeeker *seeker = static_cast<MP3FrameIndexSeeker *>(me);
+    seeker->buildIndex();
+    seeker->decStrong(seeker);
+
+    Mutex::Autolock autoLock(gWalkLock);
+    --gNumWalks;
+    return NULL;
+}
+
+void MP3FrameIndexSeeker::buildIndex() {
+    // Read big chunks and parse the frame headers from memory, rather than
+    // reading each header on its own.
+    uint8_t *buffer = new uint8_t[kReadSize];
+    off64_t bufferPos = 0;
+    size_t bufferSize = 0;
+
+    Vector<uint32_t> newOffsets;
+    uint32_t numFrames = 0;
+    off64_t pos = mFirstFramePos;
+    size_t numSkippedBytes = 0;
+
+    for (;;) {
+        if (pos < bufferPos || pos + 4 > bufferPos + (off64_t)bufferSize) {
+            ssize_t n = mDataSource->readAt(pos, buffer, kReadSize);
+            if (n < 4) {
+                break;
+            }
+            bufferPos = pos;
+            bufferSize = n;
+
+            if (!newOffsets.isEmpty()) {
+                Mutex::Autolock autoLock(mLock);
+                mOffsets.appendVector(newOffsets);
+                newOffsets.clear();
+            }
+        }
+
+        const uint8_t *ptr = buffer + (pos - bufferPos);
+        size_t frameSize;
+        bool valid = IsFrameHeader(U32_AT(ptr), mFixedHeader, &frameSize);
+
+        if (valid && numSkippedBytes > 0) {
+            // After losing sync, also require the next frame to look right
+            // if it is at hand.
+            size_t nextFrameSize;
+            off64_t next = pos - bufferPos + frameSize;
+            if (next + 4 <= (off64_t)bufferSize
+                    && !IsFrameHeader(U32_AT(buffer + next),
+                            mFixedHeader, &nextFrameSize)) {
+                valid = false;
+            }
+        }
+
+        if (!valid) {
+            // Trailing tags or garbage, give up if there is a lot of it.
+            if (++numSkippedBytes > kReadSize) {
+                break;
+            }
+            ++pos;
+            continue;
+        }
+        numSkippedBytes = 0;
+
+        if (pos - mFirstFramePos > 0xffffffffll) {
+            break;
+        }
+
+        if (numFrames % kFramesPerEntry == 0) {
+            newOffsets.push(pos - mFirstFramePos);
+        }
+        ++numFrames;
+        pos += frameSize;
+    }
+
+    delete[] buffer;
+    buffer = NULL;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mOffsets.appendVector(newOffsets);
+        mNumFrames = numFrames;
+        mComplete = true;
+    }
+
+    ALOGV("indexed %d frames, duration %.2f secs",
+            numFrames, framesToUs(numFrames) / 1E6);
+
+    // mOffsets does not change any more.
+    saveIndex();
+}
+
+}  // namespace android
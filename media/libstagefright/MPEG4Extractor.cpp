@@ -39,6 +39,7 @@
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MediaSource.h>
 #include <media/stagefright/MetaData.h>
+#include <cutils/properties.h>
 #include <utils/String8.h>
 #ifdef ENABLE_AV_ENHANCEMENTS
 #include <QCMediaDefs.h>
@@ -171,28 +172,33 @@ struct MPEG4DataSource : public DataSource {
 
     status_t setCachedRange(off64_t offset, size_t size);
 
+    // Like setCachedRange() but keeps the ranges cached so far.
+    status_t addCachedRange(off64_t offset, size_t size);
+
 protected:
     virtual ~MPEG4DataSource();
 
 private:
+    struct CachedRange {
+        off64_t mOffset;
+        size_t mSize;
+        uint8_t *mData;
+    };
+
     Mutex mLock;
 
     sp<DataSource> mSource;
-    off64_t mCachedOffset;
-    size_t mCachedSize;
-    uint8_t *mCache;
+    Vector<CachedRange> mCachedRanges;
 
     void clearCache();
+    status_t addCachedRange_l(off64_t offset, size_t size);
 
     MPEG4DataSource(const MPEG4DataSource &);
     MPEG4DataSource &operator=(const MPEG4DataSource &);
 };
 
 MPEG4DataSource::MPEG4DataSource(const sp<DataSource> &source)
-    : mSource(source),
-      mCachedOffset(0),
-      mCachedSize(0),
-      mCache(NULL) {
+    : mSource(source) {
       #ifdef DOLBY_UDC
       #if defined (DEBUG_LOG_DDP_DECODER_EXTRA)
       ALOGE("@DDP MPEG4DataSource::MPEG4DataSource");
@@ -205,13 +211,11 @@ MPEG4DataSource::~MPEG4DataSource() {
 }
 
 void MPEG4DataSource::clearCache() {
-    if (mCache) {
-        free(mCache);
-        mCache = NULL;
+    for (size_t i = 0; i < mCachedRanges.size(); ++i) {
+        free(mCachedRanges.itemAt(i).mData);
     }
 
-    mCachedOffset = 0;
-    mCachedSize = 0;
+    mCachedRanges.clear();
 }
 
 status_t MPEG4DataSource::initCheck() const {
@@ -221,10 +225,14 @@ status_t MPEG4DataSource::initCheck() const {
 ssize_t MPEG4DataSource::readAt(off64_t offset, void *data, size_t size) {
     Mutex::Autolock autoLock(mLock);
 
-    if (offset >= mCachedOffset
-            && offset + size <= mCachedOffset + mCachedSize) {
-        memcpy(data, &mCache[offset - mCachedOffset], size);
-        return size;
+    for (size_t i = 0; i < mCachedRanges.size(); ++i) {
+        const CachedRange &range = mCachedRanges.itemAt(i);
+
+        if (offset >= range.mOffset
+                && offset + size <= range.mOffset + range.mSize) {
+            memcpy(data, &range.mData[offset - range.mOffset], size);
+            return size;
+        }
     }
 
     return mSource->readAt(offset, data, size);
@@ -243,23 +251,35 @@ status_t MPEG4DataSource::setCachedRange(off64_t offset, size_t size) {
 
     clearCache();
 
-    mCache = (uint8_t *)malloc(size);
+    return addCachedRange_l(offset, size);
+}
+
+status_t MPEG4DataSource::addCachedRange(off64_t offset, size_t size) {
+    Mutex::Autolock autoLock(mLock);
 
-    if (mCache == NULL) {
+    return addCachedRange_l(offset, size);
+}
+
+status_t MPEG4DataSource::addCachedRange_l(off64_t offset, size_t size) {
+    CachedRange range;
+    range.mOffset = offset;
+    range.mSize = size;
+    range.mData = (uint8_t *)malloc(size);
+
+    if (range.mData == NULL) {
         return -ENOMEM;
     }
 
-    mCachedOffset = offset;
-    mCachedSize = size;
-
-    ssize_t err = mSource->readAt(mCachedOffset, mCache, mCachedSize);
+    ssize_t err = mSource->readAt(range.mOffset, range.mData, range.mSize);
 
     if (err < (ssize_t)size) {
-        clearCache();
+        free(range.mData);
 
         return ERROR_IO;
     }
 
+    mCachedRanges.push(range);
+
     return OK;
 }
 
@@ -395,7 +415,14 @@ MPEG4Extractor::MPEG4Extractor(const sp<DataSource> &source)
       mLastTrack(NULL),
       mFileMetaData(new MetaData),
       mFirstSINF(NULL),
-      mIsDrm(false) {
+      mIsDrm(false),
+      mLazySampleTables(false) {
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.stagefright.mp4-lazy-stbl", value, NULL)
+            && (!strcmp(value, "1") || !strcasecmp(value, "true"))) {
+        mLazySampleTables = true;
+    }
+
       #ifdef DOLBY_UDC
       #if defined (DEBUG_LOG_DDP_DECODER_EXTRA)
       ALOGE("@DDP MPEG4Extractor::MPEG4Extractor");
@@ -495,7 +522,7 @@ sp<MetaData> MPEG4Extractor::getTrackMetaData(
                     track->meta->setInt64(
                             kKeyThumbnailTime, duration / 4);
                 }
-            } else {
+            } else if (materializeSampleTable(track) == OK) {
                 uint32_t sampleIndex;
                 uint64_t sampleTime;
                 if (track->sampleTable->findThumbnailSample(&sampleIndex) == OK
@@ -877,6 +904,16 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
             if (chunk_type == FOURCC('s', 't', 'b', 'l')) {
                 ALOGV("sampleTable chunk is %d bytes long.", (size_t)chunk_size);
 
+                if (mLastTrack == NULL) {
+                    return ERROR_MALFORMED;
+                }
+
+                mLastTrack->stblOffset = *offset;
+                mLastTrack->stblDataOffset = data_offset;
+                mLastTrack->stblSize = chunk_size;
+            }
+
+            if (chunk_type == FOURCC('s', 't', 'b', 'l') && !mLazySampleTables) {
                 if (mDataSource->flags()
                         & (DataSource::kWantsPrefetching
                             | DataSource::kIsCachingDataSource)) {
@@ -908,6 +945,10 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
                 track->includes_expensive_metadata = false;
                 track->skipTrack = false;
                 track->timescale = 0;
+                track->stblOffset = 0;
+                track->stblDataOffset = 0;
+                track->stblSize = 0;
+                track->deferredBoxes = 0;
                 track->meta->setCString(kKeyMIMEType, "application/octet-stream");
             }
 
@@ -1410,121 +1451,26 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
 
         case FOURCC('s', 't', 'c', 'o'):
         case FOURCC('c', 'o', '6', '4'):
-        {
-            status_t err =
-                mLastTrack->sampleTable->setChunkOffsetParams(
-                        chunk_type, data_offset, chunk_data_size);
-
-            if (err != OK) {
-                return err;
-            }
-
-            *offset += chunk_size;
-            break;
-        }
-
         case FOURCC('s', 't', 's', 'c'):
-        {
-            status_t err =
-                mLastTrack->sampleTable->setSampleToChunkParams(
-                        data_offset, chunk_data_size);
-
-            if (err != OK) {
-                return err;
-            }
-
-            *offset += chunk_size;
-            break;
-        }
-
         case FOURCC('s', 't', 's', 'z'):
         case FOURCC('s', 't', 'z', '2'):
+        case FOURCC('s', 't', 't', 's'):
+        case FOURCC('c', 't', 't', 's'):
+        case FOURCC('s', 't', 's', 's'):
         {
-            status_t err =
-                mLastTrack->sampleTable->setSampleSizeParams(
-                        chunk_type, data_offset, chunk_data_size);
-
-            if (err != OK) {
-                return err;
-            }
-
-            size_t max_size;
-            err = mLastTrack->sampleTable->getMaxSampleSize(&max_size);
-
-            if (err != OK) {
-                return err;
+            if (mLastTrack == NULL) {
+                return ERROR_MALFORMED;
             }
 
-            if (max_size != 0) {
-                // Assume that a given buffer only contains at most 10 chunks,
-                // each chunk originally prefixed with a 2 byte length will
-                // have a 4 byte header (0x00 0x00 0x00 0x01) after conversion,
-                // and thus will grow by 2 bytes per chunk.
-                mLastTrack->meta->setInt32(kKeyMaxInputSize, max_size + 10 * 2);
+            status_t err;
+            if (mLastTrack->sampleTable == NULL) {
+                // Lazy mode, materializeSampleTable() parses it later.
+                err = noteDeferredSampleTableBox(
+                        mLastTrack, chunk_type, data_offset, chunk_data_size);
             } else {
-                // No size was specified. Pick a conservatively large size.
-                int32_t width, height;
-                if (!mLastTrack->meta->findInt32(kKeyWidth, &width) ||
-                    !mLastTrack->meta->findInt32(kKeyHeight, &height)) {
-                    ALOGE("No width or height, assuming worst case 1080p");
-                    width = 1920;
-                    height = 1080;
-                }
-
-                const char *mime;
-                CHECK(mLastTrack->meta->findCString(kKeyMIMEType, &mime));
-                if (!strcmp(mime, MEDIA_MIMETYPE_VIDEO_AVC)) {
-                    // AVC requires compression ratio of at least 2, and uses
-                    // macroblocks
-                    max_size = ((width + 15) / 16) * ((height + 15) / 16) * 192;
-                } else {
-                    // For all other formats there is no minimum compression
-                    // ratio. Use compression ratio of 1.
-                    max_size = width * height * 3 / 2;
-                }
-                mLastTrack->meta->setInt32(kKeyMaxInputSize, max_size);
+                err = parseSampleTableBox(
+                        mLastTrack, chunk_type, data_offset, chunk_data_size);
             }
-            *offset += chunk_size;
-
-            // NOTE: setting another piece of metadata invalidates any pointers (such as the
-            // mimetype) previously obtained, so don't cache them.
-            const char *mime;
-            CHECK(mLastTrack->meta->findCString(kKeyMIMEType, &mime));
-            // Calculate average frame rate.
-            if (!strncasecmp("video/", mime, 6)) {
-                size_t nSamples = mLastTrack->sampleTable->countSamples();
-                int64_t durationUs;
-                if (mLastTrack->meta->findInt64(kKeyDuration, &durationUs)) {
-                    if (durationUs > 0) {
-                        int32_t frameRate = (nSamples * 1000000LL +
-                                    (durationUs >> 1)) / durationUs;
-                        mLastTrack->meta->setInt32(kKeyFrameRate, frameRate);
-                    }
-                }
-            }
-
-            break;
-        }
-
-        case FOURCC('s', 't', 't', 's'):
-        {
-            status_t err =
-                mLastTrack->sampleTable->setTimeToSampleParams(
-                        data_offset, chunk_data_size);
-
-            if (err != OK) {
-                return err;
-            }
-
-            *offset += chunk_size;
-            break;
-        }
-
-        case FOURCC('c', 't', 't', 's'):
-        {
-            status_t err =
-                mLastTrack->sampleTable->setCompositionTimeToSampleParams(
-                        data_offset, chunk_data_size);
 
             if (err != OK) {
                 return err;
@@ -1534,28 +1480,6 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
             break;
         }
 
-        case FOURCC('s', 't', 's', 's'):
-        {
-            // Ignore stss block for audio even if its present
-            // All audio sample are sync samples itself,
-            // self decodeable and playable.
-            // Parsing this block for audio restricts audio seek to few entries
-            // available in this block, sometimes 0, which is undesired.
-            const char *mime;
-            CHECK(mLastTrack->meta->findCString(kKeyMIMEType, &mime));
-            if (strncasecmp("audio/", mime, 6)) {
-                status_t err =
-                    mLastTrack->sampleTable->setSyncSampleParams(
-                            data_offset, chunk_data_size);
-
-                if (err != OK) {
-                    return err;
-                }
-            }
-            *offset += chunk_size;
-            break;
-        }
-
         // @xyz
         case FOURCC('\xA9', 'x', 'y', 'z'):
         {
@@ -2309,6 +2233,10 @@ sp<MediaSource> MPEG4Extractor::getTrack(size_t index) {
 
     ALOGV("getTrack called, pssh: %d", mPssh.size());
 
+    if (materializeSampleTable(track) != OK) {
+        return NULL;
+    }
+
     return new MPEG4Source(
             track->meta, mDataSource, track->timescale, track->sampleTable,
             mSidxEntries, mMoofOffset);
@@ -2335,8 +2263,292 @@ status_t MPEG4Extractor::verifyTrack(Track *track) {
         }
     }
 
+    if (track->sampleTable != NULL) {
+        if (!track->sampleTable->isValid()) {
+            // Make sure we have all the metadata we need.
+            return ERROR_MALFORMED;
+        }
+    } else if ((track->deferredBoxes & kRequiredSampleTableBoxes)
+            != kRequiredSampleTableBoxes) {
+        return ERROR_MALFORMED;
+    }
+
+    return OK;
+}
+
+status_t MPEG4Extractor::parseSampleTableBox(
+        Track *track, uint32_t type, off64_t data_offset, off64_t data_size) {
+    const sp<SampleTable> &sampleTable = track->sampleTable;
+
+    switch (type) {
+        case FOURCC('s', 't', 'c', 'o'):
+        case FOURCC('c', 'o', '6', '4'):
+            return sampleTable->setChunkOffsetParams(
+                    type, data_offset, data_size);
+
+        case FOURCC('s', 't', 's', 'c'):
+            return sampleTable->setSampleToChunkParams(
+                    data_offset, data_size);
+
+        case FOURCC('s', 't', 's', 'z'):
+        case FOURCC('s', 't', 'z', '2'):
+        {
+            status_t err = sampleTable->setSampleSizeParams(
+                    type, data_offset, data_size);
+
+            if (err != OK) {
+                return err;
+            }
+
+            size_t max_size;
+            err = sampleTable->getMaxSampleSize(&max_size);
+
+            if (err != OK) {
+                return err;
+            }
+
+            setMaxInputSize(track, max_size);
+            setFrameRate(track, sampleTable->countSamples());
+            return OK;
+        }
+
+        case FOURCC('s', 't', 't', 's'):
+            return sampleTable->setTimeToSampleParams(
+                    data_offset, data_size);
+
+        case FOURCC('c', 't', 't', 's'):
+            return sampleTable->setCompositionTimeToSampleParams(
+                    data_offset, data_size);
+
+        case FOURCC('s', 't', 's', 's'):
+        {
+            // Ignore stss block for audio even if its present
+            // All audio sample are sync samples itself,
+            // self decodeable and playable.
+            // Parsing this block for audio restricts audio seek to few entries
+            // available in this block, sometimes 0, which is undesired.
+            const char *mime;
+            CHECK(track->meta->findCString(kKeyMIMEType, &mime));
+            if (strncasecmp("audio/", mime, 6)) {
+                return sampleTable->setSyncSampleParams(
+                        data_offset, data_size);
+            }
+            return OK;
+        }
+
+        default:
+            return OK;
+    }
+}
+
+status_t MPEG4Extractor::noteDeferredSampleTableBox(
+        Track *track, uint32_t type, off64_t data_offset, off64_t data_size) {
+    switch (type) {
+        case FOURCC('s', 't', 'c', 'o'):
+        case FOURCC('c', 'o', '6', '4'):
+            track->deferredBoxes |= kHasChunkOffsets;
+            break;
+
+        case FOURCC('s', 't', 's', 'c'):
+            track->deferredBoxes |= kHasSampleToChunk;
+            break;
+
+        case FOURCC('s', 't', 't', 's'):
+            track->deferredBoxes |= kHasTimeToSample;
+            break;
+
+        case FOURCC('s', 't', 's', 'z'):
+        case FOURCC('s', 't', 'z', '2'):
+        {
+            // Only the header is read here. kKeyMaxInputSize must be
+            // set before the format is handed out, unless all samples
+            // share one size it starts out as a conservative bound that
+            // materializeSampleTable() replaces with the real maximum.
+            uint8_t header[12];
+            if (data_size < (off64_t)sizeof(header)) {
+                return ERROR_MALFORMED;
+            }
+
+            if (mDataSource->readAt(data_offset, header, sizeof(header))
+                    < (ssize_t)sizeof(header)) {
+                return ERROR_IO;
+            }
+
+            if (U32_AT(header) != 0) {
+                // Expected version = 0, flags = 0.
+                return ERROR_MALFORMED;
+            }
+
+            uint32_t maxSampleSize = 0;
+            uint32_t fieldSize = 32;
+            if (type == FOURCC('s', 't', 's', 'z')) {
+                maxSampleSize = U32_AT(&header[4]);
+            } else {
+                if ((U32_AT(&header[4]) & 0xffffff00) != 0) {
+                    // The high 24 bits are reserved and must be 0.
+                    return ERROR_MALFORMED;
+                }
+                fieldSize = header[7];
+            }
+            uint32_t numSamples = U32_AT(&header[8]);
+
+            if (fieldSize != 4 && fieldSize != 8 && fieldSize != 16
+                    && fieldSize != 32) {
+                return ERROR_MALFORMED;
+            }
+
+            if (maxSampleSize == 0 && fieldSize < 32) {
+                // The field width bounds the sizes.
+                maxSampleSize = (1u << fieldSize) - 1;
+            }
+
+            if (maxSampleSize == 0) {
+                const char *mime;
+                CHECK(track->meta->findCString(kKeyMIMEType, &mime));
+                if (!strncasecmp("audio/", mime, 6)) {
+                    maxSampleSize = kMaxDeferredAudioSampleSize;
+                }
+            }
+
+            // For video without an upper bound this picks one from the
+            // frame dimensions.
+            setMaxInputSize(track, maxSampleSize);
+            setFrameRate(track, numSamples);
+
+            track->deferredBoxes |= kHasSampleSizes;
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return OK;
+}
+
+// static
+void MPEG4Extractor::setMaxInputSize(Track *track, size_t max_size) {
+    if (max_size != 0) {
+        // Assume that a given buffer only contains at most 10 chunks,
+        // each chunk originally prefixed with a 2 byte length will
+        // have a 4 byte header (0x00 0x00 0x00 0x01) after conversion,
+        // and thus will grow by 2 bytes per chunk.
+        track->meta->setInt32(kKeyMaxInputSize, max_size + 10 * 2);
+    } else {
+        // No size was specified. Pick a conservatively large size.
+        int32_t width, height;
+        if (!track->meta->findInt32(kKeyWidth, &width) ||
+            !track->meta->findInt32(kKeyHeight, &height)) {
+            ALOGE("No width or height, assuming worst case 1080p");
+            width = 1920;
+            height = 1080;
+        }
+
+        const char *mime;
+        CHECK(track->meta->findCString(kKeyMIMEType, &mime));
+        if (!strcmp(mime, MEDIA_MIMETYPE_VIDEO_AVC)) {
+            // AVC requires compression ratio of at least 2, and uses
+            // macroblocks
+            max_size = ((width + 15) / 16) * ((height + 15) / 16) * 192;
+        } else {
+            // For all other formats there is no minimum compression
+            // ratio. Use compression ratio of 1.
+            max_size = width * height * 3 / 2;
+        }
+        track->meta->setInt32(kKeyMaxInputSize, max_size);
+    }
+}
+
+// static
+void MPEG4Extractor::setFrameRate(Track *track, size_t numSamples) {
+    // NOTE: setting another piece of metadata invalidates any pointers (such as the
+    // mimetype) previously obtained, so don't cache them.
+    const char *mime;
+    CHECK(track->meta->findCString(kKeyMIMEType, &mime));
+    // Calculate average frame rate.
+    if (!strncasecmp("video/", mime, 6)) {
+        int64_t durationUs;
+        if (track->meta->findInt64(kKeyDuration, &durationUs)) {
+            if (durationUs > 0) {
+                int32_t frameRate = (numSamples * 1000000LL +
+                            (durationUs >> 1)) / durationUs;
+                track->meta->setInt32(kKeyFrameRate, frameRate);
+            }
+        }
+    }
+}
+
+status_t MPEG4Extractor::materializeSampleTable(Track *track) {
+    if (track->sampleTable != NULL) {
+        return OK;
+    }
+
+    if (track->stblSize == 0) {
+        return ERROR_MALFORMED;
+    }
+
+    ALOGV("materializing sampleTable at %lld, %lld bytes",
+          track->stblOffset, track->stblSize);
+
+    if (mSampleTableSource == NULL
+            && (mDataSource->flags()
+                & (DataSource::kWantsPrefetching
+                    | DataSource::kIsCachingDataSource))) {
+        // A single wrapper holds the tables of every track materialized
+        // so far.
+        mSampleTableSource = new MPEG4DataSource(mDataSource);
+        mDataSource = mSampleTableSource;
+    }
+
+    if (mSampleTableSource != NULL) {
+        // Not fatal, the table is then read through the source.
+        mSampleTableSource->addCachedRange(
+                track->stblOffset, track->stblSize);
+    }
+
+    track->sampleTable = new SampleTable(mDataSource);
+
+    off64_t offset = track->stblDataOffset;
+    off64_t stop_offset = track->stblOffset + track->stblSize;
+    while (offset < stop_offset) {
+        uint32_t hdr[2];
+        if (mDataSource->readAt(offset, hdr, 8) < 8) {
+            track->sampleTable.clear();
+            return ERROR_IO;
+        }
+        uint64_t chunk_size = ntohl(hdr[0]);
+        uint32_t chunk_type = ntohl(hdr[1]);
+        off64_t data_offset = offset + 8;
+
+        if (chunk_size == 1) {
+            if (mDataSource->readAt(offset + 8, &chunk_size, 8) < 8) {
+                track->sampleTable.clear();
+                return ERROR_IO;
+            }
+            chunk_size = ntoh64(chunk_size);
+            data_offset += 8;
+        }
+
+        if (chunk_size < (uint64_t)(data_offset - offset)
+                || chunk_size > (uint64_t)(stop_offset - offset)) {
+            track->sampleTable.clear();
+            return ERROR_MALFORMED;
+        }
+
+        status_t err = parseSampleTableBox(
+                track, chunk_type, data_offset,
+                offset + chunk_size - data_offset);
+
+        if (err != OK) {
+            track->sampleTable.clear();
+            return err;
+        }
+
+        offset += chunk_size;
+    }
+
     if (!track->sampleTable->isValid()) {
-        // Make sure we have all the metadata we need.
+        track->sampleTable.clear();
         return ERROR_MALFORMED;
     }
 
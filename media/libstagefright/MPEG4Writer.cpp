@@ -35,10 +35,17 @@
 #include <cutils/properties.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 
+#ifdef HAVE_FALLOCATE
+#include <linux/falloc.h>
+#endif
+
 #include "include/ESDS.h"
+#include "include/avc_utils.h"
 #include "include/ExtendedUtils.h"
 
 namespace android {
@@ -52,6 +59,34 @@ static const uint8_t kNalUnitTypeSeqParamSet = 0x07;
 static const uint8_t kNalUnitTypePicParamSet = 0x08;
 static const int64_t kInitialDelayTimeUs     = 700000LL;
 
+// Size of the staging buffer for sample data, rounded up to a multiple of
+// the file system block size.
+static const size_t kWriteBufferSize        = 256 * 1024;
+
+// The file is preallocated this far ahead of the write position, in
+// steps of kPreallocateStepBytes.
+static const off64_t kPreallocateAheadBytes = 4 * 1024 * 1024;
+static const off64_t kPreallocateStepBytes  = 8 * 1024 * 1024;
+
+// Upper bound on the number of iovecs passed to a single writev().
+static const int kMaxIoVecs                 = 64;
+
+// Fragmented output holds back the first fragments until every track has
+// one, but no longer than this much media time or data.
+static const int64_t kMaxInitSegmentDelayUs = 20000000LL;
+static const size_t kMaxInitSegmentDelayBytes = 16 * 1024 * 1024;
+
+// Conversions between the network byte order sample table values and
+// host order, used to delta encode spilled sample tables.
+static inline uint64_t TableValueToHost(uint32_t x) { return ntohl(x); }
+static inline uint64_t TableValueToHost(off64_t x) { return ntoh64(x); }
+static inline void TableValueFromHost(uint64_t x, uint32_t *value) {
+    *value = htonl(x);
+}
+static inline void TableValueFromHost(uint64_t x, off64_t *value) {
+    *value = hton64(x);
+}
+
 class MPEG4Writer::Track {
 public:
     Track(MPEG4Writer *owner, const sp<MediaSource> &source, size_t trackId);
@@ -72,6 +107,17 @@ public:
     bool isMPEG4() const { return mIsMPEG4; }
     void addChunkOffset(off64_t offset);
     int32_t getTrackId() const { return mTrackId; }
+
+    // Fragmented output
+    off64_t writeTrafBox(const Chunk &chunk);
+    void addFragmentIndexEntry(
+            int64_t timeTicks, int64_t moovStartTimeUs, off64_t moofOffset);
+    void writeTrexBox();
+    void writeTfraBox();
+
+    // Left out of a fragmented file, set by the writer thread.
+    void setExcluded() { mExcluded = true; }
+    bool isExcluded() const { return mExcluded; }
     status_t dump(int fd, const Vector<String16>& args) const;
 
 private:
@@ -81,10 +127,19 @@ private:
     };
 
     // A helper class to handle faster write box with table entries
+    //
+    // Once more than kMaxElementsInMemory elements are held, all elements
+    // but the first are delta encoded and spilled to the owner's temporary
+    // file (if sample table spilling is enabled), and read back by write().
+    // The first element stays in memory so that set() and get() keep
+    // working on the leading entries.
     template<class TYPE>
     struct ListTableEntries {
-        ListTableEntries(uint32_t elementCapacity, uint32_t entryCapacity)
-            : mElementCapacity(elementCapacity),
+        ListTableEntries(
+                MPEG4Writer *owner,
+                uint32_t elementCapacity, uint32_t entryCapacity)
+            : mOwner(owner),
+            mElementCapacity(elementCapacity),
             mEntryCapacity(entryCapacity),
             mTotalNumTableEntries(0),
             mNumValuesInCurrEntry(0),
@@ -108,6 +163,8 @@ private:
         // @arg pos location the value must be in.
         void set(const TYPE& value, uint32_t pos) {
             CHECK_LT(pos, mTotalNumTableEntries * mEntryCapacity);
+            CHECK(mSpilledRuns.empty()
+                    || pos < mElementCapacity * mEntryCapacity);
 
             typename List<TYPE *>::iterator it = mTableEntryList.begin();
             uint32_t iterations = (pos / (mElementCapacity * mEntryCapacity));
@@ -129,6 +186,8 @@ private:
             if (pos >= mTotalNumTableEntries * mEntryCapacity) {
                 return false;
             }
+            CHECK(mSpilledRuns.empty()
+                    || pos < mElementCapacity * mEntryCapacity);
 
             typename List<TYPE *>::iterator it = mTableEntryList.begin();
             uint32_t iterations = (pos / (mElementCapacity * mEntryCapacity));
@@ -150,6 +209,9 @@ private:
             uint32_t nEntries = mTotalNumTableEntries % mElementCapacity;
             uint32_t nValues  = mNumValuesInCurrEntry % mEntryCapacity;
             if (nEntries == 0 && nValues == 0) {
+                if (mTableEntryList.size() >= kMaxElementsInMemory) {
+                    spill();
+                }
                 mCurrTableEntriesElement = new TYPE[mEntryCapacity * mElementCapacity];
                 CHECK(mCurrTableEntriesElement != NULL);
                 mTableEntryList.push_back(mCurrTableEntriesElement);
@@ -173,8 +235,11 @@ private:
             CHECK_EQ(mNumValuesInCurrEntry % mEntryCapacity, 0);
             uint32_t nEntries = mTotalNumTableEntries;
             writer->writeInt32(nEntries);
-            for (typename List<TYPE *>::iterator it = mTableEntryList.begin();
-                it != mTableEntryList.end(); ++it) {
+
+            // The first element, then the spilled ones, then the rest.
+            typename List<TYPE *>::iterator it = mTableEntryList.begin();
+            bool isFirstElement = true;
+            while (it != mTableEntryList.end()) {
                 CHECK_GT(nEntries, 0);
                 if (nEntries >= mElementCapacity) {
                     writer->write(*it, sizeof(TYPE) * mEntryCapacity, mElementCapacity);
@@ -183,6 +248,12 @@ private:
                     writer->write(*it, sizeof(TYPE) * mEntryCapacity, nEntries);
                     break;
                 }
+                ++it;
+
+                if (isFirstElement) {
+                    isFirstElement = false;
+                    nEntries -= writeSpilledRuns(writer);
+                }
             }
         }
 
@@ -190,12 +261,119 @@ private:
         uint32_t count() const { return mTotalNumTableEntries; }
 
     private:
+        enum {
+            kMaxElementsInMemory = 32,
+        };
+
+        // A run of elements moved to the owner's spill file.
+        struct SpilledRun {
+            off64_t  mOffset;       // in the spill file
+            size_t   mSize;         // encoded size in bytes
+            uint32_t mNumEntries;
+        };
+
+        MPEG4Writer      *mOwner;
         uint32_t         mElementCapacity;  // # entries in an element
         uint32_t         mEntryCapacity;    // # of values in each entry
         uint32_t         mTotalNumTableEntries;
         uint32_t         mNumValuesInCurrEntry;  // up to mEntryCapacity
         TYPE             *mCurrTableEntriesElement;
         mutable List<TYPE *>     mTableEntryList;
+        List<SpilledRun> mSpilledRuns;
+
+        // Move all the (full) elements but the first to the spill file.
+        // Each value is stored as the zigzag varint encoded difference to
+        // the value at the same position of the previous entry, which
+        // takes a byte or two for the monotonic or slowly changing values
+        // found in sample tables.
+        void spill() {
+            if (mTableEntryList.size() < 2 || !mOwner->canSpillSampleTables()) {
+                return;
+            }
+
+            typename List<TYPE *>::iterator it = mTableEntryList.begin();
+            ++it;
+
+            Vector<uint8_t> encoded;
+            encoded.setCapacity(
+                    2 * (mTableEntryList.size() - 1)
+                      * mElementCapacity * mEntryCapacity);
+            uint64_t prev[3] = { 0, 0, 0 };
+            CHECK_LE(mEntryCapacity, sizeof(prev) / sizeof(prev[0]));
+            uint32_t numEntries = 0;
+            for (; it != mTableEntryList.end(); ++it) {
+                const TYPE *values = *it;
+                for (uint32_t i = 0; i < mElementCapacity; ++i) {
+                    for (uint32_t j = 0; j < mEntryCapacity; ++j) {
+                        uint64_t value = TableValueToHost(*values++);
+                        int64_t delta = (int64_t)(value - prev[j]);
+                        uint64_t zigzag =
+                            ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+                        prev[j] = value;
+                        while (zigzag >= 0x80) {
+                            encoded.push((zigzag & 0x7f) | 0x80);
+                            zigzag >>= 7;
+                        }
+                        encoded.push(zigzag);
+                    }
+                }
+                numEntries += mElementCapacity;
+            }
+
+            SpilledRun run;
+            run.mSize = encoded.size();
+            run.mNumEntries = numEntries;
+            run.mOffset = mOwner->spillSampleTableData(encoded.array(), run.mSize);
+            if (run.mOffset < 0) {
+                // Keep the elements in memory.
+                return;
+            }
+            mSpilledRuns.push_back(run);
+
+            it = mTableEntryList.begin();
+            ++it;
+            while (it != mTableEntryList.end()) {
+                delete[] (*it);
+                it = mTableEntryList.erase(it);
+            }
+        }
+
+        // Decode the spilled runs and write them out in order.
+        // @return the number of entries written.
+        uint32_t writeSpilledRuns(MPEG4Writer *writer) const {
+            uint32_t nEntries = 0;
+            TYPE *values = new TYPE[mEntryCapacity * mElementCapacity];
+            for (typename List<SpilledRun>::const_iterator it = mSpilledRuns.begin();
+                 it != mSpilledRuns.end(); ++it) {
+                uint8_t *encoded = new uint8_t[it->mSize];
+                mOwner->readSpilledSampleTableData(it->mOffset, encoded, it->mSize);
+
+                const uint8_t *ptr = encoded;
+                uint64_t prev[3] = { 0, 0, 0 };
+                for (uint32_t n = 0; n < it->mNumEntries; n += mElementCapacity) {
+                    TYPE *out = values;
+                    for (uint32_t i = 0; i < mElementCapacity; ++i) {
+                        for (uint32_t j = 0; j < mEntryCapacity; ++j) {
+                            uint64_t zigzag = 0;
+                            unsigned shift = 0;
+                            do {
+                                CHECK(ptr < encoded + it->mSize);
+                                zigzag |= (uint64_t)(*ptr & 0x7f) << shift;
+                                shift += 7;
+                            } while (*ptr++ & 0x80);
+                            int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+                            prev[j] += delta;
+                            TableValueFromHost(prev[j], out++);
+                        }
+                    }
+                    writer->write(values, sizeof(TYPE) * mEntryCapacity, mElementCapacity);
+                }
+                nEntries += it->mNumEntries;
+                delete[] encoded;
+            }
+            delete[] values;
+            return nEntries;
+        }
 
         DISALLOW_EVIL_CONSTRUCTORS(ListTableEntries);
     };
@@ -225,6 +403,22 @@ private:
 
     List<MediaBuffer *> mChunkSamples;
 
+    uint32_t mNumSamples;
+    uint32_t mNumSyncSamples;
+
+    // Fragmented output: the samples in mChunkSamples make up the pending
+    // fragment, and no sample tables are kept.
+    Vector<FragmentSampleInfo> mFragmentSampleInfos;
+    int64_t mFragmentStartTimeUs;
+    int64_t mFragmentStartTimeTicks;
+    int64_t mLastDecodeTimeTicks;
+
+    struct FragmentIndexEntry {
+        int64_t mTimeTicks;
+        off64_t mMoofOffset;
+    };
+    List<FragmentIndexEntry> mFragmentIndex;  // for the 'tfra' box
+
     bool                mSamplesHaveSameSize;
     ListTableEntries<uint32_t> *mStszTableEntries;
 
@@ -258,6 +452,7 @@ private:
     bool mTrackingProgressStatus;
 
     bool mReachedEOS;
+    bool mExcluded;
     int64_t mStartTimestampUs;
     int64_t mStartTimeRealUs;
     int64_t mFirstSampleTimeRealUs;
@@ -267,7 +462,7 @@ private:
     // Update the audio track's drift information.
     void updateDriftTime(const sp<MetaData>& meta);
 
-    int32_t getStartTimeOffsetScaledTime() const;
+    int32_t getStartTimeOffsetScaledTime(int64_t moovStartTimeUs) const;
 
     static void *ThreadWrapper(void *me);
     status_t threadEntry();
@@ -297,6 +492,10 @@ private:
     int32_t mHFRRatio;
 
     void updateTrackSizeEstimate();
+    void addFragmentSample(
+            MediaBuffer *sample, uint32_t sampleSize, int64_t timestampUs,
+            int32_t cttsOffsetTicks, bool isSync);
+    void bufferFragment();
     void addOneStscTableEntry(size_t chunkId, size_t sampleId);
     void addOneStssTableEntry(size_t sampleId);
 
@@ -354,7 +553,21 @@ MPEG4Writer::MPEG4Writer(const char *filename)
       mLongitudex10000(0),
       mAreGeoTagsAvailable(false),
       mStartTimeOffsetMs(-1),
-      mHFRRatio(1) {
+      mHFRRatio(1),
+      mFragmented(false),
+      mFragmentDurationUs(0),
+      mInitSegmentWritten(false),
+      mFragmentSequenceNumber(0),
+      mWriteBuffer(NULL),
+      mWriteBufferSize(0),
+      mWriteBufferLength(0),
+      mBlockSize(0),
+      mPreallocated(false),
+      mPreallocatedEnd(0),
+      mPreallocationLimit(0),
+      mSpillFd(-1),
+      mSpillDisabled(false),
+      mSpillOffset(0) {
 
     mFd = open(filename, O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
     if (mFd >= 0) {
@@ -380,7 +593,21 @@ MPEG4Writer::MPEG4Writer(int fd)
       mLongitudex10000(0),
       mAreGeoTagsAvailable(false),
       mStartTimeOffsetMs(-1),
-      mHFRRatio(1) {
+      mHFRRatio(1),
+      mFragmented(false),
+      mFragmentDurationUs(0),
+      mInitSegmentWritten(false),
+      mFragmentSequenceNumber(0),
+      mWriteBuffer(NULL),
+      mWriteBufferSize(0),
+      mWriteBufferLength(0),
+      mBlockSize(0),
+      mPreallocated(false),
+      mPreallocatedEnd(0),
+      mPreallocationLimit(0),
+      mSpillFd(-1),
+      mSpillDisabled(false),
+      mSpillOffset(0) {
 }
 
 MPEG4Writer::~MPEG4Writer() {
@@ -422,7 +649,7 @@ status_t MPEG4Writer::Track::dump(
     snprintf(buffer, SIZE, "       reached EOS: %s\n",
             mReachedEOS? "true": "false");
     result.append(buffer);
-    snprintf(buffer, SIZE, "       frames encoded : %d\n", mStszTableEntries->count());
+    snprintf(buffer, SIZE, "       frames encoded : %d\n", mNumSamples);
     result.append(buffer);
     snprintf(buffer, SIZE, "       duration encoded : %lld us\n", mTrackDurationUs);
     result.append(buffer);
@@ -634,6 +861,18 @@ status_t MPEG4Writer::start(MetaData *param) {
 
     mStartTimestampUs = -1;
 
+    int64_t fragmentDurationUs;
+    if (param &&
+        param->findInt64(kKeyFragmentDurationUs, &fragmentDurationUs) &&
+        fragmentDurationUs > 0) {
+        mFragmented = true;
+        mFragmentDurationUs = fragmentDurationUs;
+        mInitSegmentWritten = false;
+        mFragmentSequenceNumber = 0;
+        ALOGI("Writing fragmented file, fragment duration: %lld us",
+                mFragmentDurationUs);
+    }
+
     if (!param ||
         !param->findInt32(kKeyTimeScale, &mTimeScale)) {
         mTimeScale = 1000;
@@ -648,7 +887,8 @@ status_t MPEG4Writer::start(MetaData *param) {
      * whether the actual recorded file is streamable or not.
      */
     mStreamableFile =
-        (mMaxFileSizeLimitBytes != 0 &&
+        (!mFragmented &&
+         mMaxFileSizeLimitBytes != 0 &&
          mMaxFileSizeLimitBytes >= kMinStreamableFileSizeInBytes);
 
     /*
@@ -703,22 +943,35 @@ status_t MPEG4Writer::start(MetaData *param) {
         mEstimatedMoovBoxSize = estimateMoovBoxSize(bitRate);
     }
     CHECK_GE(mEstimatedMoovBoxSize, 8);
-    if (mStreamableFile) {
-        // Reserve a 'free' box only for streamable file
-        lseek64(mFd, mFreeBoxOffset, SEEK_SET);
-        writeInt32(mEstimatedMoovBoxSize);
-        write("free", 4);
-        mMdatOffset = mFreeBoxOffset + mEstimatedMoovBoxSize;
-    } else {
+    if (mFragmented) {
+        // The init segment follows once the codec specific data of all
+        // tracks is known, each fragment carries its own mdat.
         mMdatOffset = mOffset;
+    } else {
+        if (mStreamableFile) {
+            // Reserve a 'free' box only for streamable file
+            lseek64(mFd, mFreeBoxOffset, SEEK_SET);
+            writeInt32(mEstimatedMoovBoxSize);
+            write("free", 4);
+            mMdatOffset = mFreeBoxOffset + mEstimatedMoovBoxSize;
+        } else {
+            mMdatOffset = mOffset;
+        }
+
+        mOffset = mMdatOffset;
+        lseek64(mFd, mMdatOffset, SEEK_SET);
+        if (mUse32BitOffset) {
+            write("????mdat", 8);
+        } else {
+            write("\x00\x00\x00\x01mdat????????", 16);
+        }
     }
 
-    mOffset = mMdatOffset;
-    lseek64(mFd, mMdatOffset, SEEK_SET);
-    if (mUse32BitOffset) {
-        write("????mdat", 8);
-    } else {
-        write("\x00\x00\x00\x01mdat????????", 16);
+    allocateWriteBuffer();
+    if (mIsFileSizeLimitExplicitlyRequested) {
+        mPreallocationLimit = mMaxFileSizeLimitBytes;
+        mPreallocatedEnd = 0;
+        preallocateFile_l(mOffset);
     }
 
     status_t err = startWriterThread();
@@ -827,6 +1080,22 @@ void MPEG4Writer::writeCompositionMatrix(int degrees) {
 }
 
 void MPEG4Writer::release() {
+    flushWriteBuffer_l();
+    free(mWriteBuffer);
+    mWriteBuffer = NULL;
+    mWriteBufferSize = 0;
+
+    if (mPreallocated) {
+        // Give back the preallocated space beyond what was written.
+        off64_t size = lseek64(mFd, 0, SEEK_END);
+        if (size >= 0) {
+            ftruncate64(mFd, size);
+        }
+        mPreallocated = false;
+    }
+
+    closeSpillFile();
+
     close(mFd);
     mFd = -1;
     mInitCheck = NO_INIT;
@@ -879,6 +1148,18 @@ status_t MPEG4Writer::reset() {
         return err;
     }
 
+    if (mFragmented) {
+        // The init segment and all fragments are written already.
+        if (mInitSegmentWritten) {
+            writeMfraBox();
+        }
+        CHECK(mBoxes.empty());
+        release();
+        return err;
+    }
+
+    flushWriteBuffer_l();
+
     // Fix up the size of the 'mdat' chunk.
     if (mUse32BitOffset) {
         lseek64(mFd, mMdatOffset, SEEK_SET);
@@ -982,11 +1263,45 @@ void MPEG4Writer::writeMoovBox(int64_t durationUs) {
     int32_t id = 1;
     for (List<Track *>::iterator it = mTracks.begin();
         it != mTracks.end(); ++it, ++id) {
+        if ((*it)->isExcluded()) {
+            continue;
+        }
         (*it)->writeTrackHeader(mUse32BitOffset);
     }
+    if (mFragmented) {
+        writeMvexBox();
+    }
     endBox();  // moov
 }
 
+void MPEG4Writer::writeMvexBox() {
+    beginBox("mvex");
+    for (List<Track *>::iterator it = mTracks.begin();
+        it != mTracks.end(); ++it) {
+        if (!(*it)->isExcluded()) {
+            (*it)->writeTrexBox();
+        }
+    }
+    endBox();  // mvex
+}
+
+void MPEG4Writer::writeMfraBox() {
+    off64_t mfraOffset = mOffset;
+    beginBox("mfra");
+    for (List<Track *>::iterator it = mTracks.begin();
+        it != mTracks.end(); ++it) {
+        if (!(*it)->isExcluded()) {
+            (*it)->writeTfraBox();
+        }
+    }
+    beginBox("mfro");
+    writeInt32(0);  // version=0, flags=0
+    // Size of the enclosing mfra box, including the rest of this box
+    writeInt32(mOffset + 4 - mfraOffset);
+    endBox();  // mfro
+    endBox();  // mfra
+}
+
 void MPEG4Writer::writeFtypBox(MetaData *param) {
     beginBox("ftyp");
 
@@ -1001,6 +1316,9 @@ void MPEG4Writer::writeFtypBox(MetaData *param) {
     writeInt32(0);
     writeFourcc("isom");
     writeFourcc("3gp4");
+    if (mFragmented) {
+        writeFourcc("iso5");
+    }
     endBox();
 }
 
@@ -1050,21 +1368,60 @@ void MPEG4Writer::unlock() {
 off64_t MPEG4Writer::addSample_l(MediaBuffer *buffer) {
     off64_t old_offset = mOffset;
 
-    ::write(mFd,
-          (const uint8_t *)buffer->data() + buffer->range_offset(),
-          buffer->range_length());
-
-    mOffset += buffer->range_length();
+    struct iovec iov;
+    iov.iov_base = (uint8_t *)buffer->data() + buffer->range_offset();
+    iov.iov_len = buffer->range_length();
+    writeSampleData_l(&iov, 1);
 
     return old_offset;
 }
 
+// Writes all of the given iovecs to "fd", resuming after partial writes.
+static void WriteFully(int fd, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t n = writev(fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ALOGE("writev failed: %s", strerror(errno));
+            return;
+        }
+
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+// Copies the bytes of the given iovecs, skipping the first "skip" of them,
+// to "dst".
+static void CopyFromIoVecs(
+        const struct iovec *iov, int iovcnt, size_t skip, uint8_t *dst) {
+    for (int i = 0; i < iovcnt; ++i) {
+        size_t len = iov[i].iov_len;
+        if (skip >= len) {
+            skip -= len;
+            continue;
+        }
+        memcpy(dst, (const uint8_t *)iov[i].iov_base + skip, len - skip);
+        dst += len - skip;
+        skip = 0;
+    }
+}
+
+#if defined (OMAP_ENHANCEMENT) && defined (TARGET_OMAP3)
 static void StripStartcode(MediaBuffer *buffer) {
     if (buffer->range_length() < 4) {
         return;
     }
 
-#if defined (OMAP_ENHANCEMENT) && defined (TARGET_OMAP3)
     uint8_t *data =
         (uint8_t *)buffer->data() + buffer->range_offset();
     size_t size = buffer->range_length();
@@ -1101,54 +1458,301 @@ static void StripStartcode(MediaBuffer *buffer) {
         foundStartData[2] = (nal_size >> 8) & 0xFF;
         foundStartData[3] = nal_size & 0xFF;
     }
+}
 #else
-    const uint8_t *ptr =
+// Writes the big-endian length prefix for a NAL unit of the given length
+// to "prefix" and returns its size.
+static size_t MakeNalLengthPrefix(
+        size_t length, bool use4ByteNalLength, uint8_t *prefix) {
+    if (use4ByteNalLength) {
+        prefix[0] = length >> 24;
+        prefix[1] = (length >> 16) & 0xff;
+        prefix[2] = (length >> 8) & 0xff;
+        prefix[3] = length & 0xff;
+        return 4;
+    }
+
+    CHECK_LT(length, 65536);
+    prefix[0] = length >> 8;
+    prefix[1] = length & 0xff;
+    return 2;
+}
+
+// Copies the AVC access unit in "buffer", either a single NAL unit or NAL
+// units each behind a startcode, to a new buffer that holds each NAL unit
+// behind its length prefix instead, the way the sample is stored.
+static MediaBuffer *MakeLengthPrefixedCopy(
+        MediaBuffer *buffer, bool use4ByteNalLength) {
+    const uint8_t *data =
         (const uint8_t *)buffer->data() + buffer->range_offset();
+    size_t size = buffer->range_length();
+    size_t prefixSize = use4ByteNalLength ? 4 : 2;
+
+    bool hasStartcode =
+        (size >= 3 && !memcmp(data, "\x00\x00\x01", 3))
+        || (size >= 4 && !memcmp(data, "\x00\x00\x00\x01", 4));
 
-    if (!memcmp(ptr, "\x00\x00\x00\x01", 4)) {
-        buffer->set_range(
-                buffer->range_offset() + 4, buffer->range_length() - 4);
+    if (!hasStartcode) {
+        MediaBuffer *copy = new MediaBuffer(prefixSize + size);
+        uint8_t *dst = (uint8_t *)copy->data();
+        MakeNalLengthPrefix(size, use4ByteNalLength, dst);
+        memcpy(dst + prefixSize, data, size);
+        return copy;
+    }
+
+    const uint8_t *nalStart;
+    size_t nalSize;
+
+    size_t copySize = 0;
+    const uint8_t *tmp = data;
+    size_t tmpSize = size;
+    while (getNextNALUnit(&tmp, &tmpSize, &nalStart, &nalSize, true) == OK) {
+        if (nalSize > 0) {
+            copySize += prefixSize + nalSize;
+        }
     }
+
+    MediaBuffer *copy = new MediaBuffer(copySize);
+    uint8_t *dst = (uint8_t *)copy->data();
+    while (getNextNALUnit(&data, &size, &nalStart, &nalSize, true) == OK) {
+        if (nalSize > 0) {
+            dst += MakeNalLengthPrefix(nalSize, use4ByteNalLength, dst);
+            memcpy(dst, nalStart, nalSize);
+            dst += nalSize;
+        }
+    }
+
+    return copy;
+}
 #endif
+
+void MPEG4Writer::allocateWriteBuffer() {
+    struct stat st;
+    mBlockSize = 4096;
+    if (fstat(mFd, &st) == 0 && st.st_blksize > 0) {
+        mBlockSize = st.st_blksize;
+    }
+
+    // At least two blocks, so that a flush always makes progress.
+    mWriteBufferSize =
+        ((kWriteBufferSize + mBlockSize - 1) / mBlockSize) * mBlockSize;
+    if (mWriteBufferSize < 2 * mBlockSize) {
+        mWriteBufferSize = 2 * mBlockSize;
+    }
+
+    mWriteBufferLength = 0;
+    mWriteBuffer = (uint8_t *)malloc(mWriteBufferSize);
+    if (mWriteBuffer == NULL) {
+        // Not fatal, samples are written straight through instead.
+        ALOGW("Unable to allocate %d bytes of write buffer", mWriteBufferSize);
+        mWriteBufferSize = 0;
+    }
+    ALOGV("block size %d, write buffer size %d", mBlockSize, mWriteBufferSize);
 }
 
-off64_t MPEG4Writer::addLengthPrefixedSample_l(MediaBuffer *buffer) {
-    off64_t old_offset = mOffset;
+void MPEG4Writer::preallocateFile_l(off64_t offset) {
+#ifdef HAVE_FALLOCATE
+    // Reserve the space a few MB ahead of the writes so that the file
+    // system does not have to find and zero new blocks while recording,
+    // without tying up the whole size limit. The file size is left
+    // alone; the unused part is given back in release().
+    if (mPreallocatedEnd >= mPreallocationLimit
+            || offset + kPreallocateAheadBytes <= mPreallocatedEnd) {
+        return;
+    }
+
+    off64_t end = offset + kPreallocateAheadBytes + kPreallocateStepBytes;
+    if (end > mPreallocationLimit) {
+        end = mPreallocationLimit;
+    }
 
-    size_t length = buffer->range_length();
+    if (fallocate64(mFd, FALLOC_FL_KEEP_SIZE,
+                mPreallocatedEnd, end - mPreallocatedEnd) == 0) {
+        mPreallocated = true;
+        mPreallocatedEnd = end;
+    } else {
+        ALOGV("fallocate up to %lld failed: %s", end, strerror(errno));
 
-    if (mUse4ByteNalLength) {
-        uint8_t x = length >> 24;
-        ::write(mFd, &x, 1);
-        x = (length >> 16) & 0xff;
-        ::write(mFd, &x, 1);
-        x = (length >> 8) & 0xff;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
+        // Don't try again.
+        mPreallocationLimit = 0;
+    }
+#else
+    (void)offset;
+#endif
+}
+
+bool MPEG4Writer::canSpillSampleTables() {
+    Mutex::Autolock autoLock(mSpillLock);
+    if (mSpillDisabled) {
+        return false;
+    }
+    if (mSpillFd >= 0) {
+        return true;
+    }
+
+    // Only try once per recording.
+    mSpillDisabled = true;
+
+    char dir[PROPERTY_VALUE_MAX];
+    if (!property_get("media.stagefright.mp4-spill-dir", dir, NULL)) {
+        return false;
+    }
+
+    String8 path(dir);
+    path.appendPath("mp4tables-XXXXXX");
+    int fd = mkstemp(path.lockBuffer(path.size()));
+    path.unlockBuffer();
+    if (fd < 0) {
+        ALOGW("Unable to create sample table spill file in %s: %s",
+                dir, strerror(errno));
+        return false;
+    }
+
+    // Nobody else needs to see the file, it goes away with the fd.
+    unlink(path.string());
+
+    mSpillFd = fd;
+    mSpillOffset = 0;
+    mSpillDisabled = false;
+    ALOGV("Spilling sample tables to %s", path.string());
+    return true;
+}
+
+off64_t MPEG4Writer::spillSampleTableData(const void *data, size_t size) {
+    Mutex::Autolock autoLock(mSpillLock);
+    if (mSpillFd < 0 || mSpillDisabled) {
+        return -1;
+    }
+
+    off64_t offset = mSpillOffset;
+    const uint8_t *ptr = (const uint8_t *)data;
+    size_t remaining = size;
+    while (remaining > 0) {
+        ssize_t n = pwrite64(mSpillFd, ptr, remaining, offset + (size - remaining));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // Most likely out of space, keep the tables in memory from now
+            // on. The runs spilled so far are still read back from mSpillFd.
+            ALOGW("Unable to spill sample table data: %s", strerror(errno));
+            mSpillDisabled = true;
+            return -1;
+        }
+        ptr += n;
+        remaining -= n;
+    }
+
+    mSpillOffset += size;
+    return offset;
+}
+
+void MPEG4Writer::readSpilledSampleTableData(
+        off64_t offset, void *data, size_t size) {
+    Mutex::Autolock autoLock(mSpillLock);
+    CHECK_GE(mSpillFd, 0);
+
+    uint8_t *ptr = (uint8_t *)data;
+    size_t remaining = size;
+    while (remaining > 0) {
+        ssize_t n = pread64(mSpillFd, ptr, remaining, offset + (size - remaining));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        CHECK_GT(n, 0);
+        ptr += n;
+        remaining -= n;
+    }
+}
+
+void MPEG4Writer::closeSpillFile() {
+    Mutex::Autolock autoLock(mSpillLock);
+    if (mSpillFd >= 0) {
+        close(mSpillFd);
+        mSpillFd = -1;
+    }
+    mSpillOffset = 0;
+}
+
+void MPEG4Writer::writeSampleData_l(const struct iovec *iov, int iovcnt) {
+    CHECK_LE(iovcnt, kMaxIoVecs);
+
+    size_t bytes = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        bytes += iov[i].iov_len;
+    }
+
+    preallocateFile_l(mOffset + bytes);
+
+    if (mWriteBuffer == NULL) {
+        struct iovec out[kMaxIoVecs];
+        memcpy(out, iov, iovcnt * sizeof(struct iovec));
+        WriteFully(mFd, out, iovcnt);
+        mOffset += bytes;
+        return;
+    }
 
-        ::write(mFd,
-              (const uint8_t *)buffer->data() + buffer->range_offset(),
-              length);
+    if (mWriteBufferLength + bytes <= mWriteBufferSize) {
+        CopyFromIoVecs(iov, iovcnt, 0, mWriteBuffer + mWriteBufferLength);
+        mWriteBufferLength += bytes;
+        mOffset += bytes;
+        return;
+    }
 
-        mOffset += length + 4;
+    // Write the staged data followed by the new data up to the last block
+    // boundary of the file in a single writev(), stage the rest. Large
+    // samples thus go to the file without being copied.
+    off64_t start = mOffset - mWriteBufferLength;
+    off64_t end = mOffset + bytes;
+    size_t writeSize = (end - end % mBlockSize) - start;
+
+    if (writeSize <= mWriteBufferLength) {
+        // Only a part of the staged data ends on a block boundary.
+        ::write(mFd, mWriteBuffer, writeSize);
+        mWriteBufferLength -= writeSize;
+        memmove(mWriteBuffer, mWriteBuffer + writeSize, mWriteBufferLength);
+        CopyFromIoVecs(iov, iovcnt, 0, mWriteBuffer + mWriteBufferLength);
+        mWriteBufferLength += bytes;
     } else {
-        CHECK_LT(length, 65536);
+        struct iovec out[kMaxIoVecs + 1];
+        int outcnt = 0;
+        if (mWriteBufferLength > 0) {
+            out[outcnt].iov_base = mWriteBuffer;
+            out[outcnt].iov_len = mWriteBufferLength;
+            ++outcnt;
+        }
 
-        uint8_t x = length >> 8;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-        ::write(mFd, (const uint8_t *)buffer->data() + buffer->range_offset(), length);
-        mOffset += length + 2;
+        size_t remaining = writeSize - mWriteBufferLength;
+        for (int i = 0; i < iovcnt && remaining > 0; ++i) {
+            size_t len = iov[i].iov_len < remaining? iov[i].iov_len: remaining;
+            out[outcnt].iov_base = iov[i].iov_base;
+            out[outcnt].iov_len = len;
+            ++outcnt;
+            remaining -= len;
+        }
+        WriteFully(mFd, out, outcnt);
+
+        CopyFromIoVecs(
+                iov, iovcnt, writeSize - mWriteBufferLength, mWriteBuffer);
+        mWriteBufferLength = end - (start + writeSize);
     }
+    mOffset += bytes;
+}
 
-    return old_offset;
+void MPEG4Writer::flushWriteBuffer_l() {
+    if (mWriteBufferLength == 0) {
+        return;
+    }
+
+    ::write(mFd, mWriteBuffer, mWriteBufferLength);
+    mWriteBufferLength = 0;
 }
 
 size_t MPEG4Writer::write(
         const void *ptr, size_t size, size_t nmemb) {
 
+    flushWriteBuffer_l();
+
     const size_t bytes = size * nmemb;
     if (mWriteMoovBoxToMemory) {
 
@@ -1403,18 +2007,24 @@ MPEG4Writer::Track::Track(
       mTrackId(trackId),
       mTrackDurationUs(0),
       mEstimatedTrackSizeBytes(0),
+      mNumSamples(0),
+      mNumSyncSamples(0),
+      mFragmentStartTimeUs(0),
+      mFragmentStartTimeTicks(0),
+      mLastDecodeTimeTicks(0),
       mSamplesHaveSameSize(true),
-      mStszTableEntries(new ListTableEntries<uint32_t>(1000, 1)),
-      mStcoTableEntries(new ListTableEntries<uint32_t>(1000, 1)),
-      mCo64TableEntries(new ListTableEntries<off64_t>(1000, 1)),
-      mStscTableEntries(new ListTableEntries<uint32_t>(1000, 3)),
-      mStssTableEntries(new ListTableEntries<uint32_t>(1000, 1)),
-      mSttsTableEntries(new ListTableEntries<uint32_t>(1000, 2)),
-      mCttsTableEntries(new ListTableEntries<uint32_t>(1000, 2)),
+      mStszTableEntries(new ListTableEntries<uint32_t>(owner, 1000, 1)),
+      mStcoTableEntries(new ListTableEntries<uint32_t>(owner, 1000, 1)),
+      mCo64TableEntries(new ListTableEntries<off64_t>(owner, 1000, 1)),
+      mStscTableEntries(new ListTableEntries<uint32_t>(owner, 1000, 3)),
+      mStssTableEntries(new ListTableEntries<uint32_t>(owner, 1000, 1)),
+      mSttsTableEntries(new ListTableEntries<uint32_t>(owner, 1000, 2)),
+      mCttsTableEntries(new ListTableEntries<uint32_t>(owner, 1000, 2)),
       mCodecSpecificData(NULL),
       mCodecSpecificDataSize(0),
       mGotAllCodecSpecificData(false),
       mReachedEOS(false),
+      mExcluded(false),
       mRotation(0),
       mHFRRatio(1) {
     getCodecSpecificDataFromInputFormatIfPossible();
@@ -1431,6 +2041,12 @@ MPEG4Writer::Track::Track(
 
 void MPEG4Writer::Track::updateTrackSizeEstimate() {
 
+    if (mOwner->isFragmented()) {
+        // Each sample takes one 'trun' entry in its moof.
+        mEstimatedTrackSizeBytes = mMdatSizeBytes + mNumSamples * 16;
+        return;
+    }
+
     uint32_t stcoBoxCount = (mOwner->use32BitFileOffset()
                             ? mStcoTableEntries->count()
                             : mCo64TableEntries->count());
@@ -1450,6 +2066,51 @@ void MPEG4Writer::Track::updateTrackSizeEstimate() {
     }
 }
 
+void MPEG4Writer::Track::addFragmentSample(
+        MediaBuffer *sample, uint32_t sampleSize, int64_t timestampUs,
+        int32_t cttsOffsetTicks, bool isSync) {
+
+    int64_t decodeTimeTicks = (timestampUs * mTimeScale + 500000LL) / 1000000LL;
+
+    if (!mChunkSamples.empty()) {
+        // The duration of the previous sample is known now.
+        mFragmentSampleInfos.editTop().mDurationTicks =
+            decodeTimeTicks - mLastDecodeTimeTicks;
+
+        // Video fragments start with a sync sample so that each of
+        // them can be decoded on its own.
+        if (timestampUs - mFragmentStartTimeUs >= mOwner->fragmentDurationUs()
+                && (mIsAudio || isSync)) {
+            bufferFragment();
+        }
+    }
+
+    if (mChunkSamples.empty()) {
+        mFragmentStartTimeUs = timestampUs;
+        mFragmentStartTimeTicks = decodeTimeTicks;
+    }
+
+    FragmentSampleInfo info;
+    info.mSize = sampleSize;
+    info.mDurationTicks = 0;
+    info.mCttsOffsetTicks = cttsOffsetTicks;
+    info.mIsSync = isSync;
+    mFragmentSampleInfos.push(info);
+    mChunkSamples.push_back(sample);
+    mLastDecodeTimeTicks = decodeTimeTicks;
+}
+
+void MPEG4Writer::Track::bufferFragment() {
+    ALOGV("bufferFragment: %d samples", mFragmentSampleInfos.size());
+
+    Chunk chunk(this, mFragmentStartTimeUs, mChunkSamples);
+    chunk.mSampleInfos = mFragmentSampleInfos;
+    chunk.mBaseDecodeTimeTicks = mFragmentStartTimeTicks;
+    mOwner->bufferChunk(chunk);
+    mChunkSamples.clear();
+    mFragmentSampleInfos.clear();
+}
+
 void MPEG4Writer::Track::addOneStscTableEntry(
         size_t chunkId, size_t sampleId) {
 
@@ -1465,6 +2126,9 @@ void MPEG4Writer::Track::addOneStssTableEntry(size_t sampleId) {
 void MPEG4Writer::Track::addOneSttsTableEntry(
         size_t sampleCount, int32_t duration) {
 
+    if (mOwner->isFragmented()) {  // samples are described by the fragments
+        return;
+    }
     if (duration == 0) {
         ALOGW("0-duration samples found: %d", sampleCount);
     }
@@ -1475,7 +2139,7 @@ void MPEG4Writer::Track::addOneSttsTableEntry(
 void MPEG4Writer::Track::addOneCttsTableEntry(
         size_t sampleCount, int32_t duration) {
 
-    if (mIsAudio) {
+    if (mIsAudio || mOwner->isFragmented()) {
         return;
     }
     mCttsTableEntries->add(htonl(sampleCount));
@@ -1601,6 +2265,16 @@ void MPEG4Writer::bufferChunk(const Chunk& chunk) {
          it != mChunkInfos.end(); ++it) {
 
         if (chunk.mTrack == it->mTrack) {  // Found owner
+            if (it->mExcluded) {
+                // Not in the init segment, the fragment can't be written.
+                for (List<MediaBuffer *>::const_iterator sampleIt =
+                        chunk.mSamples.begin();
+                     sampleIt != chunk.mSamples.end(); ++sampleIt) {
+                    (*sampleIt)->release();
+                }
+                return;
+            }
+
             it->mChunks.push_back(chunk);
             mChunkReadyCondition.signal();
             return;
@@ -1614,32 +2288,167 @@ void MPEG4Writer::writeChunkToFile(Chunk* chunk) {
     ALOGV("writeChunkToFile: %lld from %s track",
         chunk->mTimeStampUs, chunk->mTrack->isAudio()? "audio": "video");
 
-    int32_t isFirstSample = true;
-    while (!chunk->mSamples.empty()) {
-        List<MediaBuffer *>::iterator it = chunk->mSamples.begin();
+    if (mFragmented) {
+        writeFragmentHeader(chunk);
+    }
 
-#if defined (OMAP_ENHANCEMENT) && defined (TARGET_OMAP3)
-        off64_t offset = addSample_l(*it);
-#else
-        off64_t offset = chunk->mTrack->isAvc()
-                                ? addLengthPrefixedSample_l(*it)
-                                : addSample_l(*it);
-#endif
+    if (!mFragmented && !chunk->mSamples.empty()) {
+        chunk->mTrack->addChunkOffset(mOffset);
+    }
 
-        if (isFirstSample) {
-            chunk->mTrack->addChunkOffset(offset);
-            isFirstSample = false;
-        }
+    // Gather the samples of the chunk so that they reach the file with as
+    // few writev() calls as possible.
+    struct iovec iov[kMaxIoVecs];
+    int iovcnt = 0;
 
-        (*it)->release();
-        (*it) = NULL;
-        chunk->mSamples.erase(it);
+    List<MediaBuffer *>::iterator it = chunk->mSamples.begin();
+    while (it != chunk->mSamples.end()) {
+        MediaBuffer *buffer = *it;
+        iov[iovcnt].iov_base =
+            (uint8_t *)buffer->data() + buffer->range_offset();
+        iov[iovcnt].iov_len = buffer->range_length();
+        ++iovcnt;
+        ++it;
+
+        if (it == chunk->mSamples.end() || iovcnt == kMaxIoVecs) {
+            writeSampleData_l(iov, iovcnt);
+            iovcnt = 0;
+
+            // The gathered samples are in the file or staged by now.
+            while (chunk->mSamples.begin() != it) {
+                (*chunk->mSamples.begin())->release();
+                chunk->mSamples.erase(chunk->mSamples.begin());
+            }
+        }
     }
     chunk->mSamples.clear();
 }
 
+void MPEG4Writer::writeFragmentHeader(Chunk *chunk) {
+    if (!mInitSegmentWritten) {
+        writeMoovBox(0);
+        mInitSegmentWritten = true;
+    }
+
+    const Vector<FragmentSampleInfo> &infos = chunk->mSampleInfos;
+    CHECK_EQ(infos.size(), chunk->mSamples.size());
+    CHECK(!infos.isEmpty());
+
+    uint64_t mdatSize = 8;
+    for (size_t i = 0; i < infos.size(); ++i) {
+        mdatSize += infos[i].mSize;
+    }
+    CHECK_LE(mdatSize, 0xffffffffULL);
+
+    off64_t moofOffset = mOffset;
+    if (infos[0].mIsSync) {
+        chunk->mTrack->addFragmentIndexEntry(
+                chunk->mBaseDecodeTimeTicks + infos[0].mCttsOffsetTicks,
+                chunk->mMoovStartTimeUs, moofOffset);
+    }
+
+    beginBox("moof");
+    beginBox("mfhd");
+    writeInt32(0);  // version=0, flags=0
+    writeInt32(++mFragmentSequenceNumber);
+    endBox();  // mfhd
+    off64_t dataOffsetPos = chunk->mTrack->writeTrafBox(*chunk);
+    endBox();  // moof
+
+    // Now that the size of the moof is known, point the trun
+    // at the first sample, right after the mdat header.
+    off64_t dataOffset = mOffset - moofOffset + 8;
+    lseek64(mFd, dataOffsetPos, SEEK_SET);
+    writeInt32(dataOffset);
+    mOffset -= 4;
+    lseek64(mFd, mOffset, SEEK_SET);
+
+    writeInt32(mdatSize);
+    writeFourcc("mdat");
+}
+
+bool MPEG4Writer::isInitSegmentReady_l() {
+    // Hold the first fragments back until every track has buffered one,
+    // by then the codec specific data of all tracks is known.
+    bool allTracksReady = true;
+    int64_t minTimestampUs = 0x7FFFFFFFFFFFFFFFLL;
+    int64_t maxTimestampUs = 0;
+    size_t heldBytes = 0;
+
+    for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+         it != mChunkInfos.end(); ++it) {
+        if (it->mExcluded) {
+            continue;
+        }
+
+        if (it->mChunks.empty()) {
+            allTracksReady = false;
+            continue;
+        }
+
+        for (List<Chunk>::iterator chunkIt = it->mChunks.begin();
+             chunkIt != it->mChunks.end(); ++chunkIt) {
+            if (chunkIt->mTimeStampUs < minTimestampUs) {
+                minTimestampUs = chunkIt->mTimeStampUs;
+            }
+            if (chunkIt->mTimeStampUs > maxTimestampUs) {
+                maxTimestampUs = chunkIt->mTimeStampUs;
+            }
+
+            for (size_t i = 0; i < chunkIt->mSampleInfos.size(); ++i) {
+                heldBytes += chunkIt->mSampleInfos[i].mSize;
+            }
+        }
+    }
+
+    if (allTracksReady) {
+        return true;
+    }
+
+    if (heldBytes < kMaxInitSegmentDelayBytes
+            && (minTimestampUs > maxTimestampUs
+                || maxTimestampUs - minTimestampUs < kMaxInitSegmentDelayUs)) {
+        return false;
+    }
+
+    excludeTracksWithoutChunks_l();
+    return true;
+}
+
+void MPEG4Writer::excludeTracksWithoutChunks_l() {
+    size_t numTracksLeft = 0;
+    for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+         it != mChunkInfos.end(); ++it) {
+        if (!it->mExcluded && !it->mChunks.empty()) {
+            ++numTracksLeft;
+        }
+    }
+
+    if (numTracksLeft == 0) {
+        return;
+    }
+
+    for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+         it != mChunkInfos.end(); ++it) {
+        if (!it->mExcluded && it->mChunks.empty()) {
+            ALOGW("No fragment from the %s track in time, leaving it out",
+                    it->mTrack->isAudio()? "audio": "video");
+
+            it->mExcluded = true;
+            it->mTrack->setExcluded();
+        }
+    }
+}
+
 void MPEG4Writer::writeAllChunks() {
     ALOGV("writeAllChunks");
+
+    if (mFragmented && !mInitSegmentWritten) {
+        // The init segment cannot describe a track without any samples,
+        // the others are written without it.
+        excludeTracksWithoutChunks_l();
+    }
+
     size_t outstandingChunks = 0;
     Chunk chunk;
     while (findChunkToWrite(&chunk)) {
@@ -1656,6 +2465,11 @@ void MPEG4Writer::writeAllChunks() {
 bool MPEG4Writer::findChunkToWrite(Chunk *chunk) {
     ALOGV("findChunkToWrite");
 
+    if (mFragmented && !mInitSegmentWritten && !mDone
+            && !isInitSegmentReady_l()) {
+        return false;
+    }
+
     int64_t minTimestampUs = 0x7FFFFFFFFFFFFFFFLL;
     Track *track = NULL;
     for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
@@ -1685,6 +2499,9 @@ bool MPEG4Writer::findChunkToWrite(Chunk *chunk) {
             it->mChunks.erase(it->mChunks.begin());
             CHECK_EQ(chunk->mTrack, track);
 
+            // The fragment may be written after mLock is dropped.
+            chunk->mMoovStartTimeUs = mStartTimestampUs;
+
             int64_t interChunkTimeUs =
                 chunk->mTimeStampUs - it->mPrevChunkTimestampUs;
             if (interChunkTimeUs > it->mPrevChunkTimestampUs) {
@@ -1742,6 +2559,7 @@ status_t MPEG4Writer::startWriterThread() {
         info.mTrack = *it;
         info.mPrevChunkTimestampUs = 0;
         info.mMaxInterChunkDurUs = 0;
+        info.mExcluded = false;
         mChunkInfos.push_back(info);
     }
 
@@ -1880,15 +2698,11 @@ static const uint8_t *findNextStartCode(
 
     ALOGV("findNextStartCode: %p %d", data, length);
 
-    size_t bytesLeft = length;
-    while (bytesLeft > 4  &&
-            memcmp("\x00\x00\x00\x01", &data[length - bytesLeft], 4)) {
-        --bytesLeft;
-    }
-    if (bytesLeft <= 4) {
-        bytesLeft = 0; // Last parameter set
+    ssize_t offset = FindLongStartCode(data, length);
+    if (offset < 0 || (size_t)offset + 4 >= length) {
+        offset = length; // Last parameter set
     }
-    return &data[length - bytesLeft];
+    return &data[offset];
 }
 
 const uint8_t *MPEG4Writer::Track::parseParamSet(
@@ -2134,6 +2948,7 @@ status_t MPEG4Writer::Track::threadEntry() {
     int32_t count = 0;
     const int64_t interleaveDurationUs = mOwner->interleaveDuration();
     const bool hasMultipleTracks = (mOwner->numTracks() > 1);
+    const bool isFragmented = mOwner->isFragmented();
     int64_t chunkTimestampUs = 0;
     int32_t nChunks = 0;
     int32_t nZeroLengthFrames = 0;
@@ -2150,6 +2965,7 @@ status_t MPEG4Writer::Track::threadEntry() {
     int32_t copy_spspps_size = 0;
 #endif
     int64_t cttsOffsetTimeUs = 0;
+    int64_t fragmentCttsOffsetTicks = 0;   // Composition - decoding time
     int64_t currCttsOffsetTimeTicks = 0;   // Timescale based ticks
     int64_t lastCttsOffsetTimeTicks = -1;  // Timescale based ticks
     int32_t cttsSampleCount = 0;           // Sample count in the current ctts table entry
@@ -2301,27 +3117,27 @@ status_t MPEG4Writer::Track::threadEntry() {
                 buffer->range_length());
         copy->set_range(0, buffer->range_length() + start_code_size);
 #else
-        MediaBuffer *copy = new MediaBuffer(buffer->range_length());
-        memcpy(copy->data(), (uint8_t *)buffer->data() + buffer->range_offset(),
-                buffer->range_length());
-        copy->set_range(0, buffer->range_length());
+        // AVC samples get their NAL length prefixes as they are copied,
+        // an access unit may hold several NAL units (one per slice).
+        MediaBuffer *copy;
+        if (mIsAvc) {
+            copy = MakeLengthPrefixedCopy(buffer, mOwner->useNalLengthFour());
+        } else {
+            copy = new MediaBuffer(buffer->range_length());
+            memcpy(copy->data(), (uint8_t *)buffer->data() + buffer->range_offset(),
+                    buffer->range_length());
+            copy->set_range(0, buffer->range_length());
+        }
 #endif
         meta_data = new MetaData(*buffer->meta_data().get());
         buffer->release();
         buffer = NULL;
 
+#if defined (OMAP_ENHANCEMENT) && defined (TARGET_OMAP3)
         if (mIsAvc) StripStartcode(copy);
+#endif
 
         size_t sampleSize = copy->range_length();
-#if !defined (OMAP_ENHANCEMENT) || !defined (TARGET_OMAP3)
-        if (mIsAvc) {
-            if (mOwner->useNalLengthFour()) {
-                sampleSize += 4;
-            } else {
-                sampleSize += 2;
-            }
-        }
-#endif
 
         // Max file size or duration handling
         mMdatSizeBytes += sampleSize;
@@ -2342,7 +3158,7 @@ status_t MPEG4Writer::Track::threadEntry() {
         CHECK(meta_data->findInt64(kKeyTime, &timestampUs));
 
 ////////////////////////////////////////////////////////////////////////////////
-        if (mStszTableEntries->count() == 0) {
+        if (mNumSamples == 0) {
             mFirstSampleTimeRealUs = systemTime() / 1000;
             mStartTimestampUs = timestampUs;
             mOwner->setStartTimestampUs(mStartTimestampUs);
@@ -2367,6 +3183,8 @@ status_t MPEG4Writer::Track::threadEntry() {
             CHECK(meta_data->findInt64(kKeyDecodingTime, &decodingTimeUs));
 
             decodingTimeUs -= previousPausedDurationUs;
+            fragmentCttsOffsetTicks =
+                ((timestampUs - decodingTimeUs) * mTimeScale + 500000LL) / 1000000LL;
             cttsOffsetTimeUs =
 #ifdef QCOM_HARDWARE
                     timestampUs - decodingTimeUs;
@@ -2383,7 +3201,7 @@ status_t MPEG4Writer::Track::threadEntry() {
             currCttsOffsetTimeTicks =
                     (cttsOffsetTimeUs * mTimeScale + 500000LL) / 1000000LL;
             CHECK_LE(currCttsOffsetTimeTicks, 0x0FFFFFFFFLL);
-            if (mStszTableEntries->count() == 0) {
+            if (mNumSamples == 0) {
                 // Force the first ctts table entry to have one single entry
                 // so that we can do adjustment for the initial track start
                 // time offset easily in writeCttsBox().
@@ -2401,7 +3219,7 @@ status_t MPEG4Writer::Track::threadEntry() {
             }
 
             // Update ctts time offset range
-            if (mStszTableEntries->count() == 0) {
+            if (mNumSamples == 0) {
                 mMinCttsOffsetTimeUs = currCttsOffsetTimeTicks;
                 mMaxCttsOffsetTimeUs = currCttsOffsetTimeTicks;
             } else {
@@ -2443,25 +3261,28 @@ status_t MPEG4Writer::Track::threadEntry() {
             return err;
         }
 
-        mStszTableEntries->add(htonl(sampleSize));
-        if (mStszTableEntries->count() > 2) {
+        if (!isFragmented) {
+            mStszTableEntries->add(htonl(sampleSize));
+            if (mStszTableEntries->count() > 2) {
 
-            // Force the first sample to have its own stts entry so that
-            // we can adjust its value later to maintain the A/V sync.
-            if (mStszTableEntries->count() == 3 || currDurationTicks != lastDurationTicks) {
-                addOneSttsTableEntry(sampleCount, lastDurationTicks);
-                sampleCount = 1;
-            } else {
-                ++sampleCount;
-            }
+                // Force the first sample to have its own stts entry so that
+                // we can adjust its value later to maintain the A/V sync.
+                if (mStszTableEntries->count() == 3 || currDurationTicks != lastDurationTicks) {
+                    addOneSttsTableEntry(sampleCount, lastDurationTicks);
+                    sampleCount = 1;
+                } else {
+                    ++sampleCount;
+                }
 
-        }
-        if (mSamplesHaveSameSize) {
-            if (mStszTableEntries->count() >= 2 && previousSampleSize != sampleSize) {
-                mSamplesHaveSameSize = false;
             }
-            previousSampleSize = sampleSize;
+            if (mSamplesHaveSameSize) {
+                if (mStszTableEntries->count() >= 2 && previousSampleSize != sampleSize) {
+                    mSamplesHaveSameSize = false;
+                }
+                previousSampleSize = sampleSize;
+            }
         }
+        ++mNumSamples;
         ALOGV("%s timestampUs/lastTimestampUs: %lld/%lld",
                 mIsAudio? "Audio": "Video", timestampUs, lastTimestampUs);
         lastDurationUs = timestampUs - lastTimestampUs;
@@ -2469,7 +3290,10 @@ status_t MPEG4Writer::Track::threadEntry() {
         lastTimestampUs = timestampUs;
 
         if (isSync != 0) {
-            addOneStssTableEntry(mStszTableEntries->count());
+            ++mNumSyncSamples;
+            if (!isFragmented) {
+                addOneStssTableEntry(mStszTableEntries->count());
+            }
         }
 
         if (mTrackingProgressStatus) {
@@ -2479,14 +3303,16 @@ status_t MPEG4Writer::Track::threadEntry() {
             trackProgressStatus(timestampUs);
         }
 
+        if (isFragmented) {
+            // Every audio sample is a sync sample.
+            addFragmentSample(copy, sampleSize, timestampUs,
+                    fragmentCttsOffsetTicks, mIsAudio || isSync != 0);
+            continue;
+        }
+
         // use File write in seperate thread for video only recording
         if (!hasMultipleTracks && mIsAudio) {
-#if defined (OMAP_ENHANCEMENT) && defined (TARGET_OMAP3)
             off64_t offset = mOwner->addSample_l(copy);
-#else
-            off64_t offset = mIsAvc? mOwner->addLengthPrefixedSample_l(copy)
-                                 : mOwner->addSample_l(copy);
-#endif
             uint32_t count = (mOwner->use32BitFileOffset()
                         ? mStcoTableEntries->count()
                         : mCo64TableEntries->count());
@@ -2533,7 +3359,14 @@ status_t MPEG4Writer::Track::threadEntry() {
     mOwner->trackProgressStatus(mTrackId, -1, err);
 
     // Last chunk
-    if (!hasMultipleTracks && mIsAudio) {
+    if (isFragmented) {
+        if (!mChunkSamples.empty()) {
+            // Repeat the previous sample's duration, as for stts below.
+            mFragmentSampleInfos.editTop().mDurationTicks =
+                (mNumSamples == 1) ? 0 : lastDurationTicks;
+            bufferFragment();
+        }
+    } else if (!hasMultipleTracks && mIsAudio) {
         addOneStscTableEntry(1, mStszTableEntries->count());
     } else if (!mChunkSamples.empty()) {
         addOneStscTableEntry(++nChunks, mChunkSamples.size());
@@ -2543,7 +3376,7 @@ status_t MPEG4Writer::Track::threadEntry() {
     // We don't really know how long the last frame lasts, since
     // there is no frame time after it, just repeat the previous
     // frame's duration.
-    if (mStszTableEntries->count() == 1) {
+    if (mNumSamples == 1) {
         lastDurationUs = 0;  // A single sample's duration
         lastDurationTicks = 0;
     } else {
@@ -2573,7 +3406,7 @@ status_t MPEG4Writer::Track::threadEntry() {
     sendTrackSummary(hasMultipleTracks);
 
     ALOGI("Received total/0-length (%d/%d) buffers and encoded %d frames. - %s",
-            count, nZeroLengthFrames, mStszTableEntries->count(), mIsAudio? "audio": "video");
+            count, nZeroLengthFrames, mNumSamples, mIsAudio? "audio": "video");
     if (mIsAudio) {
         ALOGI("Audio track drift time: %lld us", mOwner->getDriftTimeUs());
     }
@@ -2585,12 +3418,12 @@ status_t MPEG4Writer::Track::threadEntry() {
 }
 
 bool MPEG4Writer::Track::isTrackMalFormed() const {
-    if (mStszTableEntries->count() == 0) {                      // no samples written
+    if (mNumSamples == 0) {                      // no samples written
         ALOGE("The number of recorded samples is 0");
         return true;
     }
 
-    if (!mIsAudio && mStssTableEntries->count() == 0) {  // no sync frames for video
+    if (!mIsAudio && mNumSyncSamples == 0) {  // no sync frames for video
         ALOGE("There are no sync frames for video track");
         return true;
     }
@@ -2621,7 +3454,7 @@ void MPEG4Writer::Track::sendTrackSummary(bool hasMultipleTracks) {
 
     mOwner->notify(MEDIA_RECORDER_TRACK_EVENT_INFO,
                     trackNum | MEDIA_RECORDER_TRACK_INFO_ENCODED_FRAMES,
-                    mStszTableEntries->count());
+                    mNumSamples);
 
     {
         // The system delay time excluding the requested initial delay that
@@ -2787,6 +3620,21 @@ void MPEG4Writer::Track::writeStblBox(bool use32BitOffset) {
         writeVideoFourCCBox();
     }
     mOwner->endBox();  // stsd
+    if (mOwner->isFragmented()) {
+        // All samples are described by the movie fragments.
+        static const char *kEmptyTables[] = { "stts", "stsc", "stsz", "stco" };
+        for (size_t i = 0; i < sizeof(kEmptyTables) / sizeof(kEmptyTables[0]); ++i) {
+            mOwner->beginBox(kEmptyTables[i]);
+            mOwner->writeInt32(0);  // version=0, flags=0
+            if (!strcmp(kEmptyTables[i], "stsz")) {
+                mOwner->writeInt32(0);  // sample size
+            }
+            mOwner->writeInt32(0);  // entry count
+            mOwner->endBox();
+        }
+        mOwner->endBox();  // stbl
+        return;
+    }
     writeSttsBox();
     writeCttsBox();
     if (!mIsAudio) {
@@ -2982,7 +3830,8 @@ void MPEG4Writer::Track::writeTkhdBox(uint32_t now) {
     mOwner->writeInt32(now);           // modification time
     mOwner->writeInt32(mTrackId);      // track id starts with 1
     mOwner->writeInt32(0);             // reserved
-    int64_t trakDurationUs = getDurationUs();
+    // The init segment of a fragmented file has no samples yet
+    int64_t trakDurationUs = mOwner->isFragmented() ? 0 : getDurationUs();
     int32_t mvhdTimeScale = mOwner->getTimeScale();
     int32_t tkhdDuration =
         (trakDurationUs * mvhdTimeScale + 5E5) / 1E6;
@@ -3043,7 +3892,7 @@ void MPEG4Writer::Track::writeHdlrBox() {
 }
 
 void MPEG4Writer::Track::writeMdhdBox(uint32_t now) {
-    int64_t trakDurationUs = getDurationUs();
+    int64_t trakDurationUs = mOwner->isFragmented() ? 0 : getDurationUs();
     mOwner->beginBox("mdhd");
     mOwner->writeInt32(0);             // version=0, flags=0
     mOwner->writeInt32(now);           // creation time
@@ -3126,9 +3975,9 @@ void MPEG4Writer::Track::writePaspBox() {
     mOwner->endBox();  // pasp
 }
 
-int32_t MPEG4Writer::Track::getStartTimeOffsetScaledTime() const {
+int32_t MPEG4Writer::Track::getStartTimeOffsetScaledTime(
+        int64_t moovStartTimeUs) const {
     int64_t trackStartTimeOffsetUs = 0;
-    int64_t moovStartTimeUs = mOwner->getStartTimestampUs();
     if (mStartTimestampUs != moovStartTimeUs) {
         CHECK_GT(mStartTimestampUs, moovStartTimeUs);
         trackStartTimeOffsetUs = mStartTimestampUs - moovStartTimeUs;
@@ -3142,7 +3991,8 @@ void MPEG4Writer::Track::writeSttsBox() {
     uint32_t duration;
     CHECK(mSttsTableEntries->get(duration, 1));
     duration = htonl(duration);  // Back to host byte order
-    mSttsTableEntries->set(htonl(duration + getStartTimeOffsetScaledTime()), 1);
+    mSttsTableEntries->set(htonl(duration + getStartTimeOffsetScaledTime(
+            mOwner->getStartTimestampUs())), 1);
     mSttsTableEntries->write(mOwner);
     mOwner->endBox();  // stts
 }
@@ -3170,7 +4020,8 @@ void MPEG4Writer::Track::writeCttsBox() {
     uint32_t duration;
     CHECK(mCttsTableEntries->get(duration, 1));
     duration = htonl(duration);  // Back host byte order
-    mCttsTableEntries->set(htonl(duration + getStartTimeOffsetScaledTime() - mMinCttsOffsetTimeUs), 1);
+    mCttsTableEntries->set(htonl(duration + getStartTimeOffsetScaledTime(
+            mOwner->getStartTimestampUs()) - mMinCttsOffsetTimeUs), 1);
     mCttsTableEntries->write(mOwner);
     mOwner->endBox();  // ctts
 }
@@ -3208,6 +4059,121 @@ void MPEG4Writer::Track::writeStcoBox(bool use32BitOffset) {
     mOwner->endBox();  // stco or co64
 }
 
+// Returns the file offset of the trun's data_offset field, which
+// the owner fills in once the size of the moof is known.
+off64_t MPEG4Writer::Track::writeTrafBox(const Chunk &chunk) {
+    const Vector<FragmentSampleInfo> &infos = chunk.mSampleInfos;
+
+    bool hasCtts = false;
+    if (!mIsAudio) {
+        for (size_t i = 0; i < infos.size(); ++i) {
+            if (infos[i].mCttsOffsetTicks != 0) {
+                hasCtts = true;
+                break;
+            }
+        }
+    }
+
+    mOwner->beginBox("traf");
+
+    mOwner->beginBox("tfhd");
+    mOwner->writeInt32(0x020000);  // version=0, flags=default-base-is-moof
+    mOwner->writeInt32(mTrackId);
+    mOwner->endBox();  // tfhd
+
+    mOwner->beginBox("tfdt");
+    mOwner->writeInt32(0x01000000);  // version=1, flags=0
+    mOwner->writeInt64(
+            chunk.mBaseDecodeTimeTicks
+                + getStartTimeOffsetScaledTime(chunk.mMoovStartTimeUs));
+    mOwner->endBox();  // tfdt
+
+    mOwner->beginBox("trun");
+    // data-offset, sample-duration, sample-size and sample-flags present,
+    // plus signed (version 1) sample-composition-time-offsets if needed.
+    uint32_t flags = 0x000001 | 0x000100 | 0x000200 | 0x000400;
+    if (hasCtts) {
+        flags |= 0x01000000 | 0x000800;
+    }
+    mOwner->writeInt32(flags);
+    mOwner->writeInt32(infos.size());
+    off64_t dataOffsetPos = mOwner->mOffset;
+    mOwner->writeInt32(0);  // data offset
+
+    // The entries go out in a single write.
+    size_t entrySize = hasCtts ? 4 : 3;
+    uint32_t *entries = new uint32_t[infos.size() * entrySize];
+    uint32_t *entry = entries;
+    for (size_t i = 0; i < infos.size(); ++i) {
+        const FragmentSampleInfo &info = infos[i];
+        entry[0] = htonl(info.mDurationTicks);
+        entry[1] = htonl(info.mSize);
+        // sample_depends_on and sample_is_non_sync_sample
+        entry[2] = htonl(info.mIsSync ? 0x02000000 : 0x01010000);
+        if (hasCtts) {
+            entry[3] = htonl(info.mCttsOffsetTicks);
+        }
+        entry += entrySize;
+    }
+    mOwner->write(entries, sizeof(uint32_t) * entrySize, infos.size());
+    delete[] entries;
+    mOwner->endBox();  // trun
+
+    mOwner->endBox();  // traf
+    return dataOffsetPos;
+}
+
+void MPEG4Writer::Track::addFragmentIndexEntry(
+        int64_t timeTicks, int64_t moovStartTimeUs, off64_t moofOffset) {
+    FragmentIndexEntry entry;
+    entry.mTimeTicks =
+        timeTicks + getStartTimeOffsetScaledTime(moovStartTimeUs);
+    entry.mMoofOffset = moofOffset;
+    mFragmentIndex.push_back(entry);
+}
+
+void MPEG4Writer::Track::writeTrexBox() {
+    mOwner->beginBox("trex");
+    mOwner->writeInt32(0);         // version=0, flags=0
+    mOwner->writeInt32(mTrackId);
+    mOwner->writeInt32(1);         // default sample description index
+    mOwner->writeInt32(0);         // default sample duration
+    mOwner->writeInt32(0);         // default sample size
+    mOwner->writeInt32(0);         // default sample flags
+    mOwner->endBox();  // trex
+}
+
+void MPEG4Writer::Track::writeTfraBox() {
+    mOwner->beginBox("tfra");
+    mOwner->writeInt32(0x01000000);  // version=1, flags=0
+    mOwner->writeInt32(mTrackId);
+    mOwner->writeInt32(0);  // 1 byte traf, trun and sample numbers
+    mOwner->writeInt32(mFragmentIndex.size());
+
+    if (mFragmentIndex.empty()) {
+        mOwner->endBox();  // tfra
+        return;
+    }
+
+    // 64-bit time and moof offset, then traf, trun and sample number.
+    // The entries go out in a single write.
+    static const size_t kEntrySize = 8 + 8 + 3;
+    uint8_t *entries = new uint8_t[mFragmentIndex.size() * kEntrySize];
+    uint8_t *entry = entries;
+    for (List<FragmentIndexEntry>::iterator it = mFragmentIndex.begin();
+         it != mFragmentIndex.end(); ++it) {
+        uint64_t timeTicks = hton64(it->mTimeTicks);
+        uint64_t moofOffset = hton64(it->mMoofOffset);
+        memcpy(&entry[0], &timeTicks, 8);
+        memcpy(&entry[8], &moofOffset, 8);
+        entry[16] = entry[17] = entry[18] = 1;
+        entry += kEntrySize;
+    }
+    mOwner->write(entries, kEntrySize, mFragmentIndex.size());
+    delete[] entries;
+    mOwner->endBox();  // tfra
+}
+
 void MPEG4Writer::writeUdtaBox() {
     beginBox("udta");
     writeGeoDataBox();
@@ -17,28 +17,48 @@
 #define LOG_TAG "MediaBufferGroup"
 #include <utils/Log.h>
 
+#include <cutils/atomic.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MediaBuffer.h>
 #include <media/stagefright/MediaBufferGroup.h>
 
 namespace android {
 
 MediaBufferGroup::MediaBufferGroup()
-    : mFirstBuffer(NULL),
-      mLastBuffer(NULL) {
+    : mMaxBufferSize(0),
+      mNumWaiters(0) {
+    for (size_t i = 0; i < kNumSizeClasses; ++i) {
+        mSizeClasses[i].mFirstBuffer = NULL;
+        mSizeClasses[i].mLastBuffer = NULL;
+        mSizeClasses[i].mFreeHint = NULL;
+    }
 }
 
 MediaBufferGroup::~MediaBufferGroup() {
-    MediaBuffer *next;
-    for (MediaBuffer *buffer = mFirstBuffer; buffer != NULL;
-         buffer = next) {
-        next = buffer->nextBuffer();
+    for (size_t i = 0; i < kNumSizeClasses; ++i) {
+        MediaBuffer *next;
+        for (MediaBuffer *buffer = mSizeClasses[i].mFirstBuffer;
+             buffer != NULL; buffer = next) {
+            next = buffer->nextBuffer();
+
+            CHECK_EQ(buffer->refcount(), 0);
 
-        CHECK_EQ(buffer->refcount(), 0);
+            buffer->setObserver(NULL);
+            buffer->release();
+        }
+    }
+}
 
-        buffer->setObserver(NULL);
-        buffer->release();
+// static
+size_t MediaBufferGroup::SizeClassIndex(size_t size) {
+    size_t index = 0;
+    while (size > 1 && index + 1 < kNumSizeClasses) {
+        size >>= 1;
+        ++index;
     }
+
+    return index;
 }
 
 void MediaBufferGroup::add_buffer(MediaBuffer *buffer) {
@@ -46,41 +66,153 @@ void MediaBufferGroup::add_buffer(MediaBuffer *buffer) {
 
     buffer->setObserver(this);
 
-    if (mLastBuffer) {
-        mLastBuffer->setNextBuffer(buffer);
+    SizeClass *sizeClass = &mSizeClasses[SizeClassIndex(buffer->size())];
+
+    // Make sure the buffer is fully initialized before lock-free readers
+    // can reach it through the list.
+    android_memory_barrier();
+
+    if (sizeClass->mLastBuffer) {
+        sizeClass->mLastBuffer->setNextBuffer(buffer);
     } else {
-        mFirstBuffer = buffer;
+        sizeClass->mFirstBuffer = buffer;
+    }
+
+    sizeClass->mLastBuffer = buffer;
+
+    if (buffer->size() > mMaxBufferSize) {
+        mMaxBufferSize = buffer->size();
+    }
+}
+
+// static
+bool MediaBufferGroup::Claim(MediaBuffer *buffer, size_t requestedSize) {
+    if (buffer->size() < requestedSize
+            || android_atomic_cmpxchg(
+                0, 1, (volatile int32_t *)&buffer->mRefCount) != 0) {
+        return false;
+    }
+
+    buffer->reset();
+    return true;
+}
+
+bool MediaBufferGroup::tryAcquire(MediaBuffer **out, size_t requestedSize) {
+    for (size_t i = SizeClassIndex(requestedSize); i < kNumSizeClasses; ++i) {
+        SizeClass *sizeClass = &mSizeClasses[i];
+
+        // In the common case the most recently returned buffer is still
+        // free, only scan the whole class if it isn't.
+        MediaBuffer *hint = sizeClass->mFreeHint;
+        if (hint != NULL && Claim(hint, requestedSize)) {
+            *out = hint;
+            return true;
+        }
+
+        for (MediaBuffer *buffer = sizeClass->mFirstBuffer;
+             buffer != NULL; buffer = buffer->nextBuffer()) {
+            if (buffer != hint && Claim(buffer, requestedSize)) {
+                *out = buffer;
+                return true;
+            }
+        }
     }
 
-    mLastBuffer = buffer;
+    return false;
+}
+
+bool MediaBufferGroup::hasFreeBuffer() const {
+    for (size_t i = 0; i < kNumSizeClasses; ++i) {
+        for (MediaBuffer *buffer = mSizeClasses[i].mFirstBuffer;
+             buffer != NULL; buffer = buffer->nextBuffer()) {
+            if (buffer->refcount() == 0) {
+                return true;
+            }
+        }
+    }
+
+    return false;
 }
 
 status_t MediaBufferGroup::acquire_buffer(MediaBuffer **out) {
+    return acquire_buffer(out, false /* nonBlocking */);
+}
+
+status_t MediaBufferGroup::acquire_buffer(
+        MediaBuffer **out, bool nonBlocking, size_t requestedSize) {
+    if (tryAcquire(out, requestedSize)) {
+        return OK;
+    }
+
+    if (requestedSize > mMaxBufferSize) {
+        ALOGE("no buffer of at least %zu bytes in this group", requestedSize);
+        return BAD_VALUE;
+    }
+
+    if (nonBlocking) {
+        return WOULD_BLOCK;
+    }
+
     Mutex::Autolock autoLock(mLock);
 
+    android_atomic_inc(&mNumWaiters);
+
     for (;;) {
-        for (MediaBuffer *buffer = mFirstBuffer;
-             buffer != NULL; buffer = buffer->nextBuffer()) {
-            if (buffer->refcount() == 0) {
-                buffer->add_ref();
-                buffer->reset();
+        // Register as a waiter before checking again, otherwise a buffer
+        // returned in between would go unnoticed.
+        android_memory_barrier();
 
-                *out = buffer;
-                goto exit;
-            }
+        if (tryAcquire(out, requestedSize)) {
+            break;
         }
 
         // All buffers are in use. Block until one of them is returned to us.
         mCondition.wait(mLock);
     }
 
-exit:
+    android_atomic_dec(&mNumWaiters);
+
     return OK;
 }
 
-void MediaBufferGroup::signalBufferReturned(MediaBuffer *) {
+void MediaBufferGroup::notifyWhenBufferAvailable(const sp<AMessage> &notify) {
+    Mutex::Autolock autoLock(mLock);
+
+    mNotifications.push_back(notify);
+
+    // Counts as a waiter until the notification has been posted.
+    android_atomic_inc(&mNumWaiters);
+    android_memory_barrier();
+
+    // A buffer may have been returned since the caller's last attempt
+    // to acquire one.
+    if (hasFreeBuffer()) {
+        postNotifications_l();
+    }
+}
+
+void MediaBufferGroup::postNotifications_l() {
+    while (!mNotifications.empty()) {
+        (*mNotifications.begin())->post();
+        mNotifications.erase(mNotifications.begin());
+
+        android_atomic_dec(&mNumWaiters);
+    }
+}
+
+void MediaBufferGroup::signalBufferReturned(MediaBuffer *buffer) {
+    mSizeClasses[SizeClassIndex(buffer->size())].mFreeHint = buffer;
+
+    android_memory_barrier();
+
+    if (android_atomic_acquire_load(&mNumWaiters) == 0) {
+        return;
+    }
+
     Mutex::Autolock autoLock(mLock);
     mCondition.signal();
+
+    postNotifications_l();
 }
 
 }  // namespace android
@@ -42,6 +42,11 @@ struct PageCache {
 
     void appendPage(Page *page);
     size_t releaseFromStart(size_t maxBytes);
+    size_t releaseFromEnd(size_t maxBytes);
+
+    // Moves whole pages totalling at most "maxBytes" from the start of
+    // this cache to the end of "target".
+    size_t moveFromStart(size_t maxBytes, PageCache *target);
 
     size_t totalSize() const {
         return mTotalSize;
@@ -134,6 +139,56 @@ size_t PageCache::releaseFromStart(size_t maxBytes) {
     return bytesReleased;
 }
 
+size_t PageCache::releaseFromEnd(size_t maxBytes) {
+    size_t bytesReleased = 0;
+
+    while (maxBytes > 0 && !mActivePages.empty()) {
+        List<Page *>::iterator it = --mActivePages.end();
+
+        Page *page = *it;
+
+        if (maxBytes < page->mSize) {
+            break;
+        }
+
+        mActivePages.erase(it);
+
+        maxBytes -= page->mSize;
+        bytesReleased += page->mSize;
+
+        releasePage(page);
+    }
+
+    mTotalSize -= bytesReleased;
+    return bytesReleased;
+}
+
+size_t PageCache::moveFromStart(size_t maxBytes, PageCache *target) {
+    CHECK_EQ(mPageSize, target->mPageSize);
+
+    size_t bytesMoved = 0;
+
+    while (maxBytes > 0 && !mActivePages.empty()) {
+        List<Page *>::iterator it = mActivePages.begin();
+
+        Page *page = *it;
+
+        if (maxBytes < page->mSize) {
+            break;
+        }
+
+        mActivePages.erase(it);
+
+        maxBytes -= page->mSize;
+        bytesMoved += page->mSize;
+
+        target->appendPage(page);
+    }
+
+    mTotalSize -= bytesMoved;
+    return bytesMoved;
+}
+
 void PageCache::copy(size_t from, void *data, size_t size) {
     ALOGV("copy from %d size %d", from, size);
 
@@ -186,6 +241,10 @@ NuCachedSource2::NuCachedSource2(
       mLooper(new ALooper),
       mCache(new PageCache(kPageSize)),
       mCacheOffset(0),
+      mCachePinned(true),
+      mNumRangesCreated(1),
+      mRetainedBytes(0),
+      mRetainedThresholdBytes(kDefaultRetainedThreshold),
       mFinalStatus(OK),
       mLastAccessPos(0),
       mFetching(true),
@@ -193,6 +252,10 @@ NuCachedSource2::NuCachedSource2(
       mNumRetriesLeft(kMaxNumRetries),
       mHighwaterThresholdBytes(kDefaultHighWaterThreshold),
       mLowwaterThresholdBytes(kDefaultLowWaterThreshold),
+      mMaxHighwaterThresholdBytes(kDefaultHighWaterThreshold),
+      mPendingReadEnd(0),
+      mAdaptiveThresholds(true),
+      mEstimatedBandwidthBps(0),
       mKeepAliveIntervalUs(kDefaultKeepAliveIntervalUs),
       mDisconnectAtHighwatermark(disconnectAtHighwatermark),
       mIsNonBlockingMode(false),
@@ -217,7 +280,11 @@ NuCachedSource2::NuCachedSource2(
     mLooper->setName("NuCachedSource2");
     mLooper->registerHandler(mReflector);
     mLooper->start();
+}
 
+void NuCachedSource2::onFirstRef() {
+    // The reflector only holds a weak reference to us, a message handled
+    // before the creator took the first strong one would destroy us.
     Mutex::Autolock autoLock(mLock);
     (new AMessage(kWhatFetchMore, mReflector->id()))->post();
 }
@@ -228,6 +295,8 @@ NuCachedSource2::~NuCachedSource2() {
 
     delete mCache;
     mCache = NULL;
+
+    releaseRetainedRanges_l();
 }
 
 void NuCachedSource2::enableNonBlockingRead(bool flag) {
@@ -320,8 +389,40 @@ void NuCachedSource2::fetchInternal() {
 
     PageCache::Page *page = mCache->acquirePage();
 
-    ssize_t n = mSource->readAt(
-            mCacheOffset + mCache->totalSize(), page->mData, kPageSize);
+    off64_t fetchOffset = mCacheOffset + mCache->totalSize();
+
+    {
+        // If the active range has grown into a range we retained earlier,
+        // continue from memory instead of fetching the same bytes again.
+        Mutex::Autolock autoLock(mLock);
+
+        List<CachedRange>::iterator it = findRetainedRange_l(fetchOffset);
+        if (it != mRetainedRanges.end()) {
+            size_t avail =
+                (*it).mOffset + (*it).mCache->totalSize() - fetchOffset;
+
+            if (avail > 0) {
+                size_t copy = avail < kPageSize ? avail : kPageSize;
+                (*it).mCache->copy(fetchOffset - (*it).mOffset, page->mData, copy);
+
+                page->mSize = copy;
+                mCache->appendPage(page);
+
+                if (copy == avail && !(*it).mPinned) {
+                    mRetainedBytes -= (*it).mCache->totalSize();
+                    delete (*it).mCache;
+                    mRetainedRanges.erase(it);
+                }
+                return;
+            }
+        }
+    }
+
+    int64_t startUs = ALooper::GetNowUs();
+
+    ssize_t n = mSource->readAt(fetchOffset, page->mData, kPageSize);
+
+    int64_t delayUs = ALooper::GetNowUs() - startUs;
 
     Mutex::Autolock autoLock(mLock);
 
@@ -351,6 +452,8 @@ void NuCachedSource2::fetchInternal() {
 
         page->mSize = n;
         mCache->appendPage(page);
+
+        updateBandwidthEstimate_l(n, delayUs);
     }
 }
 
@@ -377,7 +480,7 @@ void NuCachedSource2::onFetch() {
 
         mLastFetchTimeUs = ALooper::GetNowUs();
 
-        if (mFetching && mCache->totalSize() >= mHighwaterThresholdBytes) {
+        if (mFetching && isCacheFull_l()) {
             ALOGI("Cache full, done prefetching for now");
             mFetching = false;
 
@@ -481,7 +584,12 @@ void NuCachedSource2::restartPrefetcherIfNecessary_l(
         maxBytes -= kGrayArea;
     }
 
-    size_t actualBytes = mCache->releaseFromStart(maxBytes);
+    size_t actualBytes = 0;
+    if (mCachePinned) {
+        actualBytes = detachPinnedHead_l(maxBytes);
+    }
+
+    actualBytes += mCache->releaseFromStart(maxBytes - actualBytes);
     mCacheOffset += actualBytes;
 
     ALOGI("restarting prefetcher, totalSize = %d", mCache->totalSize());
@@ -512,6 +620,10 @@ ssize_t NuCachedSource2::readAtInternal(off64_t offset, void *data, size_t size,
         return size;
     }
 
+    if (readFromRetainedRanges_l(offset, data, size)) {
+        return size;
+    }
+
     sp<AMessage> msg = new AMessage(kWhatRead, mReflector->id());
     msg->setInt64("offset", offset);
     msg->setPointer("data", data);
@@ -578,28 +690,24 @@ size_t NuCachedSource2::approxDataRemaining_l(status_t *finalStatus) const {
 }
 
 ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
-    CHECK_LE(size, (size_t)mHighwaterThresholdBytes);
+    CHECK_LE(size, (size_t)mMaxHighwaterThresholdBytes);
+
+    mPendingReadEnd = 0;
 
     ALOGV("readInternal offset %lld size %d", offset, size);
 
-    if (!mFetching) {
-        mLastAccessPos = offset;
-        restartPrefetcherIfNecessary_l(
-                false, // ignoreLowWaterThreshold
-                true); // force
+    if (readFromRetainedRanges_l(offset, data, size)) {
+        return size;
     }
 
     if (offset < mCacheOffset
             || offset >= (off64_t)(mCacheOffset + mCache->totalSize())) {
-        static const off64_t kPadding = 256 * 1024;
-
-        // In the presence of multiple decoded streams, once of them will
-        // trigger this seek request, the other one will request data "nearby"
-        // soon, adjust the seek position so that that subsequent request
-        // does not trigger another seek.
-        off64_t seekOffset = (offset > kPadding) ? offset - kPadding : 0;
-
-        seekInternal_l(seekOffset);
+        seekInternal_l(offset);
+    } else if (!mFetching) {
+        mLastAccessPos = offset;
+        restartPrefetcherIfNecessary_l(
+                false, // ignoreLowWaterThreshold
+                true); // force
     }
 
     size_t delta = offset - mCacheOffset;
@@ -628,10 +736,14 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
 
     ALOGV("deferring read");
 
+    mPendingReadEnd = offset + size;
+
     return -EAGAIN;
 }
 
 status_t NuCachedSource2::seekInternal_l(off64_t offset) {
+    static const off64_t kPadding = 256 * 1024;
+
     mLastAccessPos = offset;
 
     if (offset >= mCacheOffset
@@ -639,12 +751,51 @@ status_t NuCachedSource2::seekInternal_l(off64_t offset) {
         return OK;
     }
 
-    ALOGI("new range: offset= %lld", offset);
+    // A read deferred right after a seek comes back here until the padding
+    // in front of it is fetched, the range we're fetching will get there.
+    if (mFetching
+            && offset >= mCacheOffset
+            && offset <= (off64_t)(mCacheOffset + mCache->totalSize())
+                    + kPadding) {
+        return OK;
+    }
+
+    // A range that never got any data doesn't count as one of the pinned
+    // ones.
+    bool rangeIsEmpty = (mCache->totalSize() == 0);
 
-    mCacheOffset = offset;
+    retainCurrentRange_l();
 
-    size_t totalSize = mCache->totalSize();
-    CHECK_EQ(mCache->releaseFromStart(totalSize), totalSize);
+    List<CachedRange>::iterator it = findRetainedRange_l(offset);
+    if (it != mRetainedRanges.end()) {
+        ALOGI("resuming cached range: offset= %lld", (*it).mOffset);
+
+        delete mCache;
+        mCache = (*it).mCache;
+        mCacheOffset = (*it).mOffset;
+        mCachePinned = (*it).mPinned;
+
+        mRetainedBytes -= mCache->totalSize();
+        mRetainedRanges.erase(it);
+    } else {
+        // In the presence of multiple decoded streams, once of them will
+        // trigger this seek request, the other one will request data "nearby"
+        // soon, adjust the seek position so that that subsequent request
+        // does not trigger another seek.
+        offset = (offset > kPadding) ? offset - kPadding : 0;
+
+        ALOGI("new range: offset= %lld", offset);
+
+        mCacheOffset = offset;
+        mLastAccessPos = offset;
+
+        if (!rangeIsEmpty) {
+            mCachePinned = (mNumRangesCreated < kNumPinnedRanges);
+            ++mNumRangesCreated;
+        }
+    }
+
+    trimRetainedRanges_l();
 
     mNumRetriesLeft = kMaxNumRetries;
     mFetching = true;
@@ -652,6 +803,250 @@ status_t NuCachedSource2::seekInternal_l(off64_t offset) {
     return OK;
 }
 
+bool NuCachedSource2::readFromRetainedRanges_l(
+        off64_t offset, void *data, size_t size) {
+    for (List<CachedRange>::iterator it = mRetainedRanges.begin();
+            it != mRetainedRanges.end(); ++it) {
+        CachedRange &range = *it;
+
+        if (offset >= range.mOffset
+                && offset + size
+                    <= range.mOffset + (off64_t)range.mCache->totalSize()) {
+            range.mCache->copy(offset - range.mOffset, data, size);
+            range.mLastAccessUs = ALooper::GetNowUs();
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+List<NuCachedSource2::CachedRange>::iterator
+NuCachedSource2::findRetainedRange_l(off64_t offset) {
+    for (List<CachedRange>::iterator it = mRetainedRanges.begin();
+            it != mRetainedRanges.end(); ++it) {
+        const CachedRange &range = *it;
+
+        if (offset >= range.mOffset
+                && offset < range.mOffset + (off64_t)range.mCache->totalSize()) {
+            return it;
+        }
+    }
+
+    return mRetainedRanges.end();
+}
+
+void NuCachedSource2::retainCurrentRange_l() {
+    size_t totalSize = mCache->totalSize();
+
+    if (totalSize == 0) {
+        return;
+    }
+
+    if (mCachePinned && totalSize > kMaxPinnedRangeBytes) {
+        totalSize -= mCache->releaseFromEnd(totalSize - kMaxPinnedRangeBytes);
+    }
+
+    off64_t rangeEnd = mCacheOffset + totalSize;
+
+    // Any unpinned range entirely covered by the one we're about to retain
+    // is redundant.
+    List<CachedRange>::iterator it = mRetainedRanges.begin();
+    while (it != mRetainedRanges.end()) {
+        const CachedRange &range = *it;
+
+        if (!range.mPinned
+                && range.mOffset >= mCacheOffset
+                && range.mOffset + (off64_t)range.mCache->totalSize()
+                    <= rangeEnd) {
+            mRetainedBytes -= range.mCache->totalSize();
+            delete range.mCache;
+            it = mRetainedRanges.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    CachedRange range;
+    range.mOffset = mCacheOffset;
+    range.mCache = mCache;
+    range.mLastAccessUs = ALooper::GetNowUs();
+    range.mPinned = mCachePinned;
+    mRetainedRanges.push_back(range);
+
+    mRetainedBytes += totalSize;
+
+    mCache = new PageCache(kPageSize);
+    mCachePinned = false;
+}
+
+size_t NuCachedSource2::detachPinnedHead_l(size_t maxBytes) {
+    mCachePinned = false;
+
+    if (maxBytes > kMaxPinnedRangeBytes) {
+        maxBytes = kMaxPinnedRangeBytes;
+    }
+
+    PageCache *head = new PageCache(kPageSize);
+    size_t bytesMoved = mCache->moveFromStart(maxBytes, head);
+
+    if (bytesMoved == 0) {
+        delete head;
+        return 0;
+    }
+
+    CachedRange range;
+    range.mOffset = mCacheOffset;
+    range.mCache = head;
+    range.mLastAccessUs = ALooper::GetNowUs();
+    range.mPinned = true;
+    mRetainedRanges.push_back(range);
+
+    mRetainedBytes += bytesMoved;
+
+    return bytesMoved;
+}
+
+size_t NuCachedSource2::retainedBudget_l() const {
+    size_t budget = mRetainedThresholdBytes;
+
+    // Leave at least half of the high watermark to the active range.
+    if (budget > mHighwaterThresholdBytes / 2) {
+        budget = mHighwaterThresholdBytes / 2;
+    }
+
+    return budget;
+}
+
+void NuCachedSource2::trimRetainedRanges_l() {
+    size_t budget = retainedBudget_l();
+
+    while (mRetainedBytes > budget
+            || mRetainedRanges.size() > kMaxNumRetainedRanges) {
+        List<CachedRange>::iterator lru = mRetainedRanges.end();
+
+        for (List<CachedRange>::iterator it = mRetainedRanges.begin();
+                it != mRetainedRanges.end(); ++it) {
+            if ((*it).mPinned) {
+                continue;
+            }
+
+            if (lru == mRetainedRanges.end()
+                    || (*it).mLastAccessUs < (*lru).mLastAccessUs) {
+                lru = it;
+            }
+        }
+
+        if (lru == mRetainedRanges.end()) {
+            // Only pinned ranges left, they go too if even those don't fit
+            // a small high watermark.
+            if (mRetainedBytes <= budget) {
+                break;
+            }
+
+            for (List<CachedRange>::iterator it = mRetainedRanges.begin();
+                    it != mRetainedRanges.end(); ++it) {
+                if (lru == mRetainedRanges.end()
+                        || (*it).mLastAccessUs < (*lru).mLastAccessUs) {
+                    lru = it;
+                }
+            }
+        }
+
+        ALOGV("evicting cached range: offset= %lld, size= %d",
+             (*lru).mOffset, (*lru).mCache->totalSize());
+
+        mRetainedBytes -= (*lru).mCache->totalSize();
+        delete (*lru).mCache;
+        mRetainedRanges.erase(lru);
+    }
+}
+
+// The active and the retained ranges together stay below the high
+// watermark, except while a read needs more of the active range.
+bool NuCachedSource2::isCacheFull_l() const {
+    if (mCache->totalSize() + mRetainedBytes < mHighwaterThresholdBytes) {
+        return false;
+    }
+
+    return mCacheOffset + (off64_t)mCache->totalSize() >= mPendingReadEnd;
+}
+
+void NuCachedSource2::releaseRetainedRanges_l() {
+    for (List<CachedRange>::iterator it = mRetainedRanges.begin();
+            it != mRetainedRanges.end(); ++it) {
+        delete (*it).mCache;
+    }
+
+    mRetainedRanges.clear();
+    mRetainedBytes = 0;
+}
+
+void NuCachedSource2::updateBandwidthEstimate_l(
+        size_t numBytes, int64_t delayUs) {
+    mEstimatedBandwidthBps =
+        UpdateBandwidthEstimate(mEstimatedBandwidthBps, numBytes, delayUs);
+
+    if (!mAdaptiveThresholds || mEstimatedBandwidthBps == 0) {
+        return;
+    }
+
+    ComputeWatermarks(
+            mEstimatedBandwidthBps, mMaxHighwaterThresholdBytes,
+            &mLowwaterThresholdBytes, &mHighwaterThresholdBytes);
+
+    // A lower high watermark leaves less room for the retained ranges.
+    trimRetainedRanges_l();
+}
+
+// static
+int64_t NuCachedSource2::UpdateBandwidthEstimate(
+        int64_t estimateBps, size_t numBytes, int64_t delayUs) {
+    if (delayUs <= 0) {
+        return estimateBps;
+    }
+
+    int64_t bps = numBytes * 1000000ll / delayUs;
+
+    if (estimateBps == 0) {
+        return bps;
+    }
+
+    return (7 * estimateBps + bps) / 8;
+}
+
+// static
+void NuCachedSource2::ComputeWatermarks(
+        int64_t bandwidthBps, size_t maxHighwater,
+        size_t *lowwater, size_t *highwater) {
+    int64_t low = bandwidthBps * kLowWaterDurationUs / 1000000ll;
+    if (low < kMinLowWaterThreshold) {
+        low = kMinLowWaterThreshold;
+    } else if (low > kMaxLowWaterThreshold) {
+        low = kMaxLowWaterThreshold;
+    }
+
+    int64_t high = bandwidthBps * kHighWaterDurationUs / 1000000ll;
+    if (high < kMinHighWaterThreshold) {
+        high = kMinHighWaterThreshold;
+    }
+    if (high < low + kMinLowWaterThreshold) {
+        high = low + kMinLowWaterThreshold;
+    }
+    if (high > (int64_t)maxHighwater) {
+        high = maxHighwater;
+    }
+
+    // Keep the low watermark below the high one whatever the maximum is.
+    if (low >= high) {
+        low = high / 2;
+    }
+
+    *lowwater = low;
+    *highwater = high;
+}
+
 void NuCachedSource2::resumeFetchingIfNecessary() {
     Mutex::Autolock autoLock(mLock);
 
@@ -717,12 +1112,18 @@ void NuCachedSource2::updateCacheParamsFromString(const char *s) {
         mHighwaterThresholdBytes = kDefaultHighWaterThreshold;
     }
 
+    mMaxHighwaterThresholdBytes = mHighwaterThresholdBytes;
+
     if (keepAliveSecs >= 0) {
         mKeepAliveIntervalUs = keepAliveSecs * 1000000ll;
     } else {
         mKeepAliveIntervalUs = kDefaultKeepAliveIntervalUs;
     }
 
+    // Explicitly configured watermarks take precedence over the ones
+    // derived from the measured bandwidth.
+    mAdaptiveThresholds = false;
+
     ALOGV("lowwater = %d bytes, highwater = %d bytes, keepalive = %lld us",
          mLowwaterThresholdBytes,
          mHighwaterThresholdBytes,
@@ -46,7 +46,9 @@ struct SampleTable::CompositionDeltaLookup {
     void setEntries(
             const uint32_t *deltaEntries, size_t numDeltaEntries);
 
-    uint32_t getCompositionTimeOffset(uint32_t sampleIndex);
+    // ctts offsets are signed (version 1 boxes, and version 0 boxes
+    // that are written that way in practice).
+    int32_t getCompositionTimeOffset(uint32_t sampleIndex);
 
 private:
     Mutex mLock;
@@ -77,7 +79,7 @@ void SampleTable::CompositionDeltaLookup::setEntries(
     mCurrentEntrySampleIndex = 0;
 }
 
-uint32_t SampleTable::CompositionDeltaLookup::getCompositionTimeOffset(
+int32_t SampleTable::CompositionDeltaLookup::getCompositionTimeOffset(
         uint32_t sampleIndex) {
     Mutex::Autolock autolock(mLock);
 
@@ -93,7 +95,7 @@ uint32_t SampleTable::CompositionDeltaLookup::getCompositionTimeOffset(
     while (mCurrentDeltaEntry < mNumDeltaEntries) {
         uint32_t sampleCount = mDeltaEntries[2 * mCurrentDeltaEntry];
         if (sampleIndex < mCurrentEntrySampleIndex + sampleCount) {
-            return mDeltaEntries[2 * mCurrentDeltaEntry + 1];
+            return (int32_t)mDeltaEntries[2 * mCurrentDeltaEntry + 1];
         }
 
         mCurrentEntrySampleIndex += sampleCount;
@@ -105,6 +107,267 @@ uint32_t SampleTable::CompositionDeltaLookup::getCompositionTimeOffset(
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Per-sample properties stored as separate arrays so that the binary
+// searches and linear scans only touch the field they need.
+struct SampleTable::SampleIndex {
+    SampleIndex(uint32_t numSamples);
+    ~SampleIndex();
+
+    status_t build(SampleTable *table);
+
+    uint32_t numSamples() const { return mNumSamples; }
+    size_t maxSampleSize() const { return mMaxSampleSize; }
+
+    off64_t offset(uint32_t sampleIndex) const {
+        return mOffsets[sampleIndex];
+    }
+
+    size_t size(uint32_t sampleIndex) const {
+        return mSizes[sampleIndex];
+    }
+
+    uint64_t compositionTime(uint32_t sampleIndex) const {
+        uint64_t time = mDecodeTimes[sampleIndex];
+        if (mCompositionDeltas != NULL) {
+            time += mCompositionDeltas[sampleIndex];
+        }
+        return time;
+    }
+
+    bool isSyncSample(uint32_t sampleIndex) const {
+        return mSyncBits == NULL
+            || (mSyncBits[sampleIndex / 32] & (1u << (sampleIndex % 32)));
+    }
+
+private:
+    uint32_t mNumSamples;
+    size_t mMaxSampleSize;
+
+    off64_t *mOffsets;
+    uint32_t *mSizes;
+    uint64_t *mDecodeTimes;
+    int32_t *mCompositionDeltas;  // NULL unless there's a ctts box.
+    uint32_t *mSyncBits;          // NULL if every sample is a sync sample.
+
+    status_t readSizes(SampleTable *table);
+    status_t readOffsets(SampleTable *table);
+    status_t readTimes(SampleTable *table);
+    void readSyncSamples(SampleTable *table);
+
+    DISALLOW_EVIL_CONSTRUCTORS(SampleIndex);
+};
+
+SampleTable::SampleIndex::SampleIndex(uint32_t numSamples)
+    : mNumSamples(numSamples),
+      mMaxSampleSize(0),
+      mOffsets(new off64_t[numSamples]),
+      mSizes(new uint32_t[numSamples]),
+      mDecodeTimes(new uint64_t[numSamples]),
+      mCompositionDeltas(NULL),
+      mSyncBits(NULL) {
+}
+
+SampleTable::SampleIndex::~SampleIndex() {
+    delete[] mSyncBits;
+    mSyncBits = NULL;
+
+    delete[] mCompositionDeltas;
+    mCompositionDeltas = NULL;
+
+    delete[] mDecodeTimes;
+    mDecodeTimes = NULL;
+
+    delete[] mSizes;
+    mSizes = NULL;
+
+    delete[] mOffsets;
+    mOffsets = NULL;
+}
+
+status_t SampleTable::SampleIndex::build(SampleTable *table) {
+    status_t err;
+    if ((err = readSizes(table)) != OK
+            || (err = readOffsets(table)) != OK
+            || (err = readTimes(table)) != OK) {
+        return err;
+    }
+
+    readSyncSamples(table);
+
+    return OK;
+}
+
+status_t SampleTable::SampleIndex::readSizes(SampleTable *table) {
+    if (table->mDefaultSampleSize > 0) {
+        for (uint32_t i = 0; i < mNumSamples; ++i) {
+            mSizes[i] = table->mDefaultSampleSize;
+        }
+
+        mMaxSampleSize = table->mDefaultSampleSize;
+        return OK;
+    }
+
+    size_t fieldSize = table->mSampleSizeFieldSize;
+    size_t numBytes = ((uint64_t)mNumSamples * fieldSize + 7) / 8;
+
+    uint8_t *data = new uint8_t[numBytes];
+    if (table->mDataSource->readAt(
+                table->mSampleSizeOffset + 12, data, numBytes)
+            < (ssize_t)numBytes) {
+        delete[] data;
+        return ERROR_IO;
+    }
+
+    for (uint32_t i = 0; i < mNumSamples; ++i) {
+        uint32_t size;
+        switch (fieldSize) {
+            case 32:
+                size = U32_AT(&data[4 * i]);
+                break;
+
+            case 16:
+                size = U16_AT(&data[2 * i]);
+                break;
+
+            case 8:
+                size = data[i];
+                break;
+
+            default:
+                CHECK_EQ(fieldSize, 4u);
+                size = (i & 1) ? data[i / 2] & 0x0f : data[i / 2] >> 4;
+                break;
+        }
+
+        mSizes[i] = size;
+
+        if (size > mMaxSampleSize) {
+            mMaxSampleSize = size;
+        }
+    }
+
+    delete[] data;
+
+    return OK;
+}
+
+status_t SampleTable::SampleIndex::readOffsets(SampleTable *table) {
+    bool is64 = (table->mChunkOffsetType == kChunkOffsetType64);
+    size_t numChunks = table->mNumChunkOffsets;
+    size_t numBytes = numChunks * (is64 ? 8 : 4);
+
+    uint8_t *data = new uint8_t[numBytes];
+    if (table->mDataSource->readAt(
+                table->mChunkOffsetOffset + 8, data, numBytes)
+            < (ssize_t)numBytes) {
+        delete[] data;
+        return ERROR_IO;
+    }
+
+    // Walk the sample-to-chunk runs exactly like SampleIterator does.
+    uint32_t sampleIndex = 0;
+    for (uint32_t i = 0;
+            i < table->mNumSampleToChunkOffsets && sampleIndex < mNumSamples;
+            ++i) {
+        const SampleToChunkEntry *entry = &table->mSampleToChunkEntries[i];
+
+        if (entry->samplesPerChunk == 0) {
+            delete[] data;
+            return ERROR_MALFORMED;
+        }
+
+        uint32_t stopChunk =
+            (i + 1 < table->mNumSampleToChunkOffsets)
+                ? entry[1].startChunk : 0xffffffff;
+
+        for (uint32_t chunk = entry->startChunk;
+                chunk < stopChunk && sampleIndex < mNumSamples; ++chunk) {
+            if (chunk >= numChunks) {
+                delete[] data;
+                return ERROR_OUT_OF_RANGE;
+            }
+
+            off64_t offset = is64
+                ? (off64_t)U64_AT(&data[8 * chunk]) : U32_AT(&data[4 * chunk]);
+
+            for (uint32_t j = 0;
+                    j < entry->samplesPerChunk && sampleIndex < mNumSamples;
+                    ++j) {
+                mOffsets[sampleIndex] = offset;
+                offset += mSizes[sampleIndex];
+                ++sampleIndex;
+            }
+        }
+    }
+
+    delete[] data;
+
+    return (sampleIndex == mNumSamples) ? OK : ERROR_OUT_OF_RANGE;
+}
+
+status_t SampleTable::SampleIndex::readTimes(SampleTable *table) {
+    uint32_t sampleIndex = 0;
+    uint64_t time = 0;
+
+    for (uint32_t i = 0;
+            i < table->mTimeToSampleCount && sampleIndex < mNumSamples; ++i) {
+        uint32_t n = table->mTimeToSample[2 * i];
+        uint32_t delta = table->mTimeToSample[2 * i + 1];
+
+        for (uint32_t j = 0; j < n && sampleIndex < mNumSamples; ++j) {
+            mDecodeTimes[sampleIndex++] = time;
+            time += delta;
+        }
+    }
+
+    if (sampleIndex < mNumSamples) {
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    if (table->mCompositionTimeDeltaEntries == NULL) {
+        return OK;
+    }
+
+    mCompositionDeltas = new int32_t[mNumSamples];
+
+    sampleIndex = 0;
+    for (size_t i = 0; i < table->mNumCompositionTimeDeltaEntries
+            && sampleIndex < mNumSamples; ++i) {
+        uint32_t n = table->mCompositionTimeDeltaEntries[2 * i];
+        int32_t delta = (int32_t)table->mCompositionTimeDeltaEntries[2 * i + 1];
+
+        for (uint32_t j = 0; j < n && sampleIndex < mNumSamples; ++j) {
+            mCompositionDeltas[sampleIndex++] = delta;
+        }
+    }
+
+    while (sampleIndex < mNumSamples) {
+        mCompositionDeltas[sampleIndex++] = 0;
+    }
+
+    return OK;
+}
+
+void SampleTable::SampleIndex::readSyncSamples(SampleTable *table) {
+    if (table->mSyncSampleOffset < 0) {
+        return;
+    }
+
+    size_t numWords = (mNumSamples + 31) / 32;
+    mSyncBits = new uint32_t[numWords];
+    memset(mSyncBits, 0, numWords * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < table->mNumSyncSamples; ++i) {
+        uint32_t x = table->mSyncSamples[i];
+
+        if (x < mNumSamples) {
+            mSyncBits[x / 32] |= 1u << (x % 32);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 SampleTable::SampleTable(const sp<DataSource> &source)
     : mDataSource(source),
       mChunkOffsetOffset(-1),
@@ -126,11 +389,16 @@ SampleTable::SampleTable(const sp<DataSource> &source)
       mNumSyncSamples(0),
       mSyncSamples(NULL),
       mLastSyncSampleIndex(0),
+      mSampleIndex(NULL),
+      mSampleIndexAttempted(false),
       mSampleToChunkEntries(NULL) {
     mSampleIterator = new SampleIterator(this);
 }
 
 SampleTable::~SampleTable() {
+    delete mSampleIndex;
+    mSampleIndex = NULL;
+
     delete[] mSampleToChunkEntries;
     mSampleToChunkEntries = NULL;
 
@@ -445,6 +713,11 @@ status_t SampleTable::getMaxSampleSize(size_t *max_size) {
 
     *max_size = 0;
 
+    if (mSampleIndex != NULL) {
+        *max_size = mSampleIndex->maxSampleSize();
+        return OK;
+    }
+
     for (uint32_t i = 0; i < mNumSampleSizes; ++i) {
         size_t sample_size;
         status_t err = getSampleSize_l(i, &sample_size);
@@ -488,6 +761,20 @@ void SampleTable::buildSampleEntriesTable() {
 
     mSampleTimeEntries = new SampleTimeEntry[mNumSampleSizes];
 
+    if (mSampleIndex != NULL) {
+        for (uint32_t i = 0; i < mNumSampleSizes; ++i) {
+            mSampleTimeEntries[i].mSampleIndex = i;
+            mSampleTimeEntries[i].mCompositionTime =
+                mSampleIndex->compositionTime(i);
+        }
+
+        if (mCompositionTimeDeltaEntries != NULL) {
+            qsort(mSampleTimeEntries, mNumSampleSizes, sizeof(SampleTimeEntry),
+                  CompareIncreasingTime);
+        }
+        return;
+    }
+
     uint32_t sampleIndex = 0;
     uint64_t sampleTime = 0;
 
@@ -503,7 +790,7 @@ void SampleTable::buildSampleEntriesTable() {
 
                 mSampleTimeEntries[sampleIndex].mSampleIndex = sampleIndex;
 
-                uint32_t compTimeDelta =
+                int32_t compTimeDelta =
                     mCompositionDeltaLookup->getCompositionTimeOffset(
                             sampleIndex);
 
@@ -516,12 +803,20 @@ void SampleTable::buildSampleEntriesTable() {
         }
     }
 
-    qsort(mSampleTimeEntries, mNumSampleSizes, sizeof(SampleTimeEntry),
-          CompareIncreasingTime);
+    // Without composition time offsets the times are already in
+    // increasing order.
+    if (mCompositionTimeDeltaEntries != NULL) {
+        qsort(mSampleTimeEntries, mNumSampleSizes, sizeof(SampleTimeEntry),
+              CompareIncreasingTime);
+    }
 }
 
 status_t SampleTable::findSampleAtTime(
         uint64_t req_time, uint32_t *sample_index, uint32_t flags) {
+    // Seeking is where the on-demand lookups get expensive, index the
+    // track the first time it happens. Failure is not fatal.
+    buildSampleIndex();
+
     buildSampleEntriesTable();
 
     uint32_t left = 0;
@@ -652,26 +947,24 @@ status_t SampleTable::findSyncSampleNear(
 
         // our sample lies between sync samples x and y.
 
-        status_t err = mSampleIterator->seekTo(start_sample_index);
+        uint64_t sample_time;
+        status_t err = getSampleTime_l(start_sample_index, &sample_time);
         if (err != OK) {
             return err;
         }
 
-        uint64_t sample_time = mSampleIterator->getSampleTime();
-
-        err = mSampleIterator->seekTo(x);
+        uint64_t x_time;
+        err = getSampleTime_l(x, &x_time);
         if (err != OK) {
             return err;
         }
-        uint64_t x_time = mSampleIterator->getSampleTime();
 
-        err = mSampleIterator->seekTo(y);
+        uint64_t y_time;
+        err = getSampleTime_l(y, &y_time);
         if (err != OK) {
             return err;
         }
 
-        uint64_t y_time = mSampleIterator->getSampleTime();
-
         if (abs_difference(x_time, sample_time)
                 > abs_difference(y_time, sample_time)) {
             // Pick the sync sample closest (timewise) to the start-sample.
@@ -770,10 +1063,74 @@ status_t SampleTable::findThumbnailSample(uint32_t *sample_index) {
 
 status_t SampleTable::getSampleSize_l(
         uint32_t sampleIndex, size_t *sampleSize) {
+    if (mSampleIndex != NULL) {
+        if (sampleIndex >= mSampleIndex->numSamples()) {
+            *sampleSize = 0;
+            return ERROR_OUT_OF_RANGE;
+        }
+
+        *sampleSize = mSampleIndex->size(sampleIndex);
+        return OK;
+    }
+
     return mSampleIterator->getSampleSizeDirect(
             sampleIndex, sampleSize);
 }
 
+status_t SampleTable::getSampleTime_l(
+        uint32_t sampleIndex, uint64_t *sampleTime) {
+    if (mSampleIndex != NULL) {
+        if (sampleIndex >= mSampleIndex->numSamples()) {
+            return ERROR_END_OF_STREAM;
+        }
+
+        *sampleTime = mSampleIndex->compositionTime(sampleIndex);
+        return OK;
+    }
+
+    status_t err = mSampleIterator->seekTo(sampleIndex);
+    if (err != OK) {
+        return err;
+    }
+
+    *sampleTime = mSampleIterator->getSampleTime();
+    return OK;
+}
+
+status_t SampleTable::buildSampleIndex() {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mSampleIndexAttempted) {
+        return (mSampleIndex != NULL) ? OK : ERROR_UNSUPPORTED;
+    }
+
+    mSampleIndexAttempted = true;
+
+    if (!isValid() || mNumSampleSizes == 0) {
+        return ERROR_MALFORMED;
+    }
+
+    if (mNumSampleSizes > kMaxNumIndexedSamples) {
+        ALOGV("Not indexing track with %d samples.", mNumSampleSizes);
+        return ERROR_UNSUPPORTED;
+    }
+
+    SampleIndex *index = new SampleIndex(mNumSampleSizes);
+
+    status_t err = index->build(this);
+    if (err != OK) {
+        ALOGW("Failed to build sample index (%d), using on-demand lookups.",
+             err);
+
+        delete index;
+        return err;
+    }
+
+    mSampleIndex = index;
+
+    return OK;
+}
+
 status_t SampleTable::getMetaDataForSample(
         uint32_t sampleIndex,
         off64_t *offset,
@@ -782,6 +1139,30 @@ status_t SampleTable::getMetaDataForSample(
         bool *isSyncSample) {
     Mutex::Autolock autoLock(mLock);
 
+    if (mSampleIndex != NULL) {
+        if (sampleIndex >= mSampleIndex->numSamples()) {
+            return ERROR_END_OF_STREAM;
+        }
+
+        if (offset) {
+            *offset = mSampleIndex->offset(sampleIndex);
+        }
+
+        if (size) {
+            *size = mSampleIndex->size(sampleIndex);
+        }
+
+        if (compositionTime) {
+            *compositionTime = mSampleIndex->compositionTime(sampleIndex);
+        }
+
+        if (isSyncSample) {
+            *isSyncSample = mSampleIndex->isSyncSample(sampleIndex);
+        }
+
+        return OK;
+    }
+
     status_t err;
     if ((err = mSampleIterator->seekTo(sampleIndex)) != OK) {
         return err;
@@ -824,7 +1205,7 @@ status_t SampleTable::getMetaDataForSample(
     return OK;
 }
 
-uint32_t SampleTable::getCompositionTimeOffset(uint32_t sampleIndex) {
+int32_t SampleTable::getCompositionTimeOffset(uint32_t sampleIndex) {
     return mCompositionDeltaLookup->getCompositionTimeOffset(sampleIndex);
 }
 
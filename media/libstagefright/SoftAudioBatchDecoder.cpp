@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SoftAudioBatchDecoder"
+#include <utils/Log.h>
+
+#include "include/SoftAudioBatchDecoder.h"
+
+#include "include/ESDS.h"
+#include "include/SoftAudioBatch.h"
+#include "include/SoftOMXComponent.h"
+#include "omx/SoftOMXPlugin.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+static const struct {
+    const char *mMime;
+    const char *mComponentName;
+} kDecoders[] = {
+    { MEDIA_MIMETYPE_AUDIO_MPEG, "OMX.google.mp3.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_AAC, "OMX.google.aac.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_VORBIS, "OMX.google.vorbis.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_AMR_NB, "OMX.google.amrnb.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_AMR_WB, "OMX.google.amrwb.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_G711_ALAW, "OMX.google.g711.alaw.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_G711_MLAW, "OMX.google.g711.mlaw.decoder" },
+};
+
+static const size_t kNumDecoders = sizeof(kDecoders) / sizeof(kDecoders[0]);
+
+// Compressed data is handed to the decoder in spans of about this size, so
+// that the whole track never has to be in memory at once.
+static const size_t kMaxSpanSize = 256 * 1024;
+
+// decodeBatch() never calls back.
+static const OMX_CALLBACKTYPE kNoCallbacks = { NULL, NULL, NULL };
+
+static void appendUnit(
+        Vector<uint8_t> *data, Vector<size_t> *sizes,
+        const void *unit, size_t size) {
+    data->appendArray((const uint8_t *)unit, size);
+    sizes->push(size);
+}
+
+// static
+status_t SoftAudioBatchDecoder::Decode(
+        const sp<MediaSource> &source,
+        void *pcm, size_t capacity, size_t *size,
+        int32_t *sampleRate, int32_t *numChannels) {
+    sp<MetaData> meta = source->getFormat();
+
+    const char *mime;
+    CHECK(meta->findCString(kKeyMIMEType, &mime));
+
+    const char *componentName = NULL;
+    for (size_t i = 0; i < kNumDecoders; ++i) {
+        if (!strcasecmp(mime, kDecoders[i].mMime)) {
+            componentName = kDecoders[i].mComponentName;
+            break;
+        }
+    }
+
+    if (componentName == NULL) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    Vector<uint8_t> data;
+    Vector<size_t> sizes;
+
+    // Codec specific data, as OMXCodec::configureCodec() would submit it.
+    uint32_t type;
+    const void *csd;
+    size_t csdSize;
+    if (!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_AAC)
+            && meta->findData(kKeyESDS, &type, &csd, &csdSize)) {
+        ESDS esds(csd, csdSize);
+        if (esds.InitCheck() != OK) {
+            return ERROR_MALFORMED;
+        }
+
+        const void *info;
+        size_t infoSize;
+        esds.getCodecSpecificInfo(&info, &infoSize);
+
+        appendUnit(&data, &sizes, info, infoSize);
+    } else if (meta->findData(kKeyVorbisInfo, &type, &csd, &csdSize)) {
+        appendUnit(&data, &sizes, csd, csdSize);
+
+        if (!meta->findData(kKeyVorbisBooks, &type, &csd, &csdSize)) {
+            return ERROR_MALFORMED;
+        }
+        appendUnit(&data, &sizes, csd, csdSize);
+    }
+
+    size_t numConfigUnits = sizes.size();
+
+    bool isVorbis = !strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_VORBIS);
+
+    SoftOMXPlugin plugin;
+    OMX_COMPONENTTYPE *handle;
+    if (plugin.makeComponentInstance(
+                componentName, &kNoCallbacks, NULL, &handle) != OMX_ErrorNone) {
+        ALOGW("unable to instantiate %s", componentName);
+        return ERROR_UNSUPPORTED;
+    }
+
+    SoftOMXComponent *codec = (SoftOMXComponent *)handle->pComponentPrivate;
+
+    SoftAudioBatch batch;
+    batch.mPCM = (uint8_t *)pcm;
+    batch.mPCMCapacity = capacity;
+
+    int32_t isADTS;
+    batch.mIsADTS = meta->findInt32(kKeyIsADTS, &isADTS) && isADTS;
+
+    int32_t channelCount;
+    if (meta->findInt32(kKeyChannelCount, &channelCount)) {
+        batch.mChannelCount = channelCount;
+    }
+
+    status_t err = source->start();
+    bool started = (err == OK);
+
+    bool eos = false;
+    while (err == OK && !eos && !batch.isFull()) {
+        while (data.size() < kMaxSpanSize) {
+            MediaBuffer *buffer;
+            status_t readErr = source->read(&buffer);
+
+            if (readErr != OK) {
+                if (readErr != ERROR_END_OF_STREAM) {
+                    // Keep what was decoded so far, like a player would.
+                    ALOGW("read returned error %d", readErr);
+                }
+                eos = true;
+                break;
+            }
+
+            const uint8_t *unit =
+                (const uint8_t *)buffer->data() + buffer->range_offset();
+            size_t unitSize = buffer->range_length();
+
+            data.appendArray(unit, unitSize);
+
+            if (isVorbis) {
+                // The number of valid samples on the page is appended to
+                // each packet, see OMXCodec::drainInputBuffer().
+                int32_t numPageSamples;
+                if (!buffer->meta_data()->findInt32(
+                            kKeyValidSamples, &numPageSamples)) {
+                    numPageSamples = -1;
+                }
+
+                data.appendArray(
+                        (const uint8_t *)&numPageSamples,
+                        sizeof(numPageSamples));
+                unitSize += sizeof(numPageSamples);
+            }
+
+            sizes.push(unitSize);
+
+            buffer->release();
+            buffer = NULL;
+        }
+
+        batch.mData = data.array();
+        batch.mSizes = sizes.array();
+        batch.mNumUnits = sizes.size();
+        batch.mNumConfigUnits = numConfigUnits;
+        batch.mEndOfStream = eos;
+
+        err = codec->decodeBatch(&batch);
+
+        data.clear();
+        sizes.clear();
+        numConfigUnits = 0;
+    }
+
+    if (started) {
+        source->stop();
+    }
+
+    plugin.destroyComponentInstance(handle);
+    codec = NULL;
+
+    if (err != OK) {
+        return err;
+    }
+
+    if (batch.mPCMSize == 0) {
+        return ERROR_MALFORMED;
+    }
+
+    // What OMXCodec's SkipCutBuffer would have done to the output.
+    size_t frameSize = batch.mNumChannels * sizeof(int16_t);
+
+    int32_t delay;
+    if (meta->findInt32(kKeyEncoderDelay, &delay) && delay > 0) {
+        size_t skip = delay * frameSize;
+        if (skip > batch.mPCMSize) {
+            skip = batch.mPCMSize;
+        }
+
+        memmove(batch.mPCM, batch.mPCM + skip, batch.mPCMSize - skip);
+        batch.mPCMSize -= skip;
+    }
+
+    int32_t padding;
+    if (eos && !batch.isFull()
+            && meta->findInt32(kKeyEncoderPadding, &padding) && padding > 0) {
+        size_t cut = padding * frameSize;
+        if (cut > batch.mPCMSize) {
+            cut = batch.mPCMSize;
+        }
+
+        batch.mPCMSize -= cut;
+    }
+
+    ALOGV("decoded %zu bytes, %d Hz, %d channels",
+          batch.mPCMSize, batch.mSampleRate, batch.mNumChannels);
+
+    *size = batch.mPCMSize;
+    *sampleRate = batch.mSampleRate;
+    *numChannels = batch.mNumChannels;
+
+    return OK;
+}
+
+}  // namespace android
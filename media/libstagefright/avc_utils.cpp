@@ -30,14 +30,7 @@
 namespace android {
 
 unsigned parseUE(ABitReader *br) {
-    unsigned numZeroes = 0;
-    while (br->getBits(1) == 0) {
-        ++numZeroes;
-    }
-
-    unsigned x = br->getBits(numZeroes);
-
-    return x + (1u << numZeroes) - 1;
+    return br->getUE();
 }
 
 // Determine video dimensions from the sequence parameterset.
@@ -176,6 +169,64 @@ void FindAVCDimensions(
     }
 }
 
+// True iff any of the 4 bytes in "x" is 0x00.
+static inline bool HasZeroByte(uint32_t x) {
+    return ((x - 0x01010101) & ~x & 0x80808080) != 0;
+}
+
+ssize_t FindStartCode(const uint8_t *data, size_t size) {
+    size_t offset = 0;
+    while (offset + 2 < size) {
+        // A startcode can only begin at a 0x00 byte, skip whole words
+        // without any.
+        if (offset + 4 <= size) {
+            uint32_t x;
+            memcpy(&x, &data[offset], sizeof(x));
+
+            if (!HasZeroByte(x)) {
+                offset += 4;
+                continue;
+            }
+        }
+
+        uint8_t byte = data[offset + 2];
+        if (byte > 0x01) {
+            // No startcode can begin at offset, offset + 1 or offset + 2.
+            offset += 3;
+        } else if (byte == 0x01) {
+            if (data[offset] == 0x00 && data[offset + 1] == 0x00) {
+                return offset;
+            }
+            offset += 3;
+        } else if (data[offset + 1] != 0x00) {
+            offset += 2;
+        } else {
+            ++offset;
+        }
+    }
+
+    return -1;
+}
+
+ssize_t FindLongStartCode(const uint8_t *data, size_t size) {
+    size_t offset = 0;
+    while (offset + 3 < size) {
+        ssize_t pos = FindStartCode(&data[offset + 1], size - offset - 1);
+
+        if (pos < 0) {
+            return -1;
+        }
+
+        if (data[offset + pos] == 0x00) {
+            return offset + pos;
+        }
+
+        offset += pos + 1;
+    }
+
+    return -1;
+}
+
 status_t getNextNALUnit(
         const uint8_t **_data, size_t *_size,
         const uint8_t **nalStart, size_t *nalSize,
@@ -211,25 +262,16 @@ status_t getNextNALUnit(
 
     size_t startOffset = offset;
 
-    for (;;) {
-        while (offset < size && data[offset] != 0x01) {
-            ++offset;
-        }
+    // Have offset point at the 0x01 of the next startcode.
+    ssize_t nextStartCode =
+        FindStartCode(&data[startOffset], size - startOffset);
 
-        if (offset == size) {
-            if (startCodeFollows) {
-                offset = size + 2;
-                break;
-            }
-
-            return -EAGAIN;
-        }
-
-        if (data[offset - 1] == 0x00 && data[offset - 2] == 0x00) {
-            break;
-        }
-
-        ++offset;
+    if (nextStartCode >= 0) {
+        offset = startOffset + nextStartCode + 2;
+    } else if (startCodeFollows) {
+        offset = size + 2;
+    } else {
+        return -EAGAIN;
     }
 
     size_t endOffset = offset - 2;
@@ -88,6 +88,7 @@ status_t ChromiumHTTPDataSource::connect_l(
 
     mURI = uri;
     mContentType = String8("application/octet-stream");
+    mCacheValidator.clear();
 
     if (headers != NULL) {
         mHeaders = *headers;
@@ -114,7 +115,8 @@ void ChromiumHTTPDataSource::onRedirect(const char *url) {
 }
 
 void ChromiumHTTPDataSource::onConnectionEstablished(
-        int64_t contentSize, const char *contentType) {
+        int64_t contentSize, const char *contentType,
+        const char *cacheValidator) {
     Mutex::Autolock autoLock(mLock);
 
     if (mState != CONNECTING) {
@@ -126,6 +128,7 @@ void ChromiumHTTPDataSource::onConnectionEstablished(
     mState = CONNECTED;
     mContentSize = (contentSize < 0) ? -1 : contentSize + mCurrentOffset;
     mContentType = String8(contentType);
+    mCacheValidator = String8(cacheValidator);
     mCondition.broadcast();
 }
 
@@ -320,6 +323,17 @@ String8 ChromiumHTTPDataSource::getMIMEType() const {
     return mContentType;
 }
 
+status_t ChromiumHTTPDataSource::getCacheValidator(String8 *validator) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mCacheValidator.isEmpty()) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    *validator = mCacheValidator;
+    return OK;
+}
+
 void ChromiumHTTPDataSource::clearDRMState_l() {
     if (mDecryptHandle != NULL) {
         // To release mDecryptHandle
@@ -450,8 +450,20 @@ void SfDelegate::OnResponseStarted(net::URLRequest *request) {
     std::string contentType;
     request->GetResponseHeaderByName("Content-Type", &contentType);
 
+    // Prefer the strong ETag validator, fall back to Last-Modified.
+    std::string cacheValidator;
+    std::string etag, lastModified;
+    request->GetResponseHeaderByName("ETag", &etag);
+    request->GetResponseHeaderByName("Last-Modified", &lastModified);
+    if (!etag.empty()) {
+        cacheValidator = "etag:" + etag;
+    } else if (!lastModified.empty()) {
+        cacheValidator = "last-modified:" + lastModified;
+    }
+
     mOwner->onConnectionEstablished(
-            request->GetExpectedContentSize(), contentType.c_str());
+            request->GetExpectedContentSize(), contentType.c_str(),
+            cacheValidator.c_str());
 }
 
 void SfDelegate::OnReadCompleted(net::URLRequest *request, int bytes_read) {
@@ -19,6 +19,7 @@
 #include <utils/Log.h>
 
 #include "SoftAAC2.h"
+#include "SoftAudioBatch.h"
 
 #include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
@@ -583,6 +584,197 @@ void SoftAAC2::onQueueFilled(OMX_U32 portIndex) {
     }
 }
 
+status_t SoftAAC2::decodeBatch(SoftAudioBatch *batch) {
+    // big enough for 6 channels of decoded HE-AAC
+    INT_PCM scratch[2048 * MAX_CHANNEL_COUNT];
+
+    UCHAR* inBuffer[FILEREAD_MAX_LAYERS];
+    UINT inBufferLength[FILEREAD_MAX_LAYERS] = {0};
+    UINT bytesValid[FILEREAD_MAX_LAYERS] = {0};
+
+    mIsADTS = batch->mIsADTS;
+
+    const uint8_t *data = batch->mData;
+    for (size_t i = 0; i < batch->mNumUnits; data += batch->mSizes[i++]) {
+        if (i < batch->mNumConfigUnits) {
+            inBuffer[0] = const_cast<UCHAR *>(data);
+            inBufferLength[0] = batch->mSizes[i];
+
+            AAC_DECODER_ERROR decoderErr =
+                aacDecoder_ConfigRaw(mAACDecoder,
+                                     inBuffer,
+                                     inBufferLength);
+
+            if (decoderErr != AAC_DEC_OK) {
+                ALOGE("aacDecoder_ConfigRaw returned error %d", decoderErr);
+                return ERROR_MALFORMED;
+            }
+
+            if (mInputBufferCount == 0) {
+                ++mInputBufferCount;
+            }
+
+            if (mStreamInfo->sampleRate && mStreamInfo->numChannels) {
+                maybeConfigureDownmix();
+            }
+            continue;
+        }
+
+        if (!isConfigured()) {
+            ALOGE("no codec specific data before the first access unit");
+            return ERROR_MALFORMED;
+        }
+
+        size_t offset = 0;
+        while (offset < batch->mSizes[i]) {
+            const uint8_t *inPtr = data + offset;
+            size_t inSize = batch->mSizes[i] - offset;
+
+            if (mIsADTS) {
+                if (inSize < 7) {
+                    ALOGE("Audio data too short to contain even the ADTS "
+                          "header. Got %zu bytes.", inSize);
+                    return ERROR_MALFORMED;
+                }
+
+                bool protectionAbsent = (inPtr[1] & 1);
+
+                unsigned aac_frame_length =
+                    ((inPtr[3] & 3) << 11)
+                    | (inPtr[4] << 3)
+                    | (inPtr[5] >> 5);
+
+                if (inSize < aac_frame_length) {
+                    ALOGE("Not enough audio data for the complete frame. "
+                          "Got %zu bytes, frame size according to the ADTS "
+                          "header is %u bytes.", inSize, aac_frame_length);
+                    return ERROR_MALFORMED;
+                }
+
+                size_t adtsHeaderSize = (protectionAbsent ? 7 : 9);
+
+                inBuffer[0] = const_cast<UCHAR *>(inPtr) + adtsHeaderSize;
+                inBufferLength[0] = aac_frame_length - adtsHeaderSize;
+
+                offset += adtsHeaderSize;
+            } else {
+                inBuffer[0] = const_cast<UCHAR *>(inPtr);
+                inBufferLength[0] = inSize;
+            }
+
+            INT_PCM *outBuffer = static_cast<INT_PCM *>(
+                    batch->outputBuffer(sizeof(scratch), scratch));
+
+            bytesValid[0] = inBufferLength[0];
+
+            int prevSampleRate = mStreamInfo->sampleRate;
+            int prevNumChannels = mStreamInfo->numChannels;
+
+            AAC_DECODER_ERROR decoderErr = AAC_DEC_NOT_ENOUGH_BITS;
+            while (bytesValid[0] > 0 && decoderErr == AAC_DEC_NOT_ENOUGH_BITS) {
+                aacDecoder_Fill(mAACDecoder,
+                                inBuffer,
+                                inBufferLength,
+                                bytesValid);
+                mDecoderHasData = true;
+
+                decoderErr = aacDecoder_DecodeFrame(mAACDecoder,
+                                                    outBuffer,
+                                                    sizeof(scratch),
+                                                    0 /* flags */);
+            }
+
+            size_t numOutBytes =
+                mStreamInfo->frameSize * sizeof(int16_t) * mStreamInfo->numChannels;
+
+            if (decoderErr == AAC_DEC_OK) {
+                offset += inBufferLength[0] - bytesValid[0];
+            } else {
+                ALOGW("AAC decoder returned error %d, substituting silence",
+                      decoderErr);
+
+                memset(outBuffer, 0, numOutBytes);
+
+                // Discard the rest of the unit.
+                offset = batch->mSizes[i];
+
+                aacDecoder_SetParam(mAACDecoder, AAC_TPDEC_CLEAR_BUFFER, 1);
+            }
+
+            // See onQueueFilled() for why the format may change on the
+            // first frames. The port reconfiguration there drops the frame
+            // that changed it, and so does this.
+            if (mInputBufferCount <= 2) {
+                if (mStreamInfo->sampleRate != prevSampleRate ||
+                    mStreamInfo->numChannels != prevNumChannels) {
+                    maybeConfigureDownmix();
+                    ALOGI("Reconfiguring decoder: %d->%d Hz, %d->%d channels",
+                          prevSampleRate, mStreamInfo->sampleRate,
+                          prevNumChannels, mStreamInfo->numChannels);
+                    continue;
+                }
+            } else if (!mStreamInfo->sampleRate || !mStreamInfo->numChannels) {
+                ALOGW("Invalid AAC stream");
+                return ERROR_MALFORMED;
+            }
+
+            if (decoderErr == AAC_DEC_OK || mNumSamplesOutput > 0) {
+                if (batch->mNumChannels == 0) {
+                    batch->mSampleRate = mStreamInfo->sampleRate;
+                    batch->mNumChannels = mStreamInfo->numChannels;
+                } else if (mStreamInfo->sampleRate != batch->mSampleRate
+                        || mStreamInfo->numChannels != batch->mNumChannels) {
+                    ALOGW("format changed from %d Hz, %d channels "
+                          "to %d Hz, %d channels",
+                          batch->mSampleRate, batch->mNumChannels,
+                          mStreamInfo->sampleRate, mStreamInfo->numChannels);
+                    return ERROR_UNSUPPORTED;
+                }
+
+                mNumSamplesOutput += mStreamInfo->frameSize;
+
+                if (!batch->append(outBuffer, numOutBytes)) {
+                    return OK;
+                }
+            }
+
+            if (decoderErr == AAC_DEC_OK) {
+                ++mInputBufferCount;
+            }
+        }
+    }
+
+    if (batch->mEndOfStream && (mDecoderHasData || mInputBufferCount)) {
+        // flush out the decoder's delayed data, as onQueueFilled() does on EOS
+        INT_PCM *outBuffer = static_cast<INT_PCM *>(
+                batch->outputBuffer(sizeof(scratch), scratch));
+
+        AAC_DECODER_ERROR decoderErr =
+            aacDecoder_DecodeFrame(mAACDecoder,
+                                   outBuffer,
+                                   sizeof(scratch),
+                                   AACDEC_FLUSH);
+        mDecoderHasData = false;
+
+        if (decoderErr != AAC_DEC_OK) {
+            ALOGE("AAC decoder returned error %d on flush", decoderErr);
+            return ERROR_MALFORMED;
+        }
+
+        if (batch->mNumChannels != 0
+                && mStreamInfo->sampleRate == batch->mSampleRate
+                && mStreamInfo->numChannels == batch->mNumChannels) {
+            batch->append(
+                    outBuffer,
+                    mStreamInfo->frameSize
+                        * sizeof(int16_t)
+                        * mStreamInfo->numChannels);
+        }
+    }
+
+    return OK;
+}
+
 void SoftAAC2::onPortFlushCompleted(OMX_U32 portIndex) {
     if (portIndex == 0) {
         // Make sure that the next buffer output does not still
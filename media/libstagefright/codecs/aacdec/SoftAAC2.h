@@ -29,6 +29,8 @@ struct SoftAAC2 : public SimpleSoftOMXComponent {
             OMX_PTR appData,
             OMX_COMPONENTTYPE **component);
 
+    virtual status_t decodeBatch(SoftAudioBatch *batch);
+
 protected:
     virtual ~SoftAAC2();
 
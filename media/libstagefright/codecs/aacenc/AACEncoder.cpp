@@ -28,6 +28,8 @@
 #include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/MetaData.h>
 
+#include <unistd.h>
+
 namespace android {
 
 AACEncoder::AACEncoder(const sp<MediaSource> &source, const sp<MetaData> &meta)
@@ -90,6 +92,14 @@ status_t AACEncoder::initCheck() {
         return UNKNOWN_ERROR;
     }
 
+    // Encode the two channels of a stereo pair on separate cores.
+    int numThreads = 2;
+    if (mChannels == 2 && sysconf(_SC_NPROCESSORS_ONLN) > 1
+            && VO_ERR_NONE != mApiHandle->SetParam(
+                mEncoderHandle, VO_PID_AAC_NUMTHREADS, &numThreads)) {
+        ALOGW("Unable to start the AAC encoder channel thread");
+    }
+
     return OK;
 }
 
@@ -18,6 +18,7 @@ LOCAL_SRC_FILES += \
 	src/bitenc.c \
 	src/block_switch.c \
 	src/channel_map.c \
+	src/channel_thread.c \
 	src/dyn_bits.c \
 	src/grp_data.c \
 	src/interface.c \
@@ -26,6 +26,8 @@
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/hexdump.h>
 
+#include <unistd.h>
+
 namespace android {
 
 template<class T>
@@ -331,6 +333,14 @@ status_t SoftAACEncoder::setAudioParams() {
         return UNKNOWN_ERROR;
     }
 
+    // Encode the two channels of a stereo pair on separate cores.
+    int numThreads = 2;
+    if (mNumChannels == 2 && sysconf(_SC_NPROCESSORS_ONLN) > 1
+            && VO_ERR_NONE != mApiHandle->SetParam(
+                mEncoderHandle, VO_PID_AAC_NUMTHREADS, &numThreads)) {
+        ALOGW("Unable to start the AAC encoder channel thread");
+    }
+
     return OK;
 }
 
@@ -32,6 +32,7 @@
 #include "psy_main.h"
 #include "qc_main.h"
 #include "psy_main.h"
+#include "channel_thread.h"
 /*-------------------------- defines --------------------------------------*/
 
 
@@ -63,6 +64,8 @@ typedef struct {
   HANDLE_BIT_BUF  hBitStream;
   int			  initOK;
 
+  CHANNEL_THREAD *hChannelThread;       /* NULL unless running with two threads */
+
   short			*intbuf;
   short			*encbuf;
   short			*inbuf;
@@ -0,0 +1,50 @@
+/*
+ ** Copyright (C) 2013 The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		channel_thread.h
+
+	Content:	Worker thread for the second channel of a channel pair element
+
+*******************************************************************************/
+
+#ifndef _CHANNEL_THREAD_H
+#define _CHANNEL_THREAD_H
+
+#include "typedef.h"
+#include "voMem.h"
+
+/*
+  per channel part of an encoding stage, ch is the channel in the element
+*/
+typedef void (*CHANNEL_JOB)(void *job, Word16 ch);
+
+/* contents private to channel_thread.c */
+typedef struct CHANNEL_THREAD CHANNEL_THREAD;
+
+Word16 ChannelThreadNew(CHANNEL_THREAD **phThread, VO_MEM_OPERATOR *pMemOP);
+void ChannelThreadDelete(CHANNEL_THREAD **phThread, VO_MEM_OPERATOR *pMemOP);
+
+/*
+  calls fn(job, ch) for all channels of the element, channel 1 on the worker
+  thread in parallel with channel 0 if there is a worker thread (hThread may
+  be NULL), returns once all of them are done
+*/
+void ChannelThreadRun(CHANNEL_THREAD *hThread,
+                      CHANNEL_JOB fn,
+                      void *job,
+                      Word16 nChannels);
+
+#endif /* _CHANNEL_THREAD_H */
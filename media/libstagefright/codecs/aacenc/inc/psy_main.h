@@ -26,6 +26,7 @@
 #include "psy_configuration.h"
 #include "qc_data.h"
 #include "memalign.h"
+#include "channel_thread.h"
 
 /*
   psy kernel
@@ -64,6 +65,7 @@ Word16 psyMain(Word16                   nChannels,   /*!< total number of channe
                PSY_OUT_CHANNEL          psyOutChannel[MAX_CHANNELS],
                PSY_OUT_ELEMENT          *psyOutElement,
                Word32                   *pScratchTns,
-			   Word32					sampleRate);
+			   Word32					sampleRate,
+               CHANNEL_THREAD           *hThread);    /*!< may be NULL */
 
 #endif /* _PSYMAIN_H */
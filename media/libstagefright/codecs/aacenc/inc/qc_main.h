@@ -26,6 +26,7 @@
 #include "qc_data.h"
 #include "interface.h"
 #include "memalign.h"
+#include "channel_thread.h"
 
 /* Quantizing & coding stage */
 
@@ -49,7 +50,8 @@ Word16 QCMain(QC_STATE *hQC,
               QC_OUT_CHANNEL  qcOutChannel[MAX_CHANNELS],   /* out                      */
               QC_OUT_ELEMENT* qcOutElement,
               Word16 nChannels,
-			  Word16 ancillaryDataBytes);     /* returns error code       */
+			  Word16 ancillaryDataBytes,
+              CHANNEL_THREAD *hThread);        /* may be NULL, returns error code */
 
 void updateBitres(QC_STATE* qcKernel,
                   QC_OUT* qcOut);
@@ -316,6 +316,7 @@ VO_U32 VO_API voAACEncSetParam(VO_HANDLE hCodec, VO_S32 uParamID, VO_PTR pData)
 	AAC_ENCODER* hAacEnc = (AAC_ENCODER*)hCodec;
 	int ret, i, bitrate, tmp;
 	int SampleRateIdx;
+	int numThreads;
 
 	if(NULL == hAacEnc)
 		return VO_ERR_INVALID_ARG;
@@ -455,6 +456,23 @@ VO_U32 VO_API voAACEncSetParam(VO_HANDLE hCodec, VO_S32 uParamID, VO_PTR pData)
 		if(ret)
 			return VO_ERR_AUDIO_UNSFEATURE;
 		break;
+	case VO_PID_AAC_NUMTHREADS:	/* encode the channels of a stereo element in parallel */
+		if(pData == NULL)
+			return VO_ERR_INVALID_ARG;
+		numThreads = *(int *)pData;
+		if(numThreads < 1)
+			return VO_ERR_INVALID_ARG;
+
+		if(numThreads == 1)
+		{
+			ChannelThreadDelete(&hAacEnc->hChannelThread, hAacEnc->voMemop);
+		}
+		else if(hAacEnc->hChannelThread == NULL)
+		{
+			if(ChannelThreadNew(&hAacEnc->hChannelThread, hAacEnc->voMemop))
+				return VO_ERR_OUTOF_MEMORY;
+		}
+		break;
 	default:
 		return VO_ERR_WRONG_PARAM_ID;
 	}
@@ -169,7 +169,8 @@ Word16 AacEncEncode(AAC_ENCODER *aacEnc,		/*!< an encoder handle */
           &aacEnc->psyOut.psyOutChannel[elInfo->ChannelIndex[0]],
           &aacEnc->psyOut.psyOutElement,
           aacEnc->psyKernel.pScratchTns,
-		  aacEnc->config.sampleRate);
+		  aacEnc->config.sampleRate,
+          aacEnc->hChannelThread);
 
   /* adjust bitrate and frame length */
   AdjustBitrate(&aacEnc->qcKernel,
@@ -185,7 +186,8 @@ Word16 AacEncEncode(AAC_ENCODER *aacEnc,		/*!< an encoder handle */
          &aacEnc->qcOut.qcChannel[elInfo->ChannelIndex[0]],
          &aacEnc->qcOut.qcElement,
          elInfo->nChannelsInEl,
-		 min(ancDataBytesLeft,ancDataBytes));
+		 min(ancDataBytesLeft,ancDataBytes),
+         aacEnc->hChannelThread);
 
   ancDataBytesLeft = ancDataBytesLeft - ancDataBytes;
 
@@ -230,6 +232,8 @@ void AacEncClose (AAC_ENCODER* hAacEnc, VO_MEM_OPERATOR *pMemOP)
 
     DeleteBitBuffer(&hAacEnc->hBitStream);
 
+    ChannelThreadDelete(&hAacEnc->hChannelThread, pMemOP);
+
 	if(hAacEnc->intbuf)
 	{
 		mem_free(pMemOP, hAacEnc->intbuf, VO_INDEX_ENC_AAC);
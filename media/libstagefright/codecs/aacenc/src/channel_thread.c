@@ -0,0 +1,175 @@
+/*
+ ** Copyright (C) 2013 The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		channel_thread.c
+
+	Content:	Worker thread for the second channel of a channel pair element
+
+	The stages of the encoder that work on each channel of an element on its
+	own (transform, psychoacoustics, scalefactor estimation and quantization)
+	are handed to ChannelThreadRun() one at a time. Channel 1 is processed by
+	the worker thread while the encoding thread processes channel 0, the
+	stages that need both channels (block switching sync, M/S, bit
+	distribution, bitstream writing) run in between on the encoding thread.
+
+*******************************************************************************/
+
+#include <pthread.h>
+
+#include "channel_thread.h"
+#include "memalign.h"
+
+struct CHANNEL_THREAD {
+  pthread_t       thread;
+  pthread_mutex_t lock;
+  pthread_cond_t  startCond;
+  pthread_cond_t  doneCond;
+
+  /* protected by lock */
+  CHANNEL_JOB     fn;
+  void           *job;
+  Word16          pending;
+  Word16          quit;
+};
+
+/*****************************************************************************
+*
+* function name: channelThreadMain
+* description:  runs the channel 1 part of each stage until told to quit
+*
+*****************************************************************************/
+static void *channelThreadMain(void *arg)
+{
+  CHANNEL_THREAD *hThread = (CHANNEL_THREAD *)arg;
+
+  pthread_mutex_lock(&hThread->lock);
+
+  for (;;) {
+    while (!hThread->pending && !hThread->quit)
+      pthread_cond_wait(&hThread->startCond, &hThread->lock);
+
+    if (hThread->quit)
+      break;
+
+    pthread_mutex_unlock(&hThread->lock);
+
+    hThread->fn(hThread->job, 1);
+
+    pthread_mutex_lock(&hThread->lock);
+    hThread->pending = 0;
+    pthread_cond_signal(&hThread->doneCond);
+  }
+
+  pthread_mutex_unlock(&hThread->lock);
+
+  return NULL;
+}
+
+/*****************************************************************************
+*
+* function name: ChannelThreadNew
+* description:  allocates and starts a worker thread
+* returns:      0 if success
+*
+*****************************************************************************/
+Word16 ChannelThreadNew(CHANNEL_THREAD **phThread, VO_MEM_OPERATOR *pMemOP)
+{
+  CHANNEL_THREAD *hThread;
+
+  *phThread = NULL;
+
+  hThread = (CHANNEL_THREAD *)mem_malloc(pMemOP, sizeof(CHANNEL_THREAD), 32, VO_INDEX_ENC_AAC);
+  if (NULL == hThread)
+    return 1;
+
+  pthread_mutex_init(&hThread->lock, NULL);
+  pthread_cond_init(&hThread->startCond, NULL);
+  pthread_cond_init(&hThread->doneCond, NULL);
+
+  if (pthread_create(&hThread->thread, NULL, channelThreadMain, hThread)) {
+    pthread_cond_destroy(&hThread->doneCond);
+    pthread_cond_destroy(&hThread->startCond);
+    pthread_mutex_destroy(&hThread->lock);
+    mem_free(pMemOP, hThread, VO_INDEX_ENC_AAC);
+    return 1;
+  }
+
+  *phThread = hThread;
+
+  return 0;
+}
+
+/*****************************************************************************
+*
+* function name: ChannelThreadDelete
+* description:  stops the worker thread and frees it, *phThread may be NULL
+*
+*****************************************************************************/
+void ChannelThreadDelete(CHANNEL_THREAD **phThread, VO_MEM_OPERATOR *pMemOP)
+{
+  CHANNEL_THREAD *hThread = *phThread;
+
+  if (NULL == hThread)
+    return;
+
+  pthread_mutex_lock(&hThread->lock);
+  hThread->quit = 1;
+  pthread_cond_signal(&hThread->startCond);
+  pthread_mutex_unlock(&hThread->lock);
+
+  pthread_join(hThread->thread, NULL);
+
+  pthread_cond_destroy(&hThread->doneCond);
+  pthread_cond_destroy(&hThread->startCond);
+  pthread_mutex_destroy(&hThread->lock);
+
+  mem_free(pMemOP, hThread, VO_INDEX_ENC_AAC);
+  *phThread = NULL;
+}
+
+/*****************************************************************************
+*
+* function name: ChannelThreadRun
+* description:  runs one stage for all channels of the element
+*
+*****************************************************************************/
+void ChannelThreadRun(CHANNEL_THREAD *hThread,
+                      CHANNEL_JOB fn,
+                      void *job,
+                      Word16 nChannels)
+{
+  Word16 ch;
+
+  if (NULL == hThread || nChannels < 2) {
+    for (ch = 0; ch < nChannels; ch++)
+      fn(job, ch);
+    return;
+  }
+
+  pthread_mutex_lock(&hThread->lock);
+  hThread->fn = fn;
+  hThread->job = job;
+  hThread->pending = 1;
+  pthread_cond_signal(&hThread->startCond);
+  pthread_mutex_unlock(&hThread->lock);
+
+  fn(job, 0);
+
+  pthread_mutex_lock(&hThread->lock);
+  while (hThread->pending)
+    pthread_cond_wait(&hThread->doneCond, &hThread->lock);
+  pthread_mutex_unlock(&hThread->lock);
+}
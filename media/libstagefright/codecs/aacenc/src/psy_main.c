@@ -44,28 +44,50 @@ static Word16 blockType2windowShape[] = {KBD_WINDOW,SINE_WINDOW,SINE_WINDOW,KBD_
 /*
   forward definitions
 */
+static Word16 advancePsychLongDetect(PSY_DATA* psyData,
+                                     TNS_DATA* tnsData,
+                                     PSY_CONFIGURATION_LONG *hPsyConfLong,
+                                     Word32 *pScratchTns);
+
 static Word16 advancePsychLong(PSY_DATA* psyData,
                                TNS_DATA* tnsData,
                                PSY_CONFIGURATION_LONG *hPsyConfLong,
-                               PSY_OUT_CHANNEL* psyOutChannel,
-                               Word32 *pScratchTns,
-                               const TNS_DATA *tnsData2,
-                               const Word16 ch);
+                               PSY_OUT_CHANNEL* psyOutChannel);
 
 static Word16 advancePsychLongMS (PSY_DATA  psyData[MAX_CHANNELS],
                                   const PSY_CONFIGURATION_LONG *hPsyConfLong);
 
+static Word16 advancePsychShortDetect(PSY_DATA* psyData,
+                                      TNS_DATA* tnsData,
+                                      const PSY_CONFIGURATION_SHORT *hPsyConfShort,
+                                      Word32 *pScratchTns);
+
 static Word16 advancePsychShort(PSY_DATA* psyData,
                                 TNS_DATA* tnsData,
                                 const PSY_CONFIGURATION_SHORT *hPsyConfShort,
-                                PSY_OUT_CHANNEL* psyOutChannel,
-                                Word32 *pScratchTns,
-                                const TNS_DATA *tnsData2,
-                                const Word16 ch);
+                                PSY_OUT_CHANNEL* psyOutChannel);
 
 static Word16 advancePsychShortMS (PSY_DATA  psyData[MAX_CHANNELS],
                                    const PSY_CONFIGURATION_SHORT *hPsyConfShort);
 
+/*
+  arguments of psyMain for its per channel stages, see ChannelThreadRun
+*/
+typedef struct {
+  Word16                   nChannels;
+  ELEMENT_INFO            *elemInfo;
+  Word16                  *timeSignal;
+  PSY_DATA                *psyData;
+  TNS_DATA                *tnsData;
+  PSY_CONFIGURATION_LONG  *hPsyConfLong;
+  PSY_CONFIGURATION_SHORT *hPsyConfShort;
+  PSY_OUT_CHANNEL         *psyOutChannel;
+  Word32                  *pScratchTns;
+  Word16                   mdctScalingArray[MAX_CHANNELS];
+  Word16                   maxScale;
+  Word16                   maxSfbPerGroup[MAX_CHANNELS];
+} PSY_JOB;
+
 
 /*****************************************************************************
 *
@@ -229,6 +251,101 @@ Word16 psyMainInit(PSY_KERNEL *hPsy,
 	return(err);
 }
 
+/*****************************************************************************
+*
+* function name: psyTransformChannel
+* description:  mdct of one channel
+*
+*****************************************************************************/
+static void psyTransformChannel(void *job, Word16 ch)
+{
+  PSY_JOB *psyJob = (PSY_JOB *)job;
+  PSY_DATA *psyData = &psyJob->psyData[ch];
+
+  Transform_Real(psyData->mdctDelayBuffer,
+                 psyJob->timeSignal+psyJob->elemInfo->ChannelIndex[ch],
+                 psyJob->nChannels,
+                 psyData->mdctSpectrum,
+                 &(psyJob->mdctScalingArray[ch]),
+                 psyData->blockSwitchingControl.windowSequence);
+}
+
+/*****************************************************************************
+*
+* function name: psyDetectChannel
+* description:  common scaling, band energies and tns detection of one channel
+*
+*****************************************************************************/
+static void psyDetectChannel(void *job, Word16 ch)
+{
+  PSY_JOB *psyJob = (PSY_JOB *)job;
+  PSY_DATA *psyData = &psyJob->psyData[ch];
+  /* the channels need scratch of their own when they run in parallel */
+  Word32 *pScratchTns = psyJob->pScratchTns + ch*FRAME_LEN_LONG;
+  Word16 scaleDiff = psyJob->maxScale - psyJob->mdctScalingArray[ch];
+  Word16 line;
+
+  /* common scaling for all channels */
+  if (scaleDiff > 0) {
+    Word32 *Spectrum = psyData->mdctSpectrum;
+	for(line=0; line<FRAME_LEN_LONG; line++) {
+      *Spectrum = (*Spectrum) >> scaleDiff;
+	  Spectrum++;
+    }
+  }
+  psyData->mdctScale = psyJob->maxScale;
+
+  if(psyData->blockSwitchingControl.windowSequence != SHORT_WINDOW)
+    advancePsychLongDetect(psyData,
+                           &psyJob->tnsData[ch],
+                           psyJob->hPsyConfLong,
+                           pScratchTns);
+  else
+    advancePsychShortDetect(psyData,
+                            &psyJob->tnsData[ch],
+                            psyJob->hPsyConfShort,
+                            pScratchTns);
+}
+
+/*****************************************************************************
+*
+* function name: psyAdvanceChannel
+* description:  tns filtering and thresholds of one channel
+*
+*****************************************************************************/
+static void psyAdvanceChannel(void *job, Word16 ch)
+{
+  PSY_JOB *psyJob = (PSY_JOB *)job;
+  PSY_DATA *psyData = &psyJob->psyData[ch];
+  PSY_CONFIGURATION_LONG *hPsyConfLong = psyJob->hPsyConfLong;
+  Word16 sfb;  /* counts through scalefactor bands */
+  Word16 line; /* counts through lines             */
+
+  if(psyData->blockSwitchingControl.windowSequence != SHORT_WINDOW) {
+    /* update long block parameter */
+	advancePsychLong(psyData,
+                     &psyJob->tnsData[ch],
+                     hPsyConfLong,
+                     &psyJob->psyOutChannel[ch]);
+
+    /* determine maxSfb */
+    for (sfb=hPsyConfLong->sfbCnt-1; sfb>=0; sfb--) {
+      for (line=hPsyConfLong->sfbOffset[sfb+1] - 1; line>=hPsyConfLong->sfbOffset[sfb]; line--) {
+
+        if (psyData->mdctSpectrum[line] != 0) break;
+      }
+      if (line >= hPsyConfLong->sfbOffset[sfb]) break;
+    }
+    psyJob->maxSfbPerGroup[ch] = sfb + 1;
+  }
+  else {
+    advancePsychShort(psyData,
+                      &psyJob->tnsData[ch],
+                      psyJob->hPsyConfShort,
+                      &psyJob->psyOutChannel[ch]);
+  }
+}
+
 /*****************************************************************************
 *
 * function name: psyMain
@@ -249,19 +366,27 @@ Word16 psyMain(Word16                   nChannels,
                PSY_OUT_CHANNEL          psyOutChannel[MAX_CHANNELS],
                PSY_OUT_ELEMENT         *psyOutElement,
                Word32                  *pScratchTns,
-			   Word32				   sampleRate)
+			   Word32				   sampleRate,
+               CHANNEL_THREAD          *hThread)
 {
-  Word16 maxSfbPerGroup[MAX_CHANNELS];
-  Word16 mdctScalingArray[MAX_CHANNELS];
+  PSY_JOB psyJob;
+  Word16 *maxSfbPerGroup = psyJob.maxSfbPerGroup;
 
   Word16 ch;   /* counts through channels          */
-  Word16 sfb;  /* counts through scalefactor bands */
-  Word16 line; /* counts through lines             */
+  Word16 w;    /* counts through short windows     */
   Word16 channels;
-  Word16 maxScale;
 
   channels = elemInfo->nChannelsInEl;
-  maxScale = 0;
+
+  psyJob.nChannels = nChannels;
+  psyJob.elemInfo = elemInfo;
+  psyJob.timeSignal = timeSignal;
+  psyJob.psyData = psyData;
+  psyJob.tnsData = tnsData;
+  psyJob.hPsyConfLong = hPsyConfLong;
+  psyJob.hPsyConfShort = hPsyConfShort;
+  psyJob.psyOutChannel = psyOutChannel;
+  psyJob.pScratchTns = pScratchTns;
 
   /* block switching */
   for(ch = 0; ch < channels; ch++) {
@@ -278,73 +403,50 @@ Word16 psyMain(Word16                   nChannels,
 
   /* transform
      and get maxScale (max mdctScaling) for all channels */
+  ChannelThreadRun(hThread, psyTransformChannel, &psyJob, channels);
+
+  psyJob.maxScale = 0;
   for(ch=0; ch<channels; ch++) {
-    Transform_Real(psyData[ch].mdctDelayBuffer,
-                   timeSignal+elemInfo->ChannelIndex[ch],
-                   nChannels,
-                   psyData[ch].mdctSpectrum,
-                   &(mdctScalingArray[ch]),
-                   psyData[ch].blockSwitchingControl.windowSequence);
-    maxScale = max(maxScale, mdctScalingArray[ch]);
+    psyJob.maxScale = max(psyJob.maxScale, psyJob.mdctScalingArray[ch]);
   }
 
-  /* common scaling for all channels */
-  for (ch=0; ch<channels; ch++) {
-    Word16 scaleDiff = maxScale - mdctScalingArray[ch];
-
-    if (scaleDiff > 0) {
-      Word32 *Spectrum = psyData[ch].mdctSpectrum;
-	  for(line=0; line<FRAME_LEN_LONG; line++) {
-        *Spectrum = (*Spectrum) >> scaleDiff;
-		Spectrum++;
+  /* common scaling, band energies and tns detection */
+  ChannelThreadRun(hThread, psyDetectChannel, &psyJob, channels);
+
+  /* TnsSync: the right channel takes the left channel's filter if their
+     prediction gains are close. It is taken before TnsEncode quantizes it,
+     which gives the same coefficients as quantizing them twice. */
+  if (channels == 2) {
+
+    if(psyData[1].blockSwitchingControl.windowSequence != SHORT_WINDOW) {
+      TnsSync(&tnsData[1],
+              &tnsData[0],
+              hPsyConfLong->tnsConf,
+              0,
+              psyData[1].blockSwitchingControl.windowSequence);
+    }
+    else {
+      for(w = 0; w < TRANS_FAC; w++) {
+        TnsSync(&tnsData[1],
+                &tnsData[0],
+                hPsyConfShort->tnsConf,
+                w,
+                psyData[1].blockSwitchingControl.windowSequence);
       }
     }
-    psyData[ch].mdctScale = maxScale;
   }
 
-  for (ch=0; ch<channels; ch++) {
-
-    if(psyData[ch].blockSwitchingControl.windowSequence != SHORT_WINDOW) {
-      /* update long block parameter */
-	  advancePsychLong(&psyData[ch],
-                       &tnsData[ch],
-                       hPsyConfLong,
-                       &psyOutChannel[ch],
-                       pScratchTns,
-                       &tnsData[1 - ch],
-                       ch);
-
-      /* determine maxSfb */
-      for (sfb=hPsyConfLong->sfbCnt-1; sfb>=0; sfb--) {
-        for (line=hPsyConfLong->sfbOffset[sfb+1] - 1; line>=hPsyConfLong->sfbOffset[sfb]; line--) {
-
-          if (psyData[ch].mdctSpectrum[line] != 0) break;
-        }
-        if (line >= hPsyConfLong->sfbOffset[sfb]) break;
-      }
-      maxSfbPerGroup[ch] = sfb + 1;
+  /* tns filtering and thresholds */
+  ChannelThreadRun(hThread, psyAdvanceChannel, &psyJob, channels);
 
-      /* Calc bandwise energies for mid and side channel
-         Do it only if 2 channels exist */
+  /* Calc bandwise energies for mid and side channel
+     Do it only if 2 channels exist */
+  if (channels == 2) {
 
-      if (ch == 1)
-        advancePsychLongMS(psyData, hPsyConfLong);
-    }
-    else {
-      advancePsychShort(&psyData[ch],
-                        &tnsData[ch],
-                        hPsyConfShort,
-                        &psyOutChannel[ch],
-                        pScratchTns,
-                        &tnsData[1 - ch],
-                        ch);
-
-      /* Calc bandwise energies for mid and side channel
-         Do it only if 2 channels exist */
-
-      if (ch == 1)
-        advancePsychShortMS (psyData, hPsyConfShort);
-    }
+    if(psyData[1].blockSwitchingControl.windowSequence != SHORT_WINDOW)
+      advancePsychLongMS(psyData, hPsyConfLong);
+    else
+      advancePsychShortMS (psyData, hPsyConfShort);
   }
 
   /* group short data */
@@ -462,23 +564,18 @@ Word16 psyMain(Word16                   nChannels,
 
 /*****************************************************************************
 *
-* function name: advancePsychLong
-* description:  psychoacoustic for long blocks
+* function name: advancePsychLongDetect
+* description:  band energies and tns detection for long blocks
 *
 *****************************************************************************/
 
-static Word16 advancePsychLong(PSY_DATA* psyData,
-                               TNS_DATA* tnsData,
-                               PSY_CONFIGURATION_LONG *hPsyConfLong,
-                               PSY_OUT_CHANNEL* psyOutChannel,
-                               Word32 *pScratchTns,
-                               const TNS_DATA* tnsData2,
-                               const Word16 ch)
+static Word16 advancePsychLongDetect(PSY_DATA* psyData,
+                                     TNS_DATA* tnsData,
+                                     PSY_CONFIGURATION_LONG *hPsyConfLong,
+                                     Word32 *pScratchTns)
 {
   Word32 i;
-  Word32 normEnergyShift = (psyData->mdctScale + 1) << 1; /* in reference code, mdct spectrum must be multipied with 2, so +1 */
-  Word32 clipEnergy = hPsyConfLong->clipEnergy >> normEnergyShift;
-  Word32 *data0, *data1, tdata;
+  Word32 *data0;
 
   /* low pass */
   data0 = psyData->mdctSpectrum + hPsyConfLong->lowpassLine;
@@ -505,14 +602,25 @@ static Word16 advancePsychLong(PSY_DATA* psyData,
             psyData->blockSwitchingControl.windowSequence,
             psyData->sfbEnergy.sfbLong);
 
-  /*  TnsSync */
-  if (ch == 1) {
-    TnsSync(tnsData,
-            tnsData2,
-            hPsyConfLong->tnsConf,
-            0,
-            psyData->blockSwitchingControl.windowSequence);
-  }
+  return 0;
+}
+
+/*****************************************************************************
+*
+* function name: advancePsychLong
+* description:  psychoacoustic for long blocks, after advancePsychLongDetect
+*
+*****************************************************************************/
+
+static Word16 advancePsychLong(PSY_DATA* psyData,
+                               TNS_DATA* tnsData,
+                               PSY_CONFIGURATION_LONG *hPsyConfLong,
+                               PSY_OUT_CHANNEL* psyOutChannel)
+{
+  Word32 i;
+  Word32 normEnergyShift = (psyData->mdctScale + 1) << 1; /* in reference code, mdct spectrum must be multipied with 2, so +1 */
+  Word32 clipEnergy = hPsyConfLong->clipEnergy >> normEnergyShift;
+  Word32 *data0, *data1, tdata;
 
   /*  Tns Encoder */
   TnsEncode(&psyOutChannel->tnsInfo,
@@ -641,28 +749,22 @@ static Word16 advancePsychLongMS (PSY_DATA psyData[MAX_CHANNELS],
 
 /*****************************************************************************
 *
-* function name: advancePsychShort
-* description:  psychoacoustic for short blocks
+* function name: advancePsychShortDetect
+* description:  band energies and tns detection for short blocks
 *
 *****************************************************************************/
 
-static Word16 advancePsychShort(PSY_DATA* psyData,
-                                TNS_DATA* tnsData,
-                                const PSY_CONFIGURATION_SHORT *hPsyConfShort,
-                                PSY_OUT_CHANNEL* psyOutChannel,
-                                Word32 *pScratchTns,
-                                const TNS_DATA *tnsData2,
-                                const Word16 ch)
+static Word16 advancePsychShortDetect(PSY_DATA* psyData,
+                                      TNS_DATA* tnsData,
+                                      const PSY_CONFIGURATION_SHORT *hPsyConfShort,
+                                      Word32 *pScratchTns)
 {
   Word32 w;
-  Word32 normEnergyShift = (psyData->mdctScale + 1) << 1; /* in reference code, mdct spectrum must be multipied with 2, so +1 */
-  Word32 clipEnergy = hPsyConfShort->clipEnergy >> normEnergyShift;
   Word32 wOffset = 0;
   Word32 *data0;
-  const Word32 *data1;
 
   for(w = 0; w < TRANS_FAC; w++) {
-    Word32 i, tdata;
+    Word32 i;
 
     /* low pass */
     data0 = psyData->mdctSpectrum + wOffset + hPsyConfShort->lowpassLine;
@@ -688,14 +790,33 @@ static Word16 advancePsychShort(PSY_DATA* psyData,
               psyData->blockSwitchingControl.windowSequence,
               psyData->sfbEnergy.sfbShort[w]);
 
-    /*  TnsSync */
-    if (ch == 1) {
-      TnsSync(tnsData,
-              tnsData2,
-              hPsyConfShort->tnsConf,
-              w,
-              psyData->blockSwitchingControl.windowSequence);
-    }
+    wOffset += FRAME_LEN_SHORT;
+  } /* for TRANS_FAC */
+
+  return 0;
+}
+
+/*****************************************************************************
+*
+* function name: advancePsychShort
+* description:  psychoacoustic for short blocks, after advancePsychShortDetect
+*
+*****************************************************************************/
+
+static Word16 advancePsychShort(PSY_DATA* psyData,
+                                TNS_DATA* tnsData,
+                                const PSY_CONFIGURATION_SHORT *hPsyConfShort,
+                                PSY_OUT_CHANNEL* psyOutChannel)
+{
+  Word32 w;
+  Word32 normEnergyShift = (psyData->mdctScale + 1) << 1; /* in reference code, mdct spectrum must be multipied with 2, so +1 */
+  Word32 clipEnergy = hPsyConfShort->clipEnergy >> normEnergyShift;
+  Word32 wOffset = 0;
+  Word32 *data0;
+  const Word32 *data1;
+
+  for(w = 0; w < TRANS_FAC; w++) {
+    Word32 i, tdata;
 
     TnsEncode(&psyOutChannel->tnsInfo,
               tnsData,
@@ -50,6 +50,17 @@ static Word16 calcMaxValueInSfb(Word16 sfbCnt,
                                 Word16 quantSpectrum[FRAME_LEN_LONG],
                                 UWord16 maxValue[MAX_GROUPED_SFB]);
 
+/*
+  arguments of QCMain for its per channel stage, see ChannelThreadRun
+*/
+typedef struct {
+  QC_STATE        *hQC;
+  PSY_OUT_CHANNEL *psyOutChannel;
+  QC_OUT_CHANNEL  *qcOutChannel;
+  Word16           maxChDynBits[MAX_CHANNELS];
+  Word32           chDynBits[MAX_CHANNELS];
+} QC_JOB;
+
 
 /*****************************************************************************
 *
@@ -247,6 +258,83 @@ Word16 QCInit(QC_STATE *hQC,
 }
 
 
+/*****************************************************************************
+*
+* function name: quantizeChannel
+* description:  estimates the scale factors of one channel and quantizes it
+*               with the smallest global gain that fits its share of the bits
+*
+*****************************************************************************/
+static void quantizeChannel(void *job, Word16 ch)
+{
+  QC_JOB *qcJob = (QC_JOB *)job;
+  QC_STATE *hQC = qcJob->hQC;
+  PSY_OUT_CHANNEL *psyOutChannel = &qcJob->psyOutChannel[ch];
+  QC_OUT_CHANNEL *qcOutChannel = &qcJob->qcOutChannel[ch];
+  Word32 chDynBits;
+  Flag   constraintsFulfilled;
+  Word32 iter;
+
+  /*estimate scale factors */
+  EstimateScaleFactors(psyOutChannel,
+                       qcOutChannel,
+                       &hQC->logSfbEnergy[ch],
+                       &hQC->logSfbFormFactor[ch],
+                       &hQC->sfbNRelevantLines[ch],
+                       1);
+
+  iter = 0;
+  do {
+    constraintsFulfilled = 1;
+
+    QuantizeSpectrum(psyOutChannel->sfbCnt,
+                     psyOutChannel->maxSfbPerGroup,
+                     psyOutChannel->sfbPerGroup,
+                     psyOutChannel->sfbOffsets,
+                     psyOutChannel->mdctSpectrum,
+                     qcOutChannel->globalGain,
+                     qcOutChannel->scf,
+                     qcOutChannel->quantSpec);
+
+    if (calcMaxValueInSfb(psyOutChannel->sfbCnt,
+                          psyOutChannel->maxSfbPerGroup,
+                          psyOutChannel->sfbPerGroup,
+                          psyOutChannel->sfbOffsets,
+                          qcOutChannel->quantSpec,
+                          qcOutChannel->maxValueInSfb) > MAX_QUANT) {
+      constraintsFulfilled = 0;
+    }
+
+    chDynBits = dynBitCount(qcOutChannel->quantSpec,
+                            qcOutChannel->maxValueInSfb,
+                            qcOutChannel->scf,
+                            psyOutChannel->windowSequence,
+                            psyOutChannel->sfbCnt,
+                            psyOutChannel->maxSfbPerGroup,
+                            psyOutChannel->sfbPerGroup,
+                            psyOutChannel->sfbOffsets,
+                            &qcOutChannel->sectionData);
+
+    if (chDynBits >= qcJob->maxChDynBits[ch]) {
+      constraintsFulfilled = 0;
+    }
+
+    if (!constraintsFulfilled) {
+      qcOutChannel->globalGain = qcOutChannel->globalGain + 1;
+    }
+
+    iter = iter + 1;
+
+  } while(!constraintsFulfilled);
+
+  qcJob->chDynBits[ch] = chDynBits;
+
+  qcOutChannel->mdctScale    = psyOutChannel->mdctScale;
+  qcOutChannel->groupingMask = psyOutChannel->groupingMask;
+  qcOutChannel->windowShape  = psyOutChannel->windowShape;
+}
+
+
 /*********************************************************************************
 *
 * function name: QCMain
@@ -262,9 +350,10 @@ Word16 QCMain(QC_STATE* hQC,
               QC_OUT_CHANNEL  qcOutChannel[MAX_CHANNELS],    /* out                      */
               QC_OUT_ELEMENT* qcOutElement,
               Word16 nChannels,
-			  Word16 ancillaryDataBytes)
+			  Word16 ancillaryDataBytes,
+              CHANNEL_THREAD *hThread)
 {
-  Word16 maxChDynBits[MAX_CHANNELS];
+  QC_JOB qcJob;
   Word16 chBitDistribution[MAX_CHANNELS];
   Word32 ch;
 
@@ -307,76 +396,24 @@ Word16 QCMain(QC_STATE* hQC,
 				   nChannels,
 				   hQC->maxBitFac);
 
-  /*estimate scale factors */
-  EstimateScaleFactors(psyOutChannel,
-                       qcOutChannel,
-                       hQC->logSfbEnergy,
-                       hQC->logSfbFormFactor,
-                       hQC->sfbNRelevantLines,
-                       nChannels);
-
   /* condition to prevent empty bitreservoir */
   for (ch = 0; ch < nChannels; ch++) {
     Word32 maxDynBits;
     maxDynBits = elBits->averageBits + elBits->bitResLevel - 7; /* -7 bec. of align bits */
     maxDynBits = maxDynBits - qcOutElement->staticBitsUsed + qcOutElement->ancBitsUsed;
-    maxChDynBits[ch] = extract_l(chBitDistribution[ch] * maxDynBits / 1000);
+    qcJob.maxChDynBits[ch] = extract_l(chBitDistribution[ch] * maxDynBits / 1000);
   }
 
-  qcOutElement->dynBitsUsed = 0;
-  for (ch = 0; ch < nChannels; ch++) {
-    Word32 chDynBits;
-    Flag   constraintsFulfilled;
-    Word32 iter;
-    iter = 0;
-    do {
-      constraintsFulfilled = 1;
-
-      QuantizeSpectrum(psyOutChannel[ch].sfbCnt,
-                       psyOutChannel[ch].maxSfbPerGroup,
-                       psyOutChannel[ch].sfbPerGroup,
-                       psyOutChannel[ch].sfbOffsets,
-                       psyOutChannel[ch].mdctSpectrum,
-                       qcOutChannel[ch].globalGain,
-                       qcOutChannel[ch].scf,
-                       qcOutChannel[ch].quantSpec);
-
-      if (calcMaxValueInSfb(psyOutChannel[ch].sfbCnt,
-                            psyOutChannel[ch].maxSfbPerGroup,
-                            psyOutChannel[ch].sfbPerGroup,
-                            psyOutChannel[ch].sfbOffsets,
-                            qcOutChannel[ch].quantSpec,
-                            qcOutChannel[ch].maxValueInSfb) > MAX_QUANT) {
-        constraintsFulfilled = 0;
-      }
-
-      chDynBits = dynBitCount(qcOutChannel[ch].quantSpec,
-                              qcOutChannel[ch].maxValueInSfb,
-                              qcOutChannel[ch].scf,
-                              psyOutChannel[ch].windowSequence,
-                              psyOutChannel[ch].sfbCnt,
-                              psyOutChannel[ch].maxSfbPerGroup,
-                              psyOutChannel[ch].sfbPerGroup,
-                              psyOutChannel[ch].sfbOffsets,
-                              &qcOutChannel[ch].sectionData);
-
-      if (chDynBits >= maxChDynBits[ch]) {
-        constraintsFulfilled = 0;
-      }
-
-      if (!constraintsFulfilled) {
-        qcOutChannel[ch].globalGain = qcOutChannel[ch].globalGain + 1;
-      }
+  /* estimate scale factors and quantize, the channels on their own */
+  qcJob.hQC = hQC;
+  qcJob.psyOutChannel = psyOutChannel;
+  qcJob.qcOutChannel = qcOutChannel;
 
-      iter = iter + 1;
+  ChannelThreadRun(hThread, quantizeChannel, &qcJob, nChannels);
 
-    } while(!constraintsFulfilled);
-
-    qcOutElement->dynBitsUsed = qcOutElement->dynBitsUsed + chDynBits;
-
-    qcOutChannel[ch].mdctScale    = psyOutChannel[ch].mdctScale;
-    qcOutChannel[ch].groupingMask = psyOutChannel[ch].groupingMask;
-    qcOutChannel[ch].windowShape  = psyOutChannel[ch].windowShape;
+  qcOutElement->dynBitsUsed = 0;
+  for (ch = 0; ch < nChannels; ch++) {
+    qcOutElement->dynBitsUsed = qcOutElement->dynBitsUsed + qcJob.chDynBits[ch];
   }
 
   /* save dynBitsUsed for correction of bits2pe relation */
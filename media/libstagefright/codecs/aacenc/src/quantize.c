@@ -20,6 +20,9 @@
 
 *******************************************************************************/
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "typedef.h"
 #include "basic_op.h"
 #include "oper_32b.h"
@@ -92,6 +95,69 @@ static Word16 quantizeSingleLine(const Word16 gain, const Word32 absSpectrum)
   return qua;
 }
 
+#if defined(__SSE2__)
+/*****************************************************************************
+*
+* function name:quantizeLines4
+* description: quantizes spectrum lines four at a time, as the g >= 0 path
+*              of quantizeLines() does. The lines beyond the last border are
+*              quantized by quantizeSingleLine(). noOfLines must be a
+*              multiple of 4 and 0 <= g < 32.
+*
+*****************************************************************************/
+static void quantizeLines4(const Word16 gain,
+                           const Word32 noOfLines,
+                           const Word32 *mdctSpectrum,
+                           Word16 *quaSpectrum,
+                           const Word16 *pquat,
+                           Word32 g)
+{
+  Word32 line, k;
+  __m128i shift = _mm_cvtsi32_si128(g);
+  __m128i minInt = _mm_set1_epi32(MIN_32);
+  __m128i border0 = _mm_set1_epi32(pquat[0]);
+  __m128i border1 = _mm_set1_epi32(pquat[1] - 1);
+  __m128i border2 = _mm_set1_epi32(pquat[2] - 1);
+  __m128i border3 = _mm_set1_epi32(pquat[3] - 1);
+
+  for (line=0; line<noOfLines; line+=4) {
+    __m128i spec, sign, sa, saShft, qua;
+    int slow;
+
+    spec = _mm_loadu_si128((const __m128i *)(mdctSpectrum + line));
+    sign = _mm_srai_epi32(spec, 31);
+
+    /* L_abs() */
+    sa = _mm_sub_epi32(_mm_xor_si128(spec, sign), sign);
+    sa = _mm_add_epi32(sa, _mm_cmpeq_epi32(sa, minInt));
+    saShft = _mm_sra_epi32(sa, shift);
+
+    /* the borders increase, so the value is the number of borders passed,
+       each compare gives -1 for a border passed */
+    qua = _mm_add_epi32(_mm_cmpgt_epi32(saShft, border0),
+                        _mm_cmpgt_epi32(saShft, border1));
+    qua = _mm_add_epi32(qua, _mm_cmpgt_epi32(saShft, border2));
+
+    /* -qua for the positive lines, qua for the negative ones */
+    sign = _mm_xor_si128(sign, _mm_cmpeq_epi32(sign, sign));
+    qua = _mm_sub_epi32(_mm_xor_si128(qua, sign), sign);
+
+    _mm_storel_epi64((__m128i *)(quaSpectrum + line), _mm_packs_epi32(qua, qua));
+
+    slow = _mm_movemask_epi8(_mm_cmpgt_epi32(saShft, border3));
+    if (slow) {
+      for (k=0; k<4; k++) {
+        if (slow & (1 << (k << 2))) {
+          Word32 mdctSpeL = mdctSpectrum[line + k];
+          Word16 q = quantizeSingleLine(gain, L_abs(mdctSpeL));
+          quaSpectrum[line + k] = mdctSpeL < 0 ? -q : q;
+        }
+      }
+    }
+  }
+}
+#endif
+
 /*****************************************************************************
 *
 * function name:quantizeLines
@@ -119,7 +185,14 @@ static void quantizeLines(const Word16 gain,
 
   if(g >= 0)
   {
-	for (line=0; line<noOfLines; line++) {
+	line = 0;
+#if defined(__SSE2__)
+	if (g < 32) {
+	  line = noOfLines & ~3;
+	  quantizeLines4(gain, line, mdctSpectrum, quaSpectrum, pquat, g);
+	}
+#endif
+	for (; line<noOfLines; line++) {
 	  Word32 qua;
 	  qua = 0;
 
@@ -316,6 +389,95 @@ void QuantizeSpectrum(Word16 sfbCnt,
 }
 
 
+#if defined(__SSE2__)
+/*****************************************************************************
+*
+* function name:calcSfbDist4
+* description: distortion of spectrum lines four at a time, as the g >= 0,
+*              g2 > 0 path of calcSfbDist() computes it. noOfLines must be a
+*              multiple of 4 and g < 32, g2 < 32.
+* returns: the sum of the distortions, not saturated
+*
+*****************************************************************************/
+static Word64 calcSfbDist4(const Word32 *spec,
+                           Word32 noOfLines,
+                           Word16 gain,
+                           const Word16 *pquat,
+                           const Word16 *repquat,
+                           Word32 g,
+                           Word32 g2)
+{
+  Word32 line, k;
+  Word64 slowDist = 0;
+  __m128i shift = _mm_cvtsi32_si128(g);
+  __m128i shift2 = _mm_cvtsi32_si128(g2);
+  __m128i minInt = _mm_set1_epi32(MIN_32);
+  __m128i lowHalf = _mm_set1_epi32(0xffff);
+  __m128i border0 = _mm_set1_epi32(pquat[0] - 1);
+  __m128i border1 = _mm_set1_epi32(pquat[1] - 1);
+  __m128i border2 = _mm_set1_epi32(pquat[2] - 1);
+  __m128i border3 = _mm_set1_epi32(pquat[3] - 1);
+  __m128i recon0 = _mm_set1_epi32(repquat[0]);
+  __m128i recon1 = _mm_set1_epi32(repquat[1] - repquat[0]);
+  __m128i recon2 = _mm_set1_epi32(repquat[2] - repquat[1]);
+  __m128i zero = _mm_setzero_si128();
+  __m128i dist = zero;
+  Word64 sum[2];
+
+  for (line=0; line<noOfLines; line+=4) {
+    __m128i x, sign, sa, saShft, recon, diff, slow;
+    int slowMask;
+
+    x = _mm_loadu_si128((const __m128i *)(spec + line));
+    sign = _mm_srai_epi32(x, 31);
+
+    /* L_abs() */
+    sa = _mm_sub_epi32(_mm_xor_si128(x, sign), sign);
+    sa = _mm_add_epi32(sa, _mm_cmpeq_epi32(sa, minInt));
+    saShft = _mm_sra_epi32(sa, shift);
+
+    /* reconstruction value of the interval the line lies in, 0 below the
+       first border */
+    recon = _mm_and_si128(_mm_cmpgt_epi32(saShft, border0), recon0);
+    recon = _mm_add_epi32(recon,
+              _mm_and_si128(_mm_cmpgt_epi32(saShft, border1), recon1));
+    recon = _mm_add_epi32(recon,
+              _mm_and_si128(_mm_cmpgt_epi32(saShft, border2), recon2));
+
+    /* below the last border diff fits in 16 bits, square it with a
+       multiply-add whose upper halves are zero */
+    diff = _mm_and_si128(_mm_sub_epi32(saShft, recon), lowHalf);
+    diff = _mm_sra_epi32(_mm_madd_epi16(diff, diff), shift2);
+
+    slow = _mm_cmpgt_epi32(saShft, border3);
+    diff = _mm_andnot_si128(slow, diff);
+
+    /* the distortions are positive, add them up in 64 bits */
+    dist = _mm_add_epi64(dist, _mm_unpacklo_epi32(diff, zero));
+    dist = _mm_add_epi64(dist, _mm_unpackhi_epi32(diff, zero));
+
+    slowMask = _mm_movemask_epi8(slow);
+    if (slowMask) {
+      for (k=0; k<4; k++) {
+        if (slowMask & (1 << (k << 2))) {
+          Word32 lineSa = L_abs(spec[line + k]);
+          Word16 qua = quantizeSingleLine(gain, lineSa);
+          Word32 iqval, diff32;
+          /* now that we have quantized x, re-quantize it. */
+          iquantizeLines(gain, 1, &qua, &iqval);
+          diff32 = lineSa - iqval;
+          slowDist += fixmul(diff32, diff32);
+        }
+      }
+    }
+  }
+
+  _mm_storeu_si128((__m128i *)sum, dist);
+
+  return sum[0] + sum[1] + slowDist;
+}
+#endif
+
 /*****************************************************************************
 *
 * function name:calcSfbDist
@@ -344,7 +506,17 @@ Word32 calcSfbDist(const Word32 *spec,
   if(g2 < 0 && g >= 0)
   {
 	  g2 = -g2;
-	  for(line=0; line<sfbWidth; line++) {
+	  line = 0;
+#if defined(__SSE2__)
+	  if (g < 32 && g2 < 32) {
+		  /* L_add() of positive values saturates only at the end */
+		  Word64 dist4;
+		  line = sfbWidth & ~3;
+		  dist4 = calcSfbDist4(spec, line, gain, pquat, repquat, g, g2);
+		  dist = dist4 < MAX_32 ? (Word32)dist4 : MAX_32;
+	  }
+#endif
+	  for(; line<sfbWidth; line++) {
 		  if (spec[line]) {
 			  Word32 diff;
 			  Word32 distSingle;
@@ -20,6 +20,9 @@
 
 *******************************************************************************/
 
+#if defined(__SSE2__) && !defined(ARMV5E)
+#include <emmintrin.h>
+#endif
 #include "basic_op.h"
 #include "oper_32b.h"
 #include "assert.h"
@@ -670,6 +673,51 @@ static Word16 CalcTnsFilter(const Word16 *signal,
 *
 *****************************************************************************/
 #ifndef ARMV5E
+#if defined(__SSE2__)
+/*****************************************************************************
+*
+* function name: AutoCorrelationSum
+* description:  sum { x[j] * y[j] >> 9 } ; j = 0..N-1, for N <= 1024.
+*               Each term is within +-2^21, so no partial sum of the L_add()
+*               chain leaves the 32 bit range but for the last one, and the
+*               plain sum saturated once gives the same result.
+*
+*****************************************************************************/
+static Word32 AutoCorrelationSum(const Word16 x[],
+                                 const Word16 y[],
+                                 Word32       samples)
+{
+  Word32 j;
+  Word32 sum[4];
+  Word64 accu;
+  __m128i acc = _mm_setzero_si128();
+
+  for(j=0; j<samples-7; j+=8) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(x + j));
+    __m128i b = _mm_loadu_si128((const __m128i *)(y + j));
+    __m128i lo = _mm_mullo_epi16(a, b);
+    __m128i hi = _mm_mulhi_epi16(a, b);
+
+    /* at most 256 terms per lane, no overflow */
+    acc = _mm_add_epi32(acc, _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 9));
+    acc = _mm_add_epi32(acc, _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 9));
+  }
+
+  _mm_storeu_si128((__m128i *)sum, acc);
+  accu = (Word64)sum[0] + sum[1] + sum[2] + sum[3];
+
+  for(; j<samples; j++) {
+    accu += (x[j] * y[j]) >> 9;
+  }
+
+  if (accu > MAX_32)
+    return MAX_32;
+  if (accu < MIN_32)
+    return MIN_32;
+  return (Word32)accu;
+}
+#endif
+
 void AutoCorrelation(const Word16		 input[],
                             Word32       corr[],
                             Word16       samples,
@@ -680,6 +728,18 @@ void AutoCorrelation(const Word16		 input[],
 
   scf = 10 - 1;
 
+#if defined(__SSE2__)
+  if (samples <= FRAME_LEN_LONG) {
+    corr[0] = AutoCorrelationSum(input, input, samples);
+    if(corr[0] == 0) return ;
+
+    for(i=1; i<corrCoeff; i++) {
+      corr[i] = AutoCorrelationSum(input, input + i, samples - i);
+    }
+    return;
+  }
+#endif
+
   isamples = samples;
   /* calc first corrCoef:  R[0] = sum { t[i] * t[i] } ; i = 0..N-1 */
   accu = 0;
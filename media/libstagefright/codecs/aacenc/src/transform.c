@@ -20,6 +20,9 @@
 
 *******************************************************************************/
 
+#if defined(__SSE4_1__) && !defined(ARMV5E) && !defined(ARMV7Neon)
+#include <smmintrin.h>
+#endif
 #include "basic_op.h"
 #include "psy_const.h"
 #include "transform.h"
@@ -179,6 +182,197 @@ static void Radix8First(int *buf, int num)
 	}
 }
 
+#if defined(__SSE4_1__)
+/*****************************************************************************
+*
+* function name: MulHigh4
+* description:  MULHIGH() of four lanes
+*
+**********************************************************************************/
+__inline __m128i MulHigh4(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epi32(a, b);
+	__m128i odd = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+	return _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xcc);
+}
+
+/*****************************************************************************
+*
+* function name: Rotate2
+* description:  rotates two complex values {re, im, re, im} by the angles
+*               given by cosx = {c0, c0, c1, c1} and sinx = {s0, s0, s1, s1}:
+*               {MULHIGH(c, re) + MULHIGH(s, im), MULHIGH(c, im) - MULHIGH(s, re)}
+*
+**********************************************************************************/
+__inline __m128i Rotate2(__m128i x, __m128i cosx, __m128i sinx)
+{
+	__m128i p = MulHigh4(cosx, x);
+	__m128i q = MulHigh4(sinx, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm_blend_epi16(_mm_add_epi32(p, q), _mm_sub_epi32(p, q), 0xcc);
+}
+
+/*****************************************************************************
+*
+* function name: Radix4FFT
+* description:  Radix 4 point fft core function, two butterflies at a time
+*               (bgn is 4 or more)
+*
+**********************************************************************************/
+static void Radix4FFT(int *buf, int num, int bgn, int *twidTab)
+{
+	__m128i x0, x1, x2, x3;
+	__m128i cs0, cs1, cs2, c1s1, c2s2, c3s3;
+	__m128i r01, r23, r45, r67, e, d, ap, am;
+	int i, j, step;
+	int *xptr, *csptr;
+
+	for (num >>= 2; num != 0; num >>= 2)
+	{
+		step = 2*bgn;
+		xptr = buf;
+
+		for (i = num; i != 0; i--)
+		{
+			csptr = twidTab;
+
+			for (j = bgn; j != 0; j -= 2)
+			{
+				/* {c1, s1, c2, s2, c3, s3} of both butterflies */
+				cs0 = _mm_loadu_si128((__m128i *)csptr);
+				cs1 = _mm_loadu_si128((__m128i *)(csptr + 4));
+				cs2 = _mm_loadu_si128((__m128i *)(csptr + 8));
+				c1s1 = _mm_unpacklo_epi64(cs0, _mm_unpackhi_epi64(cs1, cs1));
+				c2s2 = _mm_blend_epi16(cs0, cs2, 0x0f);
+				c3s3 = _mm_blend_epi16(cs1, cs2, 0xf0);
+				csptr += 12;
+
+				x0 = _mm_loadu_si128((__m128i *)xptr);
+				x1 = _mm_loadu_si128((__m128i *)(xptr + step));
+				x2 = _mm_loadu_si128((__m128i *)(xptr + 2*step));
+				x3 = _mm_loadu_si128((__m128i *)(xptr + 3*step));
+
+				r23 = Rotate2(x1, _mm_shuffle_epi32(c1s1, _MM_SHUFFLE(2, 2, 0, 0)),
+				                  _mm_shuffle_epi32(c1s1, _MM_SHUFFLE(3, 3, 1, 1)));
+				/* c2s2 is {c2, s2} of the second butterfly, then the first */
+				r45 = Rotate2(x2, _mm_shuffle_epi32(c2s2, _MM_SHUFFLE(0, 0, 2, 2)),
+				                  _mm_shuffle_epi32(c2s2, _MM_SHUFFLE(1, 1, 3, 3)));
+				r67 = Rotate2(x3, _mm_shuffle_epi32(c3s3, _MM_SHUFFLE(2, 2, 0, 0)),
+				                  _mm_shuffle_epi32(c3s3, _MM_SHUFFLE(3, 3, 1, 1)));
+
+				x0 = _mm_srai_epi32(x0, 2);
+				r01 = _mm_sub_epi32(x0, r23);
+				r23 = _mm_add_epi32(x0, r23);
+
+				/* {r4 + r6, r5 + r7} and {r4 - r6, r5 - r7} */
+				e = _mm_add_epi32(r45, r67);
+				d = _mm_sub_epi32(r45, r67);
+				d = _mm_shuffle_epi32(d, _MM_SHUFFLE(2, 3, 0, 1));
+				ap = _mm_add_epi32(r01, d);
+				am = _mm_sub_epi32(r01, d);
+
+				_mm_storeu_si128((__m128i *)(xptr + 3*step), _mm_blend_epi16(am, ap, 0xcc));
+				_mm_storeu_si128((__m128i *)(xptr + 2*step), _mm_sub_epi32(r23, e));
+				_mm_storeu_si128((__m128i *)(xptr + step), _mm_blend_epi16(ap, am, 0xcc));
+				_mm_storeu_si128((__m128i *)xptr, _mm_add_epi32(r23, e));
+
+				xptr += 4;
+			}
+			xptr += 3*step;
+		}
+		twidTab += 3*step;
+		bgn <<= 2;
+	}
+}
+
+/*********************************************************************************
+*
+* function name: PreMDCT
+* description: prepare MDCT process for next FFT compute, two points from each
+*              end at a time
+*
+**********************************************************************************/
+static void PreMDCT(int *buf0, int num, const int *csptr)
+{
+	int i;
+	__m128i x0, x1, va, vb, cs0, cs1, ta, tb;
+	int *buf1;
+
+	buf1 = buf0 + num - 1;
+
+	for(i = num >> 3; i != 0; i--)
+	{
+		cs0 = _mm_loadu_si128((__m128i *)csptr);
+		cs1 = _mm_loadu_si128((__m128i *)(csptr + 4));
+		ta = _mm_unpacklo_epi64(cs0, cs1);	/* cosa, sina of both */
+		tb = _mm_unpackhi_epi64(cs0, cs1);	/* cosb, sinb of both */
+		csptr += 8;
+
+		/* {tr1, ti2} twice, {tr2, ti1} twice from the other end */
+		x0 = _mm_loadu_si128((__m128i *)buf0);
+		x1 = _mm_loadu_si128((__m128i *)(buf1 - 3));
+		x1 = _mm_shuffle_epi32(x1, _MM_SHUFFLE(1, 0, 3, 2));
+
+		va = _mm_blend_epi16(x0, x1, 0xcc);	/* tr1, ti1 */
+		vb = _mm_blend_epi16(x1, x0, 0xcc);	/* tr2, ti2 */
+
+		va = Rotate2(va, _mm_shuffle_epi32(ta, _MM_SHUFFLE(2, 2, 0, 0)),
+		                 _mm_shuffle_epi32(ta, _MM_SHUFFLE(3, 3, 1, 1)));
+		vb = Rotate2(vb, _mm_shuffle_epi32(tb, _MM_SHUFFLE(2, 2, 0, 0)),
+		                 _mm_shuffle_epi32(tb, _MM_SHUFFLE(3, 3, 1, 1)));
+
+		_mm_storeu_si128((__m128i *)buf0, va);
+		_mm_storeu_si128((__m128i *)(buf1 - 3), _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)));
+		buf0 += 4;
+		buf1 -= 4;
+	}
+}
+
+/*********************************************************************************
+*
+* function name: PostMDCT
+* description:   post MDCT process after next FFT for MDCT, two points from
+*                each end at a time
+*
+**********************************************************************************/
+static void PostMDCT(int *buf0, int num, const int *csptr)
+{
+	int i;
+	__m128i va, vb, cs0, cs1, ta, tb, zero;
+	int *buf1;
+
+	buf1 = buf0 + num - 1;
+	zero = _mm_setzero_si128();
+
+	for(i = num >> 3; i != 0; i--)
+	{
+		cs0 = _mm_loadu_si128((__m128i *)csptr);
+		cs1 = _mm_loadu_si128((__m128i *)(csptr + 4));
+		ta = _mm_unpacklo_epi64(cs0, cs1);	/* cosa, sina of both */
+		tb = _mm_unpackhi_epi64(cs0, cs1);	/* cosb, sinb of both */
+		csptr += 8;
+
+		/* {tr1, ti1} twice, {tr2, ti2} twice from the other end */
+		va = _mm_loadu_si128((__m128i *)buf0);
+		vb = _mm_loadu_si128((__m128i *)(buf1 - 3));
+		vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2));
+
+		va = Rotate2(va, _mm_shuffle_epi32(ta, _MM_SHUFFLE(2, 2, 0, 0)),
+		                 _mm_shuffle_epi32(ta, _MM_SHUFFLE(3, 3, 1, 1)));
+		vb = Rotate2(vb, _mm_shuffle_epi32(tb, _MM_SHUFFLE(2, 2, 0, 0)),
+		                 _mm_shuffle_epi32(tb, _MM_SHUFFLE(3, 3, 1, 1)));
+
+		/* the imaginary parts go to the other end, negated */
+		_mm_storeu_si128((__m128i *)buf0,
+			_mm_blend_epi16(va, _mm_sub_epi32(zero, vb), 0xcc));
+		_mm_storeu_si128((__m128i *)(buf1 - 3), _mm_shuffle_epi32(
+			_mm_blend_epi16(vb, _mm_sub_epi32(zero, va), 0xcc), _MM_SHUFFLE(1, 0, 3, 2)));
+		buf0 += 4;
+		buf1 -= 4;
+	}
+}
+#else
 /*****************************************************************************
 *
 * function name: Radix4FFT
@@ -339,6 +533,7 @@ static void PostMDCT(int *buf0, int num, const int *csptr)
 		*buf1-- = MULHIGH(cosb, tr2) + MULHIGH(sinb, ti2);
 	}
 }
+#endif /* __SSE4_1__ */
 #else
 void Radix4First(int *buf, int num);
 void Radix8First(int *buf, int num);
@@ -19,11 +19,13 @@
 #include <utils/Log.h>
 
 #include "SoftAMR.h"
+#include "SoftAudioBatch.h"
 
 #include "gsmamr_dec.h"
 #include "pvamrwbdecoder.h"
 
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaErrors.h>
 
 namespace android {
 
@@ -274,6 +276,127 @@ static size_t getFrameSize(unsigned FT) {
     return frameSize;
 }
 
+status_t SoftAMR::decodeFrame(
+        const uint8_t *inputPtr, size_t size,
+        int16_t *outPtr, size_t *numBytesRead) {
+    if (mMode == MODE_NARROW) {
+        int32_t n =
+            AMRDecode(mState,
+              (Frame_Type_3GPP)((inputPtr[0] >> 3) & 0x0f),
+              (UWord8 *)&inputPtr[1],
+              outPtr,
+              MIME_IETF);
+
+        if (n == -1) {
+            ALOGE("PV AMR decoder AMRDecode() call failed");
+            return ERROR_MALFORMED;
+        }
+
+        ++n;  // Include the frame type header byte.
+
+        if (static_cast<size_t>(n) > size) {
+            // This is bad, should never have happened, but did. Abort now.
+            return ERROR_MALFORMED;
+        }
+
+        *numBytesRead = n;
+    } else {
+        int16 mode = ((inputPtr[0] >> 3) & 0x0f);
+
+        if (mode >= 10 && mode <= 13) {
+            ALOGE("encountered illegal frame type %d in AMR WB content.",
+                  mode);
+            return ERROR_MALFORMED;
+        }
+
+        size_t frameSize = getFrameSize(mode);
+        if (size < frameSize) {
+            ALOGE("Filled length vs frameSize %zu vs %zu. Corrupt clip?",
+               size, frameSize);
+            return ERROR_MALFORMED;
+        }
+
+        if (mode >= 9) {
+            // Produce silence instead of comfort noise and for
+            // speech lost/no data.
+            memset(outPtr, 0, kNumSamplesPerFrameWB * sizeof(int16_t));
+        } else if (mode < 9) {
+            int16 frameType;
+            RX_State_wb rx_state;
+            mime_unsorting(
+                    const_cast<uint8_t *>(&inputPtr[1]),
+                    mInputSampleBuffer,
+                    &frameType, &mode, 1, &rx_state);
+
+            int16_t numSamplesOutput;
+            pvDecoder_AmrWb(
+                    mode, mInputSampleBuffer,
+                    outPtr,
+                    &numSamplesOutput,
+                    mDecoderBuf, frameType, mDecoderCookie);
+
+            CHECK_EQ((int)numSamplesOutput, (int)kNumSamplesPerFrameWB);
+
+            for (int i = 0; i < kNumSamplesPerFrameWB; ++i) {
+                /* Delete the 2 LSBs (14-bit output) */
+                outPtr[i] &= 0xfffC;
+            }
+        }
+
+        *numBytesRead = frameSize;
+    }
+
+    return OK;
+}
+
+status_t SoftAMR::decodeBatch(SoftAudioBatch *batch) {
+    size_t numSamplesPerFrame;
+    if (mMode == MODE_NARROW) {
+        batch->mSampleRate = kSampleRateNB;
+        numSamplesPerFrame = kNumSamplesPerFrameNB;
+    } else {
+        batch->mSampleRate = kSampleRateWB;
+        numSamplesPerFrame = kNumSamplesPerFrameWB;
+    }
+    batch->mNumChannels = 1;
+
+    int16_t scratch[kNumSamplesPerFrameWB];
+
+    const uint8_t *data = batch->mData;
+    for (size_t i = 0; i < batch->mNumUnits; data += batch->mSizes[i++]) {
+        if (i < batch->mNumConfigUnits) {
+            // nothing in there this decoder needs
+            continue;
+        }
+
+        size_t offset = 0;
+
+        while (offset < batch->mSizes[i]) {
+            int16_t *outPtr = static_cast<int16_t *>(
+                    batch->outputBuffer(
+                        numSamplesPerFrame * sizeof(int16_t), scratch));
+
+            size_t numBytesRead;
+            status_t err = decodeFrame(
+                    data + offset, batch->mSizes[i] - offset,
+                    outPtr, &numBytesRead);
+
+            if (err != OK) {
+                return err;
+            }
+
+            offset += numBytesRead;
+            ++mInputBufferCount;
+
+            if (!batch->append(outPtr, numSamplesPerFrame * sizeof(int16_t))) {
+                return OK;
+            }
+        }
+    }
+
+    return OK;
+}
+
 void SoftAMR::onQueueFilled(OMX_U32 portIndex) {
     List<BufferInfo *> &inQueue = getPortQueue(0);
     List<BufferInfo *> &outQueue = getPortQueue(1);
@@ -309,88 +432,15 @@ void SoftAMR::onQueueFilled(OMX_U32 portIndex) {
         }
 
         const uint8_t *inputPtr = inHeader->pBuffer + inHeader->nOffset;
-        int32_t numBytesRead;
-
-        if (mMode == MODE_NARROW) {
-            numBytesRead =
-                AMRDecode(mState,
-                  (Frame_Type_3GPP)((inputPtr[0] >> 3) & 0x0f),
-                  (UWord8 *)&inputPtr[1],
-                  reinterpret_cast<int16_t *>(outHeader->pBuffer),
-                  MIME_IETF);
-
-            if (numBytesRead == -1) {
-                ALOGE("PV AMR decoder AMRDecode() call failed");
-
-                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
-                mSignalledError = true;
-
-                return;
-            }
-
-            ++numBytesRead;  // Include the frame type header byte.
+        size_t numBytesRead;
 
-            if (static_cast<size_t>(numBytesRead) > inHeader->nFilledLen) {
-                // This is bad, should never have happened, but did. Abort now.
+        if (decodeFrame(inputPtr, inHeader->nFilledLen,
+                        reinterpret_cast<int16_t *>(outHeader->pBuffer),
+                        &numBytesRead) != OK) {
+            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+            mSignalledError = true;
 
-                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
-                mSignalledError = true;
-
-                return;
-            }
-        } else {
-            int16 mode = ((inputPtr[0] >> 3) & 0x0f);
-
-            if (mode >= 10 && mode <= 13) {
-                ALOGE("encountered illegal frame type %d in AMR WB content.",
-                      mode);
-
-                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
-                mSignalledError = true;
-
-                return;
-            }
-
-            size_t frameSize = getFrameSize(mode);
-            if (inHeader->nFilledLen < frameSize) {
-                ALOGE("Filled length vs frameSize %d vs %d. Corrupt clip?",
-                   inHeader->nFilledLen, frameSize);
-
-                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
-                mSignalledError = true;
-                return;
-            }
-
-            int16_t *outPtr = (int16_t *)outHeader->pBuffer;
-
-            if (mode >= 9) {
-                // Produce silence instead of comfort noise and for
-                // speech lost/no data.
-                memset(outPtr, 0, kNumSamplesPerFrameWB * sizeof(int16_t));
-            } else if (mode < 9) {
-                int16 frameType;
-                RX_State_wb rx_state;
-                mime_unsorting(
-                        const_cast<uint8_t *>(&inputPtr[1]),
-                        mInputSampleBuffer,
-                        &frameType, &mode, 1, &rx_state);
-
-                int16_t numSamplesOutput;
-                pvDecoder_AmrWb(
-                        mode, mInputSampleBuffer,
-                        outPtr,
-                        &numSamplesOutput,
-                        mDecoderBuf, frameType, mDecoderCookie);
-
-                CHECK_EQ((int)numSamplesOutput, (int)kNumSamplesPerFrameWB);
-
-                for (int i = 0; i < kNumSamplesPerFrameWB; ++i) {
-                    /* Delete the 2 LSBs (14-bit output) */
-                    outPtr[i] &= 0xfffC;
-                }
-            }
-
-            numBytesRead = frameSize;
+            return;
         }
 
         inHeader->nOffset += numBytesRead;
@@ -28,6 +28,8 @@ struct SoftAMR : public SimpleSoftOMXComponent {
             OMX_PTR appData,
             OMX_COMPONENTTYPE **component);
 
+    virtual status_t decodeBatch(SoftAudioBatch *batch);
+
 protected:
     virtual ~SoftAMR();
 
@@ -79,6 +81,10 @@ private:
     status_t initDecoder();
     bool isConfigured() const;
 
+    status_t decodeFrame(
+            const uint8_t *inputPtr, size_t size,
+            int16_t *outPtr, size_t *numBytesRead);
+
     DISALLOW_EVIL_CONSTRUCTORS(SoftAMR);
 };
 
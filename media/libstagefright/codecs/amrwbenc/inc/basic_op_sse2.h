@@ -0,0 +1,91 @@
+/*
+ ** Copyright (C) 2013 The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/***********************************************************************
+*      File: basic_op_sse2.h                                           *
+*                                                                      *
+*      Description: SSE2 helpers for the x86 builds of the filter and  *
+*                   correlation loops                                  *
+*                                                                      *
+*      The loops that use them accumulate plain 32 bit products        *
+*      (vo_mult32, vo_L_mult), which wrap modulo 2^32 and so give the  *
+*      same sum in any order. pmaddwd adds two such products with the  *
+*      same wrap, so the vector versions are bit-exact with the C ones.*
+*                                                                      *
+************************************************************************/
+
+#ifndef __BASIC_OP_SSE2_H__
+#define __BASIC_OP_SSE2_H__
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+#include "typedef.h"
+
+/* 32 bit lanes of the sum of x[i] * y[i], i = 0..8*n8-1 */
+static __inline __m128i vo_sse2_dot(const Word16 *x, const Word16 *y, Word32 n8)
+{
+	__m128i acc = _mm_setzero_si128();
+
+	for (; n8 > 0; n8--)
+	{
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)x),
+					_mm_loadu_si128((const __m128i *)y)));
+		x += 8;
+		y += 8;
+	}
+	return acc;
+}
+
+/* sum of the four 32 bit lanes */
+static __inline Word32 vo_sse2_hsum(__m128i a)
+{
+	a = _mm_add_epi32(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+	a = _mm_add_epi32(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(a);
+}
+
+/* { sum of a, sum of b, sum of c, sum of d } */
+static __inline __m128i vo_sse2_hsum4(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+	__m128i ab = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+	__m128i cd = _mm_add_epi32(_mm_unpacklo_epi32(c, d), _mm_unpackhi_epi32(c, d));
+
+	return _mm_add_epi32(_mm_unpacklo_epi64(ab, cd), _mm_unpackhi_epi64(ab, cd));
+}
+
+/* (Word16)vo_mult(a, b) of 8 lanes */
+static __inline __m128i vo_sse2_mult(__m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epi16(a, b), 1),
+			_mm_srli_epi16(_mm_mullo_epi16(a, b), 15));
+}
+
+/*
+ * extract_h(L_add(L_shl2(s, 16 - k), 0x8000)) for 4 lanes, k = 1..15
+ *
+ * Returned in 32 bit lanes before the saturation, _mm_packs_epi32() of
+ * the result saturates exactly like L_shl2() and L_add() do.
+ */
+static __inline __m128i vo_sse2_shl_round(__m128i s, Word32 k)
+{
+	__m128i r = _mm_and_si128(_mm_srai_epi32(s, k - 1), _mm_set1_epi32(1));
+
+	return _mm_add_epi32(_mm_srai_epi32(s, k), r);
+}
+
+#endif /* __SSE2__ */
+
+#endif /* __BASIC_OP_SSE2_H__ */
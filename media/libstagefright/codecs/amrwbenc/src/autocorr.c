@@ -26,6 +26,7 @@
 #include "basic_op.h"
 #include "oper_32b.h"
 #include "acelp.h"
+#include "basic_op_sse2.h"
 #include "ham_wind.tab"
 
 void Autocorr(
@@ -36,6 +37,76 @@ void Autocorr(
 	     )
 {
 	Word32 i, norm, shift;
+#if defined(__SSE2__)
+	Word16 y[L_WINDOW + 8];               /* padded with zeros for the lags */
+	__m128i x8, w8, y8, lo, hi, acc;
+	Word32 L_sum, L_sum1, F_LEN;
+
+	/* Windowing of signal and energy of signal */
+	acc = _mm_setzero_si128();
+	for (i = 0; i < L_WINDOW; i += 8)
+	{
+		x8 = _mm_loadu_si128((__m128i *)&x[i]);
+		w8 = _mm_loadu_si128((__m128i *)&vo_window[i]);
+		lo = _mm_mullo_epi16(x8, w8);
+		hi = _mm_mulhi_epi16(x8, w8);
+		x8 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), _mm_set1_epi32(0x4000)), 15);
+		w8 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), _mm_set1_epi32(0x4000)), 15);
+		x8 = _mm_srai_epi32(_mm_slli_epi32(x8, 16), 16);
+		w8 = _mm_srai_epi32(_mm_slli_epi32(w8, 16), 16);
+		y8 = _mm_packs_epi32(x8, w8);
+		_mm_storeu_si128((__m128i *)&y[i], y8);
+
+		/* vo_L_mult(y[i], y[i]) >> 8, one by one */
+		lo = _mm_mullo_epi16(y8, y8);
+		hi = _mm_mulhi_epi16(y8, y8);
+		acc = _mm_add_epi32(acc, _mm_srai_epi32(_mm_slli_epi32(_mm_unpacklo_epi16(lo, hi), 1), 8));
+		acc = _mm_add_epi32(acc, _mm_srai_epi32(_mm_slli_epi32(_mm_unpackhi_epi16(lo, hi), 1), 8));
+	}
+	for (; i < L_WINDOW + 8; i++)
+		y[i] = 0;
+	L_sum = vo_L_deposit_h(16) + vo_sse2_hsum(acc);
+
+	/* scale signal to avoid overflow in autocorrelation */
+	norm = norm_l(L_sum);
+	shift = 4 - (norm >> 1);
+	if(shift > 0)
+	{
+		/* vo_shr_r() without the 32 bit intermediate */
+		for (i = 0; i < L_WINDOW; i += 8)
+		{
+			y8 = _mm_loadu_si128((__m128i *)&y[i]);
+			lo = _mm_and_si128(_mm_srai_epi16(y8, shift - 1), _mm_set1_epi16(1));
+			_mm_storeu_si128((__m128i *)&y[i], _mm_add_epi16(_mm_srai_epi16(y8, shift), lo));
+		}
+	}
+
+	/* Compute and normalize r[0] */
+	L_sum = (vo_sse2_hsum(vo_sse2_dot(y, y, L_WINDOW >> 3)) << 1) + 1;
+
+	norm = norm_l(L_sum);
+	L_sum = (L_sum << norm);
+
+	r_h[0] = L_sum >> 16;
+	r_l[0] = (L_sum & 0xffff)>>1;
+
+	/* Compute r[1] to r[m], the padding ends the sums */
+	for (i = 1; i <= 8; i++)
+	{
+		F_LEN = L_WINDOW - (2*i - 1);
+		L_sum1 = vo_sse2_hsum(vo_sse2_dot(y, y + (2*i) - 1, (F_LEN + 7) >> 3));
+		F_LEN = L_WINDOW - 2*i;
+		L_sum = vo_sse2_hsum(vo_sse2_dot(y, y + (2*i), (F_LEN + 7) >> 3));
+
+		L_sum1 = L_sum1<<norm;
+		L_sum = L_sum<<norm;
+
+		r_h[(2*i)-1] = L_sum1 >> 15;
+		r_l[(2*i)-1] = L_sum1 & 0x00007fff;
+		r_h[(2*i)] = L_sum >> 15;
+		r_l[(2*i)] = L_sum & 0x00007fff;
+	}
+#else
 	Word16 y[L_WINDOW];
 	Word32 L_sum, L_sum1, L_tmp, F_LEN;
 	Word16 *p1,*p2,*p3;
@@ -120,6 +191,7 @@ void Autocorr(
 		r_h[(2*i)] = L_sum >> 15;
 		r_l[(2*i)] = L_sum & 0x00007fff;
 	}
+#endif
 	return;
 }
 
@@ -44,6 +44,7 @@
 #include "math_op.h"
 #include "acelp.h"
 #include "cnst.h"
+#include "basic_op_sse2.h"
 
 #include "q_pulse.h"
 
@@ -519,6 +520,33 @@ void ACELP_4t64_fx(
 
 	p0 = &rrixiy[0][0];
 
+#if defined(__SSE2__)
+	for (k = 0; k < NB_TRACK; k++)
+	{
+		Word16 sign_y[NB_POS], vec_y[NB_POS];
+
+		/* sign[] and vec[] of the positions of track k + 1 */
+		j_temp = (k + 1)&0x03;
+		for (j = 0; j < NB_POS; j++)
+		{
+			sign_y[j] = sign[j_temp + j * STEP];
+			vec_y[j] = vec[j_temp + j * STEP];
+		}
+		for (i = k; i < L_SUBFR; i += STEP)
+		{
+			psign = sign_y;
+			if (sign[i] < 0)
+			{
+				psign = vec_y;
+			}
+			_mm_storeu_si128((__m128i *)&p0[0], vo_sse2_mult(_mm_loadu_si128((__m128i *)&p0[0]),
+						_mm_loadu_si128((__m128i *)&psign[0])));
+			_mm_storeu_si128((__m128i *)&p0[8], vo_sse2_mult(_mm_loadu_si128((__m128i *)&p0[8]),
+						_mm_loadu_si128((__m128i *)&psign[8])));
+			p0 += NB_POS;
+		}
+	}
+#else
 	for (k = 0; k < NB_TRACK; k++)
 	{
 		j_temp = (k + 1)&0x03;
@@ -537,6 +565,7 @@ void ACELP_4t64_fx(
 			}
 		}
 	}
+#endif
 
 	/*-------------------------------------------------------------------*
 	 *                       Deep first search                           *
@@ -818,6 +847,47 @@ void ACELP_4t64_fx(
 }
 
 
+#if defined(__SSE2__)
+/*-------------------------------------------------------------------*
+ * Function  cor_h_vec_sse2()                                        *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~                                        *
+ * Correlations of h[] with vec[] at the positions of a track and at *
+ * the same positions moved by offset, before scaling:               *
+ *   L_sum[2*i]   = sum h[j] * vec[pos + j]                          *
+ *   L_sum[2*i+1] = sum h[j] * vec[pos + offset + j]                 *
+ * with pos = track + i * STEP and j up to the end of vec[].         *
+ *-------------------------------------------------------------------*/
+static void cor_h_vec_sse2(
+		Word16 h[],                           /* (i) scaled impulse response                 */
+		Word16 vec[],                         /* (i) scaled vector (/8) to correlate with h[] */
+		Word32 track,                         /* (i) track to use                            */
+		Word32 offset,                        /* (i) offset of the second correlation        */
+		Word32 L_sum[]                        /* (o) correlations (2*NB_POS elements)        */
+		)
+{
+	Word32 i, p0, p1;
+	Word16 vp[L_SUBFR + 8];                   /* vec[] padded with zeros */
+
+	for (i = 0; i < L_SUBFR; i++)
+		vp[i] = vec[i];
+	for (; i < L_SUBFR + 8; i++)
+		vp[i] = 0;
+
+	for (i = 0; i < NB_POS; i += 2)
+	{
+		p0 = track + i * STEP;
+		p1 = p0 + offset;
+
+		_mm_storeu_si128((__m128i *)&L_sum[2 * i], vo_sse2_hsum4(
+					vo_sse2_dot(h, &vp[p0], (L_SUBFR - p0 + 7) >> 3),
+					vo_sse2_dot(h, &vp[p1], (L_SUBFR - p1 + 7) >> 3),
+					vo_sse2_dot(h, &vp[p0 + STEP], (L_SUBFR - p0 - STEP + 7) >> 3),
+					vo_sse2_dot(h, &vp[p1 + STEP], (L_SUBFR - p1 - STEP + 7) >> 3)));
+	}
+	return;
+}
+#endif
+
 /*-------------------------------------------------------------------*
  * Function  cor_h_vec()                                             *
  * ~~~~~~~~~~~~~~~~~~~~~                                             *
@@ -833,15 +903,37 @@ void cor_h_vec_30(
 		Word16 cor_2[]                        /* (o) result of correlation (NB_POS elements) */
 		)
 {
-	Word32 i, j, pos, corr;
-	Word16 *p0, *p1, *p2,*p3,*cor_x,*cor_y;
+	Word32 i, pos, corr;
+	Word16 *p0, *p3,*cor_x,*cor_y;
 	Word32 L_sum1,L_sum2;
+#if !defined(__SSE2__)
+	Word32 j;
+	Word16 *p1, *p2;
+#endif
 	cor_x = cor_1;
 	cor_y = cor_2;
 	p0 = rrixix[track];
 	p3 = rrixix[0];
 	pos = track;
 
+#if defined(__SSE2__)
+	{
+		Word32 L_sum[2 * NB_POS];
+
+		cor_h_vec_sse2(h, vec, track, -3, L_sum);
+		for (i = 0; i < NB_POS; i++)
+		{
+			L_sum1 = (L_sum[2 * i] << 2);
+			L_sum2 = (L_sum[2 * i + 1] << 2);
+
+			corr = vo_round(L_sum1);
+			*cor_x++ = vo_mult(corr, sign[pos]) + (*p0++);
+			corr = vo_round(L_sum2);
+			*cor_y++ = vo_mult(corr, sign[pos-3]) + (*p3++);
+			pos += STEP;
+		}
+	}
+#else
 	for (i = 0; i < NB_POS; i+=2)
 	{
 		L_sum1 = L_sum2 = 0L;
@@ -892,6 +984,7 @@ void cor_h_vec_30(
 		*cor_y++ = vo_mult(corr, sign[pos-3]) + (*p3++);
 		pos += STEP;
 	}
+#endif
 	return;
 }
 
@@ -905,15 +998,37 @@ void cor_h_vec_012(
 		Word16 cor_2[]                        /* (o) result of correlation (NB_POS elements) */
 		)
 {
-	Word32 i, j, pos, corr;
-	Word16 *p0, *p1, *p2,*p3,*cor_x,*cor_y;
+	Word32 i, pos, corr;
+	Word16 *p0, *p3,*cor_x,*cor_y;
 	Word32 L_sum1,L_sum2;
+#if !defined(__SSE2__)
+	Word32 j;
+	Word16 *p1, *p2;
+#endif
 	cor_x = cor_1;
 	cor_y = cor_2;
 	p0 = rrixix[track];
 	p3 = rrixix[track+1];
 	pos = track;
 
+#if defined(__SSE2__)
+	{
+		Word32 L_sum[2 * NB_POS];
+
+		cor_h_vec_sse2(h, vec, track, 1, L_sum);
+		for (i = 0; i < NB_POS; i++)
+		{
+			L_sum1 = (L_sum[2 * i] << 2);
+			L_sum2 = (L_sum[2 * i + 1] << 2);
+
+			corr = (L_sum1 + 0x8000) >> 16;
+			cor_x[i] = vo_mult(corr, sign[pos]) + (*p0++);
+			corr = (L_sum2 + 0x8000) >> 16;
+			cor_y[i] = vo_mult(corr, sign[pos + 1]) + (*p3++);
+			pos += STEP;
+		}
+	}
+#else
 	for (i = 0; i < NB_POS; i+=2)
 	{
 		L_sum1 = L_sum2 = 0L;
@@ -952,6 +1067,7 @@ void cor_h_vec_012(
 		cor_y[i+1] = vo_mult(corr, sign[pos + 1]) + (*p3++);
 		pos += STEP;
 	}
+#endif
 	return;
 }
 
@@ -977,10 +1093,16 @@ void search_ixiy(
 		)
 {
 	Word32 x, y, pos, thres_ix;
-	Word16 ps1, ps2, sq, sqk;
-	Word16 alp_16, alpk;
+	Word16 ps1, sqk;
+	Word16 alpk;
 	Word16 *p0, *p1, *p2;
-	Word32 s, alp0, alp1, alp2;
+	Word32 s, alp0, alp1;
+#if defined(__SSE2__)
+	Word16 dn_y[NB_POS], sq_y[NB_POS], alp_y[NB_POS];
+#else
+	Word16 ps2, sq, alp_16;
+	Word32 alp2;
+#endif
 
 	p0 = cor_x;
 	p1 = cor_y;
@@ -994,6 +1116,11 @@ void search_ixiy(
 	sqk = -1;
 	alpk = 1;
 
+#if defined(__SSE2__)
+	for (y = track_y, pos = 0; y < L_SUBFR; y += STEP, pos++)
+		dn_y[pos] = dn[y];
+#endif
+
 	for (x = track_x; x < L_SUBFR; x += STEP)
 	{
 		ps1 = *ps + dn[x];
@@ -1001,6 +1128,43 @@ void search_ixiy(
 
 		if (dn2[x] < thres_ix)
 		{
+#if defined(__SSE2__)
+			/* sq and alp_16 of all positions of pulse 2, the search
+			   itself stays in order */
+			__m128i ps1_8 = _mm_set1_epi16(ps1), alp1_4 = _mm_set1_epi32(alp1);
+			__m128i ps2_8, c8, r8, lo, hi;
+			Word32 k;
+
+			for (k = 0; k < NB_POS; k += 8)
+			{
+				ps2_8 = _mm_add_epi16(ps1_8, _mm_loadu_si128((__m128i *)&dn_y[k]));
+				_mm_storeu_si128((__m128i *)&sq_y[k], vo_sse2_mult(ps2_8, ps2_8));
+
+				c8 = _mm_loadu_si128((__m128i *)&p1[k]);
+				r8 = _mm_loadu_si128((__m128i *)&p2[k]);
+				lo = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), c8), 3),
+						_mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), r8), 2));
+				hi = _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), c8), 3),
+						_mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), r8), 2));
+				lo = _mm_srai_epi32(_mm_add_epi32(alp1_4, lo), 16);
+				hi = _mm_srai_epi32(_mm_add_epi32(alp1_4, hi), 16);
+				_mm_storeu_si128((__m128i *)&alp_y[k], _mm_packs_epi32(lo, hi));
+			}
+			p2 += NB_POS;
+
+			pos = -1;
+			for (y = track_y, k = 0; y < L_SUBFR; y += STEP, k++)
+			{
+				s = vo_L_mult(alpk, sq_y[k]) - ((sqk * alp_y[k])<<1);
+
+				if (s > 0)
+				{
+					sqk = sq_y[k];
+					alpk = alp_y[k];
+					pos = y;
+				}
+			}
+#else
 			pos = -1;
 			for (y = track_y; y < L_SUBFR; y += STEP)
 			{
@@ -1020,6 +1184,7 @@ void search_ixiy(
 				}
 			}
 			p1 -= NB_POS;
+#endif
 
 			if (pos >= 0)
 			{
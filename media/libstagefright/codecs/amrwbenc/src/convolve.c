@@ -24,6 +24,7 @@
 
 #include "typedef.h"
 #include "basic_op.h"
+#include "basic_op_sse2.h"
 
 void Convolve (
 		Word16 x[],        /* (i)     : input vector                           */
@@ -32,6 +33,27 @@ void Convolve (
 		Word16 L           /* (i)     : vector size                            */
 	      )
 {
+#if defined(__SSE2__)
+	Word32  i, n, k;
+	Word16  hr[64 + 8];                /* h[] reversed, padded with zeros */
+	__m128i s[4], y4;
+
+	for (i = 0; i < 64; i++)
+		hr[i] = h[63 - i];
+	for (; i < 64 + 8; i++)
+		hr[i] = 0;
+
+	/* y[n] = sum x[i] * hr[63 - n + i], i = 0..n, the padding covers i > n */
+	for (n = 0; n < 64; n += 4)
+	{
+		for (k = 0; k < 4; k++)
+			s[k] = vo_sse2_dot(x, &hr[63 - n - k], (n + k + 8) >> 3);
+
+		y4 = vo_sse2_hsum4(s[0], s[1], s[2], s[3]);
+		y4 = _mm_srai_epi32(_mm_add_epi32(_mm_slli_epi32(y4, 1), _mm_set1_epi32(0x8000)), 16);
+		_mm_storel_epi64((__m128i *)&y[n], _mm_packs_epi32(y4, y4));
+	}
+#else
 	Word32  i, n;
 	Word16 *tmpH,*tmpX;
 	Word32 s;
@@ -102,6 +124,7 @@ void Convolve (
 		y[n] = ((s<<1) + 0x8000)>>16;
 		n++;
 	}
+#endif
 	return;
 }
 
@@ -27,6 +27,7 @@
 #include "typedef.h"
 #include "basic_op.h"
 #include "math_op.h"
+#include "basic_op_sse2.h"
 
 #define L_SUBFR   64
 #define NB_TRACK  4
@@ -39,9 +40,13 @@ void cor_h_x(
 	    )
 {
 	Word32 i, j;
-	Word32 L_tmp, y32[L_SUBFR], L_tot;
-	Word16 *p1, *p2;
+	Word32 y32[L_SUBFR], L_tot;
+	Word16 *p1;
 	Word32 *p3;
+#if !defined(__SSE2__)
+	Word32 L_tmp;
+	Word16 *p2;
+#endif
 	Word32 L_max, L_max1, L_max2, L_max3;
 	/* first keep the result on 32 bits and find absolute maximum */
 	L_tot  = 1;
@@ -49,6 +54,38 @@ void cor_h_x(
 	L_max1 = 0;
 	L_max2 = 0;
 	L_max3 = 0;
+#if defined(__SSE2__)
+	{
+		Word16 xp[L_SUBFR + 8];            /* x[] padded with zeros */
+		__m128i s[4], y4, sign, gt, max4;
+
+		for (i = 0; i < L_SUBFR; i++)
+			xp[i] = x[i];
+		for (; i < L_SUBFR + 8; i++)
+			xp[i] = 0;
+
+		/* lane j of max4 is the maximum of the tracks i = j (mod 4) */
+		max4 = _mm_setzero_si128();
+		for (i = 0; i < L_SUBFR; i += STEP)
+		{
+			for (j = 0; j < STEP; j++)
+				s[j] = vo_sse2_dot(&xp[i + j], h, (L_SUBFR - i - j + 7) >> 3);
+
+			y4 = vo_sse2_hsum4(s[0], s[1], s[2], s[3]);
+			y4 = _mm_add_epi32(_mm_slli_epi32(y4, 1), _mm_set1_epi32(1));
+			_mm_storeu_si128((__m128i *)&y32[i], y4);
+
+			sign = _mm_srai_epi32(y4, 31);
+			y4 = _mm_sub_epi32(_mm_xor_si128(y4, sign), sign);
+			gt = _mm_cmpgt_epi32(y4, max4);
+			max4 = _mm_or_si128(_mm_and_si128(gt, y4), _mm_andnot_si128(gt, max4));
+		}
+		L_max  = _mm_cvtsi128_si32(max4);
+		L_max1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(max4, _MM_SHUFFLE(1, 1, 1, 1)));
+		L_max2 = _mm_cvtsi128_si32(_mm_shuffle_epi32(max4, _MM_SHUFFLE(2, 2, 2, 2)));
+		L_max3 = _mm_cvtsi128_si32(_mm_shuffle_epi32(max4, _MM_SHUFFLE(3, 3, 3, 3)));
+	}
+#else
 	for (i = 0; i < L_SUBFR; i += STEP)
 	{
 		L_tmp = 1;                                    /* 1 -> to avoid null dn[] */
@@ -103,6 +140,7 @@ void cor_h_x(
 			L_max3 = L_tmp;
 		}
 	}
+#endif
 	/* tot += 3*max / 8 */
 	L_max = ((L_max + L_max1 + L_max2 + L_max3) >> 2);
 	L_tot = vo_L_add(L_tot, L_max);       /* +max/4 */
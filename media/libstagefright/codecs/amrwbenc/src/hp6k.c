@@ -27,6 +27,7 @@
 #include "basic_op.h"
 #include "acelp.h"
 #include "cnst.h"
+#include "basic_op_sse2.h"
 
 #define L_FIR 31
 
@@ -56,7 +57,13 @@ void Filt_6k_7k(
 		Word16 mem[]                          /* in/out: memory (size=30)        */
 	       )
 {
+#if defined(__SSE2__)
+	Word16 x[L_SUBFR16k + (L_FIR - 1) + 1];    /* one more for the 32nd tap */
+	__m128i c[4], d[4], s4;
+	Word32 k;
+#else
 	Word16 x[L_SUBFR16k + (L_FIR - 1)];
+#endif
 	Word32 i, L_tmp;
 
 	Copy(mem, x, L_FIR - 1);
@@ -64,7 +71,34 @@ void Filt_6k_7k(
 	{
 		x[i + L_FIR - 1] = signal[i] >> 2;                         /* gain of filter = 4 */
 	}
+#if defined(__SSE2__)
+	/* the table is symmetric, (x[i] + x[i+30]) * fir_6k_7k[0] + ... is the
+	   plain 31 tap product, padded with a zero tap */
+	x[lg + L_FIR - 1] = 0;
+	c[0] = _mm_loadu_si128((__m128i *)&fir_6k_7k[0]);
+	c[1] = _mm_loadu_si128((__m128i *)&fir_6k_7k[8]);
+	c[2] = _mm_loadu_si128((__m128i *)&fir_6k_7k[16]);
+	c[3] = _mm_srli_si128(_mm_loadu_si128((__m128i *)&fir_6k_7k[L_FIR - 8]), 2);
+	for (i = 0; i + 4 <= lg; i += 4)
+	{
+		for (k = 0; k < 4; k++)
+		{
+			d[k] = _mm_add_epi32(
+					_mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i + k]), c[0]),
+						_mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i + k + 8]), c[1])),
+					_mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i + k + 16]), c[2]),
+						_mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i + k + 24]), c[3])));
+		}
+		s4 = vo_sse2_hsum4(d[0], d[1], d[2], d[3]);
+		s4 = _mm_srai_epi32(_mm_add_epi32(s4, _mm_set1_epi32(0x4000)), 15);
+		s4 = _mm_srai_epi32(_mm_slli_epi32(s4, 16), 16);        /* (Word16) */
+		_mm_storel_epi64((__m128i *)&signal[i], _mm_packs_epi32(s4, s4));
+	}
+	/* remaining samples */
+	for (; i < lg; i++)
+#else
 	for (i = 0; i < lg; i++)
+#endif
 	{
 		L_tmp =  (x[i] + x[i+ 30]) * fir_6k_7k[0];
 		L_tmp += (x[i+1] + x[i + 29]) * fir_6k_7k[1];
@@ -38,6 +38,7 @@
 */
 #include "typedef.h"
 #include "basic_op.h"
+#include "basic_op_sse2.h"
 #include "math_op.h"
 
 /*___________________________________________________________________________
@@ -202,8 +203,13 @@ Word32 Dot_product12(                      /* (o) Q31: normalized result (1 < va
 {
 	Word16 sft;
 	Word32 i, L_sum;
+#if defined(__SSE2__)
+	L_sum = vo_sse2_hsum(vo_sse2_dot(x, y, lg >> 3));
+	for (i = lg & ~7; i < lg; i++)
+#else
 	L_sum = 0;
 	for (i = 0; i < lg; i++)
+#endif
 	{
 		L_sum += x[i] * y[i];
 	}
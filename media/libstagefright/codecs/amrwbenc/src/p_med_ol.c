@@ -26,6 +26,7 @@
 #include "acelp.h"
 #include "oper_32b.h"
 #include "math_op.h"
+#include "basic_op_sse2.h"
 #include "p_med_ol.tab"
 
 Word16 Pitch_med_ol(
@@ -57,10 +58,17 @@ Word16 Pitch_med_ol(
 	for (i = L_max; i > L_min; i--)
 	{
 		/* Compute the correlation */
+#if defined(__SSE2__)
+		R0 = vo_sse2_hsum(vo_sse2_dot(wsp, &wsp[-i], L_frame >> 3)) << 1;
+		p1 = &wsp[L_frame & ~7];
+		p2 = &wsp[(L_frame & ~7) - i];
+		for (j = L_frame & ~7; j < L_frame; j+=4)
+#else
 		R0 = 0;
 		p1 = wsp;
 		p2 = &wsp[-i];
 		for (j = 0; j < L_frame; j+=4)
+#endif
 		{
 			R0 += vo_L_mult((*p1++), (*p2++));
 			R0 += vo_L_mult((*p1++), (*p2++));
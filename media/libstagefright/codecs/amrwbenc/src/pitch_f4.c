@@ -27,6 +27,7 @@
 #include "math_op.h"
 #include "acelp.h"
 #include "cnst.h"
+#include "basic_op_sse2.h"
 
 #define UP_SAMP      4
 #define L_INTERPOL1  4
@@ -182,6 +183,9 @@ static void Norm_Corr(
 #endif
 
 	/* Compute rounded down 1/sqrt(energy of xn[]) */
+#if defined(__SSE2__)
+	L_tmp = vo_sse2_hsum(vo_sse2_dot(xn, xn, 64 >> 3));
+#else
 	L_tmp = 0;
 	for (i = 0; i < 64; i+=4)
 	{
@@ -190,6 +194,7 @@ static void Norm_Corr(
 		L_tmp += (xn[i+2] * xn[i+2]);
 		L_tmp += (xn[i+3] * xn[i+3]);
 	}
+#endif
 
 	L_tmp = (L_tmp << 1) + 1;
 	exp = norm_l(L_tmp);
@@ -202,6 +207,10 @@ static void Norm_Corr(
 	for (t = t_min; t <= t_max; t++)
 	{
 		/* Compute correlation between xn[] and excf[] */
+#if defined(__SSE2__)
+		L_tmp  = vo_sse2_hsum(vo_sse2_dot(xn, excf, 64 >> 3));
+		L_tmp1 = vo_sse2_hsum(vo_sse2_dot(excf, excf, 64 >> 3));
+#else
 		L_tmp  = 0;
 		L_tmp1 = 0;
 		for (i = 0; i < 64; i+=4)
@@ -215,6 +224,7 @@ static void Norm_Corr(
 			L_tmp  += (xn[i+3] * excf[i+3]);
 			L_tmp1 += (excf[i+3] * excf[i+3]);
 		}
+#endif
 
 		L_tmp = (L_tmp << 1) + 1;
 		L_tmp1 = (L_tmp1 << 1) + 1;
@@ -253,11 +263,28 @@ static void Norm_Corr(
 		{
 			k = -(t + 1);
 			tmp = exc[k];
+#if defined(__SSE2__)
+			{
+				/* top block first, each block reads the old excf[i - 1] */
+				__m128i t8 = _mm_set1_epi16(tmp), m8, e8;
+
+				for (i = 56; i >= 0; i -= 8)
+				{
+					m8 = vo_sse2_mult(t8, _mm_loadu_si128((__m128i *)&h[i]));
+					if (i > 0)
+						e8 = _mm_loadu_si128((__m128i *)&excf[i - 1]);
+					else
+						e8 = _mm_slli_si128(_mm_loadu_si128((__m128i *)&excf[0]), 2);
+					_mm_storeu_si128((__m128i *)&excf[i], _mm_add_epi16(m8, e8));
+				}
+			}
+#else
 			for (i = 63; i > 0; i--)
 			{
 				excf[i] = add1(vo_mult(tmp, h[i]), excf[i - 1]);
 			}
 			excf[0] = vo_mult(tmp, h[0]);
+#endif
 		}
 	}
 	return;
@@ -26,6 +26,7 @@
 
 #include "typedef.h"
 #include "basic_op.h"
+#include "basic_op_sse2.h"
 
 #define UP_SAMP      4
 #define L_INTERPOL2  16
@@ -71,7 +72,36 @@ void Pred_lt4(
 	k = 3 - frac;                                /* k = UP_SAMP - 1 - frac */
 
 	ptr2 = &(inter4_2[k][0]);
-	for (j = 0; j < L_subfr; j++)
+	j = 0;
+#if defined(__SSE2__)
+	/* 4 samples at a time, exc[j+3] must only depend on exc[] before exc[j] */
+	if (T0 >= 20)
+	{
+		__m128i c0, c1, c2, c3, d[4], s4;
+		Word16 n;
+
+		c0 = _mm_loadu_si128((__m128i *)&ptr2[0]);
+		c1 = _mm_loadu_si128((__m128i *)&ptr2[8]);
+		c2 = _mm_loadu_si128((__m128i *)&ptr2[16]);
+		c3 = _mm_loadu_si128((__m128i *)&ptr2[24]);
+		for (; j + 4 <= L_subfr; j += 4)
+		{
+			for (n = 0; n < 4; n++)
+			{
+				ptr1 = x + n;
+				d[n] = _mm_add_epi32(
+						_mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&ptr1[0]), c0),
+							_mm_madd_epi16(_mm_loadu_si128((__m128i *)&ptr1[8]), c1)),
+						_mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&ptr1[16]), c2),
+							_mm_madd_epi16(_mm_loadu_si128((__m128i *)&ptr1[24]), c3)));
+			}
+			s4 = vo_sse2_shl_round(vo_sse2_hsum4(d[0], d[1], d[2], d[3]), 16 - 2);
+			_mm_storel_epi64((__m128i *)&exc[j], _mm_packs_epi32(s4, s4));
+			x += 4;
+		}
+	}
+#endif
+	for (; j < L_subfr; j++)
 	{
 		ptr = ptr2;
 		ptr1 = x;
@@ -24,6 +24,7 @@
 
 #include "typedef.h"
 #include "basic_op.h"
+#include "basic_op_sse2.h"
 
 void Residu(
 		Word16 a[],                           /* (i) Q12 : prediction coefficients                     */
@@ -34,7 +35,37 @@ void Residu(
 {
 	Word16 i,*p1, *p2;
 	Word32 s;
+#if defined(__SSE2__)
+	Word16 ar[16];
+	__m128i a_lo, a_hi, a0, d[4], s4;
+	Word32 k;
+
+	/* a[16..1] to go with x[i-16..i-1], a[0] * x[i] is added on its own */
+	for (k = 0; k < 16; k++)
+		ar[k] = a[16 - k];
+	a_lo = _mm_loadu_si128((__m128i *)&ar[0]);
+	a_hi = _mm_loadu_si128((__m128i *)&ar[8]);
+	a0 = _mm_set1_epi32((unsigned short)a[0]);
+
+	for (i = 0; i + 4 <= lg; i += 4)
+	{
+		for (k = 0; k < 4; k++)
+		{
+			d[k] = _mm_add_epi32(
+					_mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i + k - 16]), a_lo),
+					_mm_madd_epi16(_mm_loadu_si128((__m128i *)&x[i + k - 8]), a_hi));
+		}
+		s4 = vo_sse2_hsum4(d[0], d[1], d[2], d[3]);
+		s4 = _mm_add_epi32(s4, _mm_madd_epi16(_mm_unpacklo_epi16(
+						_mm_loadl_epi64((__m128i *)&x[i]), _mm_setzero_si128()), a0));
+		s4 = vo_sse2_shl_round(s4, 16 - 5);
+		_mm_storel_epi64((__m128i *)&y[i], _mm_packs_epi32(s4, s4));
+	}
+	/* remaining samples */
+	for (; i < lg; i++)
+#else
 	for (i = 0; i < lg; i++)
+#endif
 	{
 		p1 = a;
 		p2 = &x[i];
@@ -23,6 +23,7 @@
 
 #include "typedef.h"
 #include "basic_op.h"
+#include "basic_op_sse2.h"
 
 void Scale_sig(
 		Word16 x[],                           /* (i/o) : signal to scale               */
@@ -32,6 +33,36 @@ void Scale_sig(
 {
 	Word32 i;
 	Word32 L_tmp;
+#if defined(__SSE2__)
+	__m128i x8, lo, hi, sh;
+
+	/* blocks of 8, the C code below does the rest */
+	if(exp > 0 && exp <= 16)
+	{
+		/* round(x << exp) saturated, packs does the saturation */
+		sh = _mm_cvtsi32_si128(exp);
+		for (; lg >= 8; lg -= 8, x += 8)
+		{
+			x8 = _mm_loadu_si128((__m128i *)x);
+			lo = _mm_sll_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(x8, x8), 16), sh);
+			hi = _mm_sll_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(x8, x8), 16), sh);
+			_mm_storeu_si128((__m128i *)x, _mm_packs_epi32(lo, hi));
+		}
+	}
+	else if(exp <= 0 && exp > -16)
+	{
+		sh = _mm_cvtsi32_si128(-exp);
+		for (; lg >= 8; lg -= 8, x += 8)
+		{
+			x8 = _mm_loadu_si128((__m128i *)x);
+			lo = _mm_sra_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), x8), sh);
+			hi = _mm_sra_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), x8), sh);
+			lo = _mm_srai_epi32(_mm_add_epi32(lo, _mm_set1_epi32(0x8000)), 16);
+			hi = _mm_srai_epi32(_mm_add_epi32(hi, _mm_set1_epi32(0x8000)), 16);
+			_mm_storeu_si128((__m128i *)x, _mm_packs_epi32(lo, hi));
+		}
+	}
+#endif
 	if(exp > 0)
 	{
 		for (i = lg - 1 ; i >= 0; i--)
@@ -25,6 +25,7 @@
 #include "basic_op.h"
 #include "math_op.h"
 #include "cnst.h"
+#include "basic_op_sse2.h"
 
 void Syn_filt(
 		Word16 a[],                           /* (i) Q12 : a[m+1] prediction coefficients           */
@@ -35,6 +36,47 @@ void Syn_filt(
 		Word16 update                         /* (i)     : 0=no update, 1=update of memory.         */
 	     )
 {
+#if defined(__SSE2__)
+	Word32 i, a0;
+	Word32 L_tmp;
+	Word16 hist[16];
+	__m128i c0, c1, h0, h1, d;
+
+	/* h0 = y[i-1] .. y[i-8] and h1 = y[i-9] .. y[i-16], c0 and c1 the
+	   matching a[1..16] */
+	for (i = 0; i < 16; i++)
+	{
+		hist[i] = mem[15 - i];
+	}
+	h0 = _mm_loadu_si128((__m128i *)&hist[0]);
+	h1 = _mm_loadu_si128((__m128i *)&hist[8]);
+	c0 = _mm_loadu_si128((__m128i *)&a[1]);
+	c1 = _mm_loadu_si128((__m128i *)&a[9]);
+	a0 = (a[0] >> 1);                     /* input / 2 */
+	/* Do the filtering. */
+	for (i = 0; i < lg; i++)
+	{
+		d = _mm_add_epi32(_mm_madd_epi16(h0, c0), _mm_madd_epi16(h1, c1));
+		L_tmp = vo_mult32(a0, x[i]) - vo_sse2_hsum(d);
+
+		L_tmp = L_shl2(L_tmp, 4);
+		y[i] = extract_h(L_add(L_tmp, 0x8000));
+
+		h1 = _mm_or_si128(_mm_slli_si128(h1, 2), _mm_srli_si128(h0, 14));
+		h0 = _mm_insert_epi16(_mm_slli_si128(h0, 2), y[i], 0);
+	}
+	/* Update memory if required */
+	if (update)
+	{
+		_mm_storeu_si128((__m128i *)&hist[0], h0);
+		_mm_storeu_si128((__m128i *)&hist[8], h1);
+		for (i = 0; i < 16; i++)
+		{
+			mem[i] = hist[15 - i];
+		}
+	}
+	return;
+#else
 	Word32 i, a0;
 	Word16 y_buf[L_SUBFR16k + M16k];
 	Word32 L_tmp;
@@ -79,6 +121,7 @@ void Syn_filt(
 			mem[i] = yy[lg - 16 + i];
 		}
 	return;
+#endif
 }
 
 
@@ -92,6 +135,49 @@ void Syn_filt_32(
 		Word16 lg                             /* (i)     : size of filtering              */
 		)
 {
+#if defined(__SSE2__)
+	Word32 i,a0;
+	Word32 L_tmp, L_tmp1;
+	Word16 ra[16];
+	__m128i c0, c1, lo, hi, d;
+
+	/* a[15..0], so that sig_lo/sig_hi[i-16 .. i-1] can be used as they are */
+	for (i = 0; i < 16; i++)
+	{
+		ra[i] = a[15 - i];
+	}
+	c0 = _mm_loadu_si128((__m128i *)&ra[0]);
+	c1 = _mm_loadu_si128((__m128i *)&ra[8]);
+	a0 = a[0] >> (4 + Qnew);          /* input / 16 and >>Qnew */
+	/* Do the filtering. */
+	for (i = 0; i < lg; i++)
+	{
+		lo = _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&sig_lo[i - 16]), c0),
+				_mm_madd_epi16(_mm_loadu_si128((__m128i *)&sig_lo[i - 8]), c1));
+		hi = _mm_add_epi32(_mm_madd_epi16(_mm_loadu_si128((__m128i *)&sig_hi[i - 16]), c0),
+				_mm_madd_epi16(_mm_loadu_si128((__m128i *)&sig_hi[i - 8]), c1));
+		/* lane 0: sum of the sig_lo products, lane 2: sum of the sig_hi ones */
+		d = _mm_add_epi32(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+		d = _mm_add_epi32(d, _mm_shuffle_epi32(d, _MM_SHUFFLE(2, 3, 0, 1)));
+		L_tmp  = -_mm_cvtsi128_si32(d);
+		L_tmp1 = -_mm_cvtsi128_si32(_mm_unpackhi_epi64(d, d));
+
+		L_tmp = L_tmp >> 11;
+		L_tmp += vo_L_mult(exc[i], a0);
+
+		/* sig_hi = bit16 to bit31 of synthesis */
+		L_tmp = L_tmp - (L_tmp1<<1);
+
+		L_tmp = L_tmp >> 3;           /* ai in Q12 */
+		sig_hi[i] = extract_h(L_tmp);
+
+		/* sig_lo = bit4 to bit15 of synthesis */
+		L_tmp >>= 4;           /* 4 : sig_lo[i] >> 4 */
+		sig_lo[i] = (Word16)((L_tmp - (sig_hi[i] << 13)));
+	}
+
+	return;
+#else
 	Word32 i,a0;
 	Word32 L_tmp, L_tmp1;
 	Word16 *p1, *p2, *p3;
@@ -153,6 +239,7 @@ void Syn_filt_32(
 	}
 
 	return;
+#endif
 }
 
 
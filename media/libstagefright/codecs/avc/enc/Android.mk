@@ -16,6 +16,7 @@ LOCAL_SRC_FILES := \
     src/sad.cpp \
     src/sad_halfpel.cpp \
     src/slice.cpp \
+    src/slice_thread.cpp \
     src/vlc_encode.cpp
 
 
@@ -61,6 +62,7 @@ LOCAL_SHARED_LIBRARIES := \
         libstagefright_enc_common \
         libstagefright_foundation \
         libstagefright_omx \
+        libcutils \
         libutils \
         liblog \
         libui
@@ -17,6 +17,7 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "SoftAVCEncoder"
 #include <utils/Log.h>
+#include <cutils/properties.h>
 
 #include "avcenc_api.h"
 #include "avcenc_int.h"
@@ -254,6 +255,14 @@ OMX_ERRORTYPE SoftAVCEncoder::initEncParams() {
 
     mEncParams->use_overrun_buffer = AVC_OFF;
 
+    // Encode each picture as this many slices in parallel. Off by default,
+    // slices cost some compression and only pay off on several cores.
+    mEncParams->num_slice = 0;
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.stagefright.avcenc-slices", value, NULL)) {
+        mEncParams->num_slice = atoi(value);
+    }
+
     if (mVideoColorFormat == OMX_COLOR_FormatYUV420SemiPlanar) {
         // Color conversion is needed.
         CHECK(mInputFrameData == NULL);
@@ -871,7 +880,32 @@ void SoftAVCEncoder::onQueueFilled(OMX_U32 portIndex) {
         CHECK(encoderStatus == AVCENC_SUCCESS || encoderStatus == AVCENC_NEW_IDR);
         dataLength = outHeader->nAllocLen;  // Reset the output buffer length
         if (inHeader->nFilledLen > 0) {
+            // With several slices all slices of the picture go to the same
+            // buffer, each behind a start code, the first one included.
+            uint32_t filledLength = 0;
+            if (mEncParams->num_slice > 1) {
+                memcpy(outPtr, "\x00\x00\x00\x01", 4);
+                filledLength = 4;
+                outPtr += 4;
+                dataLength -= 4;
+            }
             encoderStatus = PVAVCEncodeNAL(mHandle, outPtr, &dataLength, &type);
+
+            while (encoderStatus == AVCENC_SUCCESS && mEncParams->num_slice > 1) {
+                CHECK(NULL == PVAVCEncGetOverrunBuffer(mHandle));
+                filledLength += dataLength;
+                if (filledLength + 4 >= outHeader->nAllocLen) {
+                    encoderStatus = AVCENC_BITSTREAM_BUFFER_FULL;
+                    break;
+                }
+                memcpy(outPtr + dataLength, "\x00\x00\x00\x01", 4);
+                filledLength += 4;
+                outPtr += dataLength + 4;
+                dataLength = outHeader->nAllocLen - filledLength;
+                encoderStatus = PVAVCEncodeNAL(mHandle, outPtr, &dataLength, &type);
+            }
+            dataLength += filledLength;
+
             if (encoderStatus == AVCENC_SUCCESS) {
                 CHECK(NULL == PVAVCEncGetOverrunBuffer(mHandle));
             } else if (encoderStatus == AVCENC_PICTURE_READY) {
@@ -82,6 +82,8 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncInitialize(AVCHandle *avcHandle, AVCEncPar
 
     encvid->avcHandle = avcHandle;
 
+    encvid->sliceThread = NULL;
+
     encvid->common = (AVCCommonObj*) avcHandle->CBAVC_Malloc(userData, sizeof(AVCCommonObj), DEFAULT_ATTR);
     if (encvid->common == NULL)
     {
@@ -223,6 +225,16 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncInitialize(AVCHandle *avcHandle, AVCEncPar
     encvid->functionPointer->SAD_MB_HalfPel[2] = &AVCSAD_MB_HalfPel_Cyh;
     encvid->functionPointer->SAD_MB_HalfPel[3] = &AVCSAD_MB_HalfPel_Cxhyh;
 
+    /* start the threads for parallel slices */
+    if (encParam->num_slice > 1)
+    {
+        status = AVCSliceThreadInit(avcHandle, encParam->num_slice);
+        if (status != AVCENC_SUCCESS)
+        {
+            return status;
+        }
+    }
+
     /* initialize timing control */
     encvid->modTimeRef = 0;     /* ALWAYS ASSUME THAT TIMESTAMP START FROM 0 !!!*/
     video->prevFrameNum = 0;
@@ -435,6 +447,12 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncodeNAL(AVCHandle *avcHandle, unsigned char
             break;
 
         case AVCEnc_Encoding_Frame:
+            /* the other slices of the picture are already encoded */
+            if (encvid->sliceThread != NULL && encvid->sliceThread->nextSlice > 0)
+            {
+                return AVCSliceThreadNextNAL(encvid, buffer, buf_nal_size, nal_type);
+            }
+
             /* initialized the structure */
             BitstreamEncInit(bitstream, buffer, *buf_nal_size, encvid->overrunBuffer, encvid->oBSize);
             BitstreamWriteBits(bitstream, 8, (video->nal_ref_idc << 5) | (video->nal_unit_type));
@@ -457,6 +475,12 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncodeNAL(AVCHandle *avcHandle, unsigned char
                 return status;
             }
 
+            /* the other slices are encoded in parallel with this one */
+            if (encvid->sliceThread != NULL)
+            {
+                AVCSliceThreadStartEncode(encvid);
+            }
+
             status = AVCEncodeSlice(encvid);
 
             video->slice_id++;
@@ -470,6 +494,11 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncodeNAL(AVCHandle *avcHandle, unsigned char
 
             *nal_type = video->nal_unit_type;
 
+            if (encvid->sliceThread != NULL)
+            {
+                status = AVCSliceThreadFinishEncode(encvid, status);
+            }
+
             if (status == AVCENC_PICTURE_READY)
             {
                 status = RCUpdateFrame(encvid);
@@ -498,6 +527,13 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncodeNAL(AVCHandle *avcHandle, unsigned char
                 /* update POC related variables */
                 PostPOC(video);
 
+                /* return the other slices with the next calls */
+                if (encvid->sliceThread != NULL)
+                {
+                    encvid->sliceThread->nextSlice = 1;
+                    return AVCENC_SUCCESS;
+                }
+
                 encvid->enc_state = AVCEnc_Analyzing_Frame;
                 status = AVCENC_PICTURE_READY;
 
@@ -596,6 +632,8 @@ OSCL_EXPORT_REF void    PVAVCCleanUpEncoder(AVCHandle *avcHandle)
 
     if (encvid != NULL)
     {
+        AVCSliceThreadCleanUp(avcHandle);
+
         CleanMotionSearchModule(avcHandle);
 
         CleanupRateControlModule(avcHandle);
@@ -158,6 +158,9 @@ typedef struct tagAVCEncParam
 
     AVCFlag use_overrun_buffer;  /* do not throw away the frame if output buffer is not big enough.
                                     copy excess bits to the overrun buffer */
+
+    int num_slice;  /* number of slices per picture, 0 or 1 for one slice. Each slice is a band of
+                    macroblock rows encoded on its own thread, requires num_slice_group == 1 */
 } AVCEncParams;
 
 
@@ -241,6 +244,10 @@ extern "C"
     \param "buf_nal_size"   "As input, the size of the buffer in bytes.
                         This is the physical limitation of the buffer. As output, the size of the EBSP."
     \param "nal_type"   "Pointer to the NAL type of the returned buffer."
+    With num_slice > 1, the first call for a picture encodes all of its slices in parallel
+    and returns the first one. The following calls return the other slices in order, the
+    last one with AVCENC_PICTURE_READY. CBAVC_Malloc and CBAVC_Free may then be called from
+    the slice threads.
     \return "AVCENC_SUCCESS for success of encoding one slice,
              AVCENC_PICTURE_READY for the completion of a frame encoding,
              AVCENC_FAIL for failure (this should not occur, though)."
@@ -31,6 +31,8 @@ and necessary type defitionitions and enumerations.
 #include "avcenc_api.h"
 #endif
 
+#include <pthread.h>
+
 typedef float OsclFloat;
 
 /* Definition for the structures below */
@@ -86,6 +88,8 @@ typedef float OsclFloat;
 
 #define DEFAULT_OVERRUN_BUFFER_SIZE 1000
 
+#define MAX_NUM_SLICE   8   /* max number of slices per picture encoded in parallel */
+
 // associated with the above cost model
 const uint8 COEFF_COST[2][16] =
 {
@@ -121,6 +125,17 @@ typedef enum
     AVCEnc_Encoding_Frame,
 } AVCEnc_State ;
 
+/**
+This enumeration lists the jobs run by the slice threads, see slice_thread.cpp.
+@publishedAll
+*/
+typedef enum
+{
+    AVCEnc_Slice_Exit = 0,
+    AVCEnc_Slice_MotionSearch,
+    AVCEnc_Slice_Encode
+} AVCEnc_SliceJob;
+
 /**
 Bitstream structure contains bitstream related parameters such as the pointer
 to the buffer, the current byte position and bit position. The content of the
@@ -386,6 +401,9 @@ typedef struct tagEncObject
 
     int                 currSliceGroup; /* currently encoded slice group id */
 
+    int                 firstMbRow; /* first MB row of the current slice */
+    int                 lastMbRow;  /* last MB row of the current slice */
+
     int     level[24][16], run[24][16]; /* scratch memory */
     int     leveldc[16], rundc[16]; /* for DC component */
     int     levelcdc[16], runcdc[16]; /* for chroma DC component */
@@ -463,9 +481,66 @@ typedef struct tagEncObject
     /* Application control data */
     AVCHandle *avcHandle;
 
+    /* slices encoded in parallel, NULL for one slice per picture */
+    struct tagEncSliceThread *sliceThread;
 
 } AVCEncObject;
 
+/**
+This structure holds one slice, a band of MB rows, encoded by its own thread. Before each
+parallel pass, the encoder object and the structures it points to are copied from the main
+object, only the MB arrays and the pictures are shared.
+@publishedAll
+*/
+typedef struct tagEncSlice
+{
+    AVCEncObject    encvid;
+    AVCCommonObj    common;
+    AVCSliceHeader  sliceHdr;
+    AVCRateControl  rateCtrl;
+    AVCEncBitstream bitstream;
+
+    int     firstMbRow;     /* first MB row of the slice */
+    int     lastMbRow;      /* last MB row of the slice */
+
+    uint8   *buffer;        /* NAL unit of the slice, reallocated when it gets too small */
+    int     bufSize;        /* allocated size of the buffer */
+    uint    nalSize;        /* size of the NAL unit in the buffer */
+
+    int     numIntraSearch; /* number of MBs to be intra searched, from the motion search */
+    int     totalSAD;       /* SAD of the band, from the motion search */
+
+    AVCEnc_Status status;   /* status of the slice encoding */
+
+    struct tagEncSliceThread *owner;
+    pthread_t thread;
+} AVCEncSlice;
+
+/**
+This structure keeps the slice threads. The first slice of a picture is encoded by the
+calling thread with the main encoder object, each of the others by a thread of its own.
+@publishedAll
+*/
+typedef struct tagEncSliceThread
+{
+    int     numSlice;       /* number of slices per picture */
+    int     numThread;      /* number of threads started, numSlice-1 unless it failed */
+    int     nextSlice;      /* next slice to be returned by PVAVCEncodeNAL, 0 for none */
+    AVCEncSlice *slice;     /* array of numSlice slices */
+
+    pthread_mutex_t lock;
+    pthread_cond_t  start;  /* signaled when a job is posted */
+    pthread_cond_t  done;   /* signaled when the last thread finished its job */
+    AVCEnc_SliceJob job;    /* current job */
+    int     jobCount;       /* number of jobs posted so far */
+    int     numBusy;        /* number of threads still working on the current job */
+
+    /* parameters of the motion search job, see AVCMotionSearchRows() */
+    int     start_i;
+    int     incr_i;
+    int     type_pred;
+} AVCEncSliceThread;
+
 
 #endif /*AVCENC_INT_H_INCLUDED*/
 
@@ -379,6 +379,11 @@ extern "C"
     */
     void cost_i4(uint8 *org, int org_pitch, uint8 *pred, uint16 *cost);
 
+    /**
+    Generic C version of cost_i4(), the SSE2 version must give the same result.
+    */
+    void cost_i4_C(uint8 *org, int org_pitch, uint8 *pred, uint16 *cost);
+
     /**
     This function performs chroma intra search. Each mode is saved in encvid->pred_ic.
     \param "encvid" "Pointer to AVCEncObject."
@@ -504,6 +509,22 @@ extern "C"
     */
     void AVCMotionEstimation(AVCEncObject *encvid);
 
+    /**
+    This function performs one pass of the motion estimation over a range of MB rows. Only
+    motion vectors of these rows are used as candidates.
+    \param "encvid" "Pointer to AVCEncObject."
+    \param "first_row" "First MB row."
+    \param "last_row" "Last MB row."
+    \param "start_i" "Start column, toggled from row to row when incr_i is 2."
+    \param "incr_i" "Column increment, 2 for the checkerboard passes of the scene change detection."
+    \param "type_pred" "Indicates the type of operations."
+    \param "NumIntraSearch" "Number of MBs to be intra searched, incremented."
+    \param "totalSAD" "Total SAD, incremented."
+    \return "void"
+    */
+    void AVCMotionSearchRows(AVCEncObject *encvid, int first_row, int last_row, int start_i, int incr_i,
+                             int type_pred, int *NumIntraSearch, int *totalSAD);
+
     /**
     This function performs repetitive edge padding to the reference picture by adding 16 pixels
     around the luma and 8 pixels around the chromas.
@@ -630,6 +651,12 @@ extern "C"
      */
     void GenerateHalfPelPred(uint8 *subpel_pred, uint8 *ncand, int lx);
 
+    /**
+    Generic C version of GenerateHalfPelPred(), the SSE2 version must give the
+    same result.
+    */
+    void GenerateHalfPelPred_C(uint8 *subpel_pred, uint8 *ncand, int lx);
+
     /**
     This function calculate vertical interpolation at half-point of size 4x17.
     \param "dst" "Pointer to destination."
@@ -648,6 +675,12 @@ extern "C"
     */
     void GenerateQuartPelPred(uint8 **bilin_base, uint8 *qpel_pred, int hpel_pos);
 
+    /**
+    Generic C version of GenerateQuartPelPred(), the SSE2 version must give the
+    same result.
+    */
+    void GenerateQuartPelPred_C(uint8 **bilin_base, uint8 *qpel_pred, int hpel_pos);
+
     /**
     This function calculates the SATD of a subpel candidate.
     \param "cand"   "Pointer to a candidate."
@@ -922,6 +955,60 @@ extern "C"
     */
     AVCEnc_Status EncodeIntra4x4Mode(AVCCommonObj *video, AVCMacroblock *currMB, AVCEncBitstream *stream);
 
+    /*------------- slice_thread.c -------------------------*/
+
+    /**
+    This function starts the threads encoding the slices of a picture in parallel.
+    \param "avcHandle" "Pointer to the AVCHandle."
+    \param "num_slice" "Number of slices per picture."
+    \return "AVCENC_SUCCESS for success, AVCENC_MEMORY_FAIL or AVCENC_FAIL if the threads
+    cannot be started."
+    */
+    AVCEnc_Status AVCSliceThreadInit(AVCHandle *avcHandle, int num_slice);
+
+    /**
+    This function stops the slice threads and frees their memory.
+    \param "avcHandle" "Pointer to the AVCHandle."
+    \return "void"
+    */
+    void AVCSliceThreadCleanUp(AVCHandle *avcHandle);
+
+    /**
+    This function performs one pass of the motion estimation, one band of MB rows per slice
+    in parallel. See AVCMotionSearchRows() for the parameters.
+    \return "void"
+    */
+    void AVCSliceThreadMotionSearch(AVCEncObject *encvid, int start_i, int incr_i, int type_pred,
+                                    int *NumIntraSearch, int *totalSAD);
+
+    /**
+    This function starts encoding all slices but the first one into their own buffers. It is
+    called after the slice header of the first slice has been encoded.
+    \param "encvid" "Pointer to AVCEncObject."
+    \return "void"
+    */
+    void AVCSliceThreadStartEncode(AVCEncObject *encvid);
+
+    /**
+    This function waits for the slices started by AVCSliceThreadStartEncode() and merges
+    their statistics into the main object.
+    \param "encvid" "Pointer to AVCEncObject."
+    \param "status" "Status of the first slice."
+    \return "AVCENC_PICTURE_READY if all slices are encoded, or the first error."
+    */
+    AVCEnc_Status AVCSliceThreadFinishEncode(AVCEncObject *encvid, AVCEnc_Status status);
+
+    /**
+    This function returns the next slice encoded by AVCSliceThreadStartEncode().
+    \param "encvid" "Pointer to AVCEncObject."
+    \param "buffer" "Pointer to the output buffer."
+    \param "buf_nal_size" "As input, the size of the buffer. As output, the size of the NAL."
+    \param "nal_type" "Pointer to the NAL type of the returned buffer."
+    \return "AVCENC_SUCCESS if more slices follow, AVCENC_PICTURE_READY for the last one."
+    */
+    AVCEnc_Status AVCSliceThreadNextNAL(AVCEncObject *encvid, uint8 *buffer, uint *buf_nal_size,
+                                        int *nal_type);
+
     /*------------- vlc_encode.c -----------------------*/
     /**
     This function encodes and writes a value into an Exp-Golomb codeword.
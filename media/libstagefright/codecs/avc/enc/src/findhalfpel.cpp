@@ -16,6 +16,11 @@
  * -------------------------------------------------------------------
  */
 #include "avcenc_lib.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /* 3/29/01 fast half-pel search based on neighboring guess */
 /* value ranging from 0 to 4, high complexity (more accurate) to
    low complexity (less accurate) */
@@ -143,7 +148,187 @@ int AVCFindHalfPelMB(AVCEncObject *encvid, uint8 *cur, AVCMV *mot, uint8 *ncand,
 Each sub-pel position array is 20 pixel wide (for word-alignment) and 17 pixel tall. */
 /** The sub-pel position is labeled in spiral manner from the center. */
 
+#if defined(__SSE2__)
+
+/* 6-tap filter on 16-bit lanes, a + f - 5 * (b + e) + 20 * (c + d) */
+static inline __m128i Filter6Epi16(__m128i a, __m128i b, __m128i c, __m128i d,
+                                   __m128i e, __m128i f)
+{
+    a = _mm_add_epi16(a, f);
+    b = _mm_mullo_epi16(_mm_add_epi16(b, e), _mm_set1_epi16(5));
+    c = _mm_mullo_epi16(_mm_add_epi16(c, d), _mm_set1_epi16(20));
+
+    return _mm_add_epi16(_mm_sub_epi16(a, b), c);
+}
+
+static inline __m128i LoadU8Epi16(uint8 *ref)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)ref), _mm_setzero_si128());
+}
+
+/* (tmp + 512) >> 10 of the 6-tap filter over 6 rows of 16-bit intermediates,
+   needs 32-bit precision */
+static inline __m128i FilterMiddleEpi16(int16 *src)
+{
+    __m128i s05, s14, s23, lo, hi;
+    const __m128i c0 = _mm_set1_epi32(0x00140001); /* 1, 20 */
+    const __m128i c1 = _mm_set1_epi32(0x0200FFFB); /* -5, 512 */
+    const __m128i one = _mm_set1_epi16(1);
+
+    s05 = _mm_add_epi16(_mm_loadu_si128((__m128i*)src),
+                        _mm_loadu_si128((__m128i*)(src + 120))); // 24*5
+    s14 = _mm_add_epi16(_mm_loadu_si128((__m128i*)(src + 24)),
+                        _mm_loadu_si128((__m128i*)(src + 96)));
+    s23 = _mm_add_epi16(_mm_loadu_si128((__m128i*)(src + 48)),
+                        _mm_loadu_si128((__m128i*)(src + 72)));
+
+    lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(s05, s23), c0),
+                       _mm_madd_epi16(_mm_unpacklo_epi16(s14, one), c1));
+    hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(s05, s23), c0),
+                       _mm_madd_epi16(_mm_unpackhi_epi16(s14, one), c1));
+
+    return _mm_packs_epi32(_mm_srai_epi32(lo, 10), _mm_srai_epi32(hi, 10));
+}
+
+void GenerateHalfPelPred(uint8* subpel_pred, uint8 *ncand, int lx)
+{
+    uint8 *ref;
+    uint8 *dst;
+    int32 tmp32;
+    int16 tmp_horz[24*22], *dst_16; /* stride is 24 here */
+    __m128i lo, hi, a, b, c, d, e, f;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(16);
+    /* lanes of the 3rd and 4th column in each group of 4, see below */
+    const __m128i borrow_msk = _mm_set_epi16(-1, -1, 0, 0, -1, -1, 0, 0);
+    int i, j;
+
+    /* first copy full-pel to the first array, 24x22 from (-3,-3) */
+    ref = ncand - 3 - lx - (lx << 1);
+    dst = subpel_pred;
+    for (j = 0; j < 22; j++)
+    {
+        _mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((__m128i*)ref));
+        _mm_storel_epi64((__m128i*)(dst + 16), _mm_loadl_epi64((__m128i*)(ref + 16)));
+        ref += lx;
+        dst += 24;
+    }
+
+    /* horizontal interp of all 22 lines to tmp_horz, 18 lines of it also
+       go to the 14th array 17x18 */
+    ref = subpel_pred;
+    dst_16 = tmp_horz;
+    dst = subpel_pred + V0Q_H2Q * SUBPEL_PRED_BLK_SIZE;
+    for (j = 0; j < 22; j++)
+    {
+        lo = Filter6Epi16(LoadU8Epi16(ref), LoadU8Epi16(ref + 1), LoadU8Epi16(ref + 2),
+                          LoadU8Epi16(ref + 3), LoadU8Epi16(ref + 4), LoadU8Epi16(ref + 5));
+        hi = Filter6Epi16(LoadU8Epi16(ref + 8), LoadU8Epi16(ref + 9), LoadU8Epi16(ref + 10),
+                          LoadU8Epi16(ref + 11), LoadU8Epi16(ref + 12), LoadU8Epi16(ref + 13));
+        _mm_storeu_si128((__m128i*)dst_16, lo);
+        _mm_storeu_si128((__m128i*)(dst_16 + 8), hi);
+
+        /* do the 17th column here */
+        tmp32 = ref[16] + ref[21] - 5 * (ref[17] + ref[20]) + 20 * (ref[18] + ref[19]);
+        dst_16[16] = tmp32;
+
+        if (j >= 2 && j < 20)
+        {
+            lo = _mm_srai_epi16(_mm_add_epi16(lo, round), 5);
+            hi = _mm_srai_epi16(_mm_add_epi16(hi, round), 5);
+            _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(lo, hi));
+
+            tmp32 = (tmp32 + 16) >> 5;
+            CLIP_RESULT(tmp32)
+            dst[16] = tmp32;
+
+            dst += 24;
+        }
+
+        ref += 24;
+        dst_16 += 24;
+    }
+
+    /* Do middle point filtering, 12th array 17x17 */
+    dst_16 = tmp_horz;
+    dst = subpel_pred + V2Q_H2Q * SUBPEL_PRED_BLK_SIZE;
+    for (j = 0; j < 17; j++)
+    {
+        lo = FilterMiddleEpi16(dst_16);
+        hi = FilterMiddleEpi16(dst_16 + 8);
+        _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(lo, hi));
+
+        tmp32 = dst_16[16] + dst_16[136] - 5 * (dst_16[40] + dst_16[112])
+                + 20 * (dst_16[64] + dst_16[88]);
+        tmp32 = (tmp32 + 512) >> 10;
+        CLIP_RESULT(tmp32)
+        dst[16] = tmp32;
+
+        dst_16 += 24;
+        dst += 24;
+    }
+
+    /* do vertical interpolation, 10th array 18x17 */
+    ref = subpel_pred + 2;
+    dst = subpel_pred + V2Q_H0Q * SUBPEL_PRED_BLK_SIZE;
+    for (j = 0; j < 17; j++)
+    {
+        /* the first 2 columns */
+        for (i = 0; i < 2; i++)
+        {
+            tmp32 = ref[i] + ref[i+120] - 5 * (ref[i+24] + ref[i+96])
+                    + 20 * (ref[i+48] + ref[i+72]);
+            tmp32 = (tmp32 + 16) >> 5;
+            CLIP_RESULT(tmp32)
+            dst[i] = tmp32;
+        }
+
+        /* The remaining 16 columns must match the packed 2x16-bit version
+           used on the other platforms, in which the 3rd and 4th column of
+           each group of 4 borrow from the 1st and 2nd one when those are
+           negative before the shift. */
+        a = _mm_loadu_si128((__m128i*)(ref + 2));
+        b = _mm_loadu_si128((__m128i*)(ref + 26));
+        c = _mm_loadu_si128((__m128i*)(ref + 50));
+        d = _mm_loadu_si128((__m128i*)(ref + 74));
+        e = _mm_loadu_si128((__m128i*)(ref + 98));
+        f = _mm_loadu_si128((__m128i*)(ref + 122));
+
+        lo = Filter6Epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero),
+                          _mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(d, zero),
+                          _mm_unpacklo_epi8(e, zero), _mm_unpacklo_epi8(f, zero));
+        hi = Filter6Epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero),
+                          _mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(d, zero),
+                          _mm_unpackhi_epi8(e, zero), _mm_unpackhi_epi8(f, zero));
+        lo = _mm_add_epi16(lo, round);
+        hi = _mm_add_epi16(hi, round);
+        lo = _mm_add_epi16(lo, _mm_and_si128(borrow_msk,
+                                             _mm_slli_si128(_mm_cmplt_epi16(lo, zero), 4)));
+        hi = _mm_add_epi16(hi, _mm_and_si128(borrow_msk,
+                                             _mm_slli_si128(_mm_cmplt_epi16(hi, zero), 4)));
+        _mm_storeu_si128((__m128i*)(dst + 2),
+                         _mm_packus_epi16(_mm_srai_epi16(lo, 5), _mm_srai_epi16(hi, 5)));
+
+        ref += 24;
+        dst += 24;
+    }
+
+    return ;
+}
+
+#else
+
 void GenerateHalfPelPred(uint8* subpel_pred, uint8 *ncand, int lx)
+{
+    GenerateHalfPelPred_C(subpel_pred, ncand, lx);
+
+    return ;
+}
+
+#endif /* __SSE2__ */
+
+/* generic version, also the reference for the SSE2 one */
+void GenerateHalfPelPred_C(uint8* subpel_pred, uint8 *ncand, int lx)
 {
     /* let's do straightforward way first */
     uint8 *ref;
@@ -515,7 +700,79 @@ void VertInterpWClip(uint8 *dst, uint8 *ref)
 }
 
 
+#if defined(__SSE2__)
+
+#define AVG_U8(x, y) _mm_avg_epu8(_mm_loadu_si128((__m128i*)(x)), _mm_loadu_si128((__m128i*)(y)))
+
+void GenerateQuartPelPred(uint8 **bilin_base, uint8 *qpel_cand, int hpel_pos)
+{
+    // for even value of hpel_pos, start with pattern 1, otherwise, start with pattern 2
+    int j;
+
+    uint8 *c1 = qpel_cand;
+    uint8 *tl = bilin_base[0];
+    uint8 *tr = bilin_base[1];
+    uint8 *bl = bilin_base[2];
+    uint8 *br = bilin_base[3];
+
+    if (!(hpel_pos&1)) // diamond pattern
+    {
+        for (j = 16; j > 0; j--)
+        {
+            _mm_storeu_si128((__m128i*)c1, AVG_U8(br, tr));
+            _mm_storeu_si128((__m128i*)(c1 + 384), AVG_U8(bl + 1, tr)); /* c2 */
+            _mm_storeu_si128((__m128i*)(c1 + 768), AVG_U8(bl + 1, br)); /* c3 */
+            _mm_storeu_si128((__m128i*)(c1 + 1152), AVG_U8(bl + 1, tr + 24)); /* c4 */
+            _mm_storeu_si128((__m128i*)(c1 + 1536), AVG_U8(br, tr + 24)); /* c5 */
+            _mm_storeu_si128((__m128i*)(c1 + 1920), AVG_U8(bl, tr + 24)); /* c6 */
+            _mm_storeu_si128((__m128i*)(c1 + 2304), AVG_U8(bl, br)); /* c7 */
+            _mm_storeu_si128((__m128i*)(c1 + 2688), AVG_U8(bl, tr)); /* c8 */
+
+            // advance to the next line, pitch is 24
+            tr += 24;
+            bl += 24;
+            br += 24;
+            c1 += 24;
+        }
+    }
+    else // star pattern
+    {
+        for (j = 16; j > 0; j--)
+        {
+            _mm_storeu_si128((__m128i*)c1, AVG_U8(br, tr));
+            _mm_storeu_si128((__m128i*)(c1 + 384), AVG_U8(br, tl + 1)); /* c2 */
+            _mm_storeu_si128((__m128i*)(c1 + 768), AVG_U8(br, bl + 1)); /* c3 */
+            _mm_storeu_si128((__m128i*)(c1 + 1152), AVG_U8(br, tl + 25)); /* c4 */
+            _mm_storeu_si128((__m128i*)(c1 + 1536), AVG_U8(br, tr + 24)); /* c5 */
+            _mm_storeu_si128((__m128i*)(c1 + 1920), AVG_U8(br, tl + 24)); /* c6 */
+            _mm_storeu_si128((__m128i*)(c1 + 2304), AVG_U8(br, bl)); /* c7 */
+            _mm_storeu_si128((__m128i*)(c1 + 2688), AVG_U8(br, tl)); /* c8 */
+
+            // advance to the next line, pitch is 24
+            tl += 24;
+            tr += 24;
+            bl += 24;
+            br += 24;
+            c1 += 24;
+        }
+    }
+
+    return ;
+}
+
+#else
+
 void GenerateQuartPelPred(uint8 **bilin_base, uint8 *qpel_cand, int hpel_pos)
+{
+    GenerateQuartPelPred_C(bilin_base, qpel_cand, hpel_pos);
+
+    return ;
+}
+
+#endif /* __SSE2__ */
+
+/* generic version, also the reference for the SSE2 one */
+void GenerateQuartPelPred_C(uint8 **bilin_base, uint8 *qpel_cand, int hpel_pos)
 {
     // for even value of hpel_pos, start with pattern 1, otherwise, start with pattern 2
     int i, j;
@@ -772,6 +772,9 @@ AVCEnc_Status InitFrame(AVCEncObject *encvid)
     /************* motion estimation and scene analysis ************/
     // , to move this to MB-based MV search for comparison
     // use sub-optimal QP for mv search
+    /* whole picture, narrowed down to a band of rows with parallel slices */
+    encvid->firstMbRow = 0;
+    encvid->lastMbRow = video->PicHeightInMbs - 1;
     AVCMotionEstimation(encvid);  /* AVCENC_SUCCESS or AVCENC_NEW_IDR */
 
     /* after this point, the picture type will be fixed to either IDR or non-IDR */
@@ -17,6 +17,10 @@
  */
 #include "avcenc_lib.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define TH_I4  0  /* threshold biasing toward I16 mode instead of I4 mode */
 #define TH_Intra  0 /* threshold biasing toward INTER mode instead of intra mode */
 
@@ -43,8 +47,9 @@ bool IntraDecisionABE(AVCEncObject *encvid, int min_cost, uint8 *curL, int picPi
     OsclFloat ABE;
     bool intra = true;
 
+    /* the left neighbor is read one row too far, skip the last row of the slice */
     if (((x_pos >> 4) != (int)video->PicWidthInMbs - 1) &&
-            ((y_pos >> 4) != (int)video->PicHeightInMbs - 1) &&
+            ((y_pos >> 4) != encvid->lastMbRow) &&
             video->intraAvailA &&
             video->intraAvailB)
     {
@@ -1286,7 +1291,72 @@ PRED_RESULT_READY:
     return predIntra4x4PredMode;
 }
 
+#if defined(__SSE2__)
+
 void cost_i4(uint8 *org, int org_pitch, uint8 *pred, uint16 *cost)
+{
+    __m128i r01, r23, s, d, x, y;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i sign0 = _mm_set_epi16(-1, -1, 1, 1, -1, -1, 1, 1);
+    const __m128i sign1 = _mm_set_epi16(-1, 1, -1, 1, -1, 1, -1, 1);
+    int satd;
+
+    /* residue, 2 lines per register */
+    r01 = _mm_unpacklo_epi32(_mm_cvtsi32_si128(*((uint32*)org)),
+                             _mm_cvtsi32_si128(*((uint32*)(org + org_pitch))));
+    org += (org_pitch << 1);
+    r23 = _mm_unpacklo_epi32(_mm_cvtsi32_si128(*((uint32*)org)),
+                             _mm_cvtsi32_si128(*((uint32*)(org + org_pitch))));
+    r01 = _mm_sub_epi16(_mm_unpacklo_epi8(r01, zero),
+                        _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)pred), zero));
+    r23 = _mm_sub_epi16(_mm_unpacklo_epi8(r23, zero),
+                        _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(pred + 8)), zero));
+
+    /* vertical transform, only the magnitude of the coefficients matters */
+    s = _mm_add_epi16(r01, r23);
+    d = _mm_sub_epi16(r01, r23);
+    x = _mm_shuffle_epi32(s, 0x4E);
+    y = _mm_shuffle_epi32(d, 0x4E);
+    r01 = _mm_unpacklo_epi64(_mm_add_epi16(s, x), _mm_sub_epi16(s, x));
+    r23 = _mm_unpacklo_epi64(_mm_add_epi16(d, y), _mm_sub_epi16(d, y));
+
+    /* horizontal transform */
+    x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(r01, 0x4E), 0x4E);
+    y = _mm_shufflehi_epi16(_mm_shufflelo_epi16(r23, 0x4E), 0x4E);
+    r01 = _mm_add_epi16(_mm_mullo_epi16(r01, sign0), x);
+    r23 = _mm_add_epi16(_mm_mullo_epi16(r23, sign0), y);
+    x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(r01, 0xB1), 0xB1);
+    y = _mm_shufflehi_epi16(_mm_shufflelo_epi16(r23, 0xB1), 0xB1);
+    r01 = _mm_add_epi16(_mm_mullo_epi16(r01, sign1), x);
+    r23 = _mm_add_epi16(_mm_mullo_epi16(r23, sign1), y);
+
+    /* sum of absolute values */
+    r01 = _mm_max_epi16(r01, _mm_sub_epi16(zero, r01));
+    r23 = _mm_max_epi16(r23, _mm_sub_epi16(zero, r23));
+    s = _mm_madd_epi16(_mm_add_epi16(r01, r23), _mm_set1_epi16(1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    satd = _mm_cvtsi128_si32(s);
+
+    satd = (satd + 1) >> 1;
+    *cost += satd;
+
+    return ;
+}
+
+#else
+
+void cost_i4(uint8 *org, int org_pitch, uint8 *pred, uint16 *cost)
+{
+    cost_i4_C(org, org_pitch, pred, cost);
+
+    return ;
+}
+
+#endif /* __SSE2__ */
+
+/* generic version, also the reference for the SSE2 one */
+void cost_i4_C(uint8 *org, int org_pitch, uint8 *pred, uint16 *cost)
 {
     int k;
     int16 res[16], *pres;
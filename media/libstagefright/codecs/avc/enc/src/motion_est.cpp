@@ -238,39 +238,25 @@ void AVCMotionEstimation(AVCEncObject *encvid)
 {
     AVCCommonObj *video = encvid->common;
     int slice_type = video->slice_type;
-    AVCFrameIO *currInput = encvid->currInput;
     AVCPictureData *refPic = video->RefPicList0[0];
-    int i, j, k;
-    int mbwidth = video->PicWidthInMbs;
+    int i;
     int mbheight = video->PicHeightInMbs;
     int totalMB = video->PicSizeInMbs;
-    int pitch = currInput->pitch;
-    AVCMacroblock *currMB, *mblock = video->mblock;
-    AVCMV *mot_mb_16x16, *mot16x16 = encvid->mot16x16;
-    // AVCMV *mot_mb_16x8, *mot_mb_8x16, *mot_mb_8x8, etc;
+    AVCMacroblock *mblock = video->mblock;
     AVCRateControl *rateCtrl = encvid->rateCtrl;
     uint8 *intraSearch = encvid->intraSearch;
-    uint FS_en = encvid->fullsearch_enable;
 
     int NumIntraSearch, start_i, numLoop, incr_i;
-    int mbnum, offset;
-    uint8 *cur, *best_cand[5];
     int totalSAD = 0;   /* average SAD for rate control */
     int type_pred;
-    int abe_cost;
 
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/  /* 2/28/01 */
     int collect = 0;
-    HTFM_Stat htfm_stat;
     double newvar[16];
     double exp_lamda[15];
     /*********************************/
 #endif
-    int hp_guess = 0;
-    uint32 mv_uint32;
-
-    offset = 0;
 
     if (slice_type == AVC_I_SLICE)
     {
@@ -309,7 +295,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     encvid->sad_extra_info = NULL;
 #ifdef HTFM
     /***** HYPOTHESIS TESTING ********/
-    InitHTFM(video, &htfm_stat, newvar, &collect);
+    InitHTFM(video, &encvid->htfm_stat, newvar, &collect);
     /*********************************/
 #endif
 
@@ -336,94 +322,14 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     NumIntraSearch = 0; // to be intra searched in the encoding loop.
     while (numLoop--)
     {
-        for (j = 0; j < mbheight; j++)
+        if (encvid->sliceThread) /* one band of rows per slice, in parallel */
         {
-            if (incr_i > 1)
-                start_i = (start_i == 0 ? 1 : 0) ; /* toggle 0 and 1 */
-
-            offset = pitch * (j << 4) + (start_i << 4);
-
-            mbnum = j * mbwidth + start_i;
-
-            for (i = start_i; i < mbwidth; i += incr_i)
-            {
-                video->mbNum = mbnum;
-                video->currMB = currMB = mblock + mbnum;
-                mot_mb_16x16 = mot16x16 + mbnum;
-
-                cur = currInput->YCbCr[0] + offset;
-
-                if (currMB->mb_intra == 0) /* for INTER mode */
-                {
-#if defined(HTFM)
-                    HTFMPrepareCurMB_AVC(encvid, &htfm_stat, cur, pitch);
-#else
-                    AVCPrepareCurMB(encvid, cur, pitch);
-#endif
-                    /************************************************************/
-                    /******** full-pel 1MV search **********************/
-
-                    AVCMBMotionSearch(encvid, cur, best_cand, i << 4, j << 4, type_pred,
-                                      FS_en, &hp_guess);
-
-                    abe_cost = encvid->min_cost[mbnum] = mot_mb_16x16->sad;
-
-                    /* set mbMode and MVs */
-                    currMB->mbMode = AVC_P16;
-                    currMB->MBPartPredMode[0][0] = AVC_Pred_L0;
-                    mv_uint32 = ((mot_mb_16x16->y) << 16) | ((mot_mb_16x16->x) & 0xffff);
-                    for (k = 0; k < 32; k += 2)
-                    {
-                        currMB->mvL0[k>>1] = mv_uint32;
-                    }
-
-                    /* make a decision whether it should be tested for intra or not */
-                    if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
-                    {
-                        if (false == IntraDecisionABE(&abe_cost, cur, pitch, true))
-                        {
-                            intraSearch[mbnum] = 0;
-                        }
-                        else
-                        {
-                            NumIntraSearch++;
-                            rateCtrl->MADofMB[mbnum] = abe_cost;
-                        }
-                    }
-                    else // boundary MBs, always do intra search
-                    {
-                        NumIntraSearch++;
-                    }
-
-                    totalSAD += (int) rateCtrl->MADofMB[mbnum];//mot_mb_16x16->sad;
-                }
-                else    /* INTRA update, use for prediction */
-                {
-                    mot_mb_16x16[0].x = mot_mb_16x16[0].y = 0;
-
-                    /* reset all other MVs to zero */
-                    /* mot_mb_16x8, mot_mb_8x16, mot_mb_8x8, etc. */
-                    abe_cost = encvid->min_cost[mbnum] = 0x7FFFFFFF;  /* max value for int */
-
-                    if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
-                    {
-                        IntraDecisionABE(&abe_cost, cur, pitch, false);
-
-                        rateCtrl->MADofMB[mbnum] = abe_cost;
-                        totalSAD += abe_cost;
-                    }
-
-                    NumIntraSearch++ ;
-                    /* cannot do I16 prediction here because it needs full decoding. */
-                    // intraSearch[mbnum] = 1;
-
-                }
-
-                mbnum += incr_i;
-                offset += (incr_i << 4);
-
-            } /* for i */
-        } /* for j */
+            AVCSliceThreadMotionSearch(encvid, start_i, incr_i, type_pred, &NumIntraSearch, &totalSAD);
+        }
+        else
+        {
+            AVCMotionSearchRows(encvid, 0, mbheight - 1, start_i, incr_i, type_pred, &NumIntraSearch, &totalSAD);
+        }
 
         /* since we cannot do intra/inter decision here, the SCD has to be
         based on other criteria such as motion vectors coherency or the SAD */
@@ -464,7 +370,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     if (collect)
     {
         collect = 0;
-        UpdateHTFM(encvid, newvar, exp_lamda, &htfm_stat);
+        UpdateHTFM(encvid, newvar, exp_lamda, &encvid->htfm_stat);
     }
     /*********************************/
 #endif
@@ -472,6 +378,124 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     return ;
 }
 
+/* one pass of the motion search over the MB rows first_row to last_row, see AVCMotionEstimation().
+   Only the motion vectors of these rows are used as candidates, so that bands of rows can be
+   searched in parallel. */
+void AVCMotionSearchRows(AVCEncObject *encvid, int first_row, int last_row, int start_i, int incr_i,
+                         int type_pred, int *NumIntraSearch, int *totalSAD)
+{
+    AVCCommonObj *video = encvid->common;
+    AVCFrameIO *currInput = encvid->currInput;
+    int i, j, k;
+    int mbwidth = video->PicWidthInMbs;
+    int mbheight = video->PicHeightInMbs;
+    int pitch = currInput->pitch;
+    AVCMacroblock *currMB, *mblock = video->mblock;
+    AVCMV *mot_mb_16x16, *mot16x16 = encvid->mot16x16;
+    // AVCMV *mot_mb_16x8, *mot_mb_8x16, *mot_mb_8x8, etc;
+    AVCRateControl *rateCtrl = encvid->rateCtrl;
+    uint8 *intraSearch = encvid->intraSearch;
+    uint FS_en = encvid->fullsearch_enable;
+
+    int first_i, mbnum, offset;
+    uint8 *cur, *best_cand[5];
+    int abe_cost;
+    int hp_guess = 0;
+    uint32 mv_uint32;
+
+    for (j = first_row; j <= last_row; j++)
+    {
+        first_i = start_i;
+        if (incr_i > 1)
+            first_i = (start_i + j + 1) & 1; /* toggle 0 and 1 from row to row */
+
+        offset = pitch * (j << 4) + (first_i << 4);
+
+        mbnum = j * mbwidth + first_i;
+
+        for (i = first_i; i < mbwidth; i += incr_i)
+        {
+            video->mbNum = mbnum;
+            video->currMB = currMB = mblock + mbnum;
+            mot_mb_16x16 = mot16x16 + mbnum;
+
+            cur = currInput->YCbCr[0] + offset;
+
+            if (currMB->mb_intra == 0) /* for INTER mode */
+            {
+#if defined(HTFM)
+                HTFMPrepareCurMB_AVC(encvid, &encvid->htfm_stat, cur, pitch);
+#else
+                AVCPrepareCurMB(encvid, cur, pitch);
+#endif
+                /************************************************************/
+                /******** full-pel 1MV search **********************/
+
+                AVCMBMotionSearch(encvid, cur, best_cand, i << 4, j << 4, type_pred,
+                                  FS_en, &hp_guess);
+
+                abe_cost = encvid->min_cost[mbnum] = mot_mb_16x16->sad;
+
+                /* set mbMode and MVs */
+                currMB->mbMode = AVC_P16;
+                currMB->MBPartPredMode[0][0] = AVC_Pred_L0;
+                mv_uint32 = ((mot_mb_16x16->y) << 16) | ((mot_mb_16x16->x) & 0xffff);
+                for (k = 0; k < 32; k += 2)
+                {
+                    currMB->mvL0[k>>1] = mv_uint32;
+                }
+
+                /* make a decision whether it should be tested for intra or not */
+                if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
+                {
+                    if (false == IntraDecisionABE(&abe_cost, cur, pitch, true))
+                    {
+                        intraSearch[mbnum] = 0;
+                    }
+                    else
+                    {
+                        (*NumIntraSearch)++;
+                        rateCtrl->MADofMB[mbnum] = abe_cost;
+                    }
+                }
+                else // boundary MBs, always do intra search
+                {
+                    (*NumIntraSearch)++;
+                }
+
+                *totalSAD += (int) rateCtrl->MADofMB[mbnum];//mot_mb_16x16->sad;
+            }
+            else    /* INTRA update, use for prediction */
+            {
+                mot_mb_16x16[0].x = mot_mb_16x16[0].y = 0;
+
+                /* reset all other MVs to zero */
+                /* mot_mb_16x8, mot_mb_8x16, mot_mb_8x8, etc. */
+                abe_cost = encvid->min_cost[mbnum] = 0x7FFFFFFF;  /* max value for int */
+
+                if (i != mbwidth - 1 && j != mbheight - 1 && i != 0 && j != 0)
+                {
+                    IntraDecisionABE(&abe_cost, cur, pitch, false);
+
+                    rateCtrl->MADofMB[mbnum] = abe_cost;
+                    *totalSAD += abe_cost;
+                }
+
+                (*NumIntraSearch)++ ;
+                /* cannot do I16 prediction here because it needs full decoding. */
+                // intraSearch[mbnum] = 1;
+
+            }
+
+            mbnum += incr_i;
+            offset += (incr_i << 4);
+
+        } /* for i */
+    } /* for j */
+
+    return ;
+}
+
 /*=====================================================================
     Function:   PaddingEdge
     Date:       09/16/2000
@@ -481,7 +505,7 @@ void AVCMotionEstimation(AVCEncObject *encvid)
 void  AVCPaddingEdge(AVCPictureData *refPic)
 {
     uint8 *src, *dst;
-    int i;
+    int i, k;
     int pitch, width, height;
     uint32 temp1, temp2;
 
@@ -558,6 +582,42 @@ void  AVCPaddingEdge(AVCPictureData *refPic)
         dst += pitch;
     }
 
+    /* pad chroma by 8 pixels, once for the whole picture rather than around each
+       block in the motion compensation, which may run on several slices at a time */
+    width >>= 1;
+    height >>= 1;
+    pitch >>= 1;
+    for (k = 0; k < 2; k++)
+    {
+        src = (k == 0) ? refPic->Scb : refPic->Scr;
+
+        /* pad sides */
+        dst = src - 8;
+        i = height;
+        while (i--)
+        {
+            memset(dst, dst[8], 8);
+            memset(dst + width + 8, dst[width + 7], 8);
+            dst += pitch;
+        }
+
+        /* pad bottom */
+        i = 8;
+        while (i--)
+        {
+            memcpy(dst, dst - pitch, width + 16);
+            dst += pitch;
+        }
+
+        /* pad top */
+        dst = src - 8 - pitch;
+        i = 8;
+        while (i--)
+        {
+            memcpy(dst, src - 8, width + 16);
+            dst -= pitch;
+        }
+    }
 
     return ;
 }
@@ -1362,6 +1422,9 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
     int mbnum = video->mbNum;
     int mbwidth = video->PicWidthInMbs;
     int mbheight = video->PicHeightInMbs;
+    /* candidates only from rows of the current slice, the others may be searched in parallel */
+    int firstRow = encvid->firstMbRow;
+    int lastRow = encvid->lastMbRow;
     int i, j, same, num1;
 
     /* this part is for predicted MV */
@@ -1391,26 +1454,26 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
 
-            if (jmb < mbheight - 1)  /*bottom neighbor previous frame */
+            if (jmb < lastRow)  /*bottom neighbor previous frame */
             {
                 pmot = &mot16x16[mbnum+mbwidth];
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            else if (jmb > 0)   /*upper neighbor previous frame */
+            else if (jmb > firstRow)   /*upper neighbor previous frame */
             {
                 pmot = &mot16x16[mbnum-mbwidth];
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
 
-            if (imb > 0 && jmb > 0)  /* upper-left neighbor current frame*/
+            if (imb > 0 && jmb > firstRow)  /* upper-left neighbor current frame*/
             {
                 pmot = &mot16x16[mbnum-mbwidth-1];
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            if (jmb > 0 && imb < mbheight - 1)  /* upper right neighbor current frame*/
+            if (jmb > firstRow && imb < mbheight - 1)  /* upper right neighbor current frame*/
             {
                 pmot = &mot16x16[mbnum-mbwidth+1];
                 mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1430,7 +1493,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            if (jmb > 0)  /*upper neighbor current frame */
+            if (jmb > firstRow)  /*upper neighbor current frame */
             {
                 pmot = &mot16x16[mbnum-mbwidth];
                 mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1442,7 +1505,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            if (jmb < mbheight - 1)  /*bottom neighbor previous frame */
+            if (jmb < lastRow)  /*bottom neighbor previous frame */
             {
                 pmot = &mot16x16[mbnum+mbwidth];
                 mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1459,7 +1522,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
             pmvA_y = pmot->y;
         }
 
-        if (jmb > 0) /* get MV from top (B) neighbor either on current or previous frame */
+        if (jmb > firstRow) /* get MV from top (B) neighbor either on current or previous frame */
         {
             availB = 1;
             pmot = &mot16x16[mbnum-mbwidth];
@@ -1491,13 +1554,13 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            if (imb > 0 && jmb > 0)  /* upper-left neighbor */
+            if (imb > 0 && jmb > firstRow)  /* upper-left neighbor */
             {
                 pmot = &mot16x16[mbnum-mbwidth-1];
                 mvx[(*num_can)] = (pmot->x) >> 2;
                 mvy[(*num_can)++] = (pmot->y) >> 2;
             }
-            if (jmb > 0 && imb < mbheight - 1)  /* upper right neighbor */
+            if (jmb > firstRow && imb < mbheight - 1)  /* upper right neighbor */
             {
                 pmot = &mot16x16[mbnum-mbwidth+1];
                 mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1513,7 +1576,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 pmvA_y = pmot->y;
             }
 
-            if (jmb > 0 && imb > 0) /* get MV from top-left (B) neighbor of current frame */
+            if (jmb > firstRow && imb > 0) /* get MV from top-left (B) neighbor of current frame */
             {
                 availB = 1;
                 pmot = &mot16x16[mbnum-mbwidth-1];
@@ -1521,7 +1584,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 pmvB_y = pmot->y;
             }
 
-            if (jmb > 0 && imb < mbwidth - 1)
+            if (jmb > firstRow && imb < mbwidth - 1)
             {
                 availC = 1;
                 pmot = &mot16x16[mbnum-mbwidth+1];
@@ -1541,7 +1604,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                     mvx[(*num_can)] = (pmot->x) >> 2;
                     mvy[(*num_can)++] = (pmot->y) >> 2;
                 }
-                if (jmb > 0)  /*upper neighbor current frame */
+                if (jmb > firstRow)  /*upper neighbor current frame */
                 {
                     pmot = &mot16x16[mbnum-mbwidth];
                     mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1553,7 +1616,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                     mvx[(*num_can)] = (pmot->x) >> 2;
                     mvy[(*num_can)++] = (pmot->y) >> 2;
                 }
-                if (jmb < mbheight - 1)  /*bottom neighbor current frame */
+                if (jmb < lastRow)  /*bottom neighbor current frame */
                 {
                     pmot = &mot16x16[mbnum+mbwidth];
                     mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1569,7 +1632,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                     mvx[(*num_can)] = (pmot->x) >> 2;
                     mvy[(*num_can)++] = (pmot->y) >> 2;
 
-                    if (jmb > 0)  /*upper-left neighbor current frame */
+                    if (jmb > firstRow)  /*upper-left neighbor current frame */
                     {
                         pmot = &mot16x16[mbnum-mbwidth-1];
                         mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1577,7 +1640,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                     }
 
                 }
-                if (jmb > 0)  /*upper neighbor current frame */
+                if (jmb > firstRow)  /*upper neighbor current frame */
                 {
                     pmot = &mot16x16[mbnum-mbwidth];
                     mvx[(*num_can)] = (pmot->x) >> 2;
@@ -1601,7 +1664,7 @@ void AVCCandidateSelection(int *mvx, int *mvy, int *num_can, int imb, int jmb,
                 pmvA_y = pmot->y;
             }
 
-            if (jmb > 0) /* get MV from top (B) neighbor either on current or previous frame */
+            if (jmb > firstRow) /* get MV from top (B) neighbor either on current or previous frame */
             {
                 availB = 1;
                 pmot = &mot16x16[mbnum-mbwidth];
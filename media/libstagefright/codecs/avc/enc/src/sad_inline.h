@@ -18,6 +18,10 @@
 #ifndef _SAD_INLINE_H_
 #define _SAD_INLINE_H_
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -76,7 +80,8 @@ extern "C"
 #include "sad_mb_offset.h"
 
 
-    __inline int32 simd_sad_mb(uint8 *ref, uint8 *blk, int dmin, int lx)
+    /* generic version, also the reference for the SSE2 one */
+    __inline int32 simd_sad_mb_C(uint8 *ref, uint8 *blk, int dmin, int lx)
     {
         int32 x4, x5, x6, x8, x9, x10, x11, x12, x14;
 
@@ -169,6 +174,43 @@ SadMBOffset1:
 
     }
 
+#if defined(__SSE2__)
+
+    /* unaligned loads are cheap, no need for the offset versions */
+    __inline int32 simd_sad_mb(uint8 *ref, uint8 *blk, int dmin, int lx)
+    {
+        __m128i sad = _mm_setzero_si128();
+        int32 x10;
+        int i;
+
+        for (i = 16; i > 0; i--)
+        {
+            sad = _mm_add_epi32(sad, _mm_sad_epu8(
+                                    _mm_loadu_si128((const __m128i*)ref),
+                                    _mm_loadu_si128((const __m128i*)blk)));
+            ref += lx;
+            blk += 16;
+
+            x10 = _mm_cvtsi128_si32(_mm_add_epi32(sad,
+                                    _mm_unpackhi_epi64(sad, sad)));
+            if (x10 > dmin) /* compare with dmin */
+            {
+                break;
+            }
+        }
+
+        return x10;
+    }
+
+#else
+
+    __inline int32 simd_sad_mb(uint8 *ref, uint8 *blk, int dmin, int lx)
+    {
+        return simd_sad_mb_C(ref, blk, dmin, lx);
+    }
+
+#endif /* __SSE2__ */
+
 #elif defined(__CC_ARM)  /* only work with arm v5 */
 
     __inline int32 SUB_SAD(int32 sad, int32 tmp, int32 tmp2)
@@ -42,7 +42,10 @@ AVCEnc_Status AVCEncodeSlice(AVCEncObject *encvid)
     {
         video->mbNum = CurrMbAddr;
         currMB = video->currMB = &(video->mblock[CurrMbAddr]);
-        currMB->slice_id = video->slice_id;  // for deblocking
+        if (currMB->slice_id != (int)video->slice_id) /* already set for parallel slices */
+        {
+            currMB->slice_id = video->slice_id;  // for deblocking
+        }
 
         video->mb_x = CurrMbAddr % video->PicWidthInMbs;
         video->mb_y = CurrMbAddr / video->PicWidthInMbs;
@@ -130,6 +133,12 @@ AVCEnc_Status AVCEncodeSlice(AVCEncObject *encvid)
                 break;
             }
         }
+        else if ((uint)CurrMbAddr >= (uint)(encvid->lastMbRow + 1) * video->PicWidthInMbs)
+        {
+            /* end of a band of rows encoded as a parallel slice, see slice_thread.cpp */
+            status = AVCENC_SUCCESS;
+            break;
+        }
     }
 
     if (video->mb_skip_run > 0)
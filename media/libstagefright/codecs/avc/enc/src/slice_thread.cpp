@@ -0,0 +1,459 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+#include "avcenc_lib.h"
+
+/* Each slice of a picture is a band of MB rows. The first one is handled by the thread
+   calling the API with the main encoder object, slice i > 0 by thread i with a private
+   copy of it. The copies are made by the calling thread right before a job is posted, so
+   the threads never read the main object.
+
+   Two kinds of jobs run in parallel:
+   - one pass of the motion estimation over the band, from InitFrame(),
+   - the encoding of the slice into its own buffer, from the first PVAVCEncodeNAL() call
+     of the picture. The NAL units of the other slices are returned by the following calls.
+
+   Slices never predict across their boundaries, so MB data of other bands is only read for
+   slice_id, which is assigned to all MBs before the threads start. Reconstructed pixels,
+   mblock and the per MB arrays of the encoder object are shared, each thread writes its own
+   band. Deblocking runs over the whole picture once all slices are done. */
+
+/* copy the main encoder object into a slice, see AVCEncSlice */
+static void CopyEncObject(AVCEncSlice *slice, AVCEncObject *encvid)
+{
+    AVCEncObject *copy = &slice->encvid;
+    uint8 *subpel_pred = (uint8*) encvid->subpel_pred;
+    uint8 *copy_subpel_pred = (uint8*) copy->subpel_pred;
+    int i, j;
+
+    *copy = *encvid;
+    slice->common = *encvid->common;
+    slice->sliceHdr = *encvid->common->sliceHdr;
+    slice->rateCtrl = *encvid->rateCtrl;
+    slice->bitstream = *encvid->bitstream;
+
+    copy->common = &slice->common;
+    copy->rateCtrl = &slice->rateCtrl;
+    copy->bitstream = &slice->bitstream;
+    slice->common.sliceHdr = &slice->sliceHdr;
+    slice->bitstream.encvid = copy;
+    copy->sliceThread = NULL;
+
+    /* the sub-pel candidates point into subpel_pred */
+    for (i = 0; i < 9; i++)
+    {
+        copy->hpel_cand[i] = copy_subpel_pred + (encvid->hpel_cand[i] - subpel_pred);
+        for (j = 0; j < 4; j++)
+        {
+            copy->bilin_base[i][j] = copy_subpel_pred + (encvid->bilin_base[i][j] - subpel_pred);
+        }
+    }
+
+    copy->firstMbRow = slice->firstMbRow;
+    copy->lastMbRow = slice->lastMbRow;
+}
+
+/* encode a slice into its own buffer, which grows like the overrun buffer */
+static void EncodeSliceNAL(AVCEncSlice *slice)
+{
+    AVCEncObject *encvid = &slice->encvid;
+    AVCCommonObj *video = encvid->common;
+    AVCEncBitstream *bitstream = encvid->bitstream;
+    AVCEnc_Status status;
+
+    encvid->overrunBuffer = slice->buffer;
+    encvid->oBSize = slice->bufSize;
+
+    BitstreamEncInit(bitstream, slice->buffer, slice->bufSize, slice->buffer, slice->bufSize);
+    BitstreamWriteBits(bitstream, 8, (video->nal_ref_idc << 5) | (video->nal_unit_type));
+
+    status = InitSlice(encvid);
+
+    if (status == AVCENC_SUCCESS)
+    {
+        status = EncodeSliceHeader(encvid, bitstream);
+    }
+
+    if (status == AVCENC_SUCCESS)
+    {
+        status = AVCEncodeSlice(encvid);
+        if (status == AVCENC_PICTURE_READY) /* the last slice */
+        {
+            status = AVCENC_SUCCESS;
+        }
+    }
+
+    if (status == AVCENC_SUCCESS)
+    {
+        BitstreamTrailingBits(bitstream, &slice->nalSize);
+        slice->nalSize = bitstream->write_pos;
+    }
+
+    /* the buffer may have been reallocated */
+    slice->buffer = encvid->overrunBuffer;
+    slice->bufSize = encvid->oBSize;
+    slice->status = status;
+
+    return ;
+}
+
+static void *SliceThreadMain(void *arg)
+{
+    AVCEncSlice *slice = (AVCEncSlice*) arg;
+    AVCEncSliceThread *sliceThread = slice->owner;
+    int jobCount = 0;
+    AVCEnc_SliceJob job;
+
+    while (1)
+    {
+        pthread_mutex_lock(&sliceThread->lock);
+        while (sliceThread->jobCount == jobCount)
+        {
+            pthread_cond_wait(&sliceThread->start, &sliceThread->lock);
+        }
+        jobCount = sliceThread->jobCount;
+        job = sliceThread->job;
+        pthread_mutex_unlock(&sliceThread->lock);
+
+        if (job == AVCEnc_Slice_Exit)
+        {
+            break;
+        }
+        else if (job == AVCEnc_Slice_MotionSearch)
+        {
+            AVCMotionSearchRows(&slice->encvid, slice->firstMbRow, slice->lastMbRow,
+                                sliceThread->start_i, sliceThread->incr_i, sliceThread->type_pred,
+                                &slice->numIntraSearch, &slice->totalSAD);
+        }
+        else
+        {
+            EncodeSliceNAL(slice);
+        }
+
+        pthread_mutex_lock(&sliceThread->lock);
+        if (--sliceThread->numBusy == 0)
+        {
+            pthread_cond_signal(&sliceThread->done);
+        }
+        pthread_mutex_unlock(&sliceThread->lock);
+    }
+
+    return NULL;
+}
+
+static void PostJob(AVCEncSliceThread *sliceThread, AVCEnc_SliceJob job)
+{
+    pthread_mutex_lock(&sliceThread->lock);
+    sliceThread->job = job;
+    sliceThread->jobCount++;
+    sliceThread->numBusy = sliceThread->numThread;
+    pthread_cond_broadcast(&sliceThread->start);
+    pthread_mutex_unlock(&sliceThread->lock);
+}
+
+static void WaitJob(AVCEncSliceThread *sliceThread)
+{
+    pthread_mutex_lock(&sliceThread->lock);
+    while (sliceThread->numBusy > 0)
+    {
+        pthread_cond_wait(&sliceThread->done, &sliceThread->lock);
+    }
+    pthread_mutex_unlock(&sliceThread->lock);
+}
+
+AVCEnc_Status AVCSliceThreadInit(AVCHandle *avcHandle, int num_slice)
+{
+    AVCEncObject *encvid = (AVCEncObject*) avcHandle->AVCObject;
+    AVCCommonObj *video = encvid->common;
+    AVCEncSliceThread *sliceThread;
+    AVCEncSlice *slice;
+    void *userData = avcHandle->userData;
+    int mbheight = video->PicHeightInMbs;
+    int i;
+
+    /* slices are bands of rows, they do not mix with slice groups */
+    if (video->currPicParams->num_slice_groups_minus1 > 0)
+    {
+        return AVCENC_TOOLS_NOT_SUPPORTED;
+    }
+
+    if (num_slice > MAX_NUM_SLICE)
+    {
+        num_slice = MAX_NUM_SLICE;
+    }
+    if (num_slice > mbheight)
+    {
+        num_slice = mbheight;
+    }
+    if (num_slice < 2)
+    {
+        return AVCENC_SUCCESS;
+    }
+
+    sliceThread = (AVCEncSliceThread*) avcHandle->CBAVC_Malloc(userData, sizeof(AVCEncSliceThread), DEFAULT_ATTR);
+    if (sliceThread == NULL)
+    {
+        return AVCENC_MEMORY_FAIL;
+    }
+    encvid->sliceThread = sliceThread;
+
+    sliceThread->numSlice = num_slice;
+    sliceThread->numThread = 0;
+    sliceThread->nextSlice = 0;
+    sliceThread->job = AVCEnc_Slice_Exit;
+    sliceThread->jobCount = 0;
+    sliceThread->numBusy = 0;
+    pthread_mutex_init(&sliceThread->lock, NULL);
+    pthread_cond_init(&sliceThread->start, NULL);
+    pthread_cond_init(&sliceThread->done, NULL);
+
+    sliceThread->slice = (AVCEncSlice*) avcHandle->CBAVC_Malloc(userData, sizeof(AVCEncSlice) * num_slice, DEFAULT_ATTR);
+    if (sliceThread->slice == NULL)
+    {
+        return AVCENC_MEMORY_FAIL;
+    }
+
+    for (i = 0; i < num_slice; i++)
+    {
+        slice = &sliceThread->slice[i];
+        slice->firstMbRow = i * mbheight / num_slice;
+        slice->lastMbRow = (i + 1) * mbheight / num_slice - 1;
+        slice->owner = sliceThread;
+        slice->buffer = NULL;
+        slice->bufSize = 0;
+        slice->nalSize = 0;
+    }
+
+    for (i = 1; i < num_slice; i++)
+    {
+        slice = &sliceThread->slice[i];
+
+        /* start with the size of the uncompressed band, as the buffer only grows in
+           small steps later on */
+        slice->bufSize = (slice->lastMbRow - slice->firstMbRow + 1) * video->PicWidthInMbs * 384;
+        slice->buffer = (uint8*) avcHandle->CBAVC_Malloc(userData, slice->bufSize, DEFAULT_ATTR);
+        if (slice->buffer == NULL)
+        {
+            return AVCENC_MEMORY_FAIL;
+        }
+
+        if (pthread_create(&slice->thread, NULL, SliceThreadMain, slice) != 0)
+        {
+            return AVCENC_FAIL;
+        }
+        sliceThread->numThread++;
+    }
+
+    return AVCENC_SUCCESS;
+}
+
+void AVCSliceThreadCleanUp(AVCHandle *avcHandle)
+{
+    AVCEncObject *encvid = (AVCEncObject*) avcHandle->AVCObject;
+    AVCEncSliceThread *sliceThread = encvid->sliceThread;
+    void *userData = avcHandle->userData;
+    int i;
+
+    if (sliceThread == NULL)
+    {
+        return ;
+    }
+
+    PostJob(sliceThread, AVCEnc_Slice_Exit);
+    for (i = 1; i <= sliceThread->numThread; i++)
+    {
+        pthread_join(sliceThread->slice[i].thread, NULL);
+    }
+
+    if (sliceThread->slice)
+    {
+        for (i = 0; i < sliceThread->numSlice; i++)
+        {
+            if (sliceThread->slice[i].buffer)
+            {
+                avcHandle->CBAVC_Free(userData, sliceThread->slice[i].buffer);
+            }
+        }
+        avcHandle->CBAVC_Free(userData, sliceThread->slice);
+    }
+
+    pthread_cond_destroy(&sliceThread->done);
+    pthread_cond_destroy(&sliceThread->start);
+    pthread_mutex_destroy(&sliceThread->lock);
+
+    avcHandle->CBAVC_Free(userData, sliceThread);
+    encvid->sliceThread = NULL;
+
+    return ;
+}
+
+void AVCSliceThreadMotionSearch(AVCEncObject *encvid, int start_i, int incr_i, int type_pred,
+                                int *NumIntraSearch, int *totalSAD)
+{
+    AVCEncSliceThread *sliceThread = encvid->sliceThread;
+    AVCEncSlice *slice;
+    int i;
+
+    for (i = 1; i < sliceThread->numSlice; i++)
+    {
+        slice = &sliceThread->slice[i];
+        CopyEncObject(slice, encvid);
+        slice->numIntraSearch = 0;
+        slice->totalSAD = 0;
+    }
+
+    sliceThread->start_i = start_i;
+    sliceThread->incr_i = incr_i;
+    sliceThread->type_pred = type_pred;
+    PostJob(sliceThread, AVCEnc_Slice_MotionSearch);
+
+    /* the first band on this thread */
+    slice = &sliceThread->slice[0];
+    encvid->firstMbRow = slice->firstMbRow;
+    encvid->lastMbRow = slice->lastMbRow;
+    AVCMotionSearchRows(encvid, slice->firstMbRow, slice->lastMbRow, start_i, incr_i, type_pred,
+                        NumIntraSearch, totalSAD);
+
+    WaitJob(sliceThread);
+
+    /* the sums do not depend on the order, same result as a single pass over the picture */
+    for (i = 1; i < sliceThread->numSlice; i++)
+    {
+        slice = &sliceThread->slice[i];
+        *NumIntraSearch += slice->numIntraSearch;
+        *totalSAD += slice->totalSAD;
+    }
+
+    return ;
+}
+
+void AVCSliceThreadStartEncode(AVCEncObject *encvid)
+{
+    AVCEncSliceThread *sliceThread = encvid->sliceThread;
+    AVCCommonObj *video = encvid->common;
+    AVCMacroblock *mblock = video->mblock;
+    AVCEncSlice *slice;
+    int i, mbnum, last_mb;
+
+    /* the first slice on this thread */
+    encvid->firstMbRow = sliceThread->slice[0].firstMbRow;
+    encvid->lastMbRow = sliceThread->slice[0].lastMbRow;
+
+    /* availability of the neighbors is decided by slice_id, set it for all MBs up front */
+    for (i = 0; i < sliceThread->numSlice; i++)
+    {
+        slice = &sliceThread->slice[i];
+        mbnum = slice->firstMbRow * video->PicWidthInMbs;
+        last_mb = (slice->lastMbRow + 1) * video->PicWidthInMbs;
+        while (mbnum < last_mb)
+        {
+            mblock[mbnum++].slice_id = video->slice_id + i;
+        }
+    }
+
+    for (i = 1; i < sliceThread->numSlice; i++)
+    {
+        slice = &sliceThread->slice[i];
+        CopyEncObject(slice, encvid);
+
+        slice->common.slice_id = video->slice_id + i;
+        slice->common.mbNum = slice->firstMbRow * video->PicWidthInMbs;
+        slice->rateCtrl.NumberofHeaderBits = 0;
+        slice->rateCtrl.NumberofTextureBits = 0;
+        slice->encvid.numIntraMB = 0;
+    }
+
+    PostJob(sliceThread, AVCEnc_Slice_Encode);
+
+    return ;
+}
+
+AVCEnc_Status AVCSliceThreadFinishEncode(AVCEncObject *encvid, AVCEnc_Status status)
+{
+    AVCEncSliceThread *sliceThread = encvid->sliceThread;
+    AVCCommonObj *video = encvid->common;
+    AVCRateControl *rateCtrl = encvid->rateCtrl;
+    AVCEncSlice *slice;
+    int i;
+
+    WaitJob(sliceThread);
+
+    /* the first slice ended at its last row */
+    if (status == AVCENC_SUCCESS)
+    {
+        status = AVCENC_PICTURE_READY;
+    }
+
+    for (i = 1; i < sliceThread->numSlice; i++)
+    {
+        slice = &sliceThread->slice[i];
+        if (slice->status != AVCENC_SUCCESS)
+        {
+            if (status == AVCENC_PICTURE_READY)
+            {
+                status = slice->status;
+            }
+            continue;
+        }
+
+        /* Rate control is done per picture, every MB of every slice is coded with the
+           picture QP. There is no bit budget to split among the slices, their bit counts
+           only add up to the picture's for RCUpdateFrame(). */
+        rateCtrl->NumberofHeaderBits += slice->rateCtrl.NumberofHeaderBits;
+        rateCtrl->NumberofTextureBits += slice->rateCtrl.NumberofTextureBits;
+        rateCtrl->numFrameBits += (slice->nalSize << 3);
+        encvid->numIntraMB += slice->encvid.numIntraMB;
+    }
+
+    video->slice_id += sliceThread->numSlice - 1;
+
+    return status;
+}
+
+AVCEnc_Status AVCSliceThreadNextNAL(AVCEncObject *encvid, uint8 *buffer, uint *buf_nal_size,
+                                    int *nal_type)
+{
+    AVCEncSliceThread *sliceThread = encvid->sliceThread;
+    AVCEncSlice *slice = &sliceThread->slice[sliceThread->nextSlice];
+    AVCEncBitstream *bitstream = encvid->bitstream;
+
+    BitstreamEncInit(bitstream, buffer, *buf_nal_size, encvid->overrunBuffer, encvid->oBSize);
+
+    if (slice->nalSize > *buf_nal_size)
+    {
+        if (AVCBitstreamUseOverrunBuffer(bitstream, slice->nalSize) != AVCENC_SUCCESS)
+        {
+            return AVCENC_BITSTREAM_BUFFER_FULL;
+        }
+    }
+
+    memcpy(bitstream->bitstreamBuffer, slice->buffer, slice->nalSize);
+    bitstream->write_pos = slice->nalSize;
+
+    *buf_nal_size = slice->nalSize;
+    *nal_type = encvid->common->nal_unit_type;
+
+    if (++sliceThread->nextSlice < sliceThread->numSlice)
+    {
+        return AVCENC_SUCCESS;
+    }
+
+    sliceThread->nextSlice = 0;
+    encvid->enc_state = AVCEnc_Analyzing_Frame;
+
+    return AVCENC_PICTURE_READY;
+}
@@ -2,7 +2,8 @@ LOCAL_PATH:= $(call my-dir)
 include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES := \
-        SoftFlacEncoder.cpp
+        SoftFlacEncoder.cpp \
+        FlacSegmentEncoder.cpp
 
 LOCAL_C_INCLUDES := \
         frameworks/av/media/libstagefright/include \
@@ -10,7 +11,7 @@ LOCAL_C_INCLUDES := \
         external/flac/include
 
 LOCAL_SHARED_LIBRARIES := \
-        libstagefright libstagefright_omx libstagefright_foundation libutils liblog
+        libstagefright libstagefright_omx libstagefright_foundation libcutils libutils liblog
 
 LOCAL_STATIC_LIBRARIES := \
         libFLAC \
@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FlacSegmentEncoder"
+#include <utils/Log.h>
+
+#include "FlacSegmentEncoder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+
+namespace android {
+
+// CRC-8 (x^8 + x^2 + x + 1) of the frame header and CRC-16
+// (x^16 + x^15 + x^2 + 1) of the whole frame, both MSB first and starting
+// from 0, as the FLAC format specifies them.
+static uint8_t gCrc8Table[256];
+static uint16_t gCrc16Table[256];
+static pthread_once_t gCrcTablesOnce = PTHREAD_ONCE_INIT;
+
+static void initCrcTables() {
+    for (unsigned i = 0; i < 256; ++i) {
+        unsigned crc8 = i;
+        unsigned crc16 = i << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc8 = (crc8 & 0x80) ? (crc8 << 1) ^ 0x07 : (crc8 << 1);
+            crc16 = (crc16 & 0x8000) ? (crc16 << 1) ^ 0x8005 : (crc16 << 1);
+        }
+        gCrc8Table[i] = (uint8_t)crc8;
+        gCrc16Table[i] = (uint16_t)crc16;
+    }
+}
+
+static uint8_t crc8(const uint8_t *data, size_t size) {
+    uint8_t crc = 0;
+    while (size-- > 0) {
+        crc = gCrc8Table[crc ^ *data++];
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t size) {
+    uint16_t crc = 0;
+    while (size-- > 0) {
+        crc = (uint16_t)((crc << 8) ^ gCrc16Table[(crc >> 8) ^ *data++]);
+    }
+    return crc;
+}
+
+// Appends the fixed-blocksize frame to out, with its frame number replaced
+// by frameNumber. The number is UTF-8 coded, so the header may change size,
+// both CRCs are computed again.
+static bool appendRenumberedFrame(
+        Vector<uint8_t> *out, const uint8_t *frame, size_t size,
+        unsigned frameNumber) {
+    // sync code and blocking strategy 0 (fixed blocksize)
+    if (size < 6 || frame[0] != 0xff || frame[1] != 0xf8) {
+        return false;
+    }
+
+    // length of the coded frame number, from its first byte
+    size_t numberSize = 1;
+    if (frame[4] & 0x80) {
+        while (numberSize < 7 && (frame[4] & (0x80 >> numberSize))) {
+            ++numberSize;
+        }
+        if (numberSize < 2 || numberSize > 6) {
+            return false;
+        }
+    }
+
+    // blocksize and sample rate stored at the end of the header
+    size_t extraSize = 0;
+    unsigned blockSizeCode = frame[2] >> 4;
+    unsigned sampleRateCode = frame[2] & 0x0f;
+    if (blockSizeCode == 6) {
+        extraSize += 1;
+    } else if (blockSizeCode == 7) {
+        extraSize += 2;
+    }
+    if (sampleRateCode == 12) {
+        extraSize += 1;
+    } else if (sampleRateCode == 13 || sampleRateCode == 14) {
+        extraSize += 2;
+    }
+
+    size_t headerSize = 4 + numberSize + extraSize;   // without the CRC-8
+    if (headerSize + 1 + 2 > size) {
+        return false;
+    }
+
+    uint8_t header[4 + 6 + 4 + 1];
+    memcpy(header, frame, 4);
+
+    size_t pos = 4;
+    if (frameNumber < 0x80) {
+        header[pos++] = (uint8_t)frameNumber;
+    } else {
+        // count the continuation bytes, 6 bits of the number each
+        size_t numTrailing = 1;
+        while (numTrailing < 5 && (frameNumber >> (6 * numTrailing)) >= (0x40u >> numTrailing)) {
+            ++numTrailing;
+        }
+        header[pos++] = (uint8_t)((0xff00 >> (numTrailing + 1))
+                | (frameNumber >> (6 * numTrailing)));
+        while (numTrailing-- > 0) {
+            header[pos++] = (uint8_t)(0x80 | ((frameNumber >> (6 * numTrailing)) & 0x3f));
+        }
+    }
+
+    memcpy(&header[pos], &frame[4 + numberSize], extraSize);
+    pos += extraSize;
+    header[pos] = crc8(header, pos);
+    ++pos;
+
+    size_t start = out->size();
+    out->appendArray(header, pos);
+    out->appendArray(&frame[headerSize + 1], size - (headerSize + 1) - 2);
+
+    uint16_t crc = crc16(out->array() + start, out->size() - start);
+    out->push((uint8_t)(crc >> 8));
+    out->push((uint8_t)crc);
+
+    return true;
+}
+
+FlacSegment::FlacSegment(size_t capacity)
+    : mPcm((FLAC__int32 *)malloc(sizeof(FLAC__int32) * 2 * capacity)),
+      mCapacity(capacity),
+      mNumSamples(0),
+      mFirstFrame(0),
+      mTimeUs(0),
+      mOk(false),
+      mNumFramesOut(0),
+      mDone(false) {
+}
+
+FlacSegment::~FlacSegment() {
+    free(mPcm);
+    mPcm = NULL;
+}
+
+FlacSegmentEncoder::FlacSegmentEncoder(size_t numThreads)
+    : mQuit(false),
+      mInitCheck(OK),
+      mNumChannels(1),
+      mSampleRate(44100),
+      mCompressionLevel(5) {
+    pthread_once(&gCrcTablesOnce, initCrcTables);
+
+    for (size_t i = 0; i < numThreads; ++i) {
+        Worker *worker = new Worker;
+        worker->mOwner = this;
+        worker->mEncoder = FLAC__stream_encoder_new();
+        if (worker->mEncoder == NULL) {
+            delete worker;
+            mInitCheck = NO_MEMORY;
+            break;
+        }
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+        int err = pthread_create(&worker->mThread, &attr, ThreadWrapper, worker);
+        pthread_attr_destroy(&attr);
+
+        if (err != 0) {
+            FLAC__stream_encoder_delete(worker->mEncoder);
+            delete worker;
+            mInitCheck = UNKNOWN_ERROR;
+            break;
+        }
+
+        mWorkers.push(worker);
+    }
+}
+
+FlacSegmentEncoder::~FlacSegmentEncoder() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mQuit = true;
+        mWorkCondition.broadcast();
+    }
+
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        Worker *worker = mWorkers[i];
+        void *dummy;
+        pthread_join(worker->mThread, &dummy);
+        FLAC__stream_encoder_delete(worker->mEncoder);
+        delete worker;
+    }
+    mWorkers.clear();
+}
+
+status_t FlacSegmentEncoder::initCheck() const {
+    return mInitCheck;
+}
+
+void FlacSegmentEncoder::configure(
+        unsigned numChannels, unsigned sampleRate, unsigned compressionLevel) {
+    Mutex::Autolock autoLock(mLock);
+    mNumChannels = numChannels;
+    mSampleRate = sampleRate;
+    mCompressionLevel = compressionLevel;
+}
+
+void FlacSegmentEncoder::encode(FlacSegment *segment) {
+    Mutex::Autolock autoLock(mLock);
+    segment->mDone = false;
+    mQueue.push_back(segment);
+    mWorkCondition.signal();
+}
+
+bool FlacSegmentEncoder::isDone(FlacSegment *segment) {
+    Mutex::Autolock autoLock(mLock);
+    return segment->mDone;
+}
+
+void FlacSegmentEncoder::wait(FlacSegment *segment) {
+    Mutex::Autolock autoLock(mLock);
+    while (!segment->mDone) {
+        mDoneCondition.wait(mLock);
+    }
+}
+
+// static
+void *FlacSegmentEncoder::ThreadWrapper(void *me) {
+    Worker *worker = static_cast<Worker *>(me);
+    worker->mOwner->threadEntry(worker);
+    return NULL;
+}
+
+void FlacSegmentEncoder::threadEntry(Worker *worker) {
+    Mutex::Autolock autoLock(mLock);
+
+    for (;;) {
+        while (mQueue.empty() && !mQuit) {
+            mWorkCondition.wait(mLock);
+        }
+
+        if (mQuit) {
+            break;
+        }
+
+        FlacSegment *segment = *mQueue.begin();
+        mQueue.erase(mQueue.begin());
+
+        mLock.unlock();
+        bool ok = encodeSegment(worker->mEncoder, segment);
+        mLock.lock();
+
+        segment->mOk = ok;
+        segment->mDone = true;
+        mDoneCondition.broadcast();
+    }
+}
+
+bool FlacSegmentEncoder::encodeSegment(
+        FLAC__StreamEncoder *encoder, FlacSegment *segment) {
+    segment->mData.clear();
+    segment->mFrameEnds.clear();
+    segment->mNumFramesOut = 0;
+
+    // FLAC__stream_encoder_finish() resets the settings, set them every time
+    FLAC__bool ok = true;
+    ok = ok && FLAC__stream_encoder_set_channels(encoder, mNumChannels);
+    ok = ok && FLAC__stream_encoder_set_sample_rate(encoder, mSampleRate);
+    ok = ok && FLAC__stream_encoder_set_bits_per_sample(encoder, 16);
+    ok = ok && FLAC__stream_encoder_set_compression_level(encoder, mCompressionLevel);
+    ok = ok && FLAC__stream_encoder_set_verify(encoder, false);
+    if (!ok) {
+        return false;
+    }
+
+    if (FLAC__STREAM_ENCODER_INIT_STATUS_OK !=
+            FLAC__stream_encoder_init_stream(encoder,
+                    writeCallback   /*write_callback*/,
+                    NULL /*seek_callback*/,
+                    NULL /*tell_callback*/,
+                    NULL /*metadata_callback*/,
+                    (void *) segment /*client_data*/)) {
+        return false;
+    }
+
+    ok = FLAC__stream_encoder_process_interleaved(
+            encoder, segment->mPcm, segment->mNumSamples);
+
+    // writes out the last, possibly partial, frame
+    ok = FLAC__stream_encoder_finish(encoder) && ok;
+
+    if (!ok) {
+        ALOGE("error encoding segment at frame %u, encoder state %d",
+              segment->mFirstFrame, FLAC__stream_encoder_get_state(encoder));
+    }
+
+    return ok;
+}
+
+// static
+FLAC__StreamEncoderWriteStatus FlacSegmentEncoder::writeCallback(
+        const FLAC__StreamEncoder *encoder, const FLAC__byte buffer[],
+        size_t bytes, unsigned samples, unsigned current_frame, void *client_data) {
+    FlacSegment *segment = (FlacSegment *)client_data;
+
+    if (samples == 0) {
+        // the stream header each init writes, SoftFlacEncoder keeps the one
+        // of its own encoder
+        return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+    }
+
+    if (!appendRenumberedFrame(
+                &segment->mData, buffer, bytes,
+                segment->mFirstFrame + current_frame)) {
+        ALOGE("unexpected frame header (%zu bytes)", bytes);
+        return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+    }
+
+    segment->mFrameEnds.push(segment->mData.size());
+
+    return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
+
+}  // namespace android
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLAC_SEGMENT_ENCODER_H_
+
+#define FLAC_SEGMENT_ENCODER_H_
+
+#include <pthread.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Errors.h>
+#include <utils/List.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include "FLAC/stream_encoder.h"
+
+namespace android {
+
+// A run of consecutive FLAC frames of the stream, encoded on its own.
+struct FlacSegment {
+    FlacSegment(size_t capacity);
+    ~FlacSegment();
+
+    // interleaved input of up to two channels, mNumSamples samples per
+    // channel; only the last segment of the stream may hold less than a
+    // whole number of blocks. NULL if the allocation failed.
+    FLAC__int32 *mPcm;
+    size_t mCapacity;       // samples per channel
+    size_t mNumSamples;
+
+    unsigned mFirstFrame;   // number of its first frame in the stream
+    int64_t mTimeUs;        // time of its first sample
+
+    // valid once FlacSegmentEncoder::wait() returned
+    bool mOk;
+    Vector<uint8_t> mData;
+    Vector<size_t> mFrameEnds;  // offset in mData past the end of each frame
+
+    // the frames already written to output buffers
+    size_t mNumFramesOut;
+
+private:
+    friend struct FlacSegmentEncoder;
+
+    // protected by FlacSegmentEncoder::mLock
+    bool mDone;
+
+    DISALLOW_EVIL_CONSTRUCTORS(FlacSegment);
+};
+
+// Encodes FlacSegments on a set of worker threads, one libFLAC stream
+// encoder each. The frames of a segment are renumbered to their place in
+// the whole stream, so that segments can be written out back to back.
+struct FlacSegmentEncoder {
+    FlacSegmentEncoder(size_t numThreads);
+    ~FlacSegmentEncoder();
+
+    status_t initCheck() const;
+
+    // must not be called while segments are being encoded
+    void configure(
+            unsigned numChannels, unsigned sampleRate, unsigned compressionLevel);
+
+    void encode(FlacSegment *segment);
+    bool isDone(FlacSegment *segment);
+    void wait(FlacSegment *segment);
+
+private:
+    struct Worker {
+        FlacSegmentEncoder *mOwner;
+        pthread_t mThread;
+        FLAC__StreamEncoder *mEncoder;
+    };
+
+    Mutex mLock;
+    Condition mWorkCondition;
+    Condition mDoneCondition;
+    List<FlacSegment *> mQueue;
+    bool mQuit;
+
+    Vector<Worker *> mWorkers;
+    status_t mInitCheck;
+
+    unsigned mNumChannels;
+    unsigned mSampleRate;
+    unsigned mCompressionLevel;
+
+    static void *ThreadWrapper(void *me);
+    void threadEntry(Worker *worker);
+
+    bool encodeSegment(FLAC__StreamEncoder *encoder, FlacSegment *segment);
+
+    static FLAC__StreamEncoderWriteStatus writeCallback(
+            const FLAC__StreamEncoder *encoder, const FLAC__byte buffer[],
+            size_t bytes, unsigned samples, unsigned current_frame, void *client_data);
+
+    DISALLOW_EVIL_CONSTRUCTORS(FlacSegmentEncoder);
+};
+
+}  // namespace android
+
+#endif  // FLAC_SEGMENT_ENCODER_H_
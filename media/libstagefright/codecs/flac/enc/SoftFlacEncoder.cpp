@@ -17,6 +17,7 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "SoftFlacEncoder"
 #include <utils/Log.h>
+#include <cutils/properties.h>
 
 #include "SoftFlacEncoder.h"
 
@@ -51,6 +52,14 @@ SoftFlacEncoder::SoftFlacEncoder(
       mEncoderWriteData(false),
       mEncoderReturnedEncodedData(false),
       mEncoderReturnedNbBytes(0),
+      mNumThreads(1),
+      mBlockSize(0),
+      mFramesPerSegment(kNumFramesPerSegment),
+      mSegmentEncoder(NULL),
+      mFillingSegment(NULL),
+      mNextFrameNumber(0),
+      mSawInputEOS(false),
+      mSignalledOutputEOS(false),
       mInputBufferPcm32(NULL)
 #ifdef WRITE_FLAC_HEADER_IN_FIRST_BUFFER
       , mHeaderOffset(0)
@@ -73,10 +82,49 @@ SoftFlacEncoder::SoftFlacEncoder(
             mSignalledError = true;
         }
     }
+
+    // Encode segments of the input on this many threads. Off by default
+    // because the output then lags the input by up to a few segments.
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.stagefright.flacenc-threads", value, NULL)) {
+        int numThreads = atoi(value);
+        if (numThreads > kMaxNumThreads) {
+            numThreads = kMaxNumThreads;
+        }
+        if (numThreads > 1) {
+            mNumThreads = numThreads;
+        }
+    }
+
+    if (!mSignalledError && mNumThreads > 1) {
+        mSegmentEncoder = new FlacSegmentEncoder(mNumThreads);
+        if (mSegmentEncoder->initCheck() != OK) {
+            ALOGW("unable to start %zu encoder threads, encoding on one", mNumThreads);
+            delete mSegmentEncoder;
+            mSegmentEncoder = NULL;
+            mNumThreads = 1;
+        }
+    }
 }
 
 SoftFlacEncoder::~SoftFlacEncoder() {
     ALOGV("SoftFlacEncoder::~SoftFlacEncoder()");
+    // waits for the segment being encoded, if any
+    delete mSegmentEncoder;
+    mSegmentEncoder = NULL;
+
+    delete mFillingSegment;
+    mFillingSegment = NULL;
+    for (List<FlacSegment *>::iterator it = mSegments.begin(); it != mSegments.end(); ++it) {
+        delete *it;
+    }
+    mSegments.clear();
+    for (List<FlacSegment *>::iterator it = mFreeSegments.begin();
+            it != mFreeSegments.end(); ++it) {
+        delete *it;
+    }
+    mFreeSegments.clear();
+
     if (mFlacStreamEncoder != NULL) {
         FLAC__stream_encoder_delete(mFlacStreamEncoder);
         mFlacStreamEncoder = NULL;
@@ -264,6 +312,11 @@ void SoftFlacEncoder::onQueueFilled(OMX_U32 portIndex) {
         return;
     }
 
+    if (mSegmentEncoder != NULL) {
+        onQueueFilledSegmented();
+        return;
+    }
+
     List<BufferInfo *> &inQueue = getPortQueue(0);
     List<BufferInfo *> &outQueue = getPortQueue(1);
 
@@ -344,6 +397,260 @@ void SoftFlacEncoder::onQueueFilled(OMX_U32 portIndex) {
 }
 
 
+void SoftFlacEncoder::onQueueFilledSegmented() {
+    if (mBlockSize == 0) {
+        ALOGE("encoder not configured, no blocksize to cut segments by");
+        mSignalledError = true;
+        notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+        return;
+    }
+
+    List<BufferInfo *> &inQueue = getPortQueue(0);
+    List<BufferInfo *> &outQueue = getPortQueue(1);
+
+    for (;;) {
+        // after the end of the input, wait for the segments still encoding
+        if (!drainSegments(mSawInputEOS)) {
+            return;
+        }
+
+        if (mSawInputEOS) {
+            if (mSegments.empty() && !mSignalledOutputEOS && !outQueue.empty()) {
+                BufferInfo *outInfo = *outQueue.begin();
+                OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
+
+                outHeader->nFilledLen = 0;
+                outHeader->nFlags = OMX_BUFFERFLAG_EOS;
+
+                outQueue.erase(outQueue.begin());
+                outInfo->mOwnedByUs = false;
+                notifyFillBufferDone(outHeader);
+
+                mSignalledOutputEOS = true;
+            }
+            return;
+        }
+
+        if (inQueue.empty()) {
+            return;
+        }
+
+        if (mSegments.size() >= kMaxNumSegmentsPerThread * mNumThreads) {
+            // Without an output buffer nothing can be drained, we are called
+            // again when one comes back.
+            if (outQueue.empty()) {
+                return;
+            }
+            mSegmentEncoder->wait(*mSegments.begin());
+            continue;
+        }
+
+        BufferInfo *inInfo = *inQueue.begin();
+        OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
+
+        if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
+            queueFillingSegment();
+            mSawInputEOS = true;
+        } else {
+            if (inHeader->nFilledLen > kMaxInputBufferSize) {
+                ALOGE("input buffer too large (%ld).", inHeader->nFilledLen);
+                mSignalledError = true;
+                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+                return;
+            }
+
+            const OMX_S16 * const pcm16 =
+                reinterpret_cast<OMX_S16 *>(inHeader->pBuffer + inHeader->nOffset);
+            if (!appendToSegment(pcm16, inHeader->nFilledLen / (2 * mNumChannels),
+                        inHeader->nTimeStamp)) {
+                ALOGE("unable to allocate a segment");
+                mSignalledError = true;
+                notify(OMX_EventError, OMX_ErrorInsufficientResources, 0, NULL);
+                return;
+            }
+        }
+
+        inInfo->mOwnedByUs = false;
+        inQueue.erase(inQueue.begin());
+        inInfo = NULL;
+        notifyEmptyBufferDone(inHeader);
+        inHeader = NULL;
+    }
+}
+
+bool SoftFlacEncoder::appendToSegment(
+        const OMX_S16 *pcm16, size_t numFrames, OMX_TICKS timeUs) {
+    size_t offset = 0;
+    while (offset < numFrames) {
+        if (mFillingSegment == NULL) {
+            if (!mFreeSegments.empty()) {
+                mFillingSegment = *mFreeSegments.begin();
+                mFreeSegments.erase(mFreeSegments.begin());
+            } else {
+                mFillingSegment = new FlacSegment(mBlockSize * mFramesPerSegment);
+                if (mFillingSegment->mPcm == NULL) {
+                    delete mFillingSegment;
+                    mFillingSegment = NULL;
+                    return false;
+                }
+            }
+            mFillingSegment->mNumSamples = 0;
+            mFillingSegment->mTimeUs = timeUs + (offset * 1000000ll) / mSampleRate;
+        }
+
+        size_t n = mFillingSegment->mCapacity - mFillingSegment->mNumSamples;
+        if (n > numFrames - offset) {
+            n = numFrames - offset;
+        }
+
+        FLAC__int32 *pcm32 =
+            mFillingSegment->mPcm + mFillingSegment->mNumSamples * mNumChannels;
+        const OMX_S16 *src = pcm16 + offset * mNumChannels;
+        for (size_t i = 0; i < n * mNumChannels; i++) {
+            pcm32[i] = (FLAC__int32) src[i];
+        }
+
+        mFillingSegment->mNumSamples += n;
+        offset += n;
+
+        if (mFillingSegment->mNumSamples == mFillingSegment->mCapacity) {
+            queueFillingSegment();
+        }
+    }
+
+    return true;
+}
+
+void SoftFlacEncoder::queueFillingSegment() {
+    if (mFillingSegment == NULL) {
+        return;
+    }
+
+    // Every segment but the last holds whole blocks, so its encoder numbers
+    // its frames from 0 where the previous segment left off.
+    mFillingSegment->mFirstFrame = mNextFrameNumber;
+    mNextFrameNumber += mFillingSegment->mNumSamples / mBlockSize;
+
+    ALOGV("queueing segment of %zu samples at frame %u",
+          mFillingSegment->mNumSamples, mFillingSegment->mFirstFrame);
+
+    mSegments.push_back(mFillingSegment);
+    mSegmentEncoder->encode(mFillingSegment);
+    mFillingSegment = NULL;
+}
+
+bool SoftFlacEncoder::drainSegments(bool wait) {
+    List<BufferInfo *> &outQueue = getPortQueue(1);
+
+    while (!mSegments.empty() && !outQueue.empty()) {
+        FlacSegment *segment = *mSegments.begin();
+
+        if (wait) {
+            mSegmentEncoder->wait(segment);
+        } else if (!mSegmentEncoder->isDone(segment)) {
+            break;
+        }
+
+        if (!segment->mOk) {
+            ALOGE(" error encountered during encoding");
+            mSignalledError = true;
+            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+            return false;
+        }
+
+        const size_t numFrames = segment->mFrameEnds.size();
+        if (segment->mNumFramesOut < numFrames) {
+            BufferInfo *outInfo = *outQueue.begin();
+            OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
+
+            size_t filled = 0;
+#ifdef WRITE_FLAC_HEADER_IN_FIRST_BUFFER
+            if (!mWroteHeader) {
+                ALOGI(" writing %d bytes of header on output port", mHeaderOffset);
+                memcpy(outHeader->pBuffer, mHeader, mHeaderOffset);
+                filled = mHeaderOffset;
+                mWroteHeader = true;
+            }
+#endif
+
+            // as many whole frames as fit
+            size_t first = segment->mNumFramesOut;
+            size_t start = (first == 0) ? 0 : segment->mFrameEnds[first - 1];
+            size_t last = first;
+            while (last < numFrames
+                    && filled + segment->mFrameEnds[last] - start <= outHeader->nAllocLen) {
+                ++last;
+            }
+
+            if (last == first) {
+                ALOGE("encoded frame of %zu bytes does not fit the output buffer",
+                      segment->mFrameEnds[first] - start);
+                mSignalledError = true;
+                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+                return false;
+            }
+
+            size_t size = segment->mFrameEnds[last - 1] - start;
+            memcpy(outHeader->pBuffer + filled, segment->mData.array() + start, size);
+
+            outHeader->nOffset = 0;
+            outHeader->nFilledLen = filled + size;
+            outHeader->nTimeStamp = segment->mTimeUs
+                + ((int64_t)first * mBlockSize * 1000000ll) / mSampleRate;
+            outHeader->nFlags = 0;
+
+            ALOGV(" writing %zu frames (%zu bytes) on output port", last - first, size);
+
+            outQueue.erase(outQueue.begin());
+            outInfo->mOwnedByUs = false;
+            notifyFillBufferDone(outHeader);
+
+            segment->mNumFramesOut = last;
+        }
+
+        if (segment->mNumFramesOut == numFrames) {
+            mSegments.erase(mSegments.begin());
+            mFreeSegments.push_back(segment);
+        }
+    }
+
+    return true;
+}
+
+// Drops the input that was not written out yet.
+void SoftFlacEncoder::flushSegments() {
+    if (mSegmentEncoder == NULL) {
+        return;
+    }
+
+    while (!mSegments.empty()) {
+        FlacSegment *segment = *mSegments.begin();
+        mSegmentEncoder->wait(segment);
+        mSegments.erase(mSegments.begin());
+        mFreeSegments.push_back(segment);
+    }
+
+    if (mFillingSegment != NULL) {
+        mFreeSegments.push_back(mFillingSegment);
+        mFillingSegment = NULL;
+    }
+
+    mSawInputEOS = false;
+    mSignalledOutputEOS = false;
+}
+
+void SoftFlacEncoder::onPortFlushCompleted(OMX_U32 portIndex) {
+    if (portIndex == 0) {
+        flushSegments();
+    }
+}
+
+void SoftFlacEncoder::onReset() {
+    flushSegments();
+    mNextFrameNumber = 0;
+}
+
+
 FLAC__StreamEncoderWriteStatus SoftFlacEncoder::onEncodedFlacAvailable(
             const FLAC__byte buffer[],
             size_t bytes, unsigned samples, unsigned current_frame) {
@@ -413,6 +720,9 @@ OMX_ERRORTYPE SoftFlacEncoder::configureEncoder() {
         return OMX_ErrorInvalidState;
     }
 
+    // set again below once the encoder is initialized
+    mBlockSize = 0;
+
     FLAC__bool ok = true;
     FLAC__StreamEncoderInitStatus initStatus = FLAC__STREAM_ENCODER_INIT_STATUS_OK;
     ok = ok && FLAC__stream_encoder_set_channels(mFlacStreamEncoder, mNumChannels);
@@ -431,6 +741,36 @@ OMX_ERRORTYPE SoftFlacEncoder::configureEncoder() {
                     NULL /*metadata_callback*/,
                     (void *) this /*client_data*/);
 
+    if (ok && mSegmentEncoder != NULL) {
+        // segments hold whole frames, the blocksize comes with the level
+        mBlockSize = FLAC__stream_encoder_get_blocksize(mFlacStreamEncoder);
+
+        // With loose mid-side stereo (levels 1 and 4) libFLAC only tries
+        // all channel assignments every 0.4s worth of frames and keeps the
+        // last one in between. Segments start on such a frame, where a
+        // single encoder has no state to carry over either.
+        mFramesPerSegment = kNumFramesPerSegment;
+        if (mNumChannels == 2
+                && FLAC__stream_encoder_get_do_mid_side_stereo(mFlacStreamEncoder)
+                && FLAC__stream_encoder_get_loose_mid_side_stereo(mFlacStreamEncoder)) {
+            unsigned interval =
+                (unsigned)((double)mSampleRate * 0.4 / mBlockSize + 0.5);
+            if (interval == 0) {
+                interval = 1;
+            }
+            mFramesPerSegment =
+                ((kNumFramesPerSegment + interval - 1) / interval) * interval;
+        }
+
+        mSegmentEncoder->configure(mNumChannels, mSampleRate, mCompressionLevel);
+
+        for (List<FlacSegment *>::iterator it = mFreeSegments.begin();
+                it != mFreeSegments.end(); ++it) {
+            delete *it;
+        }
+        mFreeSegments.clear();
+    }
+
 return_result:
     if (ok) {
         ALOGV("encoder successfully configured");
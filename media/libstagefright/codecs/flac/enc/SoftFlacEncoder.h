@@ -22,6 +22,8 @@
 
 #include "FLAC/stream_encoder.h"
 
+#include "FlacSegmentEncoder.h"
+
 // use this symbol to have the first output buffer start with FLAC frame header so a dump of
 // all the output buffers can be opened as a .flac file
 //#define WRITE_FLAC_HEADER_IN_FIRST_BUFFER
@@ -46,6 +48,8 @@ protected:
             OMX_INDEXTYPE index, const OMX_PTR params);
 
     virtual void onQueueFilled(OMX_U32 portIndex);
+    virtual void onPortFlushCompleted(OMX_U32 portIndex);
+    virtual void onReset();
 
 private:
 
@@ -54,6 +58,11 @@ private:
         kMaxNumSamplesPerFrame = 1152,
         kMaxInputBufferSize = kMaxNumSamplesPerFrame * sizeof(int16_t) * 2,
         kMaxOutputBufferSize = 65536,    //TODO check if this can be reduced
+        kMaxNumThreads = 8,
+        // minimum FLAC frames per segment in the multi-threaded mode
+        kNumFramesPerSegment = 16,
+        // segments being encoded or waiting for output buffers, per thread
+        kMaxNumSegmentsPerThread = 2,
     };
 
     bool mSignalledError;
@@ -70,10 +79,30 @@ private:
 
     FLAC__StreamEncoder* mFlacStreamEncoder;
 
+    // Multi-threaded mode: the input is cut into segments of
+    // mFramesPerSegment frames that the threads of mSegmentEncoder
+    // encode in parallel, mFlacStreamEncoder only provides the stream header.
+    size_t mNumThreads;
+    unsigned mBlockSize;        // 0 until the encoder is configured
+    unsigned mFramesPerSegment;
+    FlacSegmentEncoder *mSegmentEncoder;
+    FlacSegment *mFillingSegment;
+    List<FlacSegment *> mSegments;      // queued to mSegmentEncoder, in order
+    List<FlacSegment *> mFreeSegments;
+    unsigned mNextFrameNumber;
+    bool mSawInputEOS;
+    bool mSignalledOutputEOS;
+
     void initPorts();
 
     OMX_ERRORTYPE configureEncoder();
 
+    void onQueueFilledSegmented();
+    bool appendToSegment(const OMX_S16 *pcm16, size_t numFrames, OMX_TICKS timeUs);
+    void queueFillingSegment();
+    bool drainSegments(bool wait);
+    void flushSegments();
+
     // FLAC encoder callbacks
     // maps to encoderEncodeFlac()
     static FLAC__StreamEncoderWriteStatus flacEncoderWriteCallback(
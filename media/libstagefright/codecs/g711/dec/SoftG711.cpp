@@ -19,6 +19,7 @@
 #include <utils/Log.h>
 
 #include "SoftG711.h"
+#include "SoftAudioBatch.h"
 
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaDefs.h>
@@ -249,6 +250,51 @@ void SoftG711::onQueueFilled(OMX_U32 portIndex) {
     }
 }
 
+status_t SoftG711::decodeBatch(SoftAudioBatch *batch) {
+    if (batch->mChannelCount > 0) {
+        mNumChannels = batch->mChannelCount;
+    }
+
+    batch->mSampleRate = 8000;
+    batch->mNumChannels = mNumChannels;
+
+    int16_t scratch[kMaxNumSamplesPerFrame];
+
+    const uint8_t *data = batch->mData;
+    for (size_t i = 0; i < batch->mNumUnits; data += batch->mSizes[i++]) {
+        if (i < batch->mNumConfigUnits) {
+            // nothing in there this decoder needs
+            continue;
+        }
+
+        size_t offset = 0;
+
+        while (offset < batch->mSizes[i]) {
+            size_t n = batch->mSizes[i] - offset;
+            if (n > kMaxNumSamplesPerFrame) {
+                n = kMaxNumSamplesPerFrame;
+            }
+
+            int16_t *outPtr = static_cast<int16_t *>(
+                    batch->outputBuffer(n * sizeof(int16_t), scratch));
+
+            if (mIsMLaw) {
+                DecodeMLaw(outPtr, data + offset, n);
+            } else {
+                DecodeALaw(outPtr, data + offset, n);
+            }
+
+            offset += n;
+
+            if (!batch->append(outPtr, n * sizeof(int16_t))) {
+                return OK;
+            }
+        }
+    }
+
+    return OK;
+}
+
 // static
 void SoftG711::DecodeALaw(
         int16_t *out, const uint8_t *in, size_t inSize) {
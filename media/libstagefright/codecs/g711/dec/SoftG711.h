@@ -28,6 +28,8 @@ struct SoftG711 : public SimpleSoftOMXComponent {
             OMX_PTR appData,
             OMX_COMPONENTTYPE **component);
 
+    virtual status_t decodeBatch(SoftAudioBatch *batch);
+
 protected:
     virtual ~SoftG711();
 
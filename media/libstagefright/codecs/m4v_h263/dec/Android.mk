@@ -73,3 +73,26 @@ LOCAL_MODULE := libstagefright_soft_mpeg4dec
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
+
+################################################################################
+# test utility: decoder
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := test/DecTestBench.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/src \
+	$(LOCAL_PATH)/include \
+	$(TOP)/frameworks/av/media/libstagefright/include
+
+LOCAL_CFLAGS := -DOSCL_EXPORT_REF= -DOSCL_IMPORT_REF=
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_m4vh263dec
+
+LOCAL_MODULE := m4vh263_decoder
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
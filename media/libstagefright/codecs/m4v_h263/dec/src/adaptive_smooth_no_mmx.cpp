@@ -172,6 +172,10 @@
 #include    "post_proc.h"
 #include    "mp4def.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define OSCL_DISABLE_WARNING_CONV_POSSIBLE_LOSS_OF_DATA
 
 /*----------------------------------------------------------------------------
@@ -190,6 +194,10 @@
 ; LOCAL FUNCTION DEFINITIONS
 ; Function Prototype declaration
 ----------------------------------------------------------------------------*/
+#if defined(PV_POSTPROC_ON) && defined(__SSE2__)
+static void AdaptiveSmoothSSE2(uint8 *Rec_Y, int y_start, int x_start,
+                               int y_blk_start, int thr, int width, int max_diff);
+#endif
 
 /*----------------------------------------------------------------------------
 ; LOCAL STORE/BUFFER/POINTER DEFINITIONS
@@ -243,6 +251,15 @@ void AdaptiveSmooth_NoMMX(
     /*----------------------------------------------------------------------------
     ; Function body here
     ----------------------------------------------------------------------------*/
+#if defined(__SSE2__)
+    /* all but the blocks on the left picture edge are 8 pixels wide */
+    if (x_blk_start - x_start == 1)
+    {
+        AdaptiveSmoothSSE2(Rec_Y, y_start, x_start, y_blk_start, thr, width, max_diff);
+        return;
+    }
+#endif
+
     /*  first row
     */
     addr_v = (int32)(y_start + 1) * width;  /* y coord of 1st element in the row  /
@@ -418,4 +435,74 @@ void AdaptiveSmooth_NoMMX(
     ----------------------------------------------------------------------------*/
     return;
 }
+
+#if defined(__SSE2__)
+/* AdaptiveSmooth_NoMMX() on a region 8 pixels wide, one row at a time. Each
+   output only depends on the unfiltered 3x3 neighbourhood, so the unfiltered
+   rows above and at the current row are kept in registers as the C code keeps
+   them in oldrow[]. v0, v1, v2 and the flags are the columns left of, at and
+   right of each pixel. */
+static void AdaptiveSmoothSSE2(uint8 *Rec_Y, int y_start, int x_start,
+                               int y_blk_start, int thr, int width, int max_diff)
+{
+    __m128i pelu[3], pelc[3], pell[3];
+    __m128i v[3], all_ge[3], any_ge[3];
+    __m128i sum, mask, md;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i thr1 = _mm_set1_epi16(thr - 1);
+    uint8 *Rec_Y_ptr;
+    int row_cntr, k;
+
+    md = _mm_set1_epi16(max_diff);
+    Rec_Y_ptr = &Rec_Y[(int32)y_start * width + x_start];
+
+    for (k = 0; k < 3; k++)
+    {
+        pelu[k] = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(Rec_Y_ptr + k)), zero);
+        pelc[k] = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(Rec_Y_ptr + width + k)), zero);
+    }
+
+    for (row_cntr = (y_blk_start + BLKSIZE - 1) - y_start; row_cntr > 0; row_cntr--)
+    {
+        Rec_Y_ptr += width;
+
+        for (k = 0; k < 3; k++)
+        {
+            pell[k] = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(Rec_Y_ptr + width + k)), zero);
+
+            /* weighted vertical sums and INDEX(, thr) of the three pixels */
+            v[k] = _mm_add_epi16(_mm_add_epi16(pelu[k], pell[k]), _mm_slli_epi16(pelc[k], 1));
+            all_ge[k] = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi16(pelu[k], thr1),
+                                                   _mm_cmpgt_epi16(pelc[k], thr1)),
+                                     _mm_cmpgt_epi16(pell[k], thr1));
+            any_ge[k] = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi16(pelu[k], thr1),
+                                                 _mm_cmpgt_epi16(pelc[k], thr1)),
+                                    _mm_cmpgt_epi16(pell[k], thr1));
+        }
+
+        /* sum1 == 9 or sum1 == 0 */
+        mask = _mm_or_si128(_mm_and_si128(_mm_and_si128(all_ge[0], all_ge[1]), all_ge[2]),
+                            _mm_andnot_si128(_mm_or_si128(_mm_or_si128(any_ge[0], any_ge[1]), any_ge[2]),
+                                             _mm_cmpeq_epi16(zero, zero)));
+
+        sum = _mm_add_epi16(_mm_add_epi16(v[0], v[2]), _mm_slli_epi16(v[1], 1));
+        sum = _mm_srai_epi16(_mm_add_epi16(sum, _mm_set1_epi16(8)), 4);
+
+        /* limit the change to max_diff */
+        sum = _mm_min_epi16(sum, _mm_add_epi16(pelc[1], md));
+        sum = _mm_max_epi16(sum, _mm_sub_epi16(pelc[1], md));
+
+        sum = _mm_or_si128(_mm_and_si128(mask, sum), _mm_andnot_si128(mask, pelc[1]));
+        _mm_storel_epi64((__m128i*)(Rec_Y_ptr + 1), _mm_packus_epi16(sum, sum));
+
+        for (k = 0; k < 3; k++)
+        {
+            pelu[k] = pelc[k];
+            pelc[k] = pell[k];
+        }
+    }
+
+    return;
+}
+#endif /* __SSE2__ */
 #endif
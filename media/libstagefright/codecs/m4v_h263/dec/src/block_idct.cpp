@@ -103,6 +103,10 @@
 #include "idct.h"
 #include "motion_comp.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define OSCL_DISABLE_WARNING_CONV_POSSIBLE_LOSS_OF_DATA
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -120,9 +124,15 @@
 ; Function Prototype declaration
 ----------------------------------------------------------------------------*/
 /* private prototypes */
+#if !defined(__SSE2__)
 static void idctrow(int16 *blk, uint8 *pred, uint8 *dst, int width);
 static void idctrow_intra(int16 *blk, PIXEL *, int width);
 static void idctcol(int16 *blk);
+#endif
+
+#if defined(FAST_IDCT) && defined(__SSE2__)
+static void IdctSSE2(int16 *blk, __m128i *out);
+#endif
 
 #ifdef FAST_IDCT
 // mapping from nz_coefs to functions to be used
@@ -258,8 +268,10 @@ void BlockIDCT_intra(
 #ifdef FAST_IDCT  /* VCA IDCT using nzcoefs and bitmaps*/
     int i, bmapr;
     int nz_coefs = mblock->no_coeff[comp];
+#if !defined(__SSE2__)
     uint8 *bitmapcol = mblock->bitmapcol[comp];
     uint8 bitmaprow = mblock->bitmaprow[comp];
+#endif
 
     /*----------------------------------------------------------------------------
     ; Function body here
@@ -277,6 +289,16 @@ void BlockIDCT_intra(
     }
     else
     {
+#if defined(__SSE2__)
+        __m128i out[8];
+
+        IdctSSE2(coeff_in, out);
+        for (i = 0; i < 8; i++)
+        {
+            _mm_storel_epi64((__m128i*)c_comp, _mm_packus_epi16(out[i], out[i]));
+            c_comp += width;
+        }
+#else
         i = 8;
         while (i--)
         {
@@ -302,6 +324,7 @@ void BlockIDCT_intra(
         {
             idctrow_intra(coeff_in, c_comp, width);
         }
+#endif
     }
 #else
     void idct_intra(int *block, uint8 *comp, int width);
@@ -374,6 +397,19 @@ void BlockIDCT(
     }
     else
     {
+#if defined(__SSE2__)
+        __m128i out[8];
+        const __m128i zero = _mm_setzero_si128();
+
+        IdctSSE2(coeff_in, out);
+        for (i = 0; i < 8; i++)
+        {
+            out[i] = _mm_adds_epi16(out[i], _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)pred), zero));
+            _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(out[i], out[i]));
+            pred += 16;
+            dst += width;
+        }
+#else
         i = 8;
 
         while (i--)
@@ -399,6 +435,7 @@ void BlockIDCT(
         {
             idctrow(coeff_in, pred, dst, width);
         }
+#endif
         return ;
     }
 #else // FAST_IDCT
@@ -503,6 +540,7 @@ void BlockIDCT(
 ------------------------------------------------------------------------------
 */
 
+#if !defined(__SSE2__)
 /*----------------------------------------------------------------------------
 ; Function Code FOR idctrow
 ----------------------------------------------------------------------------*/
@@ -733,6 +771,7 @@ void idctrow_intra(
     ----------------------------------------------------------------------------*/
     return;
 }
+#endif /* __SSE2__ */
 
 /*----------------------------------------------------------------------------
 ; End Function: idctrow
@@ -824,6 +863,7 @@ void idctrow_intra(
 ------------------------------------------------------------------------------
 */
 
+#if !defined(__SSE2__)
 /*----------------------------------------------------------------------------
 ; Function Code FOR idctcol
 ----------------------------------------------------------------------------*/
@@ -905,7 +945,174 @@ void idctcol(
     ----------------------------------------------------------------------------*/
     return;
 }
+#endif /* __SSE2__ */
 /*----------------------------------------------------------------------------
 ;  End Function: idctcol
 ----------------------------------------------------------------------------*/
 
+
+#if defined(FAST_IDCT) && defined(__SSE2__)
+/* SSE2 version of idctcol() followed by idctrow(), all 8 columns (rows) are
+   transformed at once in 16-bit lanes with 32-bit intermediates. The products
+   are taken with pmaddwd from the expanded forms of the C code, e.g.
+   W7 * (x4 + x5) + (W1 - W7) * x4 as W1 * x4 + W7 * x5, so the output is
+   identical to that of the sparse C functions. */
+
+#define PAIR_EPI16(a, b)    _mm_set_epi16(b, a, b, a, b, a, b, a)
+
+/* 181 * x, wrapping around in 32 bits like the C code */
+static inline __m128i Mul181Epi32(__m128i x)
+{
+    __m128i y;
+
+    y = _mm_add_epi32(x, _mm_slli_epi32(x, 2));
+    y = _mm_add_epi32(y, _mm_slli_epi32(x, 4));
+    y = _mm_add_epi32(y, _mm_slli_epi32(x, 5));
+
+    return _mm_add_epi32(y, _mm_slli_epi32(x, 7));
+}
+
+/* one 1-D transform on 4 lanes, the inputs are interleaved in pairs
+   (blk[0], blk[4]), (blk[6], blk[2]), (blk[1], blk[7]) and (blk[5], blk[3]).
+   row selects the rounding of idctrow() instead of idctcol(). */
+static inline void IdctHalfSSE2(__m128i p04, __m128i p26, __m128i p17, __m128i p53,
+                                __m128i *out, int row)
+{
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    if (row)
+    {
+        const __m128i rnd = _mm_set1_epi32(4);
+
+        x8 = _mm_add_epi32(_mm_madd_epi16(p04, PAIR_EPI16(256, 256)), _mm_set1_epi32(8192));
+        x0 = _mm_add_epi32(_mm_madd_epi16(p04, PAIR_EPI16(256, -256)), _mm_set1_epi32(8192));
+
+        /* first stage */
+        x4 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p17, PAIR_EPI16(W1, W7)), rnd), 3);
+        x5 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p17, PAIR_EPI16(W7, -W1)), rnd), 3);
+        x6 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p53, PAIR_EPI16(W5, W3)), rnd), 3);
+        x7 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p53, PAIR_EPI16(W3, -W5)), rnd), 3);
+        x2 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p26, PAIR_EPI16(-W2, W6)), rnd), 3);
+        x3 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(p26, PAIR_EPI16(W6, W2)), rnd), 3);
+    }
+    else
+    {
+        const __m128i rnd = _mm_set1_epi32(128);
+
+        x8 = _mm_add_epi32(_mm_madd_epi16(p04, PAIR_EPI16(2048, 2048)), rnd);
+        x0 = _mm_add_epi32(_mm_madd_epi16(p04, PAIR_EPI16(2048, -2048)), rnd);
+
+        /* first stage */
+        x4 = _mm_madd_epi16(p17, PAIR_EPI16(W1, W7));
+        x5 = _mm_madd_epi16(p17, PAIR_EPI16(W7, -W1));
+        x6 = _mm_madd_epi16(p53, PAIR_EPI16(W5, W3));
+        x7 = _mm_madd_epi16(p53, PAIR_EPI16(W3, -W5));
+        x2 = _mm_madd_epi16(p26, PAIR_EPI16(-W2, W6));
+        x3 = _mm_madd_epi16(p26, PAIR_EPI16(W6, W2));
+    }
+
+    /* second stage */
+    x1 = _mm_add_epi32(x4, x6);
+    x4 = _mm_sub_epi32(x4, x6);
+    x6 = _mm_add_epi32(x5, x7);
+    x5 = _mm_sub_epi32(x5, x7);
+
+    /* third stage */
+    x7 = _mm_add_epi32(x8, x3);
+    x8 = _mm_sub_epi32(x8, x3);
+    x3 = _mm_add_epi32(x0, x2);
+    x0 = _mm_sub_epi32(x0, x2);
+    x2 = _mm_srai_epi32(_mm_add_epi32(Mul181Epi32(_mm_add_epi32(x4, x5)), _mm_set1_epi32(128)), 8);
+    x4 = _mm_srai_epi32(_mm_add_epi32(Mul181Epi32(_mm_sub_epi32(x4, x5)), _mm_set1_epi32(128)), 8);
+
+    /* fourth stage */
+    out[0] = _mm_add_epi32(x7, x1);
+    out[1] = _mm_add_epi32(x3, x2);
+    out[2] = _mm_add_epi32(x0, x4);
+    out[3] = _mm_add_epi32(x8, x6);
+    out[4] = _mm_sub_epi32(x8, x6);
+    out[5] = _mm_sub_epi32(x0, x4);
+    out[6] = _mm_sub_epi32(x3, x2);
+    out[7] = _mm_sub_epi32(x7, x1);
+}
+
+/* 1-D transform of 8 lanes in v[0..7], idctcol() keeps the low 16 bits of
+   (x >> 8), idctrow() returns x >> 14 saturated to 16 bits for the clipping */
+static inline void IdctPassSSE2(__m128i *v, int row)
+{
+    __m128i lo[8], hi[8];
+    int i;
+
+    IdctHalfSSE2(_mm_unpacklo_epi16(v[0], v[4]), _mm_unpacklo_epi16(v[6], v[2]),
+                 _mm_unpacklo_epi16(v[1], v[7]), _mm_unpacklo_epi16(v[5], v[3]), lo, row);
+    IdctHalfSSE2(_mm_unpackhi_epi16(v[0], v[4]), _mm_unpackhi_epi16(v[6], v[2]),
+                 _mm_unpackhi_epi16(v[1], v[7]), _mm_unpackhi_epi16(v[5], v[3]), hi, row);
+
+    for (i = 0; i < 8; i++)
+    {
+        if (row)
+        {
+            lo[i] = _mm_srai_epi32(lo[i], 14);
+            hi[i] = _mm_srai_epi32(hi[i], 14);
+        }
+        else
+        {
+            lo[i] = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(lo[i], 8), 16), 16);
+            hi[i] = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(hi[i], 8), 16), 16);
+        }
+        v[i] = _mm_packs_epi32(lo[i], hi[i]);
+    }
+}
+
+static inline void Transpose8x8Epi16(__m128i *v)
+{
+    __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    a0 = _mm_unpacklo_epi16(v[0], v[1]);
+    a1 = _mm_unpackhi_epi16(v[0], v[1]);
+    a2 = _mm_unpacklo_epi16(v[2], v[3]);
+    a3 = _mm_unpackhi_epi16(v[2], v[3]);
+    a4 = _mm_unpacklo_epi16(v[4], v[5]);
+    a5 = _mm_unpackhi_epi16(v[4], v[5]);
+    a6 = _mm_unpacklo_epi16(v[6], v[7]);
+    a7 = _mm_unpackhi_epi16(v[6], v[7]);
+
+    b0 = _mm_unpacklo_epi32(a0, a2);
+    b1 = _mm_unpackhi_epi32(a0, a2);
+    b2 = _mm_unpacklo_epi32(a1, a3);
+    b3 = _mm_unpackhi_epi32(a1, a3);
+    b4 = _mm_unpacklo_epi32(a4, a6);
+    b5 = _mm_unpackhi_epi32(a4, a6);
+    b6 = _mm_unpacklo_epi32(a5, a7);
+    b7 = _mm_unpackhi_epi32(a5, a7);
+
+    v[0] = _mm_unpacklo_epi64(b0, b4);
+    v[1] = _mm_unpackhi_epi64(b0, b4);
+    v[2] = _mm_unpacklo_epi64(b1, b5);
+    v[3] = _mm_unpackhi_epi64(b1, b5);
+    v[4] = _mm_unpacklo_epi64(b2, b6);
+    v[5] = _mm_unpackhi_epi64(b2, b6);
+    v[6] = _mm_unpacklo_epi64(b3, b7);
+    v[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/* 2-D IDCT of blk, out[i] gets row i of the residue before clipping. blk is
+   cleared for the next block like idctrow() does. */
+void IdctSSE2(int16 *blk, __m128i *out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        out[i] = _mm_loadu_si128((__m128i*)(blk + (i << 3)));
+        _mm_storeu_si128((__m128i*)(blk + (i << 3)), zero);
+    }
+
+    IdctPassSSE2(out, 0);  /* idctcol() */
+    Transpose8x8Epi16(out);
+    IdctPassSSE2(out, 1);  /* idctrow() */
+    Transpose8x8Epi16(out);
+}
+#endif
@@ -94,6 +94,10 @@ found and the location pointed to by max_ptr contains the maximum value found.
 #include    "mp4dec_lib.h"
 #include    "post_proc.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /*----------------------------------------------------------------------------
 ; MACROS
 ; Define module specific macros here
@@ -138,6 +142,33 @@ void  FindMaxMin(
     /*----------------------------------------------------------------------------
     ; Define all local variables
     ----------------------------------------------------------------------------*/
+#if defined(__SSE2__)
+    uint    i;
+    __m128i min, max, row;
+
+    /*----------------------------------------------------------------------------
+    ; Function body here
+    ----------------------------------------------------------------------------*/
+    max = min = _mm_loadl_epi64((__m128i*)input_ptr);
+    for (i = BLKSIZE - 1; i > 0; i--)
+    {
+        input_ptr += (incr + BLKSIZE);
+        row = _mm_loadl_epi64((__m128i*)input_ptr);
+        max = _mm_max_epu8(max, row);
+        min = _mm_min_epu8(min, row);
+    }
+
+    /* reduce the low 8 bytes */
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 4));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 2));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 2));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 1));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 1));
+
+    *max_ptr = _mm_cvtsi128_si32(max) & 0xFF;
+    *min_ptr = _mm_cvtsi128_si32(min) & 0xFF;
+#else
     register    uint    i, j;
     register    int min, max;
 
@@ -168,6 +199,7 @@ void  FindMaxMin(
 
     *max_ptr = max;
     *min_ptr = min;
+#endif /* __SSE2__ */
     /*----------------------------------------------------------------------------
     ; Return nothing or data or data pointer
     ----------------------------------------------------------------------------*/
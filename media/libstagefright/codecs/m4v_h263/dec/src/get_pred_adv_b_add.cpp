@@ -77,8 +77,117 @@
 #include "mp4dec_lib.h"
 #include "motion_comp.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define OSCL_DISABLE_WARNING_CONV_POSSIBLE_LOSS_OF_DATA
 
+#if defined(__SSE2__)
+/* Unaligned 8-byte loads replace the word-alignment cases of the C code.
+   pavgb gives (a + b + 1) >> 1 for rnd1 == 1, for rnd1 == 0 the rounding
+   bit (a ^ b) & 1 is taken off again. */
+
+int GetPredAdvancedBy0x0(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    uint    i;      /* loop variable */
+    int pred_width = pred_width_rnd >> 1;
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        _mm_storel_epi64((__m128i*)pred_block, _mm_loadl_epi64((__m128i*)prev));
+        prev += width;
+        pred_block += pred_width;
+    }
+
+    return 1;
+}
+
+/* average of prev[0] and prev[offset] for an 8x8 block */
+static inline void GetPredHalfPelSSE2(uint8 *prev, uint8 *pred_block, int width,
+                                      int pred_width_rnd, int offset)
+{
+    uint    i;      /* loop variable */
+    int pred_width = pred_width_rnd >> 1;
+    __m128i a, b, avg;
+    const __m128i rnd = _mm_set1_epi8((pred_width_rnd & 1) ^ 1);
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        a = _mm_loadl_epi64((__m128i*)prev);
+        b = _mm_loadl_epi64((__m128i*)(prev + offset));
+        avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), rnd));
+        _mm_storel_epi64((__m128i*)pred_block, avg);
+        prev += width;
+        pred_block += pred_width;
+    }
+
+    return ;
+}
+
+int GetPredAdvancedBy0x1(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    GetPredHalfPelSSE2(prev, pred_block, width, pred_width_rnd, 1);
+
+    return 1;
+}
+
+int GetPredAdvancedBy1x0(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    GetPredHalfPelSSE2(prev, pred_block, width, pred_width_rnd, width);
+
+    return 1;
+}
+
+/* (a + b + c + d + rnd1 + 1) >> 2 in 16-bit lanes, the horizontal sums of
+   each row are used twice */
+int GetPredAdvancedBy1x1(
+    uint8 *prev,        /* i */
+    uint8 *pred_block,      /* i */
+    int width,      /* i */
+    int pred_width_rnd /* i */
+)
+{
+    uint    i;      /* loop variable */
+    int pred_width = pred_width_rnd >> 1;
+    __m128i sum, sum_prev, res;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rnd = _mm_set1_epi16((pred_width_rnd & 1) + 1);
+
+    sum_prev = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)prev), zero),
+                             _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(prev + 1)), zero));
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        prev += width;
+        sum = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)prev), zero),
+                            _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(prev + 1)), zero));
+        res = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(sum_prev, sum), rnd), 2);
+        _mm_storel_epi64((__m128i*)pred_block, _mm_packus_epi16(res, res));
+        sum_prev = sum;
+        pred_block += pred_width;
+    }
+
+    return 1;
+}
+
+#else /* __SSE2__ */
+
 int GetPredAdvancedBy0x0(
     uint8 *prev,        /* i */
     uint8 *pred_block,      /* i */
@@ -1187,4 +1296,5 @@ int GetPredAdvancedBy1x1(
     }
 }
 
+#endif /* __SSE2__ */
 
@@ -24,6 +24,134 @@
 const static int STRENGTH_tab[] = {0, 1, 1, 2, 2, 3, 3, 4, 4, 4, 5, 5, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 10, 11, 11, 11, 12, 12, 12};
 #endif
 
+#if defined(PV_ANNEX_IJKT_SUPPORT) && defined(__SSE2__)
+#include <emmintrin.h>
+
+/* The filter of H263_Deblock() on 8 positions in 16-bit lanes, B and C are
+   the pixels next to the edge. The branches of the C code become
+   d1 = sign(d) * max(0, min(|d| >> 3, 2 * strength - (|d| >> 3))) and
+   d2 = sign(A - D) * min(|A - D| >> 2, |d1| >> 1). */
+static inline void DeblockFilterSSE2(__m128i *A, __m128i *B, __m128i *C, __m128i *D,
+                                     __m128i strength2)
+{
+    __m128i A_D, d, sign, sign2, d1, d1_2, d2;
+
+    A_D = _mm_sub_epi16(*A, *D);
+    d = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(*C, *B), 2), A_D);
+
+    sign = _mm_srai_epi16(d, 15);
+    d1 = _mm_srai_epi16(_mm_sub_epi16(_mm_xor_si128(d, sign), sign), 3);
+    d1 = _mm_max_epi16(_mm_min_epi16(d1, _mm_sub_epi16(strength2, d1)), _mm_setzero_si128());
+    d1_2 = _mm_srai_epi16(d1, 1);
+    d1 = _mm_sub_epi16(_mm_xor_si128(d1, sign), sign);
+
+    sign2 = _mm_srai_epi16(A_D, 15);
+    d2 = _mm_srai_epi16(_mm_sub_epi16(_mm_xor_si128(A_D, sign2), sign2), 2);
+    d2 = _mm_min_epi16(d2, d1_2);
+    d2 = _mm_sub_epi16(_mm_xor_si128(d2, sign2), sign2);
+
+    *A = _mm_sub_epi16(*A, d2);
+    *B = _mm_add_epi16(*B, d1);
+    *C = _mm_sub_epi16(*C, d1);
+    *D = _mm_add_epi16(*D, d2);
+}
+
+/* vertical filtering of n (8 or 16) pixels across the edge above rec_y */
+static void DeblockVertSSE2(uint8 *rec_y, int width, int n, int strength)
+{
+    __m128i A, B, C, D;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i strength2 = _mm_set1_epi16(strength << 1);
+
+    for (; n > 0; n -= 8)
+    {
+        A = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(rec_y - (width << 1))), zero);
+        B = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(rec_y - width)), zero);
+        C = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)rec_y), zero);
+        D = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(rec_y + width)), zero);
+
+        DeblockFilterSSE2(&A, &B, &C, &D, strength2);
+
+        _mm_storel_epi64((__m128i*)(rec_y - (width << 1)), _mm_packus_epi16(A, A));
+        _mm_storel_epi64((__m128i*)(rec_y - width), _mm_packus_epi16(B, B));
+        _mm_storel_epi64((__m128i*)rec_y, _mm_packus_epi16(C, C));
+        _mm_storel_epi64((__m128i*)(rec_y + width), _mm_packus_epi16(D, D));
+        rec_y += 8;
+    }
+}
+
+/* 4 pixels of two rows, interleaved */
+static inline __m128i LoadRowsSSE2(uint8 *ptr, int width)
+{
+    int32 row0, row1;
+
+    oscl_memcpy(&row0, ptr, 4);
+    oscl_memcpy(&row1, ptr + width, 4);
+
+    return _mm_unpacklo_epi8(_mm_cvtsi32_si128(row0), _mm_cvtsi32_si128(row1));
+}
+
+/* horizontal filtering of n (8 or 16) rows across the edge left of rec_y,
+   the 4 pixels of 8 rows are transposed into A, B, C, D and back */
+static void DeblockHorzSSE2(uint8 *rec_y, int width, int n, int strength)
+{
+    __m128i A, B, C, D, r0, r1, r2, r3;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i strength2 = _mm_set1_epi16(strength << 1);
+    uint8 *ptr;
+    int32 row;
+    int i;
+
+    for (; n > 0; n -= 8)
+    {
+        ptr = rec_y - 2;
+        r0 = LoadRowsSSE2(ptr, width);
+        ptr += (width << 1);
+        r1 = LoadRowsSSE2(ptr, width);
+        ptr += (width << 1);
+        r2 = LoadRowsSSE2(ptr, width);
+        ptr += (width << 1);
+        r3 = LoadRowsSSE2(ptr, width);
+
+        r0 = _mm_unpacklo_epi16(r0, r1);    /* A0..A3 B0..B3 C0..C3 D0..D3 */
+        r2 = _mm_unpacklo_epi16(r2, r3);    /* A4..A7 B4..B7 C4..C7 D4..D7 */
+        r1 = _mm_unpacklo_epi32(r0, r2);    /* A0..A7 B0..B7 */
+        r3 = _mm_unpackhi_epi32(r0, r2);    /* C0..C7 D0..D7 */
+
+        A = _mm_unpacklo_epi8(r1, zero);
+        B = _mm_unpackhi_epi8(r1, zero);
+        C = _mm_unpacklo_epi8(r3, zero);
+        D = _mm_unpackhi_epi8(r3, zero);
+
+        DeblockFilterSSE2(&A, &B, &C, &D, strength2);
+
+        r1 = _mm_packus_epi16(A, B);
+        r3 = _mm_packus_epi16(C, D);
+        r1 = _mm_unpacklo_epi8(r1, _mm_srli_si128(r1, 8));  /* A0 B0 A1 B1 .. */
+        r3 = _mm_unpacklo_epi8(r3, _mm_srli_si128(r3, 8));  /* C0 D0 C1 D1 .. */
+        r0 = _mm_unpacklo_epi16(r1, r3);    /* rows 0..3 */
+        r2 = _mm_unpackhi_epi16(r1, r3);    /* rows 4..7 */
+
+        ptr = rec_y - 2;
+        for (i = 4; i > 0; i--)
+        {
+            row = _mm_cvtsi128_si32(r0);
+            oscl_memcpy(ptr, &row, 4);
+            r0 = _mm_srli_si128(r0, 4);
+            ptr += width;
+        }
+        for (i = 4; i > 0; i--)
+        {
+            row = _mm_cvtsi128_si32(r2);
+            oscl_memcpy(ptr, &row, 4);
+            r2 = _mm_srli_si128(r2, 4);
+            ptr += width;
+        }
+        rec_y += (width << 3);
+    }
+}
+#endif
+
 #ifdef PV_POSTPROC_ON
 /*----------------------------------------------------------------------------
 ; FUNCTION CODE
@@ -173,6 +301,131 @@ void PostFilter(
 
 
 #ifdef PV_ANNEX_IJKT_SUPPORT
+#if defined(__SSE2__)
+void H263_Deblock(uint8 *rec,
+                  int width,
+                  int height,
+                  int16 *QP_store,
+                  uint8 *mode,
+                  int chr, int annex_T)
+{
+    /*----------------------------------------------------------------------------
+    ; Define all local variables
+    ----------------------------------------------------------------------------*/
+    int i, j;
+    uint8 *rec_y;
+    int mbnum, strength, b_size;
+    int nMBPerRow, nMBPerCol;
+
+    if (chr)
+    {
+        nMBPerRow = width >> 3;
+        nMBPerCol = height >> 3;
+        b_size = 8;
+    }
+    else
+    {
+        nMBPerRow = width >> 4;
+        nMBPerCol = height >> 4;
+        b_size = 16;
+    }
+
+    /********************************* VERTICAL FILTERING ****************************/
+    /* vertical filtering of mid sections no need to check neighboring QP's etc */
+    if (!chr)
+    {
+        rec_y = rec + (width << 3);
+        mbnum = 0;
+        for (i = 0; i < nMBPerCol; i++)
+        {
+            for (j = 0; j < nMBPerRow; j++)
+            {
+                if (mode[mbnum] != MODE_SKIPPED)
+                {
+                    DeblockVertSSE2(rec_y, width, 16, STRENGTH_tab[QP_store[mbnum]]);
+                }
+                rec_y += b_size;
+                mbnum++;
+            }
+            rec_y += (15 * width);
+        }
+    }
+
+    /* VERTICAL boundary blocks */
+    rec_y = rec + width * b_size;
+    mbnum = nMBPerRow;
+    for (i = 0; i < nMBPerCol - 1; i++)
+    {
+        for (j = 0; j < nMBPerRow; j++)
+        {
+            if (mode[mbnum] != MODE_SKIPPED || mode[mbnum - nMBPerRow] != MODE_SKIPPED)
+            {
+                if (mode[mbnum] != MODE_SKIPPED)
+                {
+                    strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum]] : QP_store[mbnum])];
+                }
+                else
+                {
+                    strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum - nMBPerRow]] : QP_store[mbnum - nMBPerRow])];
+                }
+                DeblockVertSSE2(rec_y, width, b_size, strength);
+            }
+            rec_y += b_size;
+            mbnum++;
+        }
+        rec_y += ((b_size - 1) * width);
+    }
+
+    /***************************HORIZONTAL FILTERING ********************************************/
+    /* HORIZONTAL INNER */
+    if (!chr)
+    {
+        rec_y = rec + 8;
+        mbnum = 0;
+        for (i = 0; i < nMBPerCol; i++)
+        {
+            for (j = 0; j < nMBPerRow; j++)
+            {
+                if (mode[mbnum] != MODE_SKIPPED)
+                {
+                    DeblockHorzSSE2(rec_y, width, 16, STRENGTH_tab[QP_store[mbnum]]);
+                }
+                rec_y += b_size;
+                mbnum++;
+            }
+            rec_y += (15 * width);
+        }
+    }
+
+    /* HORIZONTAL EDGE */
+    rec_y = rec + b_size;
+    mbnum = 1;
+    for (i = 0; i < nMBPerCol; i++)
+    {
+        for (j = 0; j < nMBPerRow - 1; j++)
+        {
+            if (mode[mbnum] != MODE_SKIPPED || mode[mbnum-1] != MODE_SKIPPED)
+            {
+                if (mode[mbnum] != MODE_SKIPPED)
+                {
+                    strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum]] : QP_store[mbnum])];
+                }
+                else
+                {
+                    strength = STRENGTH_tab[(annex_T ?  MQ_chroma_QP_table[QP_store[mbnum - 1]] : QP_store[mbnum - 1])];
+                }
+                DeblockHorzSSE2(rec_y, width, b_size, strength);
+            }
+            rec_y += b_size;
+            mbnum++;
+        }
+        rec_y += ((width * (b_size - 1)) + b_size);
+        mbnum++;
+    }
+
+    return;
+}
+#else /* __SSE2__ */
 void H263_Deblock(uint8 *rec,
                   int width,
                   int height,
@@ -581,5 +834,6 @@ void H263_Deblock(uint8 *rec,
 
     return;
 }
+#endif /* __SSE2__ */
 #endif
 
@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Decoder test bench for MPEG-4 part 2 / H.263 elementary streams. Decodes
+ * the stream, optionally several times over, and reports the frame rate of
+ * the decoding and post-processing calls alone, reading and writing the
+ * files not included. */
+
+#include "mp4dec_api.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEBUG(argv) printf argv
+
+/* the size SoftMPEG4 starts with, H.263 streams are decoded again at the
+ * size of their first picture header if it differs */
+#define DEFAULT_WIDTH   352
+#define DEFAULT_HEIGHT  288
+
+#define MAX_NUM_FRAMES  100000
+
+/* start of each frame in the stream, the MPEG-4 configuration (VOS and VOL
+ * headers) is the data in front of the first frame */
+static int32 frameStart[MAX_NUM_FRAMES + 1];
+static int32 numFrames = 0;
+
+/*------------------------------------------------------------------------------
+
+    Function name:  FindFrames
+
+    Purpose:
+        Splits the stream into frames. MPEG-4 frames start with a VOP start
+        code, or with a GOV header followed by one. H.263 frames start with
+        a picture start code, assumed to be byte aligned as the decoder does.
+
+------------------------------------------------------------------------------*/
+static void FindFrames(uint8 *strm, int32 size, int h263)
+{
+    int32 i;
+    int lastWasGov = 0;
+
+    for (i = 0; i + 3 < size && numFrames < MAX_NUM_FRAMES; i++)
+    {
+        if (strm[i] != 0 || strm[i + 1] != 0)
+            continue;
+
+        if (h263)
+        {
+            if ((strm[i + 2] & 0xfc) == 0x80)
+                frameStart[numFrames++] = i;
+        }
+        else if (strm[i + 2] == 0x01)
+        {
+            if (strm[i + 3] == 0xb3)
+            {
+                frameStart[numFrames++] = i;
+                lastWasGov = 1;
+            }
+            else if (strm[i + 3] == 0xb6)
+            {
+                if (!lastWasGov)
+                    frameStart[numFrames++] = i;
+                lastWasGov = 0;
+            }
+        }
+    }
+    frameStart[numFrames] = size;
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  InitDecoder
+
+    Purpose:
+        Initializes the decoder for the stream and returns the size of its
+        frame buffers, 0 on error.
+
+------------------------------------------------------------------------------*/
+static int32 InitDecoder(VideoDecControls *decCtrl, uint8 *strm, int h263,
+    int32 width, int32 height, int postProcType)
+{
+    uint8 *volData[1];
+    int32 volSize = 0;
+    int32 bufWidth, bufHeight;
+
+    volData[0] = NULL;
+    if (!h263)
+    {
+        volData[0] = strm;
+        volSize = frameStart[0];
+    }
+
+    memset(decCtrl, 0, sizeof(*decCtrl));
+    if (!PVInitVideoDecoder(decCtrl, volData, &volSize, 1, width, height,
+            h263 ? H263_MODE : MPEG4_MODE))
+        return 0;
+
+    PVSetPostProcType(decCtrl, postProcType);
+    PVGetBufferDimensions(decCtrl, &bufWidth, &bufHeight);
+
+    return bufWidth * bufHeight * 3 / 2;
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  main
+
+    Purpose:
+        main function of decoder testbench. Provides command line interface
+        with file I/O for the MPEG-4 / H.263 decoder. Prints out the usage
+        information when executed without arguments.
+
+------------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    int i;
+    int h263 = 0;
+    int postProcType = PV_NO_POST_PROC;
+    int numPasses = 1;
+    int32 maxNumPics = 0;
+    char outFileName[256] = "";
+
+    FILE *finput;
+    FILE *foutput = NULL;
+    uint8 *strm;
+    int32 strmLen;
+
+    VideoDecControls decCtrl;
+    uint8 *frames[2];
+    uint8 *postFrame = NULL;
+    uint8 *outFrame;
+    int32 width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT;
+    int32 frameSize, bufWidth, bufHeight;
+    int32 pass, pic, numPics = 0;
+    int cur;
+
+    struct timespec startTime, endTime;
+    double decodeTimeMs = 0.0;
+
+    if (argc < 2)
+    {
+        DEBUG(("Usage: %s [-H] [-Nn] [-Ln] [-Pn] [-Ooutfile] file.m4v\n",
+            argv[0]));
+        DEBUG(("\t-H the stream is H.263 (default MPEG-4 part 2)\n"));
+        DEBUG(("\t-Nn forces decoding to stop after n pictures\n"));
+        DEBUG(("\t-Ln decodes the stream n times over, for timing\n"));
+        DEBUG(("\t-Pn post-processing: 0 none, 1 deblocking, 2 deringing,"
+            " 3 both\n"));
+        DEBUG(("\t-Ooutfile write the output of the first pass to "
+            "\"outfile\"\n"));
+        return 0;
+    }
+
+    /* read command line arguments */
+    for (i = 1; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i], "-H") == 0)
+            h263 = 1;
+        else if (strncmp(argv[i], "-N", 2) == 0)
+            maxNumPics = atoi(argv[i] + 2);
+        else if (strncmp(argv[i], "-L", 2) == 0)
+            numPasses = atoi(argv[i] + 2);
+        else if (strncmp(argv[i], "-P", 2) == 0)
+            postProcType = atoi(argv[i] + 2);
+        else if (strncmp(argv[i], "-O", 2) == 0)
+            strncpy(outFileName, argv[i] + 2, sizeof(outFileName) - 1);
+    }
+
+    finput = fopen(argv[argc - 1], "rb");
+    if (finput == NULL)
+    {
+        DEBUG(("UNABLE TO OPEN INPUT FILE\n"));
+        return -1;
+    }
+
+    fseek(finput, 0L, SEEK_END);
+    strmLen = (int32)ftell(finput);
+    rewind(finput);
+
+    strm = (uint8 *)malloc(strmLen);
+    if (strm == NULL || fread(strm, 1, strmLen, finput) != (size_t)strmLen)
+    {
+        DEBUG(("UNABLE TO READ INPUT FILE\n"));
+        fclose(finput);
+        free(strm);
+        return -1;
+    }
+    fclose(finput);
+
+    FindFrames(strm, strmLen, h263);
+    if (numFrames == 0)
+    {
+        DEBUG(("NO FRAMES FOUND IN THE STREAM\n"));
+        free(strm);
+        return -1;
+    }
+    if (maxNumPics > 0 && maxNumPics < numFrames)
+        numFrames = maxNumPics;
+
+    if (outFileName[0] != '\0')
+    {
+        foutput = fopen(outFileName, "wb");
+        if (foutput == NULL)
+        {
+            DEBUG(("UNABLE TO OPEN OUTPUT FILE\n"));
+            free(strm);
+            return -1;
+        }
+    }
+
+    frames[0] = frames[1] = NULL;
+
+    for (pass = 0; pass < numPasses; pass++)
+    {
+        frameSize = InitDecoder(&decCtrl, strm, h263, width, height,
+            postProcType);
+        if (frameSize == 0)
+        {
+            DEBUG(("DECODER INITIALIZATION FAILED\n"));
+            break;
+        }
+
+        if (frames[0] == NULL)
+        {
+            frames[0] = (uint8 *)malloc(frameSize);
+            frames[1] = (uint8 *)malloc(frameSize);
+            free(postFrame);
+            postFrame = (uint8 *)malloc(frameSize);
+        }
+        cur = 0;
+        PVSetReferenceYUV(&decCtrl, frames[1]);
+
+        for (pic = 0; pic < numFrames; pic++)
+        {
+            uint8 *bitstream = strm + frameStart[pic];
+            int32 size = frameStart[pic + 1] - frameStart[pic];
+            uint32 timestamp = pic;
+            uint useExtTimestamp = 1;
+            Bool ok;
+
+            outFrame = frames[cur];
+
+            clock_gettime(CLOCK_MONOTONIC, &startTime);
+            ok = PVDecodeVideoFrame(&decCtrl, &bitstream, &timestamp, &size,
+                &useExtTimestamp, frames[cur]);
+            if (ok && postProcType != PV_NO_POST_PROC)
+            {
+                /* the filters leave the reference picture as it is */
+                PVDecPostProcess(&decCtrl, postFrame);
+                outFrame = postFrame;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &endTime);
+
+            if (!ok)
+            {
+                DEBUG(("DECODING FAILED AT PICTURE %d\n", pic));
+                break;
+            }
+
+            /* the first H.263 picture header gives the real size, start
+             * over with it as SoftMPEG4 does */
+            PVGetBufferDimensions(&decCtrl, &bufWidth, &bufHeight);
+            if (bufWidth * bufHeight * 3 / 2 != frameSize)
+            {
+                DEBUG(("Width %d Height %d\n", bufWidth, bufHeight));
+                PVCleanUpVideoDecoder(&decCtrl);
+                width = bufWidth;
+                height = bufHeight;
+                free(frames[0]);
+                free(frames[1]);
+                frames[0] = frames[1] = NULL;
+                pass--;
+                break;
+            }
+
+            decodeTimeMs +=
+                (endTime.tv_sec - startTime.tv_sec) * 1000.0 +
+                (endTime.tv_nsec - startTime.tv_nsec) / 1000000.0;
+            numPics++;
+
+            if (foutput && pass == 0)
+                fwrite(outFrame, 1, frameSize, foutput);
+            cur ^= 1;
+        }
+
+        if (frames[0] == NULL)
+            continue;
+
+        PVCleanUpVideoDecoder(&decCtrl);
+        if (pic < numFrames)
+            break;
+    }
+
+    if (decodeTimeMs > 0.0)
+    {
+        DEBUG(("Decoded %d pictures in %.1f ms, %.1f fps\n",
+            numPics, decodeTimeMs, numPics * 1000.0 / decodeTimeMs));
+    }
+
+    if (foutput)
+        fclose(foutput);
+    free(frames[0]);
+    free(frames[1]);
+    free(postFrame);
+    free(strm);
+
+    return (pass < numPasses) ? -1 : 0;
+}
@@ -86,3 +86,27 @@ LOCAL_MODULE := libstagefright_soft_mp3dec
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
+
+################################################################################
+# test utility: decoder
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := test/DecTestBench.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include \
+        $(LOCAL_PATH)/src \
+        $(LOCAL_PATH)/include
+
+LOCAL_CFLAGS := \
+        -DOSCL_UNUSED_ARG=
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_mp3dec
+
+LOCAL_MODULE := mp3_decoder
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
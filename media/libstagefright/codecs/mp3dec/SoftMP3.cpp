@@ -19,9 +19,11 @@
 #include <utils/Log.h>
 
 #include "SoftMP3.h"
+#include "SoftAudioBatch.h"
 
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
 
 #include "include/pvmp3decoder_api.h"
 
@@ -326,6 +328,109 @@ void SoftMP3::onQueueFilled(OMX_U32 portIndex) {
     }
 }
 
+status_t SoftMP3::decodeBatch(SoftAudioBatch *batch) {
+    int16_t scratch[kOutputBufferSize / sizeof(int16_t)];
+
+    const uint8_t *data = batch->mData;
+    for (size_t i = 0; i < batch->mNumUnits; data += batch->mSizes[i++]) {
+        if (i < batch->mNumConfigUnits) {
+            // nothing in there this decoder needs
+            continue;
+        }
+
+        size_t offset = 0;
+
+        while (offset < batch->mSizes[i]) {
+            int16_t *outPtr = static_cast<int16_t *>(
+                    batch->outputBuffer(kOutputBufferSize, scratch));
+
+            mConfig->pInputBuffer = const_cast<uint8_t *>(data) + offset;
+            mConfig->inputBufferCurrentLength = batch->mSizes[i] - offset;
+            mConfig->inputBufferMaxLength = 0;
+            mConfig->inputBufferUsedLength = 0;
+
+            mConfig->outputFrameSize = kOutputBufferSize / sizeof(int16_t);
+            mConfig->pOutputBuffer = outPtr;
+
+            ERROR_CODE decoderErr;
+            if ((decoderErr = pvmp3_framedecoder(mConfig, mDecoderBuf))
+                    != NO_DECODING_ERROR) {
+                ALOGV("mp3 decoder returned error %d", decoderErr);
+
+                if (decoderErr != NO_ENOUGH_MAIN_DATA_ERROR
+                        && decoderErr != SIDE_INFO_ERROR
+                        && decoderErr != SYNCH_LOST_ERROR) {
+                    ALOGE("mp3 decoder returned error %d", decoderErr);
+                    return ERROR_MALFORMED;
+                }
+
+                // Like onQueueFilled(), drop the rest of the unit and play
+                // silence instead, unless there is no format to play it in
+                // yet.
+                offset = batch->mSizes[i];
+
+                if (batch->mNumChannels == 0) {
+                    continue;
+                }
+
+                if (decoderErr == SYNCH_LOST_ERROR
+                        || mConfig->outputFrameSize == 0) {
+                    mConfig->outputFrameSize =
+                        kOutputBufferSize / sizeof(int16_t);
+                }
+
+                memset(outPtr, 0, mConfig->outputFrameSize * sizeof(int16_t));
+            } else {
+                if (batch->mNumChannels == 0) {
+                    mSamplingRate = mConfig->samplingRate;
+                    mNumChannels = mConfig->num_channels;
+
+                    batch->mSampleRate = mSamplingRate;
+                    batch->mNumChannels = mNumChannels;
+                } else if (mConfig->samplingRate != batch->mSampleRate
+                        || mConfig->num_channels != batch->mNumChannels) {
+                    ALOGW("format changed from %d Hz, %d channels "
+                          "to %d Hz, %d channels",
+                          batch->mSampleRate, batch->mNumChannels,
+                          mConfig->samplingRate, mConfig->num_channels);
+                    return ERROR_UNSUPPORTED;
+                }
+
+                if (mConfig->inputBufferUsedLength == 0) {
+                    mConfig->inputBufferUsedLength = batch->mSizes[i] - offset;
+                }
+
+                CHECK_GE(batch->mSizes[i] - offset,
+                         (size_t)mConfig->inputBufferUsedLength);
+
+                offset += mConfig->inputBufferUsedLength;
+            }
+
+            size_t skip = 0;
+            if (mIsFirst) {
+                mIsFirst = false;
+                // Trim the decoder delay off the start, as onQueueFilled()
+                // does.
+                skip = kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t);
+            }
+
+            if (!batch->append(outPtr,
+                               mConfig->outputFrameSize * sizeof(int16_t),
+                               skip)) {
+                return OK;
+            }
+        }
+    }
+
+    if (batch->mEndOfStream && !mIsFirst) {
+        // pad the end of the stream with 529 samples, since that many samples
+        // were trimmed off the beginning when decoding started
+        batch->appendSilence(kPVMP3DecoderDelay * mNumChannels * sizeof(int16_t));
+    }
+
+    return OK;
+}
+
 void SoftMP3::onPortFlushCompleted(OMX_U32 portIndex) {
     if (portIndex == 0) {
         // Make sure that the next buffer output does not still
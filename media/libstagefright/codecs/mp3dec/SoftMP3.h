@@ -30,6 +30,8 @@ struct SoftMP3 : public SimpleSoftOMXComponent {
             OMX_PTR appData,
             OMX_COMPONENTTYPE **component);
 
+    virtual status_t decodeBatch(SoftAudioBatch *batch);
+
 protected:
     virtual ~SoftMP3();
 
@@ -0,0 +1,175 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Pathname: ./cpp/include/pv_mp3dec_fxd_op_sse2.h
+
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ SSE2 versions of the fixed point multiplies of pv_mp3dec_fxd_op_c_equivalent.h
+ operating on 4 int32 lanes. Every lane returns exactly what the C function
+ returns for the same arguments: the full 64-bit product is formed, shifted
+ and truncated to 32 bits, and sums wrap around like int32 additions do.
+
+------------------------------------------------------------------------------
+*/
+
+#ifndef PV_MP3DEC_FXD_OP_SSE2_H
+#define PV_MP3DEC_FXD_OP_SSE2_H
+
+#if defined(__SSE2__)
+
+#include "pvmp3_audio_type_defs.h"
+
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/*
+ *  signed 64-bit products of lanes 0 and 2 (even) and 1 and 3 (odd)
+ */
+static inline void fxp_mul32_64_sse2(__m128i a, __m128i b,
+                                     __m128i *even, __m128i *odd)
+{
+#if defined(__SSE4_1__)
+    *even = _mm_mul_epi32(a, b);
+    *odd  = _mm_mul_epi32(_mm_shuffle_epi32(a, _MM_SHUFFLE(3, 3, 1, 1)),
+                          _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 3, 1, 1)));
+#else
+    /* unsigned products, the high words corrected by the negative operands */
+    __m128i corr = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(a, 31), b),
+                                 _mm_and_si128(_mm_srai_epi32(b, 31), a));
+
+    *even = _mm_mul_epu32(a, b);
+    *odd  = _mm_mul_epu32(_mm_shuffle_epi32(a, _MM_SHUFFLE(3, 3, 1, 1)),
+                          _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 3, 1, 1)));
+    *even = _mm_sub_epi64(*even, _mm_slli_epi64(corr, 32));
+    *odd  = _mm_sub_epi64(*odd, _mm_slli_epi64(_mm_srli_epi64(corr, 32), 32));
+#endif
+}
+
+/*
+ *  (int32)(((int64)a * b) >> 32)
+ */
+static inline __m128i fxp_mul32_Q32_sse2(__m128i a, __m128i b)
+{
+    __m128i even;
+    __m128i odd;
+
+    fxp_mul32_64_sse2(a, b, &even, &odd);
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 3, 1)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+/*
+ *  (int32)(((int64)a * b) >> n), 0 < n < 32
+ */
+static inline __m128i fxp_mul32_Qn_sse2(__m128i a, __m128i b, int n)
+{
+    __m128i even;
+    __m128i odd;
+    __m128i shift = _mm_cvtsi32_si128(n);
+
+    fxp_mul32_64_sse2(a, b, &even, &odd);
+    even = _mm_srl_epi64(even, shift);
+    odd  = _mm_srl_epi64(odd, shift);
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+#define fxp_mul32_Q27_sse2(a, b)    fxp_mul32_Qn_sse2(a, b, 27)
+#define fxp_mul32_Q28_sse2(a, b)    fxp_mul32_Qn_sse2(a, b, 28)
+
+#if defined(__SSE4_1__)
+/*
+ *  Sums of fxp_mul32_Q32() products. The 64-bit products of lanes 0/2 and
+ *  1/3 are added up as they are (only their high words matter, and those
+ *  add up independently of the low words) and are merged into one vector
+ *  once by fxp_acc_Q32_sse4(). Without pmuldq the sign corrections cost as
+ *  much as the scalar multiplies, so there is no SSE2 version of these.
+ */
+typedef struct
+{
+    __m128i even;
+    __m128i odd;
+} fxp_acc_sse4;
+
+static inline void fxp_acc_sse4_init(fxp_acc_sse4 *acc)
+{
+    acc->even = _mm_setzero_si128();
+    acc->odd  = _mm_setzero_si128();
+}
+
+/*
+ *  acc += fxp_mul32_Q32(a, b), a_odd and b_odd are the operands with lanes
+ *  1 and 3 moved to 0 and 2
+ */
+static inline void fxp_mac32_Q32_sse4(fxp_acc_sse4 *acc, __m128i a, __m128i a_odd,
+                                      __m128i b, __m128i b_odd)
+{
+    acc->even = _mm_add_epi32(acc->even, _mm_mul_epi32(a, b));
+    acc->odd  = _mm_add_epi32(acc->odd, _mm_mul_epi32(a_odd, b_odd));
+}
+
+/*
+ *  acc -= fxp_mul32_Q32(a, b)
+ */
+static inline void fxp_msb32_Q32_sse4(fxp_acc_sse4 *acc, __m128i a, __m128i a_odd,
+                                      __m128i b, __m128i b_odd)
+{
+    acc->even = _mm_sub_epi32(acc->even, _mm_mul_epi32(a, b));
+    acc->odd  = _mm_sub_epi32(acc->odd, _mm_mul_epi32(a_odd, b_odd));
+}
+
+static inline __m128i fxp_acc_Q32_sse4(const fxp_acc_sse4 *acc)
+{
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(acc->even, _MM_SHUFFLE(3, 1, 3, 1)),
+                              _mm_shuffle_epi32(acc->odd, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+#endif /* __SSE4_1__ */
+
+/*
+ *  4x4 transpose of int32 lanes
+ */
+static inline void transpose4x4_epi32_sse2(__m128i *r0, __m128i *r1,
+        __m128i *r2, __m128i *r3)
+{
+    __m128i t0 = _mm_unpacklo_epi32(*r0, *r1);
+    __m128i t1 = _mm_unpacklo_epi32(*r2, *r3);
+    __m128i t2 = _mm_unpackhi_epi32(*r0, *r1);
+    __m128i t3 = _mm_unpackhi_epi32(*r2, *r3);
+
+    *r0 = _mm_unpacklo_epi64(t0, t1);
+    *r1 = _mm_unpackhi_epi64(t0, t1);
+    *r2 = _mm_unpacklo_epi64(t2, t3);
+    *r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+#endif /* __SSE2__ */
+
+#endif  /* PV_MP3DEC_FXD_OP_SSE2_H */
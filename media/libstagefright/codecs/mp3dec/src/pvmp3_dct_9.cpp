@@ -65,6 +65,7 @@ Returns
 #include "pvmp3_audio_type_defs.h"
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_mdct_18.h"
+#include "pv_mp3dec_fxd_op_sse2.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -163,5 +164,69 @@ void pvmp3_dct_9(int32 vec[])
 }
 
 
+#if defined(__SSE2__)
+/*
+ *  pvmp3_dct_9() on 4 vectors at a time, lane n of vec[k] holding element k
+ *  of vector n. Each line is the one of pvmp3_dct_9() with the same rounding.
+ */
+
+#define ADD(a, b)       _mm_add_epi32(a, b)
+#define SUB(a, b)       _mm_sub_epi32(a, b)
+#define SHL1(a)         _mm_slli_epi32(a, 1)
+#define MUL_Q32(a, c)   fxp_mul32_Q32_sse2(a, _mm_set1_epi32(c))
+
+void pvmp3_dct_9_sse2(__m128i vec[])
+{
+
+    /*  split input vector */
+
+    __m128i tmp0 =  ADD(vec[8], vec[0]);
+    __m128i tmp8 =  SUB(vec[8], vec[0]);
+    __m128i tmp1 =  ADD(vec[7], vec[1]);
+    __m128i tmp7 =  SUB(vec[7], vec[1]);
+    __m128i tmp2 =  ADD(vec[6], vec[2]);
+    __m128i tmp6 =  SUB(vec[6], vec[2]);
+    __m128i tmp3 =  ADD(vec[5], vec[3]);
+    __m128i tmp5 =  SUB(vec[5], vec[3]);
+    __m128i tmp023 = ADD(ADD(tmp0, tmp2), tmp3);
+    __m128i tmp14  = ADD(tmp1, vec[4]);
+
+    vec[0]  = ADD(tmp023, tmp14);
+    vec[6]  = SUB(_mm_srai_epi32(tmp023, 1), tmp14);
+    vec[2]  = SUB(_mm_srai_epi32(tmp1, 1), vec[4]);
+    vec[4]  = SUB(_mm_setzero_si128(), vec[2]);
+    vec[8]  = vec[4];
+    vec[4]  = ADD(vec[4], MUL_Q32(SHL1(tmp0), cos_2pi_9));
+    vec[8]  = ADD(vec[8], MUL_Q32(SHL1(tmp0), cos_4pi_9));
+    vec[2]  = ADD(vec[2], MUL_Q32(SHL1(tmp0), cos_pi_9));
+    vec[2]  = ADD(vec[2], MUL_Q32(SHL1(tmp2), cos_5pi_9));
+    vec[4]  = ADD(vec[4], MUL_Q32(SHL1(tmp2), cos_8pi_9));
+    vec[8]  = ADD(vec[8], MUL_Q32(SHL1(tmp2), cos_2pi_9));
+    vec[8]  = ADD(vec[8], MUL_Q32(SHL1(tmp3), cos_8pi_9));
+    vec[4]  = ADD(vec[4], MUL_Q32(SHL1(tmp3), cos_4pi_9));
+    vec[2]  = ADD(vec[2], MUL_Q32(SHL1(tmp3), cos_7pi_9));
+
+    vec[1]  = MUL_Q32(SHL1(tmp5), cos_11pi_18);
+    vec[1]  = ADD(vec[1], MUL_Q32(SHL1(tmp6), cos_13pi_18));
+    vec[1]  = ADD(vec[1], MUL_Q32(SHL1(tmp7), cos_5pi_6));
+    vec[1]  = ADD(vec[1], MUL_Q32(SHL1(tmp8), cos_17pi_18));
+    vec[3]  = MUL_Q32(SHL1(SUB(ADD(tmp5, tmp6), tmp8)), cos_pi_6);
+    vec[5]  = MUL_Q32(SHL1(tmp5), cos_17pi_18);
+    vec[5]  = ADD(vec[5], MUL_Q32(SHL1(tmp6), cos_7pi_18));
+    vec[5]  = ADD(vec[5], MUL_Q32(SHL1(tmp7), cos_pi_6));
+    vec[5]  = ADD(vec[5], MUL_Q32(SHL1(tmp8), cos_13pi_18));
+    vec[7]  = MUL_Q32(SHL1(tmp5), cos_5pi_18);
+    vec[7]  = ADD(vec[7], MUL_Q32(SHL1(tmp6), cos_17pi_18));
+    vec[7]  = ADD(vec[7], MUL_Q32(SHL1(tmp7), cos_pi_6));
+    vec[7]  = ADD(vec[7], MUL_Q32(SHL1(tmp8), cos_11pi_18));
+
+}
+
+#undef ADD
+#undef SUB
+#undef SHL1
+#undef MUL_Q32
+
+#endif /* __SSE2__ */
 
 #endif // If not assembly
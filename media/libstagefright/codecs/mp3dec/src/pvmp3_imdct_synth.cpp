@@ -243,6 +243,32 @@ void pvmp3_imdct_synth(int32  in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
         int32 * out     = in      + (band * FILTERBANK_BANDS);
         int32 * history = overlap + (band * FILTERBANK_BANDS);
 
+#if defined(__SSE2__)
+        /*
+         *  4 bands with the same long window are transformed together
+         */
+        if ((band + 4 <= bands2process) &&
+                ((band + 4 <= mx_band) || ((band >= mx_band) && (blk_type != SHORT))))
+        {
+            pvmp3_mdct_18_x4(out,
+                             history,
+                             (current_blk_type == START) ? start_win :
+                             (current_blk_type == STOP)  ? stop_win  : normal_win);
+
+            /* frequency inversion of the odd bands, as below */
+            for (int32 b = (band & 1) ? 0 : 1; b < 4; b += 2)
+            {
+                for (int32 slot = 1; slot < FILTERBANK_BANDS; slot += 2)
+                {
+                    out[b*FILTERBANK_BANDS + slot] = -out[b*FILTERBANK_BANDS + slot];
+                }
+            }
+
+            band += 3;
+            continue;
+        }
+#endif
+
         switch (current_blk_type)
         {
             case LONG:
@@ -70,6 +70,8 @@ Returns
 
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_mdct_18.h"
+#include "pv_mp3dec_fxd_op_sse2.h"
+#include "pvmp3_dec_defs.h"
 
 
 /*----------------------------------------------------------------------------
@@ -286,4 +288,219 @@ void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window)
     history[11] = fxp_mul32_Q32(tmp,  window[29]);
 }
 
+#if defined(__SSE2__)
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+/*
+ *  pvmp3_mdct_18() of 4 consecutive bands (vec[0..71], history[0..71]) using
+ *  the same window, one band per lane. Each line is the one of
+ *  pvmp3_mdct_18() with the same rounding, so the output is identical.
+ */
+
+#define ADD(a, b)       _mm_add_epi32(a, b)
+#define SUB(a, b)       _mm_sub_epi32(a, b)
+#define NEG(a)          _mm_sub_epi32(_mm_setzero_si128(), a)
+#define SHL1(a)         _mm_slli_epi32(a, 1)
+#define MUL_Q32(a, c)   fxp_mul32_Q32_sse2(a, _mm_set1_epi32(c))
+#define MAC_Q32(l, a, c) _mm_add_epi32(l, MUL_Q32(a, c))
+
+static void load_bands_sse2(__m128i v[FILTERBANK_BANDS], const int32 *src)
+{
+    int32 k;
+
+    for (k = 0; k < 16; k += 4)
+    {
+        v[k  ] = _mm_loadu_si128((const __m128i *)&src[k]);
+        v[k+1] = _mm_loadu_si128((const __m128i *)&src[k + FILTERBANK_BANDS]);
+        v[k+2] = _mm_loadu_si128((const __m128i *)&src[k + 2*FILTERBANK_BANDS]);
+        v[k+3] = _mm_loadu_si128((const __m128i *)&src[k + 3*FILTERBANK_BANDS]);
+        transpose4x4_epi32_sse2(&v[k], &v[k+1], &v[k+2], &v[k+3]);
+    }
+    for (; k < FILTERBANK_BANDS; k++)
+    {
+        v[k] = _mm_setr_epi32(src[k], src[k + FILTERBANK_BANDS],
+                              src[k + 2*FILTERBANK_BANDS], src[k + 3*FILTERBANK_BANDS]);
+    }
+}
+
+static void store_bands_sse2(int32 *dst, __m128i v[FILTERBANK_BANDS])
+{
+    int32 k;
+
+    for (k = 0; k < 16; k += 4)
+    {
+        transpose4x4_epi32_sse2(&v[k], &v[k+1], &v[k+2], &v[k+3]);
+        _mm_storeu_si128((__m128i *)&dst[k], v[k]);
+        _mm_storeu_si128((__m128i *)&dst[k + FILTERBANK_BANDS], v[k+1]);
+        _mm_storeu_si128((__m128i *)&dst[k + 2*FILTERBANK_BANDS], v[k+2]);
+        _mm_storeu_si128((__m128i *)&dst[k + 3*FILTERBANK_BANDS], v[k+3]);
+    }
+    for (; k < FILTERBANK_BANDS; k++)
+    {
+        int32 lanes[4];
+
+        _mm_storeu_si128((__m128i *)lanes, v[k]);
+        dst[k]                      = lanes[0];
+        dst[k + FILTERBANK_BANDS]   = lanes[1];
+        dst[k + 2*FILTERBANK_BANDS] = lanes[2];
+        dst[k + 3*FILTERBANK_BANDS] = lanes[3];
+    }
+}
+
+
+void pvmp3_mdct_18_x4(int32 vec[], int32 *history, const int32 *window)
+{
+    int32 i;
+    __m128i v[FILTERBANK_BANDS];
+    __m128i h[FILTERBANK_BANDS];
+    __m128i tmp;
+    __m128i tmp1;
+    __m128i tmp2;
+    __m128i tmp3;
+    __m128i tmp4;
+
+    load_bands_sse2(v, vec);
+    load_bands_sse2(h, history);
+
+    for (i = 0; i < 9; i++)
+    {
+        tmp  = MUL_Q32(SHL1(v[i]), cosTerms_1_ov_cos_phi[i]);
+        tmp1 = fxp_mul32_Q27_sse2(v[17 - i], _mm_set1_epi32(cosTerms_1_ov_cos_phi[17 - i]));
+        v[i]      = ADD(tmp, tmp1);
+        v[17 - i] = fxp_mul32_Q28_sse2(SUB(tmp, tmp1), _mm_set1_epi32(cosTerms_dct18[i]));
+    }
+
+
+    pvmp3_dct_9_sse2(v);         // Even terms
+    pvmp3_dct_9_sse2(&v[9]);     // Odd  terms
+
+
+    tmp3   = v[16];
+    v[16]  = v[ 8];
+    tmp4   = v[14];
+    v[14]  = v[ 7];
+    tmp    = v[12];
+    v[12]  = v[ 6];
+    tmp2   = v[10];
+    v[10]  = v[ 5];
+    v[ 8]  = v[ 4];
+    v[ 6]  = v[ 3];
+    v[ 4]  = v[ 2];
+    v[ 2]  = v[ 1];
+    v[ 1]  = SUB(v[ 9], tmp2);
+    v[ 3]  = SUB(v[11], tmp2);
+    v[ 5]  = SUB(v[11], tmp);
+    v[ 7]  = SUB(v[13], tmp);
+    v[ 9]  = SUB(v[13], tmp4);
+    v[11]  = SUB(v[15], tmp4);
+    v[13]  = SUB(v[15], tmp3);
+    v[15]  = SUB(v[17], tmp3);
+
+
+    /* overlap and add */
+
+    tmp2 = v[0];
+    tmp3 = v[9];
+
+    for (i = 0; i < 6; i++)
+    {
+        tmp  = h[i];
+        tmp4 = v[i+10];
+        v[i+10] = ADD(tmp3, tmp4);
+        tmp1 = v[i+1];
+        v[i] = MAC_Q32(tmp, v[i+10], window[i]);
+        tmp3 = tmp4;
+        h[i] = NEG(ADD(tmp2, tmp1));
+        tmp2 = tmp1;
+    }
+
+    tmp  = h[6];
+    tmp4 = v[16];
+    v[16] = ADD(tmp3, tmp4);
+    tmp1 = v[7];
+    v[ 6] = MAC_Q32(tmp, SHL1(v[16]), window[6]);
+    tmp  = h[7];
+    h[6] = NEG(ADD(tmp2, tmp1));
+    h[7] = NEG(ADD(tmp1, v[8]));
+
+    tmp1  = h[8];
+    tmp4  = ADD(v[17], tmp4);
+    v[ 7] = MAC_Q32(tmp, SHL1(tmp4), window[7]);
+    h[8]  = NEG(ADD(v[8], v[9]));
+    v[ 8] = MAC_Q32(tmp1, SHL1(v[17]), window[8]);
+
+    tmp  = h[9];
+    tmp1 = h[17];
+    tmp2 = h[16];
+    v[ 9] = MAC_Q32(tmp, SHL1(v[17]), window[9]);
+
+    v[17] = MAC_Q32(tmp1, SHL1(v[10]), window[17]);
+    v[10] = NEG(v[16]);
+    v[16] = MAC_Q32(tmp2, SHL1(v[11]), window[16]);
+    tmp1 = h[15];
+    tmp2 = h[14];
+    v[11] = NEG(v[15]);
+    v[15] = MAC_Q32(tmp1, SHL1(v[12]), window[15]);
+    v[12] = NEG(v[14]);
+    v[14] = MAC_Q32(tmp2, SHL1(v[13]), window[14]);
+
+    tmp  = h[13];
+    tmp1 = h[12];
+    tmp2 = h[11];
+    tmp3 = h[10];
+    v[13] = MAC_Q32(tmp,  SHL1(v[12]), window[13]);
+    v[12] = MAC_Q32(tmp1, SHL1(v[11]), window[12]);
+    v[11] = MAC_Q32(tmp2, SHL1(v[10]), window[11]);
+    v[10] = MAC_Q32(tmp3, SHL1(tmp4),  window[10]);
+
+
+    /* next iteration overlap */
+
+    tmp1 = SHL1(h[8]);
+    tmp3 = SHL1(h[7]);
+    tmp2 = SHL1(h[1]);
+    tmp  = SHL1(h[0]);
+
+    h[ 0] = MUL_Q32(tmp1, window[18]);
+    h[17] = MUL_Q32(tmp1, window[35]);
+    h[ 1] = MUL_Q32(tmp3, window[19]);
+    h[16] = MUL_Q32(tmp3, window[34]);
+
+    h[ 7] = MUL_Q32(tmp2, window[25]);
+    h[10] = MUL_Q32(tmp2, window[28]);
+    h[ 8] = MUL_Q32(tmp,  window[26]);
+    h[ 9] = MUL_Q32(tmp,  window[27]);
+
+    tmp1 = SHL1(h[6]);
+    tmp3 = SHL1(h[5]);
+    tmp4 = SHL1(h[4]);
+    tmp2 = SHL1(h[3]);
+    tmp  = SHL1(h[2]);
+
+    h[ 2] = MUL_Q32(tmp1, window[20]);
+    h[15] = MUL_Q32(tmp1, window[33]);
+    h[ 3] = MUL_Q32(tmp3, window[21]);
+    h[14] = MUL_Q32(tmp3, window[32]);
+    h[ 4] = MUL_Q32(tmp4, window[22]);
+    h[13] = MUL_Q32(tmp4, window[31]);
+    h[ 5] = MUL_Q32(tmp2, window[23]);
+    h[12] = MUL_Q32(tmp2, window[30]);
+    h[ 6] = MUL_Q32(tmp,  window[24]);
+    h[11] = MUL_Q32(tmp,  window[29]);
+
+    store_bands_sse2(vec, v);
+    store_bands_sse2(history, h);
+}
+
+#undef ADD
+#undef SUB
+#undef NEG
+#undef SHL1
+#undef MUL_Q32
+#undef MAC_Q32
+
+#endif /* __SSE2__ */
+
 #endif // If not assembly
@@ -50,6 +50,10 @@
 ----------------------------------------------------------------------------*/
 #include "pvmp3_audio_type_defs.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /*----------------------------------------------------------------------------
 ; MACROS
 ; Define module specific macros here
@@ -97,6 +101,12 @@ extern "C"
 
     void pvmp3_dct_6(int32 vec[]);
 
+#if defined(__SSE2__)
+    void pvmp3_mdct_18_x4(int32 vec[], int32 *history, const int32 *window);
+
+    void pvmp3_dct_9_sse2(__m128i vec[]);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -134,6 +134,40 @@ void pvmp3_poly_phase_synthesis(tmp3dec_chan   *pChVars,
 
     int16 * ptr_out = outPcm;
 
+#if defined(__SSE2__)
+    /*
+     *  The DCT of a slot only touches its own 32 samples and the window only
+     *  reads the current and older slots, so all the DCTs can run first,
+     *  4 slots at a time.
+     */
+    int32 slot;
+
+    for (slot = 0; slot + 4 <= FILTERBANK_BANDS; slot += 4)
+    {
+        pvmp3_dct_32_x4(&pChVars->circ_buffer[544 - ((slot + 3) << 5)]);
+    }
+
+    for (; slot < FILTERBANK_BANDS; slot++)
+    {
+        int32 *inData  = &pChVars->circ_buffer[544 - (slot<<5)];
+
+        pvmp3_split(&inData[16]);
+
+        pvmp3_dct_16(&inData[16], 0);
+        pvmp3_dct_16(inData, 1);     // Even terms
+
+        pvmp3_merge_in_place_N32(inData);
+    }
+
+    for (slot = 0; slot < FILTERBANK_BANDS; slot++)
+    {
+        pvmp3_polyphase_filter_window(&pChVars->circ_buffer[544 - (slot<<5)],
+                                      ptr_out,
+                                      numChannels);
+
+        ptr_out += (numChannels << 5);
+    }
+#else
 
     for (int32  band = 0; band < FILTERBANK_BANDS; band += 2)
     {
@@ -176,6 +210,7 @@ void pvmp3_poly_phase_synthesis(tmp3dec_chan   *pChVars,
         inData  -= SUBBANDS_NUMBER;
 
     }/* end band loop */
+#endif /* __SSE2__ */
 
     pv_memmove(&pChVars->circ_buffer[576],
                pChVars->circ_buffer,
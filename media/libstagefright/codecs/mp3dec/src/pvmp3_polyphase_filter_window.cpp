@@ -75,6 +75,7 @@ Input
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_dec_defs.h"
 #include "pvmp3_tables.h"
+#include "pv_mp3dec_fxd_op_sse2.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -121,6 +122,172 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
     const int32 *winPtr = pqmfSynthWin;
     int32 i;
 
+#if defined(__AVX2__)
+    /*
+     *  j = 1..15 as 8 lanes of j = jg..jg+7, lane j = 16 is computed from
+     *  valid data and dropped. Every product is truncated separately like
+     *  in fxp_mac32_Q32(), so the wrapping int32 sums are the same; only the
+     *  high words of the 64-bit products are added up.
+     */
+    const __m256i win_idx = _mm256_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112);
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    for (int32 jg = 1; jg < SUBBANDS_NUMBER / 2; jg += 8)
+    {
+        __m256i w[16];
+        __m256i w_odd[16];
+        __m256i sum1_e = _mm256_setzero_si256();
+        __m256i sum1_o = _mm256_setzero_si256();
+        __m256i sum2_e = _mm256_setzero_si256();
+        __m256i sum2_o = _mm256_setzero_si256();
+        int16 out[16];
+
+        /* winPtr[16*(j-1) + k] of the 8 lanes */
+        for (i = 0; i < 16; i++)
+        {
+            w[i]     = _mm256_i32gather_epi32((const int *)&winPtr[i], win_idx, 4);
+            w_odd[i] = _mm256_shuffle_epi32(w[i], _MM_SHUFFLE(3, 3, 1, 1));
+        }
+
+        /* pt_1 = &synth_buffer[16 + j], pt_2 = &synth_buffer[16 - j] */
+        int32 *pt_1 = &synth_buffer[(SUBBANDS_NUMBER >> 1) + jg];
+        int32 *pt_2 = &synth_buffer[(SUBBANDS_NUMBER >> 1) - jg - 7];
+
+        for (i = 0; i < 16; i += 4)
+        {
+            int32 m = i >> 1;
+            __m256i temp1 = _mm256_loadu_si256((const __m256i *)&pt_1[SUBBANDS_NUMBER * m]);
+            __m256i temp3 = _mm256_permutevar8x32_epi32(
+                                _mm256_loadu_si256((const __m256i *)&pt_2[SUBBANDS_NUMBER * (15 - m)]), reverse);
+            __m256i temp2 = _mm256_permutevar8x32_epi32(
+                                _mm256_loadu_si256((const __m256i *)&pt_2[SUBBANDS_NUMBER * (m + 1)]), reverse);
+            __m256i temp4 = _mm256_loadu_si256((const __m256i *)&pt_1[SUBBANDS_NUMBER * (14 - m)]);
+            __m256i temp1_o = _mm256_shuffle_epi32(temp1, _MM_SHUFFLE(3, 3, 1, 1));
+            __m256i temp3_o = _mm256_shuffle_epi32(temp3, _MM_SHUFFLE(3, 3, 1, 1));
+            __m256i temp2_o = _mm256_shuffle_epi32(temp2, _MM_SHUFFLE(3, 3, 1, 1));
+            __m256i temp4_o = _mm256_shuffle_epi32(temp4, _MM_SHUFFLE(3, 3, 1, 1));
+
+            sum1_e = _mm256_add_epi32(sum1_e, _mm256_mul_epi32(temp1,   w[i  ]));
+            sum1_o = _mm256_add_epi32(sum1_o, _mm256_mul_epi32(temp1_o, w_odd[i  ]));
+            sum2_e = _mm256_add_epi32(sum2_e, _mm256_mul_epi32(temp3,   w[i  ]));
+            sum2_o = _mm256_add_epi32(sum2_o, _mm256_mul_epi32(temp3_o, w_odd[i  ]));
+            sum2_e = _mm256_add_epi32(sum2_e, _mm256_mul_epi32(temp1,   w[i+1]));
+            sum2_o = _mm256_add_epi32(sum2_o, _mm256_mul_epi32(temp1_o, w_odd[i+1]));
+            sum1_e = _mm256_sub_epi32(sum1_e, _mm256_mul_epi32(temp3,   w[i+1]));
+            sum1_o = _mm256_sub_epi32(sum1_o, _mm256_mul_epi32(temp3_o, w_odd[i+1]));
+            sum1_e = _mm256_add_epi32(sum1_e, _mm256_mul_epi32(temp2,   w[i+2]));
+            sum1_o = _mm256_add_epi32(sum1_o, _mm256_mul_epi32(temp2_o, w_odd[i+2]));
+            sum2_e = _mm256_sub_epi32(sum2_e, _mm256_mul_epi32(temp4,   w[i+2]));
+            sum2_o = _mm256_sub_epi32(sum2_o, _mm256_mul_epi32(temp4_o, w_odd[i+2]));
+            sum2_e = _mm256_add_epi32(sum2_e, _mm256_mul_epi32(temp2,   w[i+3]));
+            sum2_o = _mm256_add_epi32(sum2_o, _mm256_mul_epi32(temp2_o, w_odd[i+3]));
+            sum1_e = _mm256_add_epi32(sum1_e, _mm256_mul_epi32(temp4,   w[i+3]));
+            sum1_o = _mm256_add_epi32(sum1_o, _mm256_mul_epi32(temp4_o, w_odd[i+3]));
+        }
+
+        /* merge the high words, saturate16(sum >> 6) */
+        __m256i vsum1 = _mm256_unpacklo_epi32(_mm256_shuffle_epi32(sum1_e, _MM_SHUFFLE(3, 1, 3, 1)),
+                                              _mm256_shuffle_epi32(sum1_o, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m256i vsum2 = _mm256_unpacklo_epi32(_mm256_shuffle_epi32(sum2_e, _MM_SHUFFLE(3, 1, 3, 1)),
+                                              _mm256_shuffle_epi32(sum2_o, _MM_SHUFFLE(3, 1, 3, 1)));
+        vsum1 = _mm256_srai_epi32(_mm256_add_epi32(vsum1, _mm256_set1_epi32(0x00000020)), 6);
+        vsum2 = _mm256_srai_epi32(_mm256_add_epi32(vsum2, _mm256_set1_epi32(0x00000020)), 6);
+
+        /* packs works within 128-bit halves: lanes 0-3 of sum1, sum2, then 4-7 */
+        _mm256_storeu_si256((__m256i *)out, _mm256_packs_epi32(vsum1, vsum2));
+
+        for (i = 0; i < 8 && jg + i < SUBBANDS_NUMBER / 2; i++)
+        {
+            int32 k = (jg + i) << (numChannels - 1);
+            int32 n = (i & 3) + ((i & 4) << 1);
+            outPcm[k] = out[n];
+            outPcm[(numChannels<<5) - k] = out[n + 4];
+        }
+
+        winPtr += 128;
+    }
+
+    winPtr = &pqmfSynthWin[((SUBBANDS_NUMBER / 2) - 1) << 4];
+#elif defined(__SSE4_1__)
+    /*
+     *  j = 1..15 as 4 lanes of j = jg..jg+3, lane j = 16 is computed from
+     *  valid data and dropped. Every product is truncated separately like
+     *  in fxp_mac32_Q32(), so the wrapping int32 sums are the same.
+     */
+    for (int32 jg = 1; jg < SUBBANDS_NUMBER / 2; jg += 4)
+    {
+        fxp_acc_sse4 acc1;
+        fxp_acc_sse4 acc2;
+        __m128i w[16];
+        __m128i w_odd[16];
+        int16 out[8];
+
+        /* winPtr[16*(j-1) + k] of the 4 lanes */
+        for (i = 0; i < 16; i += 4)
+        {
+            w[i  ] = _mm_loadu_si128((const __m128i *)&winPtr[i]);
+            w[i+1] = _mm_loadu_si128((const __m128i *)&winPtr[i + 16]);
+            w[i+2] = _mm_loadu_si128((const __m128i *)&winPtr[i + 32]);
+            w[i+3] = _mm_loadu_si128((const __m128i *)&winPtr[i + 48]);
+            transpose4x4_epi32_sse2(&w[i], &w[i+1], &w[i+2], &w[i+3]);
+        }
+        for (i = 0; i < 16; i++)
+        {
+            w_odd[i] = _mm_shuffle_epi32(w[i], _MM_SHUFFLE(3, 3, 1, 1));
+        }
+
+        /* pt_1 = &synth_buffer[16 + j], pt_2 = &synth_buffer[16 - j] */
+        int32 *pt_1 = &synth_buffer[(SUBBANDS_NUMBER >> 1) + jg];
+        int32 *pt_2 = &synth_buffer[(SUBBANDS_NUMBER >> 1) - jg - 3];
+
+        fxp_acc_sse4_init(&acc1);
+        fxp_acc_sse4_init(&acc2);
+
+        for (i = 0; i < 16; i += 4)
+        {
+            int32 m = i >> 1;
+            __m128i temp1 = _mm_loadu_si128((const __m128i *)&pt_1[SUBBANDS_NUMBER * m]);
+            __m128i temp3 = _mm_shuffle_epi32(
+                                _mm_loadu_si128((const __m128i *)&pt_2[SUBBANDS_NUMBER * (15 - m)]),
+                                _MM_SHUFFLE(0, 1, 2, 3));
+            __m128i temp2 = _mm_shuffle_epi32(
+                                _mm_loadu_si128((const __m128i *)&pt_2[SUBBANDS_NUMBER * (m + 1)]),
+                                _MM_SHUFFLE(0, 1, 2, 3));
+            __m128i temp4 = _mm_loadu_si128((const __m128i *)&pt_1[SUBBANDS_NUMBER * (14 - m)]);
+            __m128i temp1_o = _mm_shuffle_epi32(temp1, _MM_SHUFFLE(3, 3, 1, 1));
+            __m128i temp3_o = _mm_shuffle_epi32(temp3, _MM_SHUFFLE(3, 3, 1, 1));
+            __m128i temp2_o = _mm_shuffle_epi32(temp2, _MM_SHUFFLE(3, 3, 1, 1));
+            __m128i temp4_o = _mm_shuffle_epi32(temp4, _MM_SHUFFLE(3, 3, 1, 1));
+
+            fxp_mac32_Q32_sse4(&acc1, temp1, temp1_o, w[i  ], w_odd[i  ]);
+            fxp_mac32_Q32_sse4(&acc2, temp3, temp3_o, w[i  ], w_odd[i  ]);
+            fxp_mac32_Q32_sse4(&acc2, temp1, temp1_o, w[i+1], w_odd[i+1]);
+            fxp_msb32_Q32_sse4(&acc1, temp3, temp3_o, w[i+1], w_odd[i+1]);
+            fxp_mac32_Q32_sse4(&acc1, temp2, temp2_o, w[i+2], w_odd[i+2]);
+            fxp_msb32_Q32_sse4(&acc2, temp4, temp4_o, w[i+2], w_odd[i+2]);
+            fxp_mac32_Q32_sse4(&acc2, temp2, temp2_o, w[i+3], w_odd[i+3]);
+            fxp_mac32_Q32_sse4(&acc1, temp4, temp4_o, w[i+3], w_odd[i+3]);
+        }
+
+        /* saturate16(sum >> 6) */
+        __m128i vsum1 = _mm_add_epi32(fxp_acc_Q32_sse4(&acc1), _mm_set1_epi32(0x00000020));
+        __m128i vsum2 = _mm_add_epi32(fxp_acc_Q32_sse4(&acc2), _mm_set1_epi32(0x00000020));
+
+        _mm_storeu_si128((__m128i *)out, _mm_packs_epi32(_mm_srai_epi32(vsum1, 6),
+                         _mm_srai_epi32(vsum2, 6)));
+
+        for (i = 0; i < 4 && jg + i < SUBBANDS_NUMBER / 2; i++)
+        {
+            int32 k = (jg + i) << (numChannels - 1);
+            outPcm[k] = out[i];
+            outPcm[(numChannels<<5) - k] = out[i + 4];
+        }
+
+        winPtr += 64;
+    }
+
+    winPtr = &pqmfSynthWin[((SUBBANDS_NUMBER / 2) - 1) << 4];
+#else
 
     for (int16 j = 1; j < SUBBANDS_NUMBER / 2; j++)
     {
@@ -199,6 +366,7 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
         outPcm[k] = saturate16(sum1 >> 6);
         outPcm[(numChannels<<5) - k] = saturate16(sum2 >> 6);
     }
+#endif /* __AVX2__ */
 
 
 
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Decoder test bench for MP3 files. Decodes the file, optionally several
+ * times over, and reports the throughput of the decoding calls alone,
+ * reading and writing the files not included. */
+
+#include "pvmp3decoder_api.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEBUG(argv) printf argv
+
+/* the output buffer SoftMP3 hands the decoder, in 16-bit samples */
+#define OUTPUT_FRAME_SIZE   (4608 * 2)
+
+/*------------------------------------------------------------------------------
+
+    Function name:  main
+
+    Purpose:
+        main function of decoder testbench. Provides command line interface
+        with file I/O for the MP3 decoder. Prints out the usage information
+        when executed without arguments.
+
+------------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    int i;
+    int numPasses = 1;
+    int32 maxNumFrames = 0;
+    char outFileName[256] = "";
+
+    FILE *finput;
+    FILE *foutput = NULL;
+    uint8 *strm;
+    int32 strmLen, pos;
+
+    tPVMP3DecoderExternal config;
+    void *decoderBuf;
+    int16 *pcm;
+    ERROR_CODE err;
+    int32 pass, numFrames = 0, numErrors = 0, numPassFrames;
+    double numSamples = 0.0;    /* per channel */
+
+    struct timespec startTime, endTime;
+    double decodeTimeMs = 0.0;
+
+    if (argc < 2)
+    {
+        DEBUG(("Usage: %s [-Nn] [-Ln] [-Ooutfile] file.mp3\n", argv[0]));
+        DEBUG(("\t-Nn forces decoding to stop after n frames\n"));
+        DEBUG(("\t-Ln decodes the file n times over, for timing\n"));
+        DEBUG(("\t-Ooutfile write the PCM output of the first pass to "
+            "\"outfile\"\n"));
+        return 0;
+    }
+
+    /* read command line arguments */
+    for (i = 1; i < argc - 1; i++)
+    {
+        if (strncmp(argv[i], "-N", 2) == 0)
+            maxNumFrames = atoi(argv[i] + 2);
+        else if (strncmp(argv[i], "-L", 2) == 0)
+            numPasses = atoi(argv[i] + 2);
+        else if (strncmp(argv[i], "-O", 2) == 0)
+            strncpy(outFileName, argv[i] + 2, sizeof(outFileName) - 1);
+    }
+
+    finput = fopen(argv[argc - 1], "rb");
+    if (finput == NULL)
+    {
+        DEBUG(("UNABLE TO OPEN INPUT FILE\n"));
+        return -1;
+    }
+
+    fseek(finput, 0L, SEEK_END);
+    strmLen = (int32)ftell(finput);
+    rewind(finput);
+
+    strm = (uint8 *)malloc(strmLen);
+    if (strm == NULL || fread(strm, 1, strmLen, finput) != (size_t)strmLen)
+    {
+        DEBUG(("UNABLE TO READ INPUT FILE\n"));
+        fclose(finput);
+        free(strm);
+        return -1;
+    }
+    fclose(finput);
+
+    if (outFileName[0] != '\0')
+    {
+        foutput = fopen(outFileName, "wb");
+        if (foutput == NULL)
+        {
+            DEBUG(("UNABLE TO OPEN OUTPUT FILE\n"));
+            free(strm);
+            return -1;
+        }
+    }
+
+    decoderBuf = malloc(pvmp3_decoderMemRequirements());
+    pcm = (int16 *)malloc(OUTPUT_FRAME_SIZE * sizeof(int16));
+
+    for (pass = 0; pass < numPasses; pass++)
+    {
+        memset(&config, 0, sizeof(config));
+        config.equalizerType = flat;
+        config.crcEnabled = false;
+        pvmp3_InitDecoder(&config, decoderBuf);
+
+        pos = 0;
+        numPassFrames = 0;
+        while (pos < strmLen
+            && (maxNumFrames == 0 || numPassFrames < maxNumFrames))
+        {
+            config.pInputBuffer = strm + pos;
+            config.inputBufferCurrentLength = strmLen - pos;
+            config.inputBufferMaxLength = 0;
+            config.inputBufferUsedLength = 0;
+            config.outputFrameSize = OUTPUT_FRAME_SIZE;
+            config.pOutputBuffer = pcm;
+
+            clock_gettime(CLOCK_MONOTONIC, &startTime);
+            err = pvmp3_framedecoder(&config, decoderBuf);
+            clock_gettime(CLOCK_MONOTONIC, &endTime);
+
+            decodeTimeMs +=
+                (endTime.tv_sec - startTime.tv_sec) * 1000.0 +
+                (endTime.tv_nsec - startTime.tv_nsec) / 1000000.0;
+
+            if (err != NO_DECODING_ERROR)
+            {
+                /* tags and garbage between frames, move on to the next
+                 * sync word */
+                numErrors++;
+                if (config.inputBufferUsedLength == 0)
+                    config.inputBufferUsedLength = 1;
+            }
+            else
+            {
+                numPassFrames++;
+                numSamples += config.outputFrameSize / config.num_channels;
+                if (foutput && pass == 0)
+                    fwrite(pcm, sizeof(int16), config.outputFrameSize, foutput);
+            }
+
+            pos += config.inputBufferUsedLength;
+        }
+        numFrames += numPassFrames;
+    }
+
+    if (decodeTimeMs > 0.0)
+    {
+        DEBUG(("Decoded %d frames (%d errors) in %.1f ms, %.1f frames/s\n",
+            numFrames, numErrors, decodeTimeMs,
+            numFrames * 1000.0 / decodeTimeMs));
+        if (config.samplingRate > 0)
+        {
+            DEBUG(("%d Hz, %d channels, %.1fx real time\n",
+                config.samplingRate, config.num_channels,
+                numSamples / config.samplingRate * 1000.0 / decodeTimeMs));
+        }
+    }
+
+    if (foutput)
+        fclose(foutput);
+    free(pcm);
+    free(decoderBuf);
+    free(strm);
+
+    return numFrames > 0 ? 0 : -1;
+}
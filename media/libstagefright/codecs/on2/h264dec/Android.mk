@@ -26,6 +26,7 @@ LOCAL_SRC_FILES := \
 	./source/h264bsd_dpb.c \
 	./source/h264bsd_image.c \
 	./source/h264bsd_deblocking.c \
+	./source/h264bsd_filter_thread.c \
 	./source/h264bsd_conceal.c \
 	./source/h264bsd_vui.c \
 	./source/h264bsd_pic_order_cnt.c \
@@ -96,6 +97,10 @@ ifeq ($(ARCH_ARM_HAVE_NEON),true)
                         $(LOCAL_PATH)/./omxdl/arm_neon/vc/m4p10/api
 endif
 
+ifeq ($(TARGET_ARCH),x86)
+    LOCAL_CFLAGS     += -DH264DEC_SSE2 -msse2
+endif
+
 LOCAL_SHARED_LIBRARIES := \
 	libstagefright libstagefright_omx libstagefright_foundation libutils liblog \
 
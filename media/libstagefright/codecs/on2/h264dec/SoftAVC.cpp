@@ -25,6 +25,8 @@
 #include <media/stagefright/MediaErrors.h>
 #include <media/IOMX.h>
 
+#include <unistd.h>
+
 
 namespace android {
 
@@ -92,10 +94,17 @@ SoftAVC::~SoftAVC() {
 
 status_t SoftAVC::initDecoder() {
     // Force decoder to output buffers in display order.
-    if (H264SwDecInit(&mHandle, 0) == H264SWDEC_OK) {
-        return OK;
+    if (H264SwDecInit(&mHandle, 0) != H264SWDEC_OK) {
+        return UNKNOWN_ERROR;
+    }
+
+    // Run the deblocking filter on a second core if there is one.
+    if (sysconf(_SC_NPROCESSORS_ONLN) > 1
+            && H264SwDecSetNumThreads(mHandle, 2) != H264SWDEC_OK) {
+        ALOGW("Unable to start the deblocking thread");
     }
-    return UNKNOWN_ERROR;
+
+    return OK;
 }
 
 void SoftAVC::onQueueFilled(OMX_U32 portIndex) {
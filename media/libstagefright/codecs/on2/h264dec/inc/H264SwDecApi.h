@@ -157,6 +157,9 @@ extern "C"
 
     H264SwDecApiVersion H264SwDecGetAPIVersion(void);
 
+    H264SwDecRet H264SwDecSetNumThreads(H264SwDecInst decInst,
+                                        u32           numThreads);
+
     /* function prototype for API trace */
     void H264SwDecTrace(char *);
 
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /*------------------------------------------------------------------------------
     Module defines
@@ -37,6 +38,7 @@
 const char tagName[256] = "$Name: FIRST_ANDROID_COPYRIGHT $";
 
 void WriteOutput(char *filename, u8 *data, u32 picSize);
+void VerifyOutput(u8 *data, u32 picSize);
 u32 NextPacket(u8 **pStrm);
 u32 CropPicture(u8 *pOutImage, u8 *pInImage,
     u32 picWidth, u32 picHeight, CropParams *pCropParams);
@@ -46,6 +48,8 @@ u8 *streamStop = NULL;
 u32 packetize = 0;
 u32 nalUnitStream = 0;
 FILE *foutput = NULL;
+FILE *freference = NULL;
+u32 numMismatches = 0;
 
 #ifdef SOC_DESIGNER
 
@@ -102,6 +106,10 @@ int main(int argc, char **argv)
     u32 numErrors = 0;
     u32 cropDisplay = 0;
     u32 disableOutputReordering = 0;
+    u32 numThreads = 0;
+    u32 benchmark = 0;
+    struct timespec startTime, endTime;
+    double decodeTimeMs = 0.0;
 
     FILE *finput;
 
@@ -123,8 +131,8 @@ int main(int argc, char **argv)
     if (argc < 2)
     {
         DEBUG((
-            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-T] file.h264\n",
-            argv[0]));
+            "Usage: %s [-Nn] [-Ooutfile] [-Vreffile] [-Mn] [-B] [-P] [-U] [-C] "
+            "[-R] [-T] file.h264\n", argv[0]));
         DEBUG(("\t-Nn forces decoding to stop after n pictures\n"));
 #if defined(_NO_OUT)
         DEBUG(("\t-Ooutfile output writing disabled at compile time\n"));
@@ -132,6 +140,9 @@ int main(int argc, char **argv)
         DEBUG(("\t-Ooutfile write output to \"outfile\" (default out_wxxxhyyy.yuv)\n"));
         DEBUG(("\t-Onone does not write output\n"));
 #endif
+        DEBUG(("\t-Vreffile compare output pictures to \"reffile\"\n"));
+        DEBUG(("\t-Mn decode using n threads\n"));
+        DEBUG(("\t-B measure decoding time\n"));
         DEBUG(("\t-P packet-by-packet mode\n"));
         DEBUG(("\t-U NAL unit stream mode\n"));
         DEBUG(("\t-C display cropped image (default decoded image)\n"));
@@ -151,6 +162,23 @@ int main(int argc, char **argv)
         {
             strcpy(outFileName, argv[i]+2);
         }
+        else if ( strncmp(argv[i], "-V", 2) == 0 )
+        {
+            freference = fopen(argv[i]+2, "rb");
+            if (freference == NULL)
+            {
+                DEBUG(("UNABLE TO OPEN REFERENCE FILE\n"));
+                return -1;
+            }
+        }
+        else if ( strncmp(argv[i], "-M", 2) == 0 )
+        {
+            numThreads = (u32)atoi(argv[i]+2);
+        }
+        else if ( strcmp(argv[i], "-B") == 0 )
+        {
+            benchmark = 1;
+        }
         else if ( strcmp(argv[i], "-P") == 0 )
         {
             packetize = 1;
@@ -204,6 +232,18 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    if (numThreads)
+    {
+        ret = H264SwDecSetNumThreads(decInst, numThreads);
+        if (ret != H264SWDEC_OK)
+        {
+            DEBUG(("UNABLE TO USE %d THREADS\n", numThreads));
+            H264SwDecRelease(decInst);
+            free(byteStrmStart);
+            return -1;
+        }
+    }
+
     /* initialize H264SwDecDecode() input structure */
     streamStop = byteStrmStart + strmLen;
     decInput.pStream = byteStrmStart;
@@ -223,8 +263,19 @@ int main(int argc, char **argv)
         decInput.picId = picDecodeNumber;
 
         /* call API function to perform decoding */
+        if (benchmark)
+            clock_gettime(CLOCK_MONOTONIC, &startTime);
+
         ret = H264SwDecDecode(decInst, &decInput, &decOutput);
 
+        if (benchmark)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &endTime);
+            decodeTimeMs +=
+                (endTime.tv_sec - startTime.tv_sec) * 1000.0 +
+                (endTime.tv_nsec - startTime.tv_nsec) / 1000000.0;
+        }
+
         switch(ret)
         {
 
@@ -414,6 +465,20 @@ int main(int argc, char **argv)
     if (foutput)
         fclose(foutput);
 
+    if (freference)
+    {
+        fclose(freference);
+        DEBUG(("%d of %d pictures differ from reference\n",
+            numMismatches, picDisplayNumber - 1));
+    }
+
+    if (benchmark && decodeTimeMs > 0.0)
+    {
+        DEBUG(("Decoded %d pictures in %.1f ms, %.1f fps\n",
+            picDecodeNumber - 1, decodeTimeMs,
+            (picDecodeNumber - 1) * 1000.0 / decodeTimeMs));
+    }
+
     /* free allocated buffers */
     free(byteStrmStart);
     free(tmpImage);
@@ -421,7 +486,7 @@ int main(int argc, char **argv)
     DEBUG(("Output file: %s\n", outFileName));
 
     DEBUG(("DECODING DONE\n"));
-    if (numErrors || picDecodeNumber == 1)
+    if (numErrors || numMismatches || picDecodeNumber == 1)
     {
         DEBUG(("ERRORS FOUND\n"));
         return 1;
@@ -462,6 +527,45 @@ void WriteOutput(char *filename, u8 *data, u32 picSize)
 
     if (foutput && data)
         fwrite(data, 1, picSize, foutput);
+
+    if (freference && data)
+        VerifyOutput(data, picSize);
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  VerifyOutput
+
+    Purpose:
+        Compare picture pointed by data to the next picture in the reference
+        file. Size of the picture in pixels is indicated by picSize. Missing
+        reference pictures count as mismatches.
+
+------------------------------------------------------------------------------*/
+void VerifyOutput(u8 *data, u32 picSize)
+{
+
+    static u8 *refData = NULL;
+    static u32 refSize = 0;
+    static u32 picNumber = 0;
+
+    /* freference is global file pointer */
+    if (refSize < picSize)
+    {
+        free(refData);
+        refData = (u8 *)malloc(picSize);
+        refSize = refData ? picSize : 0;
+    }
+
+    picNumber++;
+
+    if (refData == NULL ||
+        fread(refData, 1, picSize, freference) != picSize ||
+        memcmp(refData, data, picSize) != 0)
+    {
+        DEBUG(("PIC %d DIFFERS FROM REFERENCE\n", picNumber));
+        numMismatches++;
+    }
 }
 
 /*------------------------------------------------------------------------------
@@ -29,6 +29,7 @@
           H264SwDecDecode
           H264SwDecGetAPIVersion
           H264SwDecNextPicture
+          H264SwDecSetNumThreads
 
 ------------------------------------------------------------------------------*/
 
@@ -564,4 +565,61 @@ H264SwDecRet H264SwDecNextPicture(H264SwDecInst decInst,
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: H264SwDecSetNumThreads
+
+        Functional description:
+            Set the number of threads used by the decoder instance. With two
+            or more threads the deblocking filter runs on a separate thread,
+            in parallel with the decoding of the following macroblock rows.
+            Default is one thread. Number of threads can only be reduced
+            between pictures.
+
+        Inputs:
+            decInst     decoder instance
+            numThreads  number of threads
+
+        Outputs:
+            none
+
+        Returns:
+            H264SWDEC_OK            success
+            H264SWDEC_PARAM_ERR     invalid parameters or picture in progress
+            H264SWDEC_INITFAIL      failed to create the thread
+
+------------------------------------------------------------------------------*/
+
+H264SwDecRet H264SwDecSetNumThreads(H264SwDecInst decInst, u32 numThreads)
+{
+
+    storage_t *pStorage;
+
+    DEC_API_TRC("H264SwDecSetNumThreads#");
+
+    if (decInst == NULL || numThreads == 0)
+    {
+        DEC_API_TRC("H264SwDecSetNumThreads# ERROR: decInst is NULL or numThreads is 0");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    pStorage = &(((decContainer_t *)decInst)->storage);
+
+    if (numThreads == 1 && pStorage->picStarted)
+    {
+        DEC_API_TRC("H264SwDecSetNumThreads# ERROR: Picture in progress");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    if (h264bsdSetNumThreads(pStorage, numThreads) != HANTRO_OK)
+    {
+        DEC_API_TRC("H264SwDecSetNumThreads# ERROR: Thread creation failed");
+        return(H264SWDEC_INITFAIL);
+    }
+
+    DEC_API_TRC("H264SwDecSetNumThreads# OK");
+
+    return(H264SWDEC_OK);
+
+}
 
@@ -24,6 +24,7 @@
      4. Local function prototypes
      5. Functions
           h264bsdFilterPicture
+          h264bsdFilterRows
           FilterVerLumaEdge
           FilterHorLumaEdge
           FilterHorLuma
@@ -40,6 +41,10 @@
           GetChromaEdgeThresholds
           FilterLuma
           FilterChroma
+          Transpose16x8
+          Transpose8x16
+          FilterLumaEdgeSse2
+          FilterChromaEdgeSse2
 
 ------------------------------------------------------------------------------*/
 
@@ -59,6 +64,10 @@
 #include "armVC.h"
 #endif /* H264DEC_OMXDL */
 
+#ifdef H264DEC_SSE2
+#include <emmintrin.h>
+#endif /* H264DEC_SSE2 */
+
 /*------------------------------------------------------------------------------
     2. External compiler flags
 --------------------------------------------------------------------------------
@@ -176,6 +185,7 @@ static void FilterLuma(u8 *data, bS_t *bS, edgeThreshold_t *thresholds,
 static void FilterChroma(u8 *cb, u8 *cr, bS_t *bS, edgeThreshold_t *thresholds,
         u32 imageWidth);
 
+#ifndef H264DEC_SSE2
 static void FilterVerLumaEdge( u8 *data, u32 bS, edgeThreshold_t *thresholds,
         u32 imageWidth);
 static void FilterHorLumaEdge( u8 *data, u32 bS, edgeThreshold_t *thresholds,
@@ -189,6 +199,14 @@ static void FilterHorChromaEdge( u8 *data, u32 bS, edgeThreshold_t *thresholds,
   i32 imageWidth);
 static void FilterHorChroma( u8 *data, u32 bS, edgeThreshold_t *thresholds,
   i32 imageWidth);
+#else
+static void Transpose16x8(const u8 *data, u32 width, __m128i *px);
+static void Transpose8x16(u8 *data, u32 width, __m128i *px);
+static void FilterLumaEdgeSse2(__m128i *px, __m128i bS,
+  edgeThreshold_t *thresholds);
+static void FilterChromaEdgeSse2(__m128i *px, __m128i bS,
+  edgeThreshold_t *thresholds);
+#endif /* H264DEC_SSE2 */
 
 static void GetLumaEdgeThresholds(
   edgeThreshold_t *thresholds,
@@ -548,20 +566,27 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
 #endif /* H264DEC_OMXDL */
 /*------------------------------------------------------------------------------
 
-    Function: h264bsdFilterPicture
+    Function: h264bsdFilterRows
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
+          Perform deblocking filtering for a range of macroblock rows of a
+          picture. Filter does not copy the original picture anywhere but
+          filtering is performed directly on the original image. Parameters
+          controlling the filtering process are computed based on information
+          in macroblock structures of the filtered macroblock, macroblock
+          above and macroblock on the left of the filtered one.
+
+          Filtering a row modifies the bottom pixels of the row above, rows
+          shall therefore be filtered in order. The row below does not have
+          to be filtered yet but it shall be completely decoded, its intra
+          prediction uses unfiltered pixels of the filtered row.
 
         Inputs:
           image         pointer to image to be filtered
           mb            pointer to macroblock data structure of the top-left
                         macroblock of the picture
+          firstRow      first macroblock row to be filtered
+          numRows       number of macroblock rows to be filtered
 
         Outputs:
           image         filtered image stored here
@@ -571,9 +596,11 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
 
 ------------------------------------------------------------------------------*/
 #ifndef H264DEC_OMXDL
-void h264bsdFilterPicture(
+void h264bsdFilterRows(
   image_t *image,
-  mbStorage_t *mb)
+  mbStorage_t *mb,
+  u32 firstRow,
+  u32 numRows)
 {
 
 /* Variables */
@@ -598,9 +625,11 @@ void h264bsdFilterPicture(
     data = image->data;
     picSizeInMbs = picWidthInMbs * image->height;
 
-    pMb = mb;
+    ASSERT(firstRow + numRows <= image->height);
+
+    pMb = mb + firstRow * picWidthInMbs;
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    for (mbRow = firstRow, mbCol = 0; mbRow < firstRow + numRows; pMb++)
     {
         flags = GetMbFilteringFlags(pMb);
 
@@ -638,6 +667,7 @@ void h264bsdFilterPicture(
 
 }
 
+#ifndef H264DEC_SSE2
 /*------------------------------------------------------------------------------
 
     Function: FilterVerLumaEdge
@@ -1119,6 +1149,7 @@ void FilterHorChroma(
     }
 
 }
+#endif /* H264DEC_SSE2 */
 
 
 /*------------------------------------------------------------------------------
@@ -1531,6 +1562,7 @@ void GetChromaEdgeThresholds(
 
 }
 
+#ifndef H264DEC_SSE2
 /*------------------------------------------------------------------------------
 
     Function: FilterLuma
@@ -1735,24 +1767,644 @@ void FilterChroma(
     }
 }
 
+#else /* H264DEC_SSE2 */
+
+/* Edges are filtered 16 pixels at a time, one pixel per byte lane of the
+ * registers px[0]...px[7] holding p3, p2, p1, p0, q0, q1, q2 and q3
+ * (px[0]...px[3] holding p1, p0, q0 and q1 for chroma). Vertical edges are
+ * transposed to this layout. All vertical edges of a macroblock are filtered
+ * before the horizontal ones, which gives the same result as the block row
+ * by block row order of the C implementation */
+
+/* lanes of a that are less than threshold t, zero and ones are helpers */
+#define LESS_THAN(a, t) \
+    _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8((t), (a)), zero), ones)
+
+#define ABS_DIFF(a, b) \
+    _mm_or_si128(_mm_subs_epu8((a), (b)), _mm_subs_epu8((b), (a)))
+
+/* select lanes of a where mask is set, lanes of b elsewhere */
+#define SELECT(mask, a, b) \
+    _mm_or_si128(_mm_and_si128((mask), (a)), _mm_andnot_si128((mask), (b)))
+
+/* bS values of four 4-pixel edge segments, one per 4 lanes */
+#define BS_VECTOR(b0, b1, b2, b3) \
+    _mm_set_epi32((i32)((b3) * 0x01010101), (i32)((b2) * 0x01010101), \
+                  (i32)((b1) * 0x01010101), (i32)((b0) * 0x01010101))
+
+/*------------------------------------------------------------------------------
+
+    Function: Transpose16x8
+
+        Functional description:
+            Load 8 pixels from 16 rows and transpose them so that px[i]
+            holds pixel i of each row.
+
+------------------------------------------------------------------------------*/
+static void Transpose16x8(const u8 *data, u32 width, __m128i *px)
+{
+
+/* Variables */
+
+    __m128i t[8], u[8], v[8];
+    u32 i;
+
+/* Code */
+
+    for (i = 0; i < 8; i++, data += 2*width)
+        t[i] = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i*)data),
+            _mm_loadl_epi64((const __m128i*)(data + width)));
+
+    for (i = 0; i < 4; i++)
+    {
+        u[2*i]   = _mm_unpacklo_epi16(t[2*i], t[2*i+1]);
+        u[2*i+1] = _mm_unpackhi_epi16(t[2*i], t[2*i+1]);
+    }
+
+    v[0] = _mm_unpacklo_epi32(u[0], u[2]);
+    v[1] = _mm_unpackhi_epi32(u[0], u[2]);
+    v[2] = _mm_unpacklo_epi32(u[1], u[3]);
+    v[3] = _mm_unpackhi_epi32(u[1], u[3]);
+    v[4] = _mm_unpacklo_epi32(u[4], u[6]);
+    v[5] = _mm_unpackhi_epi32(u[4], u[6]);
+    v[6] = _mm_unpacklo_epi32(u[5], u[7]);
+    v[7] = _mm_unpackhi_epi32(u[5], u[7]);
+
+    for (i = 0; i < 4; i++)
+    {
+        px[2*i]   = _mm_unpacklo_epi64(v[i], v[i+4]);
+        px[2*i+1] = _mm_unpackhi_epi64(v[i], v[i+4]);
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: Transpose8x16
+
+        Functional description:
+            Inverse of Transpose16x8, store 8 pixels to 16 rows.
+
+------------------------------------------------------------------------------*/
+static void Transpose8x16(u8 *data, u32 width, __m128i *px)
+{
+
+/* Variables */
+
+    __m128i a[8], b[8], d;
+    u32 i;
+
+/* Code */
+
+    for (i = 0; i < 4; i++)
+    {
+        a[2*i]   = _mm_unpacklo_epi8(px[2*i], px[2*i+1]);
+        a[2*i+1] = _mm_unpackhi_epi8(px[2*i], px[2*i+1]);
+    }
+
+    b[0] = _mm_unpacklo_epi16(a[0], a[2]);
+    b[1] = _mm_unpackhi_epi16(a[0], a[2]);
+    b[2] = _mm_unpacklo_epi16(a[1], a[3]);
+    b[3] = _mm_unpackhi_epi16(a[1], a[3]);
+    b[4] = _mm_unpacklo_epi16(a[4], a[6]);
+    b[5] = _mm_unpackhi_epi16(a[4], a[6]);
+    b[6] = _mm_unpacklo_epi16(a[5], a[7]);
+    b[7] = _mm_unpackhi_epi16(a[5], a[7]);
+
+    for (i = 0; i < 4; i++)
+    {
+        d = _mm_unpacklo_epi32(b[i], b[i+4]);
+        _mm_storel_epi64((__m128i*)data, d);
+        _mm_storel_epi64((__m128i*)(data + width), _mm_srli_si128(d, 8));
+        data += 2*width;
+        d = _mm_unpackhi_epi32(b[i], b[i+4]);
+        _mm_storel_epi64((__m128i*)data, d);
+        _mm_storel_epi64((__m128i*)(data + width), _mm_srli_si128(d, 8));
+        data += 2*width;
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterLumaEdgeSse2
+
+        Functional description:
+            Filter 16 pixels of a luma edge, bS given separately for each
+            pixel.
+
+------------------------------------------------------------------------------*/
+static void FilterLumaEdgeSse2(__m128i *px, __m128i bS,
+  edgeThreshold_t *thresholds)
+{
+
+/* Variables */
+
+    __m128i zero, ones, alpha, beta;
+    __m128i p3, p2, p1, p0, q0, q1, q2, q3;
+    __m128i mask, ap, aq, strong, normal, tc0, tc, small, sp, sq;
+    __m128i np2, np1, np0, nq0, nq1, nq2;
+    __m128i lo[6], hi[6];
+    __m128i P3, P2, P1, P0, Q0, Q1, Q2, Q3;
+    __m128i two, four, delta, avg, d, tmp, tcw, tc0w;
+    u32 half;
+
+/* Code */
+
+    zero = _mm_setzero_si128();
+    ones = _mm_cmpeq_epi8(zero, zero);
+    alpha = _mm_set1_epi8((i8)thresholds->alpha);
+    beta = _mm_set1_epi8((i8)thresholds->beta);
+
+    p3 = px[0]; p2 = px[1]; p1 = px[2]; p0 = px[3];
+    q0 = px[4]; q1 = px[5]; q2 = px[6]; q3 = px[7];
+
+    mask = _mm_and_si128(LESS_THAN(ABS_DIFF(p0, q0), alpha),
+                         LESS_THAN(ABS_DIFF(p1, p0), beta));
+    mask = _mm_and_si128(mask, LESS_THAN(ABS_DIFF(q1, q0), beta));
+    mask = _mm_andnot_si128(_mm_cmpeq_epi8(bS, zero), mask);
+    if (!_mm_movemask_epi8(mask))
+        return;
+
+    ap = LESS_THAN(ABS_DIFF(p2, p0), beta);
+    aq = LESS_THAN(ABS_DIFF(q2, q0), beta);
+
+    strong = _mm_and_si128(mask, _mm_cmpeq_epi8(bS, _mm_set1_epi8(4)));
+    normal = _mm_andnot_si128(strong, mask);
+
+    np2 = p2; np1 = p1; np0 = p0;
+    nq0 = q0; nq1 = q1; nq2 = q2;
+
+    two = _mm_set1_epi16(2);
+    four = _mm_set1_epi16(4);
+
+    if (_mm_movemask_epi8(normal))
+    {
+        tc0 = _mm_and_si128(_mm_cmpeq_epi8(bS, _mm_set1_epi8(1)),
+                            _mm_set1_epi8((i8)thresholds->tc0[0]));
+        tc0 = _mm_or_si128(tc0,
+                _mm_and_si128(_mm_cmpeq_epi8(bS, _mm_set1_epi8(2)),
+                              _mm_set1_epi8((i8)thresholds->tc0[1])));
+        tc0 = _mm_or_si128(tc0,
+                _mm_and_si128(_mm_cmpeq_epi8(bS, _mm_set1_epi8(3)),
+                              _mm_set1_epi8((i8)thresholds->tc0[2])));
+        tc = _mm_sub_epi8(_mm_sub_epi8(tc0, ap), aq);
+
+        for (half = 0; half < 2; half++)
+        {
+            if (half == 0)
+            {
+                P2 = _mm_unpacklo_epi8(p2, zero);
+                P1 = _mm_unpacklo_epi8(p1, zero);
+                P0 = _mm_unpacklo_epi8(p0, zero);
+                Q0 = _mm_unpacklo_epi8(q0, zero);
+                Q1 = _mm_unpacklo_epi8(q1, zero);
+                Q2 = _mm_unpacklo_epi8(q2, zero);
+                tcw = _mm_unpacklo_epi8(tc, zero);
+                tc0w = _mm_unpacklo_epi8(tc0, zero);
+            }
+            else
+            {
+                P2 = _mm_unpackhi_epi8(p2, zero);
+                P1 = _mm_unpackhi_epi8(p1, zero);
+                P0 = _mm_unpackhi_epi8(p0, zero);
+                Q0 = _mm_unpackhi_epi8(q0, zero);
+                Q1 = _mm_unpackhi_epi8(q1, zero);
+                Q2 = _mm_unpackhi_epi8(q2, zero);
+                tcw = _mm_unpackhi_epi8(tc, zero);
+                tc0w = _mm_unpackhi_epi8(tc0, zero);
+            }
+
+            /* delta = CLIP3(-tc, tc, (4(q0-p0) + (p1-q1) + 4) >> 3) */
+            delta = _mm_slli_epi16(_mm_sub_epi16(Q0, P0), 2);
+            delta = _mm_add_epi16(delta, _mm_sub_epi16(P1, Q1));
+            delta = _mm_srai_epi16(_mm_add_epi16(delta, four), 3);
+            delta = _mm_min_epi16(_mm_max_epi16(delta,
+                        _mm_sub_epi16(_mm_setzero_si128(), tcw)), tcw);
+
+            avg = _mm_avg_epu16(P0, Q0);
+
+            /* p1 + CLIP3(-tc0, tc0, (p2 + avg - 2p1) >> 1) */
+            d = _mm_sub_epi16(_mm_add_epi16(P2, avg), _mm_slli_epi16(P1, 1));
+            d = _mm_srai_epi16(d, 1);
+            d = _mm_min_epi16(_mm_max_epi16(d,
+                    _mm_sub_epi16(_mm_setzero_si128(), tc0w)), tc0w);
+            tmp = _mm_add_epi16(P1, d);
+
+            d = _mm_sub_epi16(_mm_add_epi16(Q2, avg), _mm_slli_epi16(Q1, 1));
+            d = _mm_srai_epi16(d, 1);
+            d = _mm_min_epi16(_mm_max_epi16(d,
+                    _mm_sub_epi16(_mm_setzero_si128(), tc0w)), tc0w);
+
+            if (half == 0)
+            {
+                lo[0] = tmp;
+                lo[1] = _mm_add_epi16(P0, delta);
+                lo[2] = _mm_sub_epi16(Q0, delta);
+                lo[3] = _mm_add_epi16(Q1, d);
+            }
+            else
+            {
+                hi[0] = tmp;
+                hi[1] = _mm_add_epi16(P0, delta);
+                hi[2] = _mm_sub_epi16(Q0, delta);
+                hi[3] = _mm_add_epi16(Q1, d);
+            }
+        }
+
+        np1 = SELECT(_mm_and_si128(normal, ap),
+                     _mm_packus_epi16(lo[0], hi[0]), np1);
+        np0 = SELECT(normal, _mm_packus_epi16(lo[1], hi[1]), np0);
+        nq0 = SELECT(normal, _mm_packus_epi16(lo[2], hi[2]), nq0);
+        nq1 = SELECT(_mm_and_si128(normal, aq),
+                     _mm_packus_epi16(lo[3], hi[3]), nq1);
+    }
+
+    if (_mm_movemask_epi8(strong))
+    {
+        small = LESS_THAN(ABS_DIFF(p0, q0),
+                    _mm_set1_epi8((i8)((thresholds->alpha >> 2) + 2)));
+        sp = _mm_and_si128(_mm_and_si128(strong, small), ap);
+        sq = _mm_and_si128(_mm_and_si128(strong, small), aq);
+
+        for (half = 0; half < 2; half++)
+        {
+            if (half == 0)
+            {
+                P3 = _mm_unpacklo_epi8(p3, zero);
+                P2 = _mm_unpacklo_epi8(p2, zero);
+                P1 = _mm_unpacklo_epi8(p1, zero);
+                P0 = _mm_unpacklo_epi8(p0, zero);
+                Q0 = _mm_unpacklo_epi8(q0, zero);
+                Q1 = _mm_unpacklo_epi8(q1, zero);
+                Q2 = _mm_unpacklo_epi8(q2, zero);
+                Q3 = _mm_unpacklo_epi8(q3, zero);
+            }
+            else
+            {
+                P3 = _mm_unpackhi_epi8(p3, zero);
+                P2 = _mm_unpackhi_epi8(p2, zero);
+                P1 = _mm_unpackhi_epi8(p1, zero);
+                P0 = _mm_unpackhi_epi8(p0, zero);
+                Q0 = _mm_unpackhi_epi8(q0, zero);
+                Q1 = _mm_unpackhi_epi8(q1, zero);
+                Q2 = _mm_unpackhi_epi8(q2, zero);
+                Q3 = _mm_unpackhi_epi8(q3, zero);
+            }
+
+            /* p side, tmp = p1 + p0 + q0 */
+            tmp = _mm_add_epi16(_mm_add_epi16(P1, P0), Q0);
+            d = _mm_add_epi16(_mm_add_epi16(P2, Q1), four);
+            d = _mm_add_epi16(d, _mm_slli_epi16(tmp, 1));
+            (half ? hi : lo)[0] = _mm_srli_epi16(d, 3);
+            d = _mm_add_epi16(_mm_add_epi16(P2, tmp), two);
+            (half ? hi : lo)[1] = _mm_srli_epi16(d, 2);
+            d = _mm_add_epi16(_mm_slli_epi16(P3, 1), _mm_add_epi16(P2, four));
+            d = _mm_add_epi16(d, _mm_add_epi16(_mm_slli_epi16(P2, 1), tmp));
+            (half ? hi : lo)[2] = _mm_srli_epi16(d, 3);
+
+            /* q side, tmp = p0 + q0 + q1 */
+            tmp = _mm_add_epi16(_mm_add_epi16(P0, Q0), Q1);
+            d = _mm_add_epi16(_mm_add_epi16(P1, Q2), four);
+            d = _mm_add_epi16(d, _mm_slli_epi16(tmp, 1));
+            (half ? hi : lo)[3] = _mm_srli_epi16(d, 3);
+            d = _mm_add_epi16(_mm_add_epi16(Q2, tmp), two);
+            (half ? hi : lo)[4] = _mm_srli_epi16(d, 2);
+            d = _mm_add_epi16(_mm_slli_epi16(Q3, 1), _mm_add_epi16(Q2, four));
+            d = _mm_add_epi16(d, _mm_add_epi16(_mm_slli_epi16(Q2, 1), tmp));
+            (half ? hi : lo)[5] = _mm_srli_epi16(d, 3);
+        }
+
+        /* weak variants (2p1 + p0 + q1 + 2) >> 2 and (2q1 + q0 + p1 + 2) >> 2
+         * computed as averages, exact for 8-bit input */
+        tmp = _mm_avg_epu8(p0, q1);
+        tmp = _mm_sub_epi8(tmp,
+                _mm_and_si128(_mm_xor_si128(p0, q1), _mm_set1_epi8(1)));
+        np0 = SELECT(strong, _mm_avg_epu8(p1, tmp), np0);
+        tmp = _mm_avg_epu8(q0, p1);
+        tmp = _mm_sub_epi8(tmp,
+                _mm_and_si128(_mm_xor_si128(q0, p1), _mm_set1_epi8(1)));
+        nq0 = SELECT(strong, _mm_avg_epu8(q1, tmp), nq0);
+
+        np0 = SELECT(sp, _mm_packus_epi16(lo[0], hi[0]), np0);
+        np1 = SELECT(sp, _mm_packus_epi16(lo[1], hi[1]), np1);
+        np2 = SELECT(sp, _mm_packus_epi16(lo[2], hi[2]), np2);
+        nq0 = SELECT(sq, _mm_packus_epi16(lo[3], hi[3]), nq0);
+        nq1 = SELECT(sq, _mm_packus_epi16(lo[4], hi[4]), nq1);
+        nq2 = SELECT(sq, _mm_packus_epi16(lo[5], hi[5]), nq2);
+    }
+
+    px[1] = np2; px[2] = np1; px[3] = np0;
+    px[4] = nq0; px[5] = nq1; px[6] = nq2;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterChromaEdgeSse2
+
+        Functional description:
+            Filter 16 pixels of chroma edges, bS given separately for each
+            pixel. Lanes 0...7 normally hold Cb and lanes 8...15 Cr pixels.
+
+------------------------------------------------------------------------------*/
+static void FilterChromaEdgeSse2(__m128i *px, __m128i bS,
+  edgeThreshold_t *thresholds)
+{
+
+/* Variables */
+
+    __m128i zero, ones, alpha, beta;
+    __m128i p1, p0, q0, q1;
+    __m128i mask, strong, normal, tc, tmp, np0, nq0;
+    __m128i P1, P0, Q0, Q1, delta, tcw, lo[2], hi[2];
+    u32 half;
+
+/* Code */
+
+    zero = _mm_setzero_si128();
+    ones = _mm_cmpeq_epi8(zero, zero);
+    alpha = _mm_set1_epi8((i8)thresholds->alpha);
+    beta = _mm_set1_epi8((i8)thresholds->beta);
+
+    p1 = px[0]; p0 = px[1]; q0 = px[2]; q1 = px[3];
+
+    mask = _mm_and_si128(LESS_THAN(ABS_DIFF(p0, q0), alpha),
+                         LESS_THAN(ABS_DIFF(p1, p0), beta));
+    mask = _mm_and_si128(mask, LESS_THAN(ABS_DIFF(q1, q0), beta));
+    mask = _mm_andnot_si128(_mm_cmpeq_epi8(bS, zero), mask);
+    if (!_mm_movemask_epi8(mask))
+        return;
+
+    strong = _mm_and_si128(mask, _mm_cmpeq_epi8(bS, _mm_set1_epi8(4)));
+    normal = _mm_andnot_si128(strong, mask);
+
+    np0 = p0;
+    nq0 = q0;
+
+    if (_mm_movemask_epi8(normal))
+    {
+        /* tc = tc0 + 1 */
+        tc = _mm_set1_epi8(1);
+        tc = _mm_add_epi8(tc,
+                _mm_and_si128(_mm_cmpeq_epi8(bS, _mm_set1_epi8(1)),
+                              _mm_set1_epi8((i8)thresholds->tc0[0])));
+        tc = _mm_add_epi8(tc,
+                _mm_and_si128(_mm_cmpeq_epi8(bS, _mm_set1_epi8(2)),
+                              _mm_set1_epi8((i8)thresholds->tc0[1])));
+        tc = _mm_add_epi8(tc,
+                _mm_and_si128(_mm_cmpeq_epi8(bS, _mm_set1_epi8(3)),
+                              _mm_set1_epi8((i8)thresholds->tc0[2])));
+
+        for (half = 0; half < 2; half++)
+        {
+            if (half == 0)
+            {
+                P1 = _mm_unpacklo_epi8(p1, zero);
+                P0 = _mm_unpacklo_epi8(p0, zero);
+                Q0 = _mm_unpacklo_epi8(q0, zero);
+                Q1 = _mm_unpacklo_epi8(q1, zero);
+                tcw = _mm_unpacklo_epi8(tc, zero);
+            }
+            else
+            {
+                P1 = _mm_unpackhi_epi8(p1, zero);
+                P0 = _mm_unpackhi_epi8(p0, zero);
+                Q0 = _mm_unpackhi_epi8(q0, zero);
+                Q1 = _mm_unpackhi_epi8(q1, zero);
+                tcw = _mm_unpackhi_epi8(tc, zero);
+            }
+
+            delta = _mm_slli_epi16(_mm_sub_epi16(Q0, P0), 2);
+            delta = _mm_add_epi16(delta, _mm_sub_epi16(P1, Q1));
+            delta = _mm_srai_epi16(_mm_add_epi16(delta, _mm_set1_epi16(4)), 3);
+            delta = _mm_min_epi16(_mm_max_epi16(delta,
+                        _mm_sub_epi16(_mm_setzero_si128(), tcw)), tcw);
+
+            (half ? hi : lo)[0] = _mm_add_epi16(P0, delta);
+            (half ? hi : lo)[1] = _mm_sub_epi16(Q0, delta);
+        }
+
+        np0 = SELECT(normal, _mm_packus_epi16(lo[0], hi[0]), np0);
+        nq0 = SELECT(normal, _mm_packus_epi16(lo[1], hi[1]), nq0);
+    }
+
+    if (_mm_movemask_epi8(strong))
+    {
+        /* (2p1 + p0 + q1 + 2) >> 2 == avg(p1, floor((p0 + q1) / 2)) */
+        tmp = _mm_avg_epu8(p0, q1);
+        tmp = _mm_sub_epi8(tmp,
+                _mm_and_si128(_mm_xor_si128(p0, q1), _mm_set1_epi8(1)));
+        np0 = SELECT(strong, _mm_avg_epu8(p1, tmp), np0);
+        tmp = _mm_avg_epu8(q0, p1);
+        tmp = _mm_sub_epi8(tmp,
+                _mm_and_si128(_mm_xor_si128(q0, p1), _mm_set1_epi8(1)));
+        nq0 = SELECT(strong, _mm_avg_epu8(q1, tmp), nq0);
+    }
+
+    px[1] = np0;
+    px[2] = nq0;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterLuma
+
+        Functional description:
+            Function to filter all luma edges of a macroblock
+
+------------------------------------------------------------------------------*/
+void FilterLuma(
+  u8 *data,
+  bS_t *bS,
+  edgeThreshold_t *thresholds,
+  u32 width)
+{
+
+/* Variables */
+
+    u32 i, k;
+    __m128i px[8];
+    u8 *ptr;
+
+/* Code */
+
+    ASSERT(data);
+    ASSERT(bS);
+    ASSERT(thresholds);
+
+    /* vertical edges, all 16 rows at once */
+    for (i = 0; i < 4; i++)
+    {
+        if (!(bS[i].left | bS[4+i].left | bS[8+i].left | bS[12+i].left))
+            continue;
+
+        Transpose16x8(data - 4 + 4*i, width, px);
+        FilterLumaEdgeSse2(px,
+            BS_VECTOR(bS[i].left, bS[4+i].left, bS[8+i].left, bS[12+i].left),
+            thresholds + (i ? INNER : LEFT));
+        Transpose8x16(data - 4 + 4*i, width, px);
+    }
+
+    /* horizontal edges */
+    for (i = 0; i < 4; i++, bS += 4)
+    {
+        if (!(bS[0].top | bS[1].top | bS[2].top | bS[3].top))
+            continue;
+
+        ptr = data - 4*width + 4*i*width;
+        for (k = 0; k < 8; k++)
+            px[k] = _mm_loadu_si128((const __m128i*)(ptr + k*width));
+
+        FilterLumaEdgeSse2(px,
+            BS_VECTOR(bS[0].top, bS[1].top, bS[2].top, bS[3].top),
+            thresholds + (i ? INNER : TOP));
+
+        for (k = 1; k < 7; k++)
+            _mm_storeu_si128((__m128i*)(ptr + k*width), px[k]);
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterChroma
+
+        Functional description:
+            Function to filter all chroma edges of a macroblock. Cb and Cr
+            are filtered at the same time, Cb in lanes 0...7 and Cr in lanes
+            8...15.
+
+------------------------------------------------------------------------------*/
+void FilterChroma(
+  u8 *dataCb,
+  u8 *dataCr,
+  bS_t *bS,
+  edgeThreshold_t *thresholds,
+  u32 width)
+{
+
+/* Variables */
+
+    u32 i, k;
+    __m128i px[4], t[8], u[4], v[4];
+    u8 *ptr;
+    u8 b[16], p0[16], q0[16];
+
+/* Code */
+
+    ASSERT(dataCb);
+    ASSERT(dataCr);
+    ASSERT(bS);
+    ASSERT(thresholds);
+
+    /* vertical edges, left edge uses bS of luma blocks 0, 4, 8 and 12,
+     * inner edge bS of blocks 2, 6, 10 and 14, each bS for two rows */
+    for (i = 0; i < 2; i++)
+    {
+        if (!(bS[2*i].left | bS[4+2*i].left | bS[8+2*i].left |
+              bS[12+2*i].left))
+            continue;
+
+        for (k = 0; k < 8; k++)
+        {
+            ptr = (k < 4 ? dataCb : dataCr) - 2 + (2*(k & 3)) * width + 4*i;
+            t[k] = _mm_unpacklo_epi8(
+                _mm_cvtsi32_si128(
+                    (i32)(ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) |
+                          ((u32)ptr[3] << 24))),
+                _mm_cvtsi32_si128(
+                    (i32)(ptr[width] | (ptr[width+1] << 8) |
+                          (ptr[width+2] << 16) | ((u32)ptr[width+3] << 24))));
+            b[2*k] = b[2*k+1] = (u8)bS[4*(k & 3) + 2*i].left;
+        }
+
+        for (k = 0; k < 4; k++)
+            u[k] = _mm_unpacklo_epi16(t[2*k], t[2*k+1]);
+        v[0] = _mm_unpacklo_epi32(u[0], u[1]);
+        v[1] = _mm_unpackhi_epi32(u[0], u[1]);
+        v[2] = _mm_unpacklo_epi32(u[2], u[3]);
+        v[3] = _mm_unpackhi_epi32(u[2], u[3]);
+        px[0] = _mm_unpacklo_epi64(v[0], v[2]);
+        px[1] = _mm_unpackhi_epi64(v[0], v[2]);
+        px[2] = _mm_unpacklo_epi64(v[1], v[3]);
+        px[3] = _mm_unpackhi_epi64(v[1], v[3]);
+
+        FilterChromaEdgeSse2(px, _mm_loadu_si128((const __m128i*)b),
+            thresholds + (i ? INNER : LEFT));
+
+        /* only p0 and q0 modified */
+        _mm_storeu_si128((__m128i*)p0, px[1]);
+        _mm_storeu_si128((__m128i*)q0, px[2]);
+        for (k = 0; k < 8; k++)
+        {
+            ptr = dataCb - 1 + k * width + 4*i;
+            ptr[0] = p0[k];
+            ptr[1] = q0[k];
+            ptr = dataCr - 1 + k * width + 4*i;
+            ptr[0] = p0[k+8];
+            ptr[1] = q0[k+8];
+        }
+    }
+
+    /* horizontal edges, top edge uses bS of luma blocks 0...3, inner edge
+     * bS of blocks 8...11, each bS for two columns */
+    for (i = 0; i < 2; i++, bS += 8)
+    {
+        if (!(bS[0].top | bS[1].top | bS[2].top | bS[3].top))
+            continue;
+
+        for (k = 0; k < 4; k++)
+            px[k] = _mm_unpacklo_epi64(
+                _mm_loadl_epi64(
+                    (const __m128i*)(dataCb - 2*width + (4*i + k) * width)),
+                _mm_loadl_epi64(
+                    (const __m128i*)(dataCr - 2*width + (4*i + k) * width)));
+        for (k = 0; k < 8; k++)
+            b[k] = b[k+8] = (u8)bS[k >> 1].top;
+
+        FilterChromaEdgeSse2(px, _mm_loadu_si128((const __m128i*)b),
+            thresholds + (i ? INNER : TOP));
+
+        for (k = 1; k < 3; k++)
+        {
+            _mm_storel_epi64(
+                (__m128i*)(dataCb - 2*width + (4*i + k) * width), px[k]);
+            _mm_storel_epi64(
+                (__m128i*)(dataCr - 2*width + (4*i + k) * width),
+                _mm_srli_si128(px[k], 8));
+        }
+    }
+}
+
+#endif /* H264DEC_SSE2 */
+
 #else /* H264DEC_OMXDL */
 
 /*------------------------------------------------------------------------------
 
-    Function: h264bsdFilterPicture
+    Function: h264bsdFilterRows
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
+          Perform deblocking filtering for a range of macroblock rows of a
+          picture. Filter does not copy the original picture anywhere but
+          filtering is performed directly on the original image. Parameters
+          controlling the filtering process are computed based on information
+          in macroblock structures of the filtered macroblock, macroblock
+          above and macroblock on the left of the filtered one.
+
+          Filtering a row modifies the bottom pixels of the row above, rows
+          shall therefore be filtered in order. The row below does not have
+          to be filtered yet but it shall be completely decoded, its intra
+          prediction uses unfiltered pixels of the filtered row.
 
         Inputs:
           image         pointer to image to be filtered
           mb            pointer to macroblock data structure of the top-left
                         macroblock of the picture
+          firstRow      first macroblock row to be filtered
+          numRows       number of macroblock rows to be filtered
 
         Outputs:
           image         filtered image stored here
@@ -1763,9 +2415,11 @@ void FilterChroma(
 ------------------------------------------------------------------------------*/
 
 /*lint --e{550} Symbol not accessed */
-void h264bsdFilterPicture(
+void h264bsdFilterRows(
   image_t *image,
-  mbStorage_t *mb)
+  mbStorage_t *mb,
+  u32 firstRow,
+  u32 numRows)
 {
 
 /* Variables */
@@ -1794,9 +2448,11 @@ void h264bsdFilterPicture(
     data = image->data;
     picSizeInMbs = picWidthInMbs * image->height;
 
-    pMb = mb;
+    ASSERT(firstRow + numRows <= image->height);
+
+    pMb = mb + firstRow * picWidthInMbs;
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    for (mbRow = firstRow, mbCol = 0; mbRow < firstRow + numRows; pMb++)
     {
         flags = GetMbFilteringFlags(pMb);
 
@@ -2413,5 +3069,38 @@ void GetChromaEdgeThresholds(
 
 #endif /* H264DEC_OMXDL */
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterPicture
+
+        Functional description:
+          Perform deblocking filtering for a picture, see h264bsdFilterRows.
+
+        Inputs:
+          image         pointer to image to be filtered
+          mb            pointer to macroblock data structure of the top-left
+                        macroblock of the picture
+
+        Outputs:
+          image         filtered image stored here
+
+        Returns:
+          none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterPicture(
+  image_t *image,
+  mbStorage_t *mb)
+{
+
+/* Code */
+
+    ASSERT(image);
+
+    h264bsdFilterRows(image, mb, 0, image->height);
+
+}
+
 /*lint +e701 +e702 */
 
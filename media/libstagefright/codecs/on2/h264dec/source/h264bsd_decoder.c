@@ -35,6 +35,7 @@
           h264bsdVideoRange
           h264bsdMatrixCoefficients
           h264bsdCroppingParams
+          h264bsdSetNumThreads
 
 ------------------------------------------------------------------------------*/
 
@@ -54,6 +55,7 @@
 #include "h264bsd_dpb.h"
 #include "h264bsd_deblocking.h"
 #include "h264bsd_conceal.h"
+#include "h264bsd_filter_thread.h"
 
 /*------------------------------------------------------------------------------
     2. External compiler flags
@@ -230,6 +232,9 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
         {
             DEBUG(("CONCEALING..."));
 
+            /* concealment reads and writes pixels of the whole picture */
+            h264bsdFilterThreadSync(pStorage->filterThread);
+
             /* return error if second phase of
              * initialization is not completed */
             if (pStorage->pendingActivation)
@@ -420,6 +425,8 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                     }
                     pStorage->currImage->data =
                         h264bsdAllocateDpbImage(pStorage->dpb);
+                    h264bsdFilterThreadStartPicture(pStorage->filterThread,
+                        pStorage->currImage, pStorage->mb);
                 }
 
                 /* store slice header to storage if successfully decoded */
@@ -441,6 +448,11 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                     return(H264BSD_ERROR);
                 }
 
+                /* redundant slice may overwrite decoded macroblocks */
+                if (pStorage->sliceHeader->redundantPicCnt)
+                    h264bsdFilterThreadUndo(pStorage->filterThread,
+                        pStorage->sliceHeader->firstMbInSlice);
+
                 DEBUG(("SLICE DATA, FIRST %d\n",
                         pStorage->sliceHeader->firstMbInSlice));
                 tmp = h264bsdDecodeSliceData(&strm, pStorage,
@@ -450,6 +462,10 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                     EPRINT("SLICE_DATA");
                     h264bsdMarkSliceCorrupted(pStorage,
                         pStorage->sliceHeader->firstMbInSlice);
+                    /* corrupted macroblocks will be concealed or decoded
+                     * again */
+                    h264bsdFilterThreadUndo(pStorage->filterThread,
+                        pStorage->sliceHeader->firstMbInSlice);
                     return(H264BSD_ERROR);
                 }
 
@@ -471,7 +487,8 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
 
     if (picReady)
     {
-        h264bsdFilterPicture(pStorage->currImage, pStorage->mb);
+        h264bsdFilterThreadFinishPicture(pStorage->filterThread,
+            pStorage->currImage, pStorage->mb);
 
         h264bsdResetStorage(pStorage);
 
@@ -541,6 +558,9 @@ void h264bsdShutdown(storage_t *pStorage)
 
     ASSERT(pStorage);
 
+    h264bsdFilterThreadDestroy(pStorage->filterThread);
+    pStorage->filterThread = NULL;
+
     for (i = 0; i < MAX_NUM_SEQ_PARAM_SETS; i++)
     {
         if (pStorage->sps[i])
@@ -959,3 +979,48 @@ u32 h264bsdProfile(storage_t *pStorage)
         return 0;
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdSetNumThreads
+
+        Functional description:
+            Set number of threads used for decoding. With more than one
+            thread the deblocking filter runs on a separate thread, one
+            macroblock row behind the decoding of the picture.
+
+        Inputs:
+            pStorage    pointer to storage structure
+            numThreads  number of threads
+
+        Returns:
+            HANTRO_OK   success
+            HANTRO_NOK  failed to create the filter thread or trying to
+                        stop it in the middle of a picture
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdSetNumThreads(storage_t *pStorage, u32 numThreads)
+{
+
+/* Code */
+
+    ASSERT(pStorage);
+
+    if (numThreads > 1)
+    {
+        if (pStorage->filterThread == NULL)
+            return(h264bsdFilterThreadCreate(&pStorage->filterThread));
+    }
+    else if (pStorage->filterThread)
+    {
+        /* part of the current picture may have been filtered already */
+        if (pStorage->picStarted)
+            return(HANTRO_NOK);
+
+        h264bsdFilterThreadDestroy(pStorage->filterThread);
+        pStorage->filterThread = NULL;
+    }
+
+    return(HANTRO_OK);
+}
+
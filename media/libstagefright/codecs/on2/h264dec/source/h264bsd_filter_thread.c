@@ -0,0 +1,596 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Table of contents
+
+     1. Include headers
+     2. External compiler flags
+     3. Module defines
+     4. Local function prototypes
+     5. Functions
+          h264bsdFilterThreadCreate
+          h264bsdFilterThreadDestroy
+          h264bsdFilterThreadStartPicture
+          h264bsdFilterThreadMbDecoded
+          h264bsdFilterThreadSync
+          h264bsdFilterThreadUndo
+          h264bsdFilterThreadFinishPicture
+          FilterThreadMain
+          CopyRow
+
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+    1. Include headers
+------------------------------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include "h264bsd_filter_thread.h"
+#include "h264bsd_deblocking.h"
+#include "h264bsd_util.h"
+
+/*------------------------------------------------------------------------------
+    2. External compiler flags
+--------------------------------------------------------------------------------
+
+--------------------------------------------------------------------------------
+    3. Module defines
+------------------------------------------------------------------------------*/
+
+/* Deblocking of a macroblock row modifies the bottom pixel rows of the row
+ * above and all pixel rows of the row itself. Intra prediction of the row
+ * below needs the unfiltered bottom pixel row, a row is therefore released
+ * to the filter thread once the row below it has been completely decoded.
+ * Rows are filtered in order, one at a time or in batches, while the
+ * decoding thread keeps on decoding the following rows.
+ *
+ * Error handling may find out later that macroblocks of released rows have
+ * to be decoded again or concealed, which would then read filtered instead
+ * of unfiltered neighbours. Before a row is filtered, all the pixels its
+ * filtering modifies are saved, so that filtering can be undone row by row
+ * in reverse order. */
+
+/* pixel rows above a macroblock row modified by its filtering */
+#define LUMA_LINES_ABOVE    3
+#define CHROMA_LINES_ABOVE  1
+
+/* bytes saved per macroblock of a row */
+#define BACKUP_PER_MB \
+    ((16 + LUMA_LINES_ABOVE) * 16 + 2 * (8 + CHROMA_LINES_ABOVE) * 8)
+
+struct filterThread
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t rowsReleasedCond;
+    pthread_cond_t rowsFilteredCond;
+
+    /* protected by lock */
+    image_t image;
+    mbStorage_t *mb;
+    u32 rowsReleased;
+    u32 rowsFiltered;
+    u32 quit;
+
+    /* saved pixels of each row, written by the filter thread, read by the
+     * decoding thread after h264bsdFilterThreadSync */
+    u8 *backup;
+    u32 backupMbs;
+
+    /* only accessed by the decoding thread */
+    u32 active;
+    u32 inOrder;
+    u32 nextMbAddr;
+};
+
+/*------------------------------------------------------------------------------
+    4. Local function prototypes
+------------------------------------------------------------------------------*/
+
+static void *FilterThreadMain(void *arg);
+static void CopyRow(filterThread_t *pThread, image_t *image, u32 row,
+    u32 restore);
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadCreate
+
+        Functional description:
+            Create a deblocking filter thread.
+
+        Inputs:
+            none
+
+        Outputs:
+            ppThread    pointer to created filter thread stored here
+
+        Returns:
+            HANTRO_OK   success
+            HANTRO_NOK  failed to allocate memory or create the thread
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdFilterThreadCreate(filterThread_t **ppThread)
+{
+
+/* Variables */
+
+    filterThread_t *pThread;
+
+/* Code */
+
+    ASSERT(ppThread);
+
+    *ppThread = NULL;
+
+    ALLOCATE(pThread, 1, filterThread_t);
+    if (pThread == NULL)
+        return(HANTRO_NOK);
+
+    H264SwDecMemset(pThread, 0, sizeof(filterThread_t));
+
+    pthread_mutex_init(&pThread->lock, NULL);
+    pthread_cond_init(&pThread->rowsReleasedCond, NULL);
+    pthread_cond_init(&pThread->rowsFilteredCond, NULL);
+
+    if (pthread_create(&pThread->thread, NULL, FilterThreadMain, pThread))
+    {
+        pthread_cond_destroy(&pThread->rowsFilteredCond);
+        pthread_cond_destroy(&pThread->rowsReleasedCond);
+        pthread_mutex_destroy(&pThread->lock);
+        FREE(pThread);
+        return(HANTRO_NOK);
+    }
+
+    *ppThread = pThread;
+
+    return(HANTRO_OK);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadDestroy
+
+        Functional description:
+            Stop the filter thread and free all the memories allocated for
+            it. Rows released but not yet filtered are filtered first.
+
+        Inputs:
+            pThread     pointer to filter thread, may be NULL
+
+        Outputs:
+            none
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadDestroy(filterThread_t *pThread)
+{
+
+/* Code */
+
+    if (pThread == NULL)
+        return;
+
+    h264bsdFilterThreadSync(pThread);
+
+    pthread_mutex_lock(&pThread->lock);
+    pThread->quit = HANTRO_TRUE;
+    pthread_cond_signal(&pThread->rowsReleasedCond);
+    pthread_mutex_unlock(&pThread->lock);
+
+    pthread_join(pThread->thread, NULL);
+
+    pthread_cond_destroy(&pThread->rowsFilteredCond);
+    pthread_cond_destroy(&pThread->rowsReleasedCond);
+    pthread_mutex_destroy(&pThread->lock);
+
+    FREE(pThread->backup);
+    FREE(pThread);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadStartPicture
+
+        Functional description:
+            Start deblocking of a new picture. Macroblocks of the picture
+            shall be reported to h264bsdFilterThreadMbDecoded as they are
+            decoded. The whole picture is filtered by
+            h264bsdFilterThreadFinishPicture if memory for the saved pixels
+            cannot be allocated.
+
+        Inputs:
+            pThread     pointer to filter thread, may be NULL
+            image       pointer to the picture
+            mb          pointer to macroblock data structure of the top-left
+                        macroblock of the picture
+
+        Outputs:
+            none
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadStartPicture(filterThread_t *pThread,
+    image_t *image, mbStorage_t *mb)
+{
+
+/* Code */
+
+    ASSERT(image);
+    ASSERT(mb);
+
+    if (pThread == NULL)
+        return;
+
+    h264bsdFilterThreadSync(pThread);
+
+    if (pThread->backupMbs != image->width * image->height)
+    {
+        FREE(pThread->backup);
+        pThread->backupMbs = 0;
+        ALLOCATE(pThread->backup, image->width * image->height * BACKUP_PER_MB,
+            u8);
+        if (pThread->backup == NULL)
+        {
+            pThread->active = HANTRO_FALSE;
+            return;
+        }
+        pThread->backupMbs = image->width * image->height;
+    }
+
+    pthread_mutex_lock(&pThread->lock);
+    pThread->image = *image;
+    pThread->mb = mb;
+    pThread->rowsReleased = 0;
+    pThread->rowsFiltered = 0;
+    pthread_mutex_unlock(&pThread->lock);
+
+    pThread->active = HANTRO_TRUE;
+    pThread->inOrder = HANTRO_TRUE;
+    pThread->nextMbAddr = 0;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadMbDecoded
+
+        Functional description:
+            Report a successfully decoded macroblock of the current picture.
+            Rows are only released while the macroblocks are decoded in
+            raster scan order, i.e. with flexible macroblock ordering,
+            arbitrary slice ordering or missing slices the rest of the
+            picture is filtered by h264bsdFilterThreadFinishPicture.
+
+        Inputs:
+            pThread     pointer to filter thread, may be NULL
+            mbAddr      address of the decoded macroblock
+
+        Outputs:
+            none
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadMbDecoded(filterThread_t *pThread, u32 mbAddr)
+{
+
+/* Variables */
+
+    u32 rows;
+
+/* Code */
+
+    if (pThread == NULL || !pThread->active || !pThread->inOrder)
+        return;
+
+    if (mbAddr != pThread->nextMbAddr)
+    {
+        pThread->inOrder = HANTRO_FALSE;
+        return;
+    }
+
+    pThread->nextMbAddr++;
+    if (pThread->nextMbAddr % pThread->image.width)
+        return;
+
+    /* row completed, the one above it may be filtered now */
+    rows = pThread->nextMbAddr / pThread->image.width;
+    if (rows > 1)
+    {
+        pthread_mutex_lock(&pThread->lock);
+        pThread->rowsReleased = rows - 1;
+        pthread_cond_signal(&pThread->rowsReleasedCond);
+        pthread_mutex_unlock(&pThread->lock);
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadSync
+
+        Functional description:
+            Wait until all the released rows have been filtered. Shall be
+            called before any of the pixels or macroblock data of the
+            released rows is modified or freed.
+
+        Inputs:
+            pThread     pointer to filter thread, may be NULL
+
+        Outputs:
+            none
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadSync(filterThread_t *pThread)
+{
+
+/* Code */
+
+    if (pThread == NULL)
+        return;
+
+    pthread_mutex_lock(&pThread->lock);
+    while (pThread->rowsFiltered != pThread->rowsReleased)
+        pthread_cond_wait(&pThread->rowsFilteredCond, &pThread->lock);
+    pthread_mutex_unlock(&pThread->lock);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadUndo
+
+        Functional description:
+            Undo filtering of the rows that decoding or concealment of the
+            macroblock at mbAddr, or of any macroblock after it, may read.
+            Shall be called before macroblocks of the current picture are
+            decoded again or concealed, i.e. when a slice is found corrupted
+            or a redundant slice is about to be decoded. No more rows are
+            released for the current picture, the rest of it is filtered by
+            h264bsdFilterThreadFinishPicture.
+
+        Inputs:
+            pThread     pointer to filter thread, may be NULL
+            mbAddr      address of the first macroblock to be decoded again
+                        or concealed
+
+        Outputs:
+            none
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadUndo(filterThread_t *pThread, u32 mbAddr)
+{
+
+/* Variables */
+
+    u32 row;
+
+/* Code */
+
+    if (pThread == NULL || !pThread->active)
+        return;
+
+    h264bsdFilterThreadSync(pThread);
+    pThread->inOrder = HANTRO_FALSE;
+
+    /* intra prediction and concealment read the bottom pixels of the row
+     * above, it shall not be filtered either */
+    row = mbAddr / pThread->image.width;
+    row = row ? row - 1 : 0;
+
+    pthread_mutex_lock(&pThread->lock);
+    while (pThread->rowsFiltered > row)
+    {
+        pThread->rowsFiltered--;
+        CopyRow(pThread, &pThread->image, pThread->rowsFiltered, HANTRO_TRUE);
+    }
+    pThread->rowsReleased = pThread->rowsFiltered;
+    pthread_mutex_unlock(&pThread->lock);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterThreadFinishPicture
+
+        Functional description:
+            Complete deblocking of the current picture. Rows not filtered by
+            the filter thread are filtered by the calling thread. Whole
+            picture is filtered if there is no filter thread or the picture
+            was not started with h264bsdFilterThreadStartPicture.
+
+        Inputs:
+            pThread     pointer to filter thread, may be NULL
+            image       pointer to the picture
+            mb          pointer to macroblock data structure of the top-left
+                        macroblock of the picture
+
+        Outputs:
+            image       filtered image stored here
+
+        Returns:
+            none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdFilterThreadFinishPicture(filterThread_t *pThread,
+    image_t *image, mbStorage_t *mb)
+{
+
+/* Variables */
+
+    u32 firstRow;
+
+/* Code */
+
+    ASSERT(image);
+    ASSERT(mb);
+
+    if (pThread == NULL || !pThread->active)
+    {
+        h264bsdFilterPicture(image, mb);
+        return;
+    }
+
+    h264bsdFilterThreadSync(pThread);
+    pThread->active = HANTRO_FALSE;
+
+    if (image->data != pThread->image.data || mb != pThread->mb)
+        firstRow = 0;
+    else
+        firstRow = pThread->rowsFiltered;
+
+    h264bsdFilterRows(image, mb, firstRow, image->height - firstRow);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterThreadMain
+
+        Functional description:
+            Main loop of the filter thread, filters released rows until
+            asked to quit.
+
+------------------------------------------------------------------------------*/
+
+static void *FilterThreadMain(void *arg)
+{
+
+/* Variables */
+
+    filterThread_t *pThread = (filterThread_t *)arg;
+    image_t image;
+    mbStorage_t *mb;
+    u32 firstRow, numRows, row;
+
+/* Code */
+
+    pthread_mutex_lock(&pThread->lock);
+
+    for (;;)
+    {
+        while (!pThread->quit &&
+               pThread->rowsFiltered == pThread->rowsReleased)
+            pthread_cond_wait(&pThread->rowsReleasedCond, &pThread->lock);
+
+        if (pThread->quit)
+            break;
+
+        image = pThread->image;
+        mb = pThread->mb;
+        firstRow = pThread->rowsFiltered;
+        numRows = pThread->rowsReleased - firstRow;
+
+        pthread_mutex_unlock(&pThread->lock);
+
+        for (row = firstRow; row < firstRow + numRows; row++)
+        {
+            CopyRow(pThread, &image, row, HANTRO_FALSE);
+            h264bsdFilterRows(&image, mb, row, 1);
+        }
+
+        pthread_mutex_lock(&pThread->lock);
+
+        pThread->rowsFiltered += numRows;
+        pthread_cond_signal(&pThread->rowsFilteredCond);
+    }
+
+    pthread_mutex_unlock(&pThread->lock);
+
+    return(NULL);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: CopyRow
+
+        Functional description:
+            Save the pixels modified by filtering of a macroblock row, or
+            restore them. These are the pixels of the row itself and the
+            bottom pixel rows of the row above.
+
+------------------------------------------------------------------------------*/
+
+static void CopyRow(filterThread_t *pThread, image_t *image, u32 row,
+    u32 restore)
+{
+
+/* Variables */
+
+    u32 width, height;
+    u32 lumaLines, chromaLines;
+    u32 comp, size;
+    u8 *pixels, *saved;
+
+/* Code */
+
+    ASSERT(pThread->backup);
+    ASSERT(row < image->height);
+
+    width = image->width;
+    height = image->height;
+
+    lumaLines = row ? 16 + LUMA_LINES_ABOVE : 16;
+    chromaLines = row ? 8 + CHROMA_LINES_ABOVE : 8;
+
+    saved = pThread->backup + row * width * BACKUP_PER_MB;
+
+    size = lumaLines * width * 16;
+    pixels = image->data + (row + 1) * 16 * width * 16 - size;
+    if (restore)
+        H264SwDecMemcpy(pixels, saved, size);
+    else
+        H264SwDecMemcpy(saved, pixels, size);
+    saved += size;
+
+    size = chromaLines * width * 8;
+    for (comp = 0; comp < 2; comp++)
+    {
+        pixels = image->data + width * height * (256 + comp * 64) +
+            (row + 1) * 8 * width * 8 - size;
+        if (restore)
+            H264SwDecMemcpy(pixels, saved, size);
+        else
+            H264SwDecMemcpy(saved, pixels, size);
+        saved += size;
+    }
+
+}
+
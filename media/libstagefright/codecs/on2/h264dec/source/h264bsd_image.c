@@ -25,6 +25,7 @@
      5. Functions
           h264bsdWriteMacroblock
           h264bsdWriteOutputBlocks
+          AddResidualSse2
 
 ------------------------------------------------------------------------------*/
 
@@ -36,6 +37,10 @@
 #include "h264bsd_util.h"
 #include "h264bsd_neighbour.h"
 
+#ifdef H264DEC_SSE2
+#include <emmintrin.h>
+#endif /* H264DEC_SSE2 */
+
 /*------------------------------------------------------------------------------
     2. External compiler flags
 --------------------------------------------------------------------------------
@@ -55,6 +60,10 @@ extern const u8 h264bsdClip[];
     4. Local function prototypes
 ------------------------------------------------------------------------------*/
 
+#ifdef H264DEC_SSE2
+static void AddResidualSse2(u8 *imageBlock, u32 width, const u8 *pred,
+    u32 predWidth, const i32 *residual);
+#endif /* H264DEC_SSE2 */
 
 
 /*------------------------------------------------------------------------------
@@ -76,7 +85,7 @@ extern const u8 h264bsdClip[];
             none
 
 ------------------------------------------------------------------------------*/
-#ifndef H264DEC_NEON
+#if !defined(H264DEC_NEON) && !defined(H264DEC_SSE2)
 void h264bsdWriteMacroblock(image_t *image, u8 *data)
 {
 
@@ -140,6 +149,46 @@ void h264bsdWriteMacroblock(image_t *image, u8 *data)
         cr += width-2;
     }
 
+}
+#elif defined(H264DEC_SSE2)
+void h264bsdWriteMacroblock(image_t *image, u8 *data)
+{
+
+/* Variables */
+
+    u32 i;
+    u32 width;
+    u8 *lum, *cb, *cr;
+
+/* Code */
+
+    ASSERT(image);
+    ASSERT(data);
+
+    width = image->width * 16;
+    lum = image->luma;
+    cb = image->cb;
+    cr = image->cr;
+
+    for (i = 16; i; i--)
+    {
+        _mm_storeu_si128((__m128i*)lum,
+            _mm_loadu_si128((const __m128i*)data));
+        data += 16;
+        lum += width;
+    }
+
+    width >>= 1;
+    for (i = 8; i; i--)
+    {
+        _mm_storel_epi64((__m128i*)cb, _mm_loadl_epi64((const __m128i*)data));
+        _mm_storel_epi64((__m128i*)cr,
+            _mm_loadl_epi64((const __m128i*)(data + 64)));
+        data += 8;
+        cb += width;
+        cr += width;
+    }
+
 }
 #endif
 #ifndef H264DEC_OMXDL
@@ -174,7 +223,6 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
 
 /* Variables */
 
-    u32 i;
     u32 picWidth, picSize;
     u8 *lum, *cb, *cr;
     u8 *imageBlock;
@@ -183,8 +231,12 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
     u32 block;
     u32 x, y;
     i32 *pRes;
-    i32 tmp1, tmp2, tmp3, tmp4;
+    i32 tmp1, tmp2;
+#ifndef H264DEC_SSE2
+    u32 i;
+    i32 tmp3, tmp4;
     const u8 *clp = h264bsdClip + 512;
+#endif /* H264DEC_SSE2 */
 
 /* Code */
 
@@ -242,6 +294,9 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
 
             RANGE_CHECK_ARRAY(pRes, -512, 511, 16);
 
+#ifdef H264DEC_SSE2
+            AddResidualSse2(imageBlock, picWidth, tmp, 16, pRes);
+#else
             /* Calculate image = prediction + residual
              * Process four pixels in a loop */
             for (i = 4; i; i--)
@@ -265,6 +320,7 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
                 imageBlock[3] = (u8)tmp3;
                 imageBlock += picWidth;
             }
+#endif /* H264DEC_SSE2 */
         }
 
     }
@@ -316,6 +372,9 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
 
             RANGE_CHECK_ARRAY(pRes, -512, 511, 16);
 
+#ifdef H264DEC_SSE2
+            AddResidualSse2(imageBlock, picWidth, tmp, 8, pRes);
+#else
             for (i = 4; i; i--)
             {
                 tmp1 = tmp[0];
@@ -337,9 +396,63 @@ void h264bsdWriteOutputBlocks(image_t *image, u32 mbNum, u8 *data,
                 imageBlock[3] = (u8)tmp3;
                 imageBlock += picWidth;
             }
+#endif /* H264DEC_SSE2 */
         }
     }
 
 }
+
+#ifdef H264DEC_SSE2
+/*------------------------------------------------------------------------------
+
+    Function: AddResidualSse2
+
+        Functional description:
+            Write image = prediction + residual for one 4x4 block. Residual
+            values are in the range [-512, 511], hence the sums fit in 16
+            bits and the saturating pack does the clipping.
+
+------------------------------------------------------------------------------*/
+static void AddResidualSse2(u8 *imageBlock, u32 width, const u8 *pred,
+    u32 predWidth, const i32 *residual)
+{
+
+/* Variables */
+
+    __m128i zero, res01, res23, pred01, pred23, out;
+
+/* Code */
+
+    zero = _mm_setzero_si128();
+
+    res01 = _mm_packs_epi32(
+        _mm_loadu_si128((const __m128i*)(residual + 0)),
+        _mm_loadu_si128((const __m128i*)(residual + 4)));
+    res23 = _mm_packs_epi32(
+        _mm_loadu_si128((const __m128i*)(residual + 8)),
+        _mm_loadu_si128((const __m128i*)(residual + 12)));
+
+    /*lint -e826 */
+    pred01 = _mm_unpacklo_epi32(
+        _mm_cvtsi32_si128(*(const i32*)pred),
+        _mm_cvtsi32_si128(*(const i32*)(pred + predWidth)));
+    pred23 = _mm_unpacklo_epi32(
+        _mm_cvtsi32_si128(*(const i32*)(pred + 2*predWidth)),
+        _mm_cvtsi32_si128(*(const i32*)(pred + 3*predWidth)));
+
+    out = _mm_packus_epi16(
+        _mm_add_epi16(_mm_unpacklo_epi8(pred01, zero), res01),
+        _mm_add_epi16(_mm_unpacklo_epi8(pred23, zero), res23));
+
+    *(i32*)imageBlock = _mm_cvtsi128_si32(out);
+    *(i32*)(imageBlock + width) = _mm_cvtsi128_si32(_mm_srli_si128(out, 4));
+    *(i32*)(imageBlock + 2*width) =
+        _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+    *(i32*)(imageBlock + 3*width) =
+        _mm_cvtsi128_si32(_mm_srli_si128(out, 12));
+
+}
+#endif /* H264DEC_SSE2 */
+
 #endif /* H264DEC_OMXDL */
 
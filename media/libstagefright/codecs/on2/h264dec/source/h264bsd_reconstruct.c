@@ -42,6 +42,10 @@
 #include "armVC.h"
 #endif /* H264DEC_OMXDL */
 
+#ifdef H264DEC_SSE2
+#include <emmintrin.h>
+#endif /* H264DEC_SSE2 */
+
 /*------------------------------------------------------------------------------
     2. External compiler flags
 --------------------------------------------------------------------------------
@@ -80,6 +84,11 @@ extern const u8 h264bsdClip[];
     4. Local function prototypes
 ------------------------------------------------------------------------------*/
 
+#ifdef H264DEC_SSE2
+static void Interpolate6TapSse2(const u8 *ref, u8 *mb, u32 width, u32 step,
+    u32 partWidth, u32 partHeight, const u8 *avg, u32 avgWidth);
+#endif /* H264DEC_SSE2 */
+
 #ifndef H264DEC_OMXDL
 
 /*------------------------------------------------------------------------------
@@ -486,6 +495,7 @@ static void PredictChroma(
 
 ------------------------------------------------------------------------------*/
 #ifndef H264DEC_ARM11
+#ifndef H264DEC_SSE2
 void h264bsdInterpolateVerHalf(
   u8 *ref,
   u8 *mb,
@@ -1191,6 +1201,336 @@ void h264bsdInterpolateHorVerQuarter(
     }
 
 }
+#else /* H264DEC_SSE2 */
+
+/*------------------------------------------------------------------------------
+
+    Function: Interpolate6TapSse2
+
+        Functional description:
+          Apply the 6-tap filter (1, -5, 20, 20, -5, 1) to a block, 8 pixels
+          at a time. Taps are 'step' bytes apart, i.e. step 1 gives
+          horizontal and step 'width' vertical interpolation. Tap 0 of the
+          first output pixel is at ref. If avg is non-NULL the result is
+          averaged with the block at avg (row stride avgWidth).
+
+------------------------------------------------------------------------------*/
+static void Interpolate6TapSse2(
+  const u8 *ref,
+  u8 *mb,
+  u32 width,
+  u32 step,
+  u32 partWidth,
+  u32 partHeight,
+  const u8 *avg,
+  u32 avgWidth)
+{
+
+/* Variables */
+
+    u32 x, y, k;
+    __m128i zero, c5, c20, round, t[6], sum, out;
+
+/* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+    ASSERT(partWidth == 4 || partWidth == 8 || partWidth == 16);
+
+    zero = _mm_setzero_si128();
+    c5 = _mm_set1_epi16(5);
+    c20 = _mm_set1_epi16(20);
+    round = _mm_set1_epi16(16);
+
+    for (y = partHeight; y; y--)
+    {
+        for (x = 0; x < partWidth; x += 8)
+        {
+            /* 4 pixel wide blocks only read 4 bytes per tap, the
+             * reference may end right after the block */
+            for (k = 0; k < 6; k++)
+            {
+                /*lint -e826 */
+                if (partWidth == 4)
+                    t[k] = _mm_cvtsi32_si128(*(const i32*)(ref + k*step));
+                else
+                    t[k] = _mm_loadl_epi64(
+                        (const __m128i*)(ref + x + k*step));
+                t[k] = _mm_unpacklo_epi8(t[k], zero);
+            }
+
+            /* (16 + A + 20(C+D) - 5(B+E) + F) >> 5, at most 15 bits */
+            sum = _mm_add_epi16(_mm_add_epi16(t[0], t[5]), round);
+            sum = _mm_add_epi16(sum,
+                _mm_mullo_epi16(_mm_add_epi16(t[2], t[3]), c20));
+            sum = _mm_sub_epi16(sum,
+                _mm_mullo_epi16(_mm_add_epi16(t[1], t[4]), c5));
+            out = _mm_packus_epi16(_mm_srai_epi16(sum, 5), zero);
+
+            if (partWidth == 4)
+            {
+                if (avg)
+                    out = _mm_avg_epu8(out,
+                        _mm_cvtsi32_si128(*(const i32*)avg));
+                *(i32*)mb = _mm_cvtsi128_si32(out);
+            }
+            else
+            {
+                if (avg)
+                    out = _mm_avg_epu8(out,
+                        _mm_loadl_epi64((const __m128i*)(avg + x)));
+                _mm_storel_epi64((__m128i*)(mb + x), out);
+            }
+        }
+        ref += width;
+        mb += 16;
+        if (avg)
+            avg += avgWidth;
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateVerHalf
+
+        Functional description:
+          Function to perform vertical interpolation of pixel position 'h'
+          for a block.
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateVerHalf(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight)
+{
+    u32 p1[21*21/4+1];
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth, partHeight+5, partWidth);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    Interpolate6TapSse2(ref, mb, width, width, partWidth, partHeight,
+        NULL, 0);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateVerQuarter
+
+        Functional description:
+          Function to perform vertical interpolation of pixel position 'd'
+          or 'n' for a block.
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateVerQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 verOffset)    /* 0 for pixel d, 1 for pixel n */
+{
+    u32 p1[21*21/4+1];
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth, partHeight+5, partWidth);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    /* average with integer sample position, either G or M */
+    Interpolate6TapSse2(ref, mb, width, width, partWidth, partHeight,
+        ref + (2+verOffset)*width, width);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateHorHalf
+
+        Functional description:
+          Function to perform horizontal interpolation of pixel position 'b'
+          for a block.
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateHorHalf(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight)
+{
+    u32 p1[21*21/4+1];
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+    ASSERT((partWidth&0x3) == 0);
+    ASSERT((partHeight&0x3) == 0);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth + 5;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    Interpolate6TapSse2(ref, mb, width, 1, partWidth, partHeight, NULL, 0);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateHorQuarter
+
+        Functional description:
+          Function to perform horizontal interpolation of pixel position 'a'
+          or 'c' for a block.
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateHorQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 horOffset) /* 0 for pixel a, 1 for pixel c */
+{
+    u32 p1[21*21/4+1];
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth + 5;
+    }
+
+    ref += (u32)y0 * width + (u32)x0;
+
+    /* average with integer sample position, either G or H */
+    Interpolate6TapSse2(ref, mb, width, 1, partWidth, partHeight,
+        ref + 2 + horOffset, width);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdInterpolateHorVerQuarter
+
+        Functional description:
+          Function to perform horizontal and vertical interpolation of pixel
+          position 'e', 'g', 'p' or 'r' for a block.
+
+------------------------------------------------------------------------------*/
+void h264bsdInterpolateHorVerQuarter(
+  u8 *ref,
+  u8 *mb,
+  i32 x0,
+  i32 y0,
+  u32 width,
+  u32 height,
+  u32 partWidth,
+  u32 partHeight,
+  u32 horVerOffset) /* 0 for pixel e, 1 for pixel g,
+                       2 for pixel p, 3 for pixel r */
+{
+    u32 p1[21*21/4+1];
+
+    /* Code */
+
+    ASSERT(ref);
+    ASSERT(mb);
+
+    if ((x0 < 0) || ((u32)x0+partWidth+5 > width) ||
+        (y0 < 0) || ((u32)y0+partHeight+5 > height))
+    {
+        h264bsdFillBlock(ref, (u8*)p1, x0, y0, width, height,
+                partWidth+5, partHeight+5, partWidth+5);
+
+        x0 = 0;
+        y0 = 0;
+        ref = (u8*)p1;
+        width = partWidth+5;
+    }
+
+    /* Ref points to G + (-2, -2) */
+    ref += (u32)y0 * width + (u32)x0;
+
+    /* horizontal interpolation of either b or s, depending on vertical
+     * offset */
+    Interpolate6TapSse2(ref + (((horVerOffset & 0x2) >> 1) + 2) * width,
+        mb, width, 1, partWidth, partHeight, NULL, 0);
+
+    /* vertical interpolation of either h or m, depending on horizontal
+     * offset, averaged with the horizontal result */
+    Interpolate6TapSse2(ref + 2 + (horVerOffset & 0x1), mb, width, width,
+        partWidth, partHeight, mb, 16);
+
+}
+
+#endif /* H264DEC_SSE2 */
 #endif
 
 /*------------------------------------------------------------------------------
@@ -340,6 +340,9 @@ u32 h264bsdActivateParamSets(storage_t *pStorage, u32 ppsId, u32 isIdr)
     {
         pStorage->pendingActivation = HANTRO_FALSE;
 
+        /* filter thread may still be accessing the old picture */
+        h264bsdFilterThreadSync(pStorage->filterThread);
+
         FREE(pStorage->mb);
         FREE(pStorage->sliceGroupMap);
 
@@ -19,9 +19,11 @@
 #include <utils/Log.h>
 
 #include "SoftVorbis.h"
+#include "SoftAudioBatch.h"
 
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
 
 extern "C" {
     #include <Tremolo/codec_internal.h>
@@ -400,6 +402,128 @@ void SoftVorbis::onQueueFilled(OMX_U32 portIndex) {
     }
 }
 
+status_t SoftVorbis::decodeBatch(SoftAudioBatch *batch) {
+    int16_t scratch[kMaxNumSamplesPerBuffer];
+
+    const uint8_t *data = batch->mData;
+    for (size_t i = 0; i < batch->mNumUnits; data += batch->mSizes[i++]) {
+        size_t size = batch->mSizes[i];
+
+        if (mInputBufferCount < 2) {
+            // The identification and setup headers, as in onQueueFilled().
+            if (size < 7) {
+                return ERROR_MALFORMED;
+            }
+
+            ogg_buffer buf;
+            ogg_reference ref;
+            oggpack_buffer bits;
+
+            makeBitReader(
+                    data + 7, size - 7,
+                    &buf, &ref, &bits);
+
+            if (mInputBufferCount == 0) {
+                CHECK(mVi == NULL);
+                mVi = new vorbis_info;
+                vorbis_info_init(mVi);
+
+                if (_vorbis_unpack_info(mVi, &bits) != 0) {
+                    return ERROR_MALFORMED;
+                }
+            } else {
+                if (_vorbis_unpack_books(mVi, &bits) != 0) {
+                    return ERROR_MALFORMED;
+                }
+
+                CHECK(mState == NULL);
+                mState = new vorbis_dsp_state;
+                if (vorbis_dsp_init(mState, mVi) != 0) {
+                    return ERROR_MALFORMED;
+                }
+            }
+
+            ++mInputBufferCount;
+            continue;
+        }
+
+        int32_t numPageSamples;
+        if (size < sizeof(numPageSamples)) {
+            return ERROR_MALFORMED;
+        }
+        memcpy(&numPageSamples,
+               data + size - sizeof(numPageSamples),
+               sizeof(numPageSamples));
+
+        if (numPageSamples >= 0) {
+            mNumFramesLeftOnPage = numPageSamples;
+        }
+
+        size -= sizeof(numPageSamples);
+
+        ogg_buffer buf;
+        buf.data = const_cast<uint8_t *>(data);
+        buf.size = size;
+        buf.refcount = 1;
+        buf.ptr.owner = NULL;
+
+        ogg_reference ref;
+        ref.buffer = &buf;
+        ref.begin = 0;
+        ref.length = buf.size;
+        ref.next = NULL;
+
+        ogg_packet pack;
+        pack.packet = &ref;
+        pack.bytes = ref.length;
+        pack.b_o_s = 0;
+        pack.e_o_s = 0;
+        pack.granulepos = 0;
+        pack.packetno = 0;
+
+        int16_t *outPtr = static_cast<int16_t *>(
+                batch->outputBuffer(sizeof(scratch), scratch));
+
+        int numFrames = 0;
+
+        int err = vorbis_dsp_synthesis(mState, &pack, 1);
+        if (err != 0) {
+            ALOGW("vorbis_dsp_synthesis returned %d", err);
+        } else {
+            numFrames = vorbis_dsp_pcmout(
+                    mState, outPtr, kMaxNumSamplesPerBuffer);
+
+            if (numFrames < 0) {
+                ALOGE("vorbis_dsp_pcmout returned %d", numFrames);
+                numFrames = 0;
+            }
+        }
+
+        if (mNumFramesLeftOnPage >= 0) {
+            if (numFrames > mNumFramesLeftOnPage) {
+                ALOGV("discarding %d frames at end of page",
+                     numFrames - mNumFramesLeftOnPage);
+                numFrames = mNumFramesLeftOnPage;
+            }
+            mNumFramesLeftOnPage -= numFrames;
+        }
+
+        ++mInputBufferCount;
+
+        if (batch->mNumChannels == 0) {
+            batch->mSampleRate = mVi->rate;
+            batch->mNumChannels = mVi->channels;
+        }
+
+        if (!batch->append(
+                    outPtr, numFrames * sizeof(int16_t) * mVi->channels)) {
+            return OK;
+        }
+    }
+
+    return OK;
+}
+
 void SoftVorbis::onPortFlushCompleted(OMX_U32 portIndex) {
     if (portIndex == 0 && mState != NULL) {
         // Make sure that the next buffer output does not still
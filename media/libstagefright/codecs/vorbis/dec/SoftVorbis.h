@@ -31,6 +31,8 @@ struct SoftVorbis : public SimpleSoftOMXComponent {
             OMX_PTR appData,
             OMX_COMPONENTTYPE **component);
 
+    virtual status_t decodeBatch(SoftAudioBatch *batch);
+
 protected:
     virtual ~SoftVorbis();
 
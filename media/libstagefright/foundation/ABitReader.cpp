@@ -18,6 +18,8 @@
 
 #include <media/stagefright/foundation/ADebug.h>
 
+#include <string.h>
+
 namespace android {
 
 ABitReader::ABitReader(const uint8_t *data, size_t size)
@@ -27,12 +29,37 @@ ABitReader::ABitReader(const uint8_t *data, size_t size)
       mNumBitsLeft(0) {
 }
 
+static inline uint64_t U64_AT(const uint8_t *ptr) {
+    uint64_t x;
+    memcpy(&x, ptr, sizeof(x));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    x = __builtin_bswap64(x);
+#elif !defined(__BYTE_ORDER__)
+    x = (uint64_t)ptr[0] << 56 | (uint64_t)ptr[1] << 48
+        | (uint64_t)ptr[2] << 40 | (uint64_t)ptr[3] << 32
+        | (uint64_t)ptr[4] << 24 | (uint64_t)ptr[5] << 16
+        | (uint64_t)ptr[6] << 8 | (uint64_t)ptr[7];
+#endif
+
+    return x;
+}
+
 void ABitReader::fillReservoir() {
     CHECK_GT(mSize, 0u);
 
+    if (mSize >= 8) {
+        mReservoir = U64_AT(mData);
+        mNumBitsLeft = 64;
+
+        mData += 8;
+        mSize -= 8;
+        return;
+    }
+
     mReservoir = 0;
     size_t i;
-    for (i = 0; mSize > 0 && i < 4; ++i) {
+    for (i = 0; mSize > 0 && i < 8; ++i) {
         mReservoir = (mReservoir << 8) | *mData;
 
         ++mData;
@@ -40,13 +67,13 @@ void ABitReader::fillReservoir() {
     }
 
     mNumBitsLeft = 8 * i;
-    mReservoir <<= 32 - mNumBitsLeft;
+    mReservoir <<= 64 - mNumBitsLeft;
 }
 
-uint32_t ABitReader::getBits(size_t n) {
+uint32_t ABitReader::getBitsSlow(size_t n) {
     CHECK_LE(n, 32u);
 
-    uint32_t result = 0;
+    uint64_t result = 0;
     while (n > 0) {
         if (mNumBitsLeft == 0) {
             fillReservoir();
@@ -57,37 +84,113 @@ uint32_t ABitReader::getBits(size_t n) {
             m = mNumBitsLeft;
         }
 
-        result = (result << m) | (mReservoir >> (32 - m));
+        result = (result << m) | (mReservoir >> (64 - m));
         mReservoir <<= m;
         mNumBitsLeft -= m;
 
         n -= m;
     }
 
-    return result;
+    return (uint32_t)result;
 }
 
-void ABitReader::skipBits(size_t n) {
-    while (n > 32) {
-        getBits(32);
-        n -= 32;
+uint32_t ABitReader::peekBitsSlow(size_t n) const {
+    CHECK_LE(n, 32u);
+
+    if (n == 0) {
+        return 0;
     }
 
+    CHECK_LE(n, numBitsLeft());
+
+    // The bits left in the reservoir followed by as many of the
+    // unconsumed bytes as needed.
+    uint64_t result = (mNumBitsLeft > 0) ? mReservoir >> (64 - mNumBitsLeft) : 0;
+    size_t numBits = mNumBitsLeft;
+
+    const uint8_t *ptr = mData;
+    while (numBits < n) {
+        result = (result << 8) | *ptr++;
+        numBits += 8;
+    }
+
+    return (uint32_t)(result >> (numBits - n));
+}
+
+void ABitReader::skipBitsSlow(size_t n) {
+    n -= mNumBitsLeft;
+    mReservoir = 0;
+    mNumBitsLeft = 0;
+
+    // Skip whole bytes without going through the reservoir.
+    size_t numBytes = n / 8;
+    CHECK_LE(numBytes, mSize);
+
+    mData += numBytes;
+    mSize -= numBytes;
+
+    n %= 8;
     if (n > 0) {
         getBits(n);
     }
 }
 
+uint32_t ABitReader::getUE() {
+    size_t numZeroes = 0;
+
+    for (;;) {
+        if (mNumBitsLeft == 0) {
+            fillReservoir();
+        }
+
+        // Bits beyond mNumBitsLeft are always zero, so a leading one
+        // found by the count is valid.
+        if (mReservoir != 0) {
+            size_t n = __builtin_clzll(mReservoir);
+
+            numZeroes += n;
+            mReservoir <<= n;
+            mNumBitsLeft -= n;
+            break;
+        }
+
+        numZeroes += mNumBitsLeft;
+        mNumBitsLeft = 0;
+    }
+
+    CHECK_LT(numZeroes, 32u);
+
+    // Consume the marker bit.
+    mReservoir <<= 1;
+    --mNumBitsLeft;
+
+    return (1u << numZeroes) - 1 + getBits(numZeroes);
+}
+
+int32_t ABitReader::getSE() {
+    uint32_t codeNum = getUE();
+
+    return (codeNum & 1) ? (int32_t)((codeNum + 1) / 2) : -(int32_t)(codeNum / 2);
+}
+
 void ABitReader::putBits(uint32_t x, size_t n) {
     CHECK_LE(n, 32u);
 
-    while (mNumBitsLeft + n > 32) {
+    if (n == 0) {
+        return;
+    }
+
+    while (mNumBitsLeft + n > 64) {
         mNumBitsLeft -= 8;
         --mData;
         ++mSize;
     }
 
-    mReservoir = (mReservoir >> n) | (x << (32 - n));
+    // Bits past mNumBitsLeft must stay zero, getUE() relies on it.
+    mReservoir = (mNumBitsLeft > 0)
+        ? mReservoir & (~0ull << (64 - mNumBitsLeft)) : 0;
+
+    mReservoir = (mReservoir >> n) | ((uint64_t)x << (64 - n));
     mNumBitsLeft += n;
 }
 
@@ -22,11 +22,35 @@
 
 namespace android {
 
+struct ABuffer::SharedStorage : public RefBase {
+    SharedStorage(void *data, bool ownsData)
+        : mData(data),
+          mOwnsData(ownsData) {
+    }
+
+    bool ownsData() const { return mOwnsData; }
+
+protected:
+    virtual ~SharedStorage() {
+        if (mOwnsData) {
+            free(mData);
+        }
+        mData = NULL;
+    }
+
+private:
+    void *mData;
+    bool mOwnsData;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SharedStorage);
+};
+
 ABuffer::ABuffer(size_t capacity)
     : mData(malloc(capacity)),
       mCapacity(capacity),
       mRangeOffset(0),
       mRangeLength(capacity),
+      mSlicedEnd(0),
       mInt32Data(0),
       mOwnsData(true) {
 }
@@ -36,12 +60,13 @@ ABuffer::ABuffer(void *data, size_t capacity)
       mCapacity(capacity),
       mRangeOffset(0),
       mRangeLength(capacity),
+      mSlicedEnd(0),
       mInt32Data(0),
       mOwnsData(false) {
 }
 
 ABuffer::~ABuffer() {
-    if (mOwnsData) {
+    if (mOwnsData && mStorage == NULL) {
         if (mData != NULL) {
             free(mData);
             mData = NULL;
@@ -61,6 +86,97 @@ void ABuffer::setRange(size_t offset, size_t size) {
     mRangeLength = size;
 }
 
+sp<ABuffer> ABuffer::slice(size_t offset, size_t size) {
+    CHECK_LE(offset, mRangeLength);
+    CHECK_LE(offset + size, mRangeLength);
+
+    if (mStorage == NULL) {
+        // Counts the slices of this buffer. Memory the buffer owns is
+        // from now on released along with the last buffer referring to it.
+        mStorage = new SharedStorage(mData, mOwnsData);
+    }
+
+    sp<ABuffer> buffer = new ABuffer(data() + offset, size);
+    buffer->mStorage = mStorage;
+
+    if (mRangeOffset + offset + size > mSlicedEnd) {
+        mSlicedEnd = mRangeOffset + offset + size;
+    }
+
+    if (!mStorage->ownsData()) {
+        buffer->mParent = (mParent != NULL) ? mParent : this;
+    }
+
+    return buffer;
+}
+
+bool ABuffer::isShared() const {
+    return mStorage != NULL && mStorage->getStrongCount() > 1;
+}
+
+void ABuffer::append(const void *data, size_t size) {
+    size_t neededSize = mRangeLength + size;
+
+    if (isShared()) {
+        // Slices may refer to any byte of the storage up to mSlicedEnd,
+        // which may well lie past the current range. Only a buffer that
+        // owns the storage knows about all of its slices.
+        if (!mOwnsData
+                || mRangeOffset + mRangeLength < mSlicedEnd
+                || mRangeOffset + neededSize > mCapacity) {
+            reallocate(neededSize);
+        }
+    } else if (mRangeOffset + neededSize > mCapacity) {
+        if (neededSize <= mCapacity) {
+            // Reclaim the space in front of the current range.
+            memmove(base(), this->data(), mRangeLength);
+            mRangeOffset = 0;
+        } else {
+            reallocate(neededSize);
+        }
+    }
+
+    memcpy(base() + mRangeOffset + mRangeLength, data, size);
+    mRangeLength += size;
+}
+
+void ABuffer::reallocate(size_t capacity) {
+    // Grow geometrically to keep repeated appends amortized O(1), but
+    // don't grow at all if we only move away from shared storage.
+    size_t newCapacity = mCapacity;
+    if (newCapacity < capacity) {
+        newCapacity = mCapacity + mCapacity / 2;
+        if (newCapacity < capacity) {
+            newCapacity = capacity;
+        }
+    }
+
+    if (mOwnsData && mStorage == NULL && mRangeOffset == 0) {
+        void *newData = realloc(mData, newCapacity);
+        CHECK(newData != NULL);
+
+        mData = newData;
+    } else {
+        void *newData = malloc(newCapacity);
+        CHECK(newData != NULL);
+
+        memcpy(newData, data(), mRangeLength);
+
+        if (mOwnsData && mStorage == NULL) {
+            free(mData);
+        }
+
+        mData = newData;
+        mOwnsData = true;
+        mStorage.clear();
+        mParent.clear();
+        mRangeOffset = 0;
+        mSlicedEnd = 0;
+    }
+
+    mCapacity = newCapacity;
+}
+
 void ABuffer::setFarewellMessage(const sp<AMessage> msg) {
     mFarewell = msg;
 }
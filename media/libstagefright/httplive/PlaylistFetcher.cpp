@@ -1046,20 +1046,16 @@ status_t PlaylistFetcher::extractAndQueueAccessUnitsFromTs(const sp<ABuffer> &bu
         mNextPTSTimeUs = -1ll;
     }
 
-    size_t offset = 0;
-    while (offset + 188 <= buffer->size()) {
-        status_t err = mTSParser->feedTSPacket(buffer->data() + offset, 188);
+    size_t offset = (buffer->size() / 188) * 188;
+    status_t err = mTSParser->feedTSPackets(buffer->data(), offset / 188);
 
-        if (err != OK) {
-            return err;
-        }
-
-        offset += 188;
+    if (err != OK) {
+        return err;
     }
+
     // setRange to indicate consumed bytes.
     buffer->setRange(buffer->offset() + offset, buffer->size() - offset);
 
-    status_t err = OK;
     for (size_t i = mPacketSources.size(); i-- > 0;) {
         sp<AnotherPacketSource> packetSource = mPacketSources.valueAt(i);
 
@@ -53,6 +53,8 @@ struct ChromiumHTTPDataSource : public HTTPBase {
 
     virtual status_t reconnectAtOffset(off64_t offset);
 
+    virtual status_t getCacheValidator(String8 *validator);
+
     static status_t UpdateProxyConfig(
             const char *host, int32_t port, const char *exclusionList);
 
@@ -91,6 +93,7 @@ private:
     int64_t mContentSize;
 
     String8 mContentType;
+    String8 mCacheValidator;
 
     sp<DecryptHandle> mDecryptHandle;
     DrmManagerClient *mDrmManagerClient;
@@ -108,7 +111,8 @@ private:
     void initiateRead(void *data, size_t size);
 
     void onConnectionEstablished(
-            int64_t contentSize, const char *contentType);
+            int64_t contentSize, const char *contentType,
+            const char *cacheValidator);
 
     void onConnectionFailed(status_t err);
     void onReadCompleted(ssize_t size);
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISK_CACHED_SOURCE_H_
+
+#define DISK_CACHED_SOURCE_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/threads.h>
+
+#include "HTTPBase.h"
+
+namespace android {
+
+// Persists the byte ranges read from an HTTP source in a sparse cache file
+// keyed by the URL and the request headers, so that replaying the same
+// resource does not hit the network again. The entry is only reused if the
+// server's validator (ETag or Last-Modified) still matches.
+//
+// Disabled unless the property "media.stagefright.disk-cache-dir" names a
+// writable directory, "media.stagefright.disk-cache-size" caps the total
+// size of that directory in MB.
+struct DiskCachedSource : public HTTPBase {
+    // Returns a DiskCachedSource wrapping the (already connected) "source"
+    // if disk caching is enabled and applicable to it, "source" otherwise.
+    // "headers" are the ones "source" was connected with, a response to
+    // different credentials or cookies is cached separately.
+    static sp<HTTPBase> Wrap(
+            const sp<HTTPBase> &source, const char *uri,
+            const KeyedVector<String8, String8> *headers = NULL);
+
+    virtual status_t connect(
+            const char *uri,
+            const KeyedVector<String8, String8> *headers = NULL,
+            off64_t offset = 0);
+
+    virtual void disconnect();
+
+    virtual status_t initCheck() const;
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size);
+    virtual status_t getSize(off64_t *size);
+    virtual uint32_t flags();
+
+    virtual status_t reconnectAtOffset(off64_t offset);
+
+    virtual bool estimateBandwidth(int32_t *bandwidth_bps);
+    virtual status_t getEstimatedBandwidthKbps(int32_t *kbps);
+    virtual status_t setBandwidthStatCollectFreq(int32_t freqMs);
+    virtual status_t getCacheValidator(String8 *validator);
+
+    virtual sp<DecryptHandle> DrmInitialization(const char *mime);
+    virtual void getDrmInfo(sp<DecryptHandle> &handle, DrmManagerClient **client);
+
+    virtual String8 getUri();
+    virtual String8 getMIMEType() const;
+
+protected:
+    virtual ~DiskCachedSource();
+
+private:
+    enum {
+        kBlockSize              = 65536,
+        kHeaderSize             = 4096,
+        kMaxValidatorLength     = 1024,
+        kMaxURILength           = 2048,
+
+        // Upper bound on the number of missing blocks fetched from the
+        // source by a single readAt().
+        kMaxBlocksPerFetch      = 16,
+
+        kDefaultMaxCacheSizeMB  = 256,
+    };
+
+    struct Header;
+
+    Mutex mLock;
+
+    sp<HTTPBase> mSource;
+
+    int mFd;
+    off64_t mContentSize;
+    size_t mNumBlocks;
+
+    // The header and the bitmap of cached blocks are memory-mapped,
+    // the block data itself follows at mDataOffset.
+    void *mIndex;
+    size_t mIndexSize;
+    off64_t mDataOffset;
+
+    // Taken by the readAt() fetching from the source while mLock is
+    // released, a concurrent fetch allocates its own.
+    uint8_t *mFetchBuffer;
+
+    DiskCachedSource(const sp<HTTPBase> &source);
+
+    status_t openCacheFile(
+            const char *dir, const char *uri, uint64_t headersHash,
+            const String8 &validator, off64_t maxCacheSize);
+
+    void closeCacheFile_l();
+
+    bool isBlockCached_l(size_t block) const;
+    void markBlockCached_l(size_t block);
+
+    ssize_t readCachedBlocks_l(
+            size_t firstBlock, size_t lastBlock,
+            off64_t offset, void *data, size_t size);
+
+    ssize_t fetchBlocks_l(
+            size_t firstBlock, size_t lastBlock,
+            off64_t offset, void *data, size_t size);
+
+    // Reads from the source with mLock released.
+    ssize_t readFromSource_l(off64_t offset, void *data, size_t size);
+
+    static uint64_t HashURI(const char *uri);
+    static uint64_t HashHeaders(const KeyedVector<String8, String8> *headers);
+
+    static void EvictEntries(
+            const char *dir, off64_t maxCacheSize, off64_t bytesNeeded,
+            const String8 &skipPath);
+
+    DISALLOW_EVIL_CONSTRUCTORS(DiskCachedSource);
+};
+
+}  // namespace android
+
+#endif  // DISK_CACHED_SOURCE_H_
@@ -48,6 +48,11 @@ struct HTTPBase : public DataSource {
 
     virtual status_t setBandwidthStatCollectFreq(int32_t freqMs);
 
+    // Returns an opaque string identifying the current version of the
+    // resource (derived from the ETag or Last-Modified response headers),
+    // ERROR_UNSUPPORTED if the server did not provide either.
+    virtual status_t getCacheValidator(String8 *validator);
+
     static status_t UpdateProxyConfig(
             const char *host, int32_t port, const char *exclusionList);
 
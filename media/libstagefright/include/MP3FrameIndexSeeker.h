@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MP3_FRAME_INDEX_SEEKER_H_
+
+#define MP3_FRAME_INDEX_SEEKER_H_
+
+#include "include/MP3Seeker.h"
+
+#include <utils/String8.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct DataSource;
+
+// Seeks using the offsets of every kFramesPerEntry-th frame, found by
+// walking all frame headers once on a background thread. Meant for files
+// that have neither a XING nor a VBRI table of contents.
+//
+// Disabled unless the property "media.stagefright.mp3-index-dir" names a
+// writable directory. Finished indices are stored there, keyed by a hash of
+// the file's size and content, so that opening the file again does not
+// require another scan. The walk finishes and saves the index even if the
+// extractor is released first.
+struct MP3FrameIndexSeeker : public MP3Seeker {
+    static sp<MP3FrameIndexSeeker> CreateFromSource(
+            const sp<DataSource> &source,
+            off64_t first_frame_pos, uint32_t fixed_header);
+
+    // Only succeeds once the index is complete.
+    virtual bool getDuration(int64_t *durationUs);
+
+    // Fails for positions that have not been indexed yet.
+    virtual bool getOffsetForTime(int64_t *timeUs, off64_t *pos);
+
+private:
+    enum {
+        kFramesPerEntry = 16,
+        kReadSize       = 65536,
+    };
+
+    sp<DataSource> mDataSource;
+    off64_t mFirstFramePos;
+    uint32_t mFixedHeader;
+    int mSampleRate;
+    int mSamplesPerFrame;
+    String8 mIndexPath;
+    uint64_t mKey;
+
+    Mutex mLock;
+    // Offset of every kFramesPerEntry-th frame, relative to mFirstFramePos.
+    Vector<uint32_t> mOffsets;
+    uint32_t mNumFrames;
+    bool mComplete;
+
+    MP3FrameIndexSeeker();
+    virtual ~MP3FrameIndexSeeker();
+
+    int64_t framesToUs(int64_t numFrames) const;
+
+    bool loadIndex();
+    void saveIndex();
+
+    static void *ThreadWrapper(void *me);
+    void buildIndex();
+
+    DISALLOW_EVIL_CONSTRUCTORS(MP3FrameIndexSeeker);
+};
+
+}  // namespace android
+
+#endif  // MP3_FRAME_INDEX_SEEKER_H_
@@ -31,6 +31,7 @@ namespace android {
 
 struct AMessage;
 class DataSource;
+struct MPEG4DataSource;
 class SampleTable;
 class String8;
 
@@ -71,6 +72,31 @@ private:
         sp<SampleTable> sampleTable;
         bool includes_expensive_metadata;
         bool skipTrack;
+
+        // Location of the track's 'stbl' box. In lazy mode "sampleTable"
+        // stays NULL until materializeSampleTable() parses it from here,
+        // "deferredBoxes" records which of the mandatory boxes were seen.
+        off64_t stblOffset;
+        off64_t stblDataOffset;
+        off64_t stblSize;
+        uint32_t deferredBoxes;
+    };
+
+    enum {
+        kHasChunkOffsets    = 1,
+        kHasSampleToChunk   = 2,
+        kHasSampleSizes     = 4,
+        kHasTimeToSample    = 8,
+
+        kRequiredSampleTableBoxes =
+            kHasChunkOffsets | kHasSampleToChunk
+                | kHasSampleSizes | kHasTimeToSample,
+    };
+
+    enum {
+        // Compressed audio frames stay well below this, it stands in for
+        // a deferred track's max input size until the table is parsed.
+        kMaxDeferredAudioSampleSize = 64 * 1024,
     };
 
     Vector<SidxEntry> mSidxEntries;
@@ -102,6 +128,17 @@ private:
 
     static status_t verifyTrack(Track *track);
 
+    status_t parseSampleTableBox(
+            Track *track, uint32_t type, off64_t data_offset, off64_t data_size);
+
+    status_t noteDeferredSampleTableBox(
+            Track *track, uint32_t type, off64_t data_offset, off64_t data_size);
+
+    status_t materializeSampleTable(Track *track);
+
+    static void setMaxInputSize(Track *track, size_t max_size);
+    static void setFrameRate(Track *track, size_t numSamples);
+
     struct SINF {
         SINF *next;
         uint16_t trackID;
@@ -113,6 +150,15 @@ private:
     SINF *mFirstSINF;
 
     bool mIsDrm;
+    // If set (property "media.stagefright.mp4-lazy-stbl"), readMetaData()
+    // only notes where each track's sample table lives and the tables are
+    // parsed once the track is actually used, so that files with many or
+    // long tracks don't pay for tables that are never read.
+    bool mLazySampleTables;
+
+    // Caches the 'stbl' box of every track materialized in lazy mode.
+    sp<MPEG4DataSource> mSampleTableSource;
+
     status_t parseDrmSINF(off64_t *offset, off64_t data_offset);
 
     status_t parseTrackHeader(off64_t data_offset, off64_t data_size);
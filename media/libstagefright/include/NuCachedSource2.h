@@ -21,6 +21,7 @@
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AHandlerReflector.h>
 #include <media/stagefright/DataSource.h>
+#include <utils/List.h>
 
 namespace android {
 
@@ -73,14 +74,35 @@ struct NuCachedSource2 : public DataSource {
 protected:
     virtual ~NuCachedSource2();
 
+    virtual void onFirstRef();
+
 private:
     friend struct AHandlerReflector<NuCachedSource2>;
+    friend struct NuCachedSource2Peer;  // tests
 
     enum {
         kPageSize                       = 65536,
         kDefaultHighWaterThreshold      = 20 * 1024 * 1024,
         kDefaultLowWaterThreshold       = 4 * 1024 * 1024,
 
+        // Bounds for the watermarks derived from the measured bandwidth
+        // when no explicit cache configuration was supplied.
+        kMinLowWaterThreshold           = 1024 * 1024,
+        kMaxLowWaterThreshold           = 8 * 1024 * 1024,
+        kMinHighWaterThreshold          = 4 * 1024 * 1024,
+
+        // Ranges that were cached before a seek are kept around (LRU)
+        // up to this many bytes, and up to half the high watermark, which
+        // the active and retained ranges share.
+        kDefaultRetainedThreshold       = 8 * 1024 * 1024,
+        kMaxNumRetainedRanges           = 16,
+
+        // The first few ranges the extractor touches usually hold the
+        // container's index (moov etc.), they are evicted last and only
+        // their first kMaxPinnedRangeBytes are kept.
+        kNumPinnedRanges                = 2,
+        kMaxPinnedRangeBytes            = 2 * 1024 * 1024,
+
         // Read data after a 15 sec timeout whether we're actively
         // fetching or not.
         kDefaultKeepAliveIntervalUs     = 15000000,
@@ -95,6 +117,18 @@ private:
         kMaxNumRetries = 10,
     };
 
+    // Seconds worth of data at the estimated bandwidth that the low and
+    // high watermarks correspond to.
+    static const int64_t kLowWaterDurationUs = 10000000ll;
+    static const int64_t kHighWaterDurationUs = 60000000ll;
+
+    struct CachedRange {
+        off64_t mOffset;
+        PageCache *mCache;
+        int64_t mLastAccessUs;
+        bool mPinned;
+    };
+
     //3 second timeout for readAt function call
     static const int64_t kReadSourceTimeoutNs = 3000000000LL;
 
@@ -108,6 +142,13 @@ private:
 
     PageCache *mCache;
     off64_t mCacheOffset;
+    bool mCachePinned;
+    size_t mNumRangesCreated;
+
+    List<CachedRange> mRetainedRanges;
+    size_t mRetainedBytes;
+    size_t mRetainedThresholdBytes;
+
     status_t mFinalStatus;
     off64_t mLastAccessPos;
     sp<AMessage> mAsyncResult;
@@ -119,6 +160,19 @@ private:
     size_t mHighwaterThresholdBytes;
     size_t mLowwaterThresholdBytes;
 
+    // The configured high watermark. The adaptive one stays below it and
+    // reads of up to this many bytes are allowed.
+    size_t mMaxHighwaterThresholdBytes;
+
+    // End of the read waiting for the active range, fetching goes on
+    // past the high watermark until it is cached.
+    off64_t mPendingReadEnd;
+
+    // Thresholds track the estimated bandwidth unless they were
+    // explicitly configured.
+    bool mAdaptiveThresholds;
+    int64_t mEstimatedBandwidthBps;
+
     bool mSuspended;
 
     // If the keep-alive interval is 0, keep-alives are disabled.
@@ -140,6 +194,28 @@ private:
 
     size_t approxDataRemaining_l(status_t *finalStatus) const;
 
+    bool readFromRetainedRanges_l(off64_t offset, void *data, size_t size);
+    List<CachedRange>::iterator findRetainedRange_l(off64_t offset);
+    void retainCurrentRange_l();
+    size_t detachPinnedHead_l(size_t maxBytes);
+    size_t retainedBudget_l() const;
+    void trimRetainedRanges_l();
+    bool isCacheFull_l() const;
+    void releaseRetainedRanges_l();
+
+    void updateBandwidthEstimate_l(size_t numBytes, int64_t delayUs);
+
+    // Moving average of the fetch bandwidth, estimateBps is 0 before the
+    // first sample.
+    static int64_t UpdateBandwidthEstimate(
+            int64_t estimateBps, size_t numBytes, int64_t delayUs);
+
+    // The watermarks that correspond to the given bandwidth, the high one
+    // never exceeds maxHighwater.
+    static void ComputeWatermarks(
+            int64_t bandwidthBps, size_t maxHighwater,
+            size_t *lowwater, size_t *highwater);
+
     void restartPrefetcherIfNecessary_l(
             bool ignoreLowWaterThreshold = false, bool force = false);
 
@@ -82,11 +82,24 @@ public:
 
     status_t findThumbnailSample(uint32_t *sample_index);
 
+    // Decodes offset, size, time and sync flag of every sample into memory
+    // in a single pass over the tables. Afterwards none of the lookups
+    // above touch the DataSource. Called by the first findSampleAtTime(),
+    // so tracks that are only played through never pay for it. Tracks
+    // with more than kMaxNumIndexedSamples samples, or whose index failed
+    // to build once, keep using the on-demand lookups.
+    status_t buildSampleIndex();
+
 protected:
     ~SampleTable();
 
 private:
     struct CompositionDeltaLookup;
+    struct SampleIndex;
+
+    enum {
+        kMaxNumIndexedSamples = 262144,
+    };
 
     static const uint32_t kChunkOffsetType32;
     static const uint32_t kChunkOffsetType64;
@@ -128,6 +141,9 @@ private:
 
     SampleIterator *mSampleIterator;
 
+    SampleIndex *mSampleIndex;
+    bool mSampleIndexAttempted;
+
     struct SampleToChunkEntry {
         uint32_t startChunk;
         uint32_t samplesPerChunk;
@@ -138,7 +154,8 @@ private:
     friend struct SampleIterator;
 
     status_t getSampleSize_l(uint32_t sample_index, size_t *sample_size);
-    uint32_t getCompositionTimeOffset(uint32_t sampleIndex);
+    status_t getSampleTime_l(uint32_t sample_index, uint64_t *sample_time);
+    int32_t getCompositionTimeOffset(uint32_t sampleIndex);
 
     static int CompareIncreasingTime(const void *, const void *);
 
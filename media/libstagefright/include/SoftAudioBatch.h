@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SOFT_AUDIO_BATCH_H_
+
+#define SOFT_AUDIO_BATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+
+// A span of compressed audio for SoftOMXComponent::decodeBatch(), which
+// decodes all of it straight into the caller's PCM buffer instead of going
+// through the OMX ports one buffer at a time. Successive calls on the same
+// component continue the same stream.
+struct SoftAudioBatch {
+    SoftAudioBatch();
+
+    // mNumUnits access units, back to back in mData, mSizes[i] bytes each.
+    // The first mNumConfigUnits of them are codec specific data, i.e. what
+    // would have been submitted with OMX_BUFFERFLAG_CODECCONFIG.
+    const uint8_t *mData;
+    const size_t *mSizes;
+    size_t mNumUnits;
+    size_t mNumConfigUnits;
+
+    // Set on the last span so that the decoder flushes out delayed samples.
+    bool mEndOfStream;
+
+    // What the port parameters would have said, for decoders that can't
+    // tell from the bitstream.
+    int32_t mChannelCount;      // G.711
+    bool mIsADTS;               // AAC
+
+    // 16 bit interleaved PCM is appended at mPCM + mPCMSize, decoding stops
+    // once mPCMCapacity bytes have been written.
+    uint8_t *mPCM;
+    size_t mPCMCapacity;
+    size_t mPCMSize;
+
+    // Format of the PCM, valid once any has been appended.
+    int32_t mSampleRate;
+    int32_t mNumChannels;
+
+    bool isFull() const { return mPCMSize >= mPCMCapacity; }
+
+    // Where the next |size| bytes of PCM should be decoded to: the end of
+    // mPCM if they fit, |scratch| otherwise.
+    void *outputBuffer(size_t size, void *scratch);
+
+    // Appends |size| bytes decoded to |data|, as returned by outputBuffer(),
+    // leaving out the first |skip| of them. Returns false once mPCM is full.
+    bool append(const void *data, size_t size, size_t skip = 0);
+
+    bool appendSilence(size_t size);
+
+private:
+    SoftAudioBatch(const SoftAudioBatch &);
+    SoftAudioBatch &operator=(const SoftAudioBatch &);
+};
+
+}  // namespace android
+
+#endif  // SOFT_AUDIO_BATCH_H_
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SOFT_AUDIO_BATCH_DECODER_H_
+
+#define SOFT_AUDIO_BATCH_DECODER_H_
+
+#include <utils/Errors.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+struct MediaSource;
+
+// Decodes a whole audio track into one PCM buffer with the matching
+// OMX.google software decoder, handing it large spans of access units
+// through SoftOMXComponent::decodeBatch() instead of passing every buffer
+// through OMX. Meant for offline decoding, e.g. MediaPlayer::decode().
+struct SoftAudioBatchDecoder {
+    // |source| must not have been started yet. Writes at most |capacity|
+    // bytes of 16 bit interleaved PCM to |pcm|, with the encoder delay and
+    // padding removed. Returns ERROR_UNSUPPORTED if none of the software
+    // decoders can do this for the track's format.
+    static status_t Decode(
+            const sp<MediaSource> &source,
+            void *pcm, size_t capacity, size_t *size,
+            int32_t *sampleRate, int32_t *numChannels);
+};
+
+}  // namespace android
+
+#endif  // SOFT_AUDIO_BATCH_DECODER_H_
@@ -20,12 +20,15 @@
 
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AString.h>
+#include <utils/Errors.h>
 #include <utils/RefBase.h>
 
 #include <OMX_Component.h>
 
 namespace android {
 
+struct SoftAudioBatch;
+
 struct SoftOMXComponent : public RefBase {
     SoftOMXComponent(
             const char *name,
@@ -40,6 +43,12 @@ struct SoftOMXComponent : public RefBase {
 
     virtual void prepareForDestruction() {}
 
+    // Decodes a span of compressed audio without going through the ports,
+    // see SoftAudioBatch.h. Must not be mixed with OMX use of the same
+    // component. Returns ERROR_UNSUPPORTED unless the component is one of
+    // the audio decoders implementing it.
+    virtual status_t decodeBatch(SoftAudioBatch *batch);
+
 protected:
     virtual ~SoftOMXComponent();
 
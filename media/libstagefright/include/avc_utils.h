@@ -43,6 +43,14 @@ void FindAVCDimensions(
         int32_t *sarWidth = NULL, int32_t *sarHeight = NULL);
 unsigned parseUE(ABitReader *br);
 
+// Returns the offset of the first 0x00 0x00 0x01 startcode prefix in
+// data[0..size), or -1 if there is none. To resume a search once more data
+// arrived, start again 2 bytes before the previous end.
+ssize_t FindStartCode(const uint8_t *data, size_t size);
+
+// Same as above, for the 4 byte startcode 0x00 0x00 0x00 0x01.
+ssize_t FindLongStartCode(const uint8_t *data, size_t size);
+
 status_t getNextNALUnit(
         const uint8_t **_data, size_t *_size,
         const uint8_t **nalStart, size_t *nalSize,
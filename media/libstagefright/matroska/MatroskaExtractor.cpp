@@ -39,11 +39,46 @@
 
 #include <cutils/properties.h>
 
+#include <pthread.h>
+
 namespace android {
 
+// Optionally reads ahead (see prefetch()) into one of two buffers on a
+// background thread, so that fetching the next cluster from a network
+// source overlaps with parsing and decoding the current one.
 struct DataSourceReader : public mkvparser::IMkvReader {
-    DataSourceReader(const sp<DataSource> &source)
-        : mSource(source) {
+    DataSourceReader(const sp<DataSource> &source, bool enablePrefetch)
+        : mSource(source),
+          mPrefetchEnabled(enablePrefetch),
+          mLastUsedBuffer(0),
+          mThreadStarted(false),
+          mDone(false) {
+        for (size_t i = 0; i < kNumPrefetchBuffers; ++i) {
+            PrefetchBuffer *buffer = &mBuffers[i];
+            buffer->mData = NULL;
+            buffer->mOffset = 0;
+            buffer->mSize = 0;
+            buffer->mLength = 0;
+            buffer->mPending = false;
+        }
+    }
+
+    virtual ~DataSourceReader() {
+        if (mThreadStarted) {
+            {
+                Mutex::Autolock autoLock(mLock);
+                mDone = true;
+                mCondition.broadcast();
+            }
+
+            void *dummy;
+            pthread_join(mThread, &dummy);
+        }
+
+        for (size_t i = 0; i < kNumPrefetchBuffers; ++i) {
+            delete[] mBuffers[i].mData;
+            mBuffers[i].mData = NULL;
+        }
     }
 
     virtual int Read(long long position, long length, unsigned char* buffer) {
@@ -54,6 +89,10 @@ struct DataSourceReader : public mkvparser::IMkvReader {
             return 0;
         }
 
+        if (mPrefetchEnabled && readFromPrefetchBuffer(position, length, buffer)) {
+            return 0;
+        }
+
         ssize_t n = mSource->readAt(position, buffer, length);
 
         if (n <= 0) {
@@ -83,9 +122,159 @@ struct DataSourceReader : public mkvparser::IMkvReader {
         return 0;
     }
 
+    // Start reading the given range in the background, unless it is already
+    // buffered or both buffers are busy. Only the first kMaxPrefetchSize
+    // bytes of the range are read.
+    void prefetch(off64_t offset, size_t size) {
+        if (!mPrefetchEnabled || offset < 0 || size == 0) {
+            return;
+        }
+
+        if (size > kMaxPrefetchSize) {
+            size = kMaxPrefetchSize;
+        }
+
+        Mutex::Autolock autoLock(mLock);
+
+        for (size_t i = 0; i < kNumPrefetchBuffers; ++i) {
+            const PrefetchBuffer &buffer = mBuffers[i];
+            if (offset >= buffer.mOffset
+                    && offset + size <= buffer.mOffset + buffer.mSize) {
+                return;
+            }
+        }
+
+        // Keep the buffer that is being read from.
+        size_t index = (mLastUsedBuffer + 1) % kNumPrefetchBuffers;
+        PrefetchBuffer *buffer = &mBuffers[index];
+        if (buffer->mPending) {
+            return;
+        }
+
+        if (buffer->mData == NULL) {
+            buffer->mData = new uint8_t[kMaxPrefetchSize];
+        }
+        buffer->mOffset = offset;
+        buffer->mSize = size;
+        buffer->mLength = 0;
+        buffer->mPending = true;
+
+        if (!mThreadStarted) {
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+            mThreadStarted =
+                pthread_create(&mThread, &attr, ThreadWrapper, this) == 0;
+            pthread_attr_destroy(&attr);
+
+            if (!mThreadStarted) {
+                buffer->mPending = false;
+                buffer->mSize = 0;
+                mPrefetchEnabled = false;
+                return;
+            }
+        }
+
+        mCondition.broadcast();
+    }
+
 private:
+    enum {
+        kNumPrefetchBuffers = 2,
+        kMaxPrefetchSize    = 1024 * 1024,
+    };
+
+    struct PrefetchBuffer {
+        uint8_t *mData;
+        off64_t mOffset;
+        size_t mSize;       // requested
+        size_t mLength;     // actually read
+        bool mPending;
+    };
+
     sp<DataSource> mSource;
 
+    bool mPrefetchEnabled;
+    Mutex mLock;
+    Condition mCondition;
+    PrefetchBuffer mBuffers[kNumPrefetchBuffers];
+    size_t mLastUsedBuffer;
+    bool mThreadStarted;
+    bool mDone;
+    pthread_t mThread;
+
+    bool readFromPrefetchBuffer(
+            long long position, long length, unsigned char *data) {
+        Mutex::Autolock autoLock(mLock);
+
+        size_t i = 0;
+        while (i < kNumPrefetchBuffers) {
+            const PrefetchBuffer &buffer = mBuffers[i];
+            if (position < buffer.mOffset
+                    || position + length > buffer.mOffset + buffer.mSize) {
+                ++i;
+                continue;
+            }
+
+            if (buffer.mPending) {
+                // No point in reading it again while it is on its way,
+                // look again once it has arrived.
+                mCondition.wait(mLock);
+                i = 0;
+                continue;
+            }
+
+            if (position + length > buffer.mOffset + buffer.mLength) {
+                return false;
+            }
+
+            memcpy(data, buffer.mData + (position - buffer.mOffset), length);
+            mLastUsedBuffer = i;
+            return true;
+        }
+
+        return false;
+    }
+
+    static void *ThreadWrapper(void *me) {
+        static_cast<DataSourceReader *>(me)->threadFunc();
+        return NULL;
+    }
+
+    void threadFunc() {
+        Mutex::Autolock autoLock(mLock);
+        for (;;) {
+            PrefetchBuffer *buffer = NULL;
+            while (!mDone && buffer == NULL) {
+                for (size_t i = 0; i < kNumPrefetchBuffers; ++i) {
+                    if (mBuffers[i].mPending) {
+                        buffer = &mBuffers[i];
+                        break;
+                    }
+                }
+                if (buffer == NULL) {
+                    mCondition.wait(mLock);
+                }
+            }
+
+            if (mDone) {
+                break;
+            }
+
+            // Only this thread clears mPending, the buffer stays put.
+            off64_t offset = buffer->mOffset;
+            size_t size = buffer->mSize;
+
+            mLock.unlock();
+            ssize_t n = mSource->readAt(offset, buffer->mData, size);
+            mLock.lock();
+
+            buffer->mLength = n > 0 ? n : 0;
+            buffer->mPending = false;
+            mCondition.broadcast();
+        }
+    }
+
     DataSourceReader(const DataSourceReader &);
     DataSourceReader &operator=(const DataSourceReader &);
 };
@@ -115,7 +304,14 @@ private:
     const mkvparser::BlockEntry *mBlockEntry;
     long mBlockEntryIndex;
 
+    // Whether this iterator has visited all blocks since a point covered by
+    // the seek index, so that it may extend the index.
+    bool mIndexing;
+
     void advance_l();
+    void updateSeekIndex_l();
+    bool skipClustersTo_l(int64_t seekTimeUs);
+    void prefetchNextCluster_l();
 
     BlockIterator(const BlockIterator &);
     BlockIterator &operator=(const BlockIterator &);
@@ -223,7 +419,8 @@ BlockIterator::BlockIterator(
       mTrackNum(trackNum),
       mCluster(NULL),
       mBlockEntry(NULL),
-      mBlockEntryIndex(0) {
+      mBlockEntryIndex(0),
+      mIndexing(false) {
     reset();
 }
 
@@ -286,6 +483,8 @@ void BlockIterator::advance_l() {
             ALOGV("Parse (2) returned %ld", res);
             CHECK_GE(res, 0);
 
+            prefetchNextCluster_l();
+
             mBlockEntryIndex = 0;
             continue;
         }
@@ -295,9 +494,68 @@ void BlockIterator::advance_l() {
         ++mBlockEntryIndex;
 
         if (mBlockEntry->GetBlock()->GetTrackNumber() == mTrackNum) {
+            updateSeekIndex_l();
+            break;
+        }
+    }
+}
+
+void BlockIterator::updateSeekIndex_l() {
+    if (!mIndexing
+            || mExtractor->mSeekIndexFromCues
+            || mTrackNum != mExtractor->mSeekIndexTrackNum) {
+        return;
+    }
+
+    const mkvparser::Block *block = mBlockEntry->GetBlock();
+    int64_t timeUs = (block->GetTime(mCluster) + 500ll) / 1000ll;
+
+    if (block->IsKey()) {
+        mExtractor->addSeekPoint_l(
+                timeUs, mCluster->GetPosition(), mBlockEntryIndex - 1);
+    }
+
+    if (timeUs > mExtractor->mSeekIndexEndUs) {
+        mExtractor->mSeekIndexEndUs = timeUs;
+    }
+}
+
+// Moves on to the last cluster starting at or before the given time,
+// reading no more than the headers of the clusters in between.
+// Returns true if the iterator moved.
+bool BlockIterator::skipClustersTo_l(int64_t seekTimeUs) {
+    const int64_t seekTimeNs = seekTimeUs * 1000ll;
+
+    bool moved = false;
+    for (;;) {
+        const mkvparser::Cluster *nextCluster;
+        long long pos;
+        long len;
+        long res = mExtractor->mSegment->ParseNext(
+                mCluster, nextCluster, pos, len);
+
+        if (res != 0 || nextCluster == NULL || nextCluster->EOS()
+                || nextCluster->GetTime() > seekTimeNs) {
             break;
         }
+
+        mCluster = nextCluster;
+        mBlockEntryIndex = 0;
+        moved = true;
+    }
+
+    return moved;
+}
+
+void BlockIterator::prefetchNextCluster_l() {
+    if (mCluster == NULL || mCluster->EOS() || mCluster->m_element_size <= 0) {
+        return;
     }
+
+    // Clusters tend to be of similar size.
+    mExtractor->mReader->prefetch(
+            mCluster->m_element_start + mCluster->m_element_size,
+            mCluster->m_element_size);
 }
 
 void BlockIterator::reset() {
@@ -306,6 +564,7 @@ void BlockIterator::reset() {
     mCluster = mExtractor->mSegment->GetFirst();
     mBlockEntry = NULL;
     mBlockEntryIndex = 0;
+    mIndexing = true;
 
     do {
         advance_l();
@@ -319,16 +578,15 @@ void BlockIterator::seek(
 
     *actualFrameTimeUs = -1ll;
 
-    const int64_t seekTimeNs = seekTimeUs * 1000ll;
-
     mkvparser::Segment* const pSegment = mExtractor->mSegment;
 
     // Special case the 0 seek to avoid loading Cues when the application
     // extraneously seeks to 0 before playing.
-    if (seekTimeNs <= 0) {
+    if (seekTimeUs <= 0) {
         ALOGV("Seek to beginning: %lld", seekTimeUs);
         mCluster = pSegment->GetFirst();
         mBlockEntryIndex = 0;
+        mIndexing = true;
         do {
             advance_l();
         } while (!eos() && block()->GetTrackNumber() != mTrackNum);
@@ -337,79 +595,35 @@ void BlockIterator::seek(
 
     ALOGV("Seeking to: %lld", seekTimeUs);
 
-    // If the Cues have not been located then find them.
-    const mkvparser::Cues* pCues = pSegment->GetCues();
-    const mkvparser::SeekHead* pSH = pSegment->GetSeekHead();
-    if (!pCues && pSH) {
-        const size_t count = pSH->GetCount();
-        const mkvparser::SeekHead::Entry* pEntry;
-        ALOGV("No Cues yet");
-
-        for (size_t index = 0; index < count; index++) {
-            pEntry = pSH->GetEntry(index);
-
-            if (pEntry->id == 0x0C53BB6B) { // Cues ID
-                long len; long long pos;
-                pSegment->ParseCues(pEntry->pos, pos, len);
-                pCues = pSegment->GetCues();
-                ALOGV("Cues found");
-                break;
-            }
-        }
+    mExtractor->loadCues_l();
 
-        if (!pCues) {
-            ALOGE("No Cues in file");
-            return;
-        }
-    }
-    else if (!pSH) {
-        ALOGE("No SeekHead");
-        return;
-    }
+    // Always *search* based on the seek index track (the Cue index is built
+    // around video keyframes), but finalize based on mTrackNum.
+    ssize_t index = mExtractor->findSeekPoint_l(seekTimeUs);
+    if (index >= 0) {
+        const MatroskaExtractor::SeekPoint &point =
+            mExtractor->mSeekPoints.itemAt(index);
 
-    const mkvparser::CuePoint* pCP;
-    while (!pCues->DoneParsing()) {
-        pCues->LoadCuePoint();
-        pCP = pCues->GetLast();
+        mCluster = pSegment->FindOrPreloadCluster(point.mClusterPos);
 
-        if (pCP->GetTime(pSegment) >= seekTimeNs) {
-            ALOGV("Parsed past relevant Cue");
-            break;
-        }
-    }
+        CHECK(mCluster);
+        CHECK(!mCluster->EOS());
 
-    // The Cue index is built around video keyframes
-    mkvparser::Tracks const *pTracks = pSegment->GetTracks();
-    const mkvparser::Track *pTrack = NULL;
-    for (size_t index = 0; index < pTracks->GetTracksCount(); ++index) {
-        pTrack = pTracks->GetTrackByIndex(index);
-        if (pTrack && pTrack->GetType() == 1) { // VIDEO_TRACK
-            ALOGV("Video track located at %d", index);
-            break;
-        }
+        mBlockEntryIndex = point.mBlockEntryIndex;
+    } else {
+        mCluster = pSegment->GetFirst();
+        mBlockEntryIndex = 0;
     }
+    mIndexing = true;
 
-    // Always *search* based on the video track, but finalize based on mTrackNum
-    const mkvparser::CuePoint::TrackPosition* pTP;
-    if (pTrack && pTrack->GetType() == 1) {
-        if (!pCues->Find(seekTimeNs, pTrack, pCP, pTP)) {
-            ALOGE("Did not find cue-point for video track at %lld", seekTimeUs);
-            return;
+    if (!mExtractor->mSeekIndexFromCues
+            && seekTimeUs > mExtractor->mSeekIndexEndUs) {
+        // Past what has been played so far, skip ahead cluster by cluster.
+        if (skipClustersTo_l(seekTimeUs)) {
+            mIndexing = false;
         }
-    } else {
-        ALOGE("Did not locate the video track for seeking");
-        return;
     }
 
-    mCluster = pSegment->FindOrPreloadCluster(pTP->m_pos);
-
-    CHECK(mCluster);
-    CHECK(!mCluster->EOS());
-
-    // mBlockEntryIndex starts at 0 but m_block starts at 1
-    CHECK_GT(pTP->m_block, 0);
-    mBlockEntryIndex = pTP->m_block - 1;
-
     for (;;) {
         advance_l();
 
@@ -423,6 +637,8 @@ void BlockIterator::seek(
             break;
         }
     }
+
+    prefetchNextCluster_l();
 }
 
 const mkvparser::Block *BlockIterator::block() const {
@@ -656,10 +872,16 @@ status_t MatroskaSource::read(
 
 MatroskaExtractor::MatroskaExtractor(const sp<DataSource> &source)
     : mDataSource(source),
-      mReader(new DataSourceReader(mDataSource)),
+      mReader(new DataSourceReader(
+                  mDataSource,
+                  mDataSource->flags() & DataSource::kIsCachingDataSource)),
       mSegment(NULL),
       mExtractedThumbnails(false),
-      mIsWebm(false) {
+      mIsWebm(false),
+      mSeekIndexTrackNum(0),
+      mSeekIndexFromCues(false),
+      mCuesParsed(false),
+      mSeekIndexEndUs(-1) {
     off64_t size;
     mIsLiveStreaming =
         (mDataSource->flags()
@@ -1014,6 +1236,119 @@ void MatroskaExtractor::addTracks() {
         trackInfo->mTrackNum = track->GetNumber();
         trackInfo->mMeta = meta;
     }
+
+    // Seek based on the first video track, or the first track there is.
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        const char *mime;
+        CHECK(mTracks.itemAt(i).mMeta->findCString(kKeyMIMEType, &mime));
+
+        if (i == 0 || !strncasecmp(mime, "video/", 6)) {
+            mSeekIndexTrackNum = mTracks.itemAt(i).mTrackNum;
+        }
+        if (!strncasecmp(mime, "video/", 6)) {
+            break;
+        }
+    }
+}
+
+void MatroskaExtractor::loadCues_l() {
+    if (mCuesParsed) {
+        return;
+    }
+    mCuesParsed = true;
+
+    // If the Cues have not been located then find them.
+    const mkvparser::Cues* pCues = mSegment->GetCues();
+    const mkvparser::SeekHead* pSH = mSegment->GetSeekHead();
+    if (!pCues && pSH) {
+        const size_t count = pSH->GetCount();
+        const mkvparser::SeekHead::Entry* pEntry;
+        ALOGV("No Cues yet");
+
+        for (size_t index = 0; index < count; index++) {
+            pEntry = pSH->GetEntry(index);
+
+            if (pEntry->id == 0x0C53BB6B) { // Cues ID
+                long len; long long pos;
+                mSegment->ParseCues(pEntry->pos, pos, len);
+                pCues = mSegment->GetCues();
+                ALOGV("Cues found");
+                break;
+            }
+        }
+    }
+
+    if (!pCues) {
+        ALOGI("No Cues in file, seek index is built while playing");
+        return;
+    }
+
+    const mkvparser::Track *pTrack =
+        mSegment->GetTracks()->GetTrackByNumber(mSeekIndexTrackNum);
+    if (!pTrack) {
+        return;
+    }
+
+    // The Cues are read in one go, rather than one CuePoint per seek.
+    while (!pCues->DoneParsing()) {
+        pCues->LoadCuePoint();
+    }
+
+    Vector<SeekPoint> seekPoints;
+    for (const mkvparser::CuePoint *pCP = pCues->GetFirst();
+         pCP != NULL; pCP = pCues->GetNext(pCP)) {
+        const mkvparser::CuePoint::TrackPosition *pTP = pCP->Find(pTrack);
+
+        // m_block starts at 1 but mBlockEntryIndex starts at 0
+        if (pTP == NULL || pTP->m_block <= 0) {
+            continue;
+        }
+
+        SeekPoint point;
+        point.mTimeUs = (pCP->GetTime(mSegment) + 500ll) / 1000ll;
+        point.mClusterPos = pTP->m_pos;
+        point.mBlockEntryIndex = pTP->m_block - 1;
+        seekPoints.push(point);
+    }
+
+    if (seekPoints.isEmpty()) {
+        ALOGW("No Cues for track %lu", mSeekIndexTrackNum);
+        return;
+    }
+
+    ALOGV("%d seek points from the Cues", seekPoints.size());
+    mSeekPoints = seekPoints;
+    mSeekIndexFromCues = true;
+}
+
+void MatroskaExtractor::addSeekPoint_l(
+        int64_t timeUs, long long clusterPos, long blockEntryIndex) {
+    // Usually appended, unless playback went back into the indexed part.
+    ssize_t index = findSeekPoint_l(timeUs);
+    if (index >= 0 && mSeekPoints.itemAt(index).mTimeUs == timeUs) {
+        return;
+    }
+
+    SeekPoint point;
+    point.mTimeUs = timeUs;
+    point.mClusterPos = clusterPos;
+    point.mBlockEntryIndex = blockEntryIndex;
+    mSeekPoints.insertAt(point, index + 1);
+}
+
+ssize_t MatroskaExtractor::findSeekPoint_l(int64_t timeUs) const {
+    ssize_t lo = 0;
+    ssize_t hi = mSeekPoints.size();
+    while (lo < hi) {
+        ssize_t mid = lo + (hi - lo) / 2;
+        if (mSeekPoints.itemAt(mid).mTimeUs <= timeUs) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo - 1;
 }
 
 void MatroskaExtractor::findThumbnails() {
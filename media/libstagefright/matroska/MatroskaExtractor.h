@@ -60,6 +60,13 @@ private:
         sp<MetaData> mMeta;
     };
 
+    // A key frame of the seek index track, sorted by time.
+    struct SeekPoint {
+        int64_t mTimeUs;
+        long long mClusterPos;  // Relative to the segment
+        long mBlockEntryIndex;
+    };
+
     Mutex mLock;
     Vector<TrackInfo> mTracks;
 
@@ -70,9 +77,26 @@ private:
     bool mIsLiveStreaming;
     bool mIsWebm;
 
+    // Seeking is based on the key frames of a single track, the first video
+    // track if there is one. The index is taken from the Cues if the file
+    // has them, otherwise it is built while playing: it then covers all key
+    // frames up to mSeekIndexEndUs.
+    Vector<SeekPoint> mSeekPoints;
+    unsigned long mSeekIndexTrackNum;
+    bool mSeekIndexFromCues;
+    bool mCuesParsed;
+    int64_t mSeekIndexEndUs;
+
     void addTracks();
     void findThumbnails();
 
+    void loadCues_l();
+    void addSeekPoint_l(
+            int64_t timeUs, long long clusterPos, long blockEntryIndex);
+    // Returns the index of the last seek point at or before the given
+    // time, -1 if there is none.
+    ssize_t findSeekPoint_l(int64_t timeUs) const;
+
     bool isLiveStreaming() const;
 
     MatroskaExtractor(const MatroskaExtractor &);
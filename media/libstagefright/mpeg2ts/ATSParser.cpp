@@ -78,6 +78,8 @@ struct ATSParser::Program : public RefBase {
         return mProgramMapPID;
     }
 
+    void addStreamPIDsToFilter(uint32_t *filter) const;
+
     uint32_t parserFlags() const {
         return mParser->mFlags;
     }
@@ -138,6 +140,10 @@ private:
     status_t flush();
     status_t parsePES(ABitReader *br);
 
+    // Handles the common layout of a PES packet straight from the bytes,
+    // returns false without side effects if parsePES() needs to take over.
+    bool parsePESFast(const uint8_t *data, size_t size, status_t *err);
+
     void onPayloadData(
             unsigned PTS_DTS_flags, uint64_t PTS, uint64_t DTS,
             const uint8_t *data, size_t size);
@@ -213,6 +219,13 @@ bool ATSParser::Program::parsePID(
     return true;
 }
 
+void ATSParser::Program::addStreamPIDsToFilter(uint32_t *filter) const {
+    for (size_t i = 0; i < mStreams.size(); ++i) {
+        unsigned pid = mStreams.keyAt(i);
+        filter[pid >> 5] |= 1u << (pid & 31);
+    }
+}
+
 void ATSParser::Program::signalDiscontinuity(
         DiscontinuityType type, const sp<AMessage> &extra) {
     int64_t mediaTimeUs;
@@ -558,21 +571,7 @@ status_t ATSParser::Stream::parse(
     size_t payloadSizeBits = br->numBitsLeft();
     CHECK_EQ(payloadSizeBits % 8, 0u);
 
-    size_t neededSize = mBuffer->size() + payloadSizeBits / 8;
-    if (mBuffer->capacity() < neededSize) {
-        // Increment in multiples of 64K.
-        neededSize = (neededSize + 65535) & ~65535;
-
-        ALOGI("resizing buffer to %d bytes", neededSize);
-
-        sp<ABuffer> newBuffer = new ABuffer(neededSize);
-        memcpy(newBuffer->data(), mBuffer->data(), mBuffer->size());
-        newBuffer->setRange(0, mBuffer->size());
-        mBuffer = newBuffer;
-    }
-
-    memcpy(mBuffer->data() + mBuffer->size(), br->data(), payloadSizeBits / 8);
-    mBuffer->setRange(0, mBuffer->size() + payloadSizeBits / 8);
+    mBuffer->append(br->data(), payloadSizeBits / 8);
 
     return OK;
 }
@@ -822,6 +821,90 @@ status_t ATSParser::Stream::parsePES(ABitReader *br) {
     return OK;
 }
 
+// Decodes a 33 bit PTS or DTS, returns false if the 4 bit prefix or any of
+// the marker bits are not what they should be.
+static bool ParseTimestamp(const uint8_t *data, unsigned prefix, uint64_t *ts) {
+    if ((data[0] >> 4) != prefix
+            || !(data[0] & 1) || !(data[2] & 1) || !(data[4] & 1)) {
+        return false;
+    }
+
+    *ts = ((uint64_t)((data[0] >> 1) & 7) << 30)
+        | ((uint64_t)data[1] << 22)
+        | ((uint64_t)(data[2] >> 1) << 15)
+        | ((uint64_t)data[3] << 7)
+        | (data[4] >> 1);
+
+    return true;
+}
+
+bool ATSParser::Stream::parsePESFast(
+        const uint8_t *data, size_t size, status_t *err) {
+    if (size < 9 || data[0] != 0x00 || data[1] != 0x00 || data[2] != 0x01) {
+        return false;
+    }
+
+    unsigned stream_id = data[3];
+    switch (stream_id) {
+        case 0xbc:  // program_stream_map
+        case 0xbe:  // padding_stream
+        case 0xbf:  // private_stream_2
+        case 0xf0:  // ECM
+        case 0xf1:  // EMM
+        case 0xff:  // program_stream_directory
+        case 0xf2:  // DSMCC
+        case 0xf8:  // H.222.1 type E
+            return false;
+
+        default:
+            break;
+    }
+
+    unsigned PES_packet_length = U16_AT(&data[4]);
+    unsigned PTS_DTS_flags = data[7] >> 6;
+    unsigned PES_header_data_length = data[8];
+
+    // Leave anything with ESCR or ES_rate and all the inconsistent cases
+    // to parsePES().
+    if ((data[6] >> 6) != 2
+            || PTS_DTS_flags == 1
+            || (data[7] & 0x30)
+            || size < 9 + PES_header_data_length) {
+        return false;
+    }
+
+    uint64_t PTS = 0, DTS = 0;
+
+    if (PTS_DTS_flags == 2 || PTS_DTS_flags == 3) {
+        if (PES_header_data_length < (PTS_DTS_flags == 3 ? 10u : 5u)
+                || !ParseTimestamp(&data[9], PTS_DTS_flags, &PTS)
+                || (PTS_DTS_flags == 3
+                        && !ParseTimestamp(&data[14], 1, &DTS))) {
+            return false;
+        }
+
+        ALOGV("PTS = 0x%016llx (%.2f)", PTS, PTS / 90000.0);
+    }
+
+    const uint8_t *payload = &data[9 + PES_header_data_length];
+    size_t payloadSize = size - 9 - PES_header_data_length;
+
+    if (PES_packet_length != 0) {
+        if (PES_packet_length < PES_header_data_length + 3
+                || payloadSize
+                    < PES_packet_length - 3 - PES_header_data_length) {
+            return false;
+        }
+
+        payloadSize = PES_packet_length - 3 - PES_header_data_length;
+    }
+
+    onPayloadData(PTS_DTS_flags, PTS, DTS, payload, payloadSize);
+
+    *err = OK;
+    return true;
+}
+
 status_t ATSParser::Stream::flush() {
     if (mBuffer->size() == 0) {
         return OK;
@@ -829,9 +912,11 @@ status_t ATSParser::Stream::flush() {
 
     ALOGV("flushing stream 0x%04x size = %d", mElementaryPID, mBuffer->size());
 
-    ABitReader br(mBuffer->data(), mBuffer->size());
-
-    status_t err = parsePES(&br);
+    status_t err;
+    if (!parsePESFast(mBuffer->data(), mBuffer->size(), &err)) {
+        ABitReader br(mBuffer->data(), mBuffer->size());
+        err = parsePES(&br);
+    }
 
     mBuffer->setRange(0, 0);
 
@@ -920,6 +1005,7 @@ ATSParser::ATSParser(uint32_t flags)
       mTimeOffsetValid(false),
       mTimeOffsetUs(0ll),
       mNumTSPacketsParsed(0),
+      mPIDFilterValid(false),
       mNumPCRs(0) {
     mPSISections.add(0 /* PID */, new PSISection);
 }
@@ -930,8 +1016,63 @@ ATSParser::~ATSParser() {
 status_t ATSParser::feedTSPacket(const void *data, size_t size) {
     CHECK_EQ(size, kTSPacketSize);
 
-    ABitReader br((const uint8_t *)data, kTSPacketSize);
-    return parseTS(&br);
+    return parseTS((const uint8_t *)data);
+}
+
+status_t ATSParser::feedTSPackets(const void *data, size_t numPackets) {
+    const uint8_t *packets = (const uint8_t *)data;
+
+    // Make sure we are in sync before parsing any of the packets.
+    for (size_t i = 0; i < numPackets; ++i) {
+        if (packets[i * kTSPacketSize] != 0x47) {
+            ALOGE("TS packet %d of %d does not start with a sync byte.",
+                  i, numPackets);
+
+            return ERROR_MALFORMED;
+        }
+    }
+
+    for (size_t i = 0; i < numPackets; ++i) {
+        const uint8_t *packet = &packets[i * kTSPacketSize];
+        uint32_t header = U32_AT(packet);
+
+        if (header & 0x800000) {  // transport_error_indicator
+            continue;
+        }
+
+        if (!mPIDFilterValid) {
+            updatePIDFilter();
+        }
+
+        unsigned PID = (header >> 8) & 0x1fff;
+        if (!(mPIDFilter[PID >> 5] & (1u << (PID & 31)))) {
+            ++mNumTSPacketsParsed;
+            continue;
+        }
+
+        status_t err = parseTS(packet);
+
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    return OK;
+}
+
+void ATSParser::updatePIDFilter() {
+    memset(mPIDFilter, 0, sizeof(mPIDFilter));
+
+    for (size_t i = 0; i < mPSISections.size(); ++i) {
+        unsigned PID = mPSISections.keyAt(i);
+        mPIDFilter[PID >> 5] |= 1u << (PID & 31);
+    }
+
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        mPrograms.itemAt(i)->addStreamPIDsToFilter(mPIDFilter);
+    }
+
+    mPIDFilterValid = true;
 }
 
 void ATSParser::signalDiscontinuity(
@@ -1062,6 +1203,9 @@ status_t ATSParser::parsePID(
             return OK;
         }
 
+        // Parsing the section may add or remove PSI sections and streams.
+        mPIDFilterValid = false;
+
         ABitReader sectionBits(section->data(), section->size());
 
         if (PID == 0) {
@@ -1170,44 +1314,44 @@ void ATSParser::parseAdaptationField(ABitReader *br, unsigned PID) {
     }
 }
 
-status_t ATSParser::parseTS(ABitReader *br) {
+status_t ATSParser::parseTS(const uint8_t *packet) {
     ALOGV("---");
 
-    unsigned sync_byte = br->getBits(8);
+    // The 4 byte header is decoded in one go, only the adaptation field and
+    // the payload go through an ABitReader.
+    uint32_t header = U32_AT(packet);
+
+    unsigned sync_byte = header >> 24;
     CHECK_EQ(sync_byte, 0x47u);
 
-    if (br->getBits(1)) {  // transport_error_indicator
+    if (header & 0x800000) {  // transport_error_indicator
         // silently ignore.
         return OK;
     }
 
-    unsigned payload_unit_start_indicator = br->getBits(1);
+    unsigned payload_unit_start_indicator = (header >> 22) & 1;
     ALOGV("payload_unit_start_indicator = %u", payload_unit_start_indicator);
 
-    MY_LOGV("transport_priority = %u", br->getBits(1));
-
-    unsigned PID = br->getBits(13);
+    unsigned PID = (header >> 8) & 0x1fff;
     ALOGV("PID = 0x%04x", PID);
 
-    MY_LOGV("transport_scrambling_control = %u", br->getBits(2));
-
-    unsigned adaptation_field_control = br->getBits(2);
+    unsigned adaptation_field_control = (header >> 4) & 3;
     ALOGV("adaptation_field_control = %u", adaptation_field_control);
 
-    unsigned continuity_counter = br->getBits(4);
+    unsigned continuity_counter = header & 0x0f;
     ALOGV("PID = 0x%04x, continuity_counter = %u", PID, continuity_counter);
 
-    // ALOGI("PID = 0x%04x, continuity_counter = %u", PID, continuity_counter);
+    ABitReader br(packet + 4, kTSPacketSize - 4);
 
     if (adaptation_field_control == 2 || adaptation_field_control == 3) {
-        parseAdaptationField(br, PID);
+        parseAdaptationField(&br, PID);
     }
 
     status_t err = OK;
 
     if (adaptation_field_control == 1 || adaptation_field_control == 3) {
         err = parsePID(
-                br, PID, continuity_counter, payload_unit_start_indicator);
+                &br, PID, continuity_counter, payload_unit_start_indicator);
     }
 
     ++mNumTSPacketsParsed;
@@ -1277,26 +1421,12 @@ ATSParser::PSISection::~PSISection() {
 }
 
 status_t ATSParser::PSISection::append(const void *data, size_t size) {
-    if (mBuffer == NULL || mBuffer->size() + size > mBuffer->capacity()) {
-        size_t newCapacity =
-            (mBuffer == NULL) ? size : mBuffer->capacity() + size;
-
-        newCapacity = (newCapacity + 1023) & ~1023;
-
-        sp<ABuffer> newBuffer = new ABuffer(newCapacity);
-
-        if (mBuffer != NULL) {
-            memcpy(newBuffer->data(), mBuffer->data(), mBuffer->size());
-            newBuffer->setRange(0, mBuffer->size());
-        } else {
-            newBuffer->setRange(0, 0);
-        }
-
-        mBuffer = newBuffer;
+    if (mBuffer == NULL) {
+        mBuffer = new ABuffer((size + 1023) & ~1023);
+        mBuffer->setRange(0, 0);
     }
 
-    memcpy(mBuffer->data() + mBuffer->size(), data, size);
-    mBuffer->setRange(0, mBuffer->size() + size);
+    mBuffer->append(data, size);
 
     return OK;
 }
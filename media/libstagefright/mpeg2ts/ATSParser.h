@@ -65,6 +65,11 @@ struct ATSParser : public RefBase {
 
     status_t feedTSPacket(const void *data, size_t size);
 
+    // Parses "numPackets" consecutive transport stream packets of 188 bytes
+    // each. Packets on PIDs that are neither a PSI section nor an elementary
+    // stream of a known program are counted but not parsed any further.
+    status_t feedTSPackets(const void *data, size_t numPackets);
+
     void signalDiscontinuity(
             DiscontinuityType type, const sp<AMessage> &extra);
 
@@ -115,6 +120,17 @@ private:
 
     size_t mNumTSPacketsParsed;
 
+    enum {
+        kNumPIDs = 8192,
+    };
+
+    // One bit per PID that parsePID() would do anything with, rebuilt
+    // whenever a PSI section has been parsed.
+    uint32_t mPIDFilter[kNumPIDs / 32];
+    bool mPIDFilterValid;
+
+    void updatePIDFilter();
+
     void parseProgramAssociationTable(ABitReader *br);
     void parseProgramMap(ABitReader *br);
     void parsePES(ABitReader *br);
@@ -125,7 +141,7 @@ private:
         unsigned payload_unit_start_indicator);
 
     void parseAdaptationField(ABitReader *br, unsigned PID);
-    status_t parseTS(ABitReader *br);
+    status_t parseTS(const uint8_t *packet);
 
     void updatePCR(unsigned PID, uint64_t PCR, size_t byteOffsetFromStart);
 
@@ -37,7 +37,10 @@ namespace android {
 
 ElementaryStreamQueue::ElementaryStreamQueue(Mode mode, uint32_t flags)
     : mMode(mode),
-      mFlags(flags) {
+      mFlags(flags),
+      mNALScanOffset(0),
+      mNALTotalSize(0),
+      mFoundSlice(false) {
 }
 
 sp<MetaData> ElementaryStreamQueue::getFormat() {
@@ -51,6 +54,11 @@ void ElementaryStreamQueue::clear(bool clearFormat) {
 
     mRangeInfos.clear();
 
+    mNALs.clear();
+    mNALScanOffset = 0;
+    mNALTotalSize = 0;
+    mFoundSlice = false;
+
     if (clearFormat) {
         mFormat.clear();
     }
@@ -134,13 +142,7 @@ status_t ElementaryStreamQueue::appendData(
 #else
                 uint8_t *ptr = (uint8_t *)data;
 
-                ssize_t startOffset = -1;
-                for (size_t i = 0; i + 3 < size; ++i) {
-                    if (!memcmp("\x00\x00\x00\x01", &ptr[i], 4)) {
-                        startOffset = i;
-                        break;
-                    }
-                }
+                ssize_t startOffset = FindLongStartCode(ptr, size);
 
                 if (startOffset < 0) {
                     return ERROR_MALFORMED;
@@ -167,13 +169,7 @@ status_t ElementaryStreamQueue::appendData(
 #else
                 uint8_t *ptr = (uint8_t *)data;
 
-                ssize_t startOffset = -1;
-                for (size_t i = 0; i + 2 < size; ++i) {
-                    if (!memcmp("\x00\x00\x01", &ptr[i], 3)) {
-                        startOffset = i;
-                        break;
-                    }
-                }
+                ssize_t startOffset = FindStartCode(ptr, size);
 
                 if (startOffset < 0) {
                     return ERROR_MALFORMED;
@@ -267,25 +263,12 @@ status_t ElementaryStreamQueue::appendData(
         }
     }
 
-    size_t neededSize = (mBuffer == NULL ? 0 : mBuffer->size()) + size;
-    if (mBuffer == NULL || neededSize > mBuffer->capacity()) {
-        neededSize = (neededSize + 65535) & ~65535;
-
-        ALOGV("resizing buffer to size %d", neededSize);
-
-        sp<ABuffer> buffer = new ABuffer(neededSize);
-        if (mBuffer != NULL) {
-            memcpy(buffer->data(), mBuffer->data(), mBuffer->size());
-            buffer->setRange(0, mBuffer->size());
-        } else {
-            buffer->setRange(0, 0);
-        }
-
-        mBuffer = buffer;
+    if (mBuffer == NULL) {
+        mBuffer = new ABuffer((size + 65535) & ~65535);
+        mBuffer->setRange(0, 0);
     }
 
-    memcpy(mBuffer->data() + mBuffer->size(), data, size);
-    mBuffer->setRange(0, mBuffer->size() + size);
+    mBuffer->append(data, size);
 
     RangeInfo info;
     info.mLength = size;
@@ -311,15 +294,10 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnit() {
         RangeInfo info = *mRangeInfos.begin();
         mRangeInfos.erase(mRangeInfos.begin());
 
-        sp<ABuffer> accessUnit = new ABuffer(info.mLength);
-        memcpy(accessUnit->data(), mBuffer->data(), info.mLength);
+        sp<ABuffer> accessUnit = mBuffer->slice(0, info.mLength);
         accessUnit->meta()->setInt64("timeUs", info.mTimestampUs);
 
-        memmove(mBuffer->data(),
-                mBuffer->data() + info.mLength,
-                mBuffer->size() - info.mLength);
-
-        mBuffer->setRange(0, mBuffer->size() - info.mLength);
+        consume(info.mLength);
 
         if (mFormat == NULL) {
             mFormat = MakeAVCCodecSpecificData(accessUnit);
@@ -346,6 +324,16 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnit() {
             return dequeueAccessUnitMPEGAudio();
     }
 }
+
+void ElementaryStreamQueue::consume(size_t size) {
+    CHECK_LE(size, mBuffer->size());
+    mBuffer->setRange(mBuffer->offset() + size, mBuffer->size() - size);
+
+    mNALs.clear();
+    mNALScanOffset = 0;
+    mNALTotalSize = 0;
+    mFoundSlice = false;
+}
 sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitAC3() {
     int64_t timeUs;
     uint16_t offset = 0;
@@ -443,11 +431,8 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitAC3() {
     if (offset == 0) {
         return NULL;
     }
-    sp<ABuffer> accessUnit = new ABuffer(offset);
-    memcpy(accessUnit->data(), mBuffer->data(), offset);
-    memmove(mBuffer->data(), mBuffer->data() + offset,
-            mBuffer->size() - offset);
-    mBuffer->setRange(0, mBuffer->size() - offset);
+    sp<ABuffer> accessUnit = mBuffer->slice(0, offset);
+    consume(offset);
     accessUnit->meta()->setInt64("timeUs", timeUs);
     return accessUnit;
 }
@@ -484,8 +469,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitPCMAudio() {
         return NULL;
     }
 
-    sp<ABuffer> accessUnit = new ABuffer(payloadSize);
-    memcpy(accessUnit->data(), mBuffer->data() + 4, payloadSize);
+    sp<ABuffer> accessUnit = mBuffer->slice(4, payloadSize);
 
     int64_t timeUs = fetchTimestamp(payloadSize + 4);
     CHECK_GE(timeUs, 0ll);
@@ -496,12 +480,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitPCMAudio() {
         ptr[i] = ntohs(ptr[i]);
     }
 
-    memmove(
-            mBuffer->data(),
-            mBuffer->data() + 4 + payloadSize,
-            mBuffer->size() - 4 - payloadSize);
-
-    mBuffer->setRange(0, mBuffer->size() - 4 - payloadSize);
+    consume(4 + payloadSize);
 
     return accessUnit;
 }
@@ -594,12 +573,8 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitAAC() {
 
     int64_t timeUs = fetchTimestamp(offset);
 
-    sp<ABuffer> accessUnit = new ABuffer(offset);
-    memcpy(accessUnit->data(), mBuffer->data(), offset);
-
-    memmove(mBuffer->data(), mBuffer->data() + offset,
-            mBuffer->size() - offset);
-    mBuffer->setRange(0, mBuffer->size() - offset);
+    sp<ABuffer> accessUnit = mBuffer->slice(0, offset);
+    consume(offset);
 
     accessUnit->meta()->setInt64("timeUs", timeUs);
 
@@ -641,23 +616,15 @@ int64_t ElementaryStreamQueue::fetchTimestamp(size_t size) {
     return timeUs;
 }
 
-struct NALPosition {
-    size_t nalOffset;
-    size_t nalSize;
-};
-
 sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
-    const uint8_t *data = mBuffer->data();
-
-    size_t size = mBuffer->size();
-    Vector<NALPosition> nals;
-
-    size_t totalSize = 0;
+    // Pick up where the previous call ran out of data instead of scanning
+    // the pending access unit all over again.
+    const uint8_t *data = mBuffer->data() + mNALScanOffset;
+    size_t size = mBuffer->size() - mNALScanOffset;
 
     status_t err;
     const uint8_t *nalStart;
     size_t nalSize;
-    bool foundSlice = false;
     while ((err = getNextNALUnit(&data, &size, &nalStart, &nalSize)) == OK) {
         if (nalSize == 0) continue;
 
@@ -665,7 +632,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
         bool flush = false;
 
         if (nalType == 1 || nalType == 5) {
-            if (foundSlice) {
+            if (mFoundSlice) {
                 ABitReader br(nalStart + 1, nalSize);
                 unsigned first_mb_in_slice = parseUE(&br);
 
@@ -676,8 +643,8 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
                 }
             }
 
-            foundSlice = true;
-        } else if ((nalType == 9 || nalType == 7) && foundSlice) {
+            mFoundSlice = true;
+        } else if ((nalType == 9 || nalType == 7) && mFoundSlice) {
             // Access unit delimiter and SPS will be associated with the
             // next frame.
 
@@ -688,47 +655,62 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
             // The access unit will contain all nal units up to, but excluding
             // the current one, separated by 0x00 0x00 0x00 0x01 startcodes.
 
-            size_t auSize = 4 * nals.size() + totalSize;
-            sp<ABuffer> accessUnit = new ABuffer(auSize);
+            size_t auSize = 4 * mNALs.size() + mNALTotalSize;
+
+            // If the nal units already follow each other with exactly that
+            // separation, the access unit is just a slice of the queue.
+            size_t auOffset = mNALs.itemAt(0).nalOffset - 4;
+            bool contiguous = mNALs.itemAt(0).nalOffset >= 4;
+            for (size_t i = 0; contiguous && i < mNALs.size(); ++i) {
+                const NALPosition &pos = mNALs.itemAt(i);
+                contiguous = !memcmp(
+                        mBuffer->data() + pos.nalOffset - 4,
+                        "\x00\x00\x00\x01", 4)
+                    && (i + 1 == mNALs.size()
+                        || mNALs.itemAt(i + 1).nalOffset
+                            == pos.nalOffset + pos.nalSize + 4);
+            }
 
 #if !LOG_NDEBUG
             AString out;
-#endif
-
-            size_t dstOffset = 0;
-            for (size_t i = 0; i < nals.size(); ++i) {
-                const NALPosition &pos = nals.itemAt(i);
-
-                unsigned nalType = mBuffer->data()[pos.nalOffset] & 0x1f;
-
-#if !LOG_NDEBUG
+            for (size_t i = 0; i < mNALs.size(); ++i) {
                 char tmp[128];
-                sprintf(tmp, "0x%02x", nalType);
+                sprintf(tmp, "0x%02x",
+                        mBuffer->data()[mNALs.itemAt(i).nalOffset] & 0x1f);
                 if (i > 0) {
                     out.append(", ");
                 }
                 out.append(tmp);
+            }
+
+            ALOGV("accessUnit contains nal types %s", out.c_str());
 #endif
 
-                memcpy(accessUnit->data() + dstOffset, "\x00\x00\x00\x01", 4);
+            sp<ABuffer> accessUnit;
+            if (contiguous) {
+                accessUnit = mBuffer->slice(auOffset, auSize);
+            } else {
+                accessUnit = new ABuffer(auSize);
 
-                memcpy(accessUnit->data() + dstOffset + 4,
-                       mBuffer->data() + pos.nalOffset,
-                       pos.nalSize);
+                size_t dstOffset = 0;
+                for (size_t i = 0; i < mNALs.size(); ++i) {
+                    const NALPosition &pos = mNALs.itemAt(i);
 
-                dstOffset += pos.nalSize + 4;
-            }
+                    memcpy(accessUnit->data() + dstOffset,
+                           "\x00\x00\x00\x01", 4);
 
-            ALOGV("accessUnit contains nal types %s", out.c_str());
+                    memcpy(accessUnit->data() + dstOffset + 4,
+                           mBuffer->data() + pos.nalOffset,
+                           pos.nalSize);
 
-            const NALPosition &pos = nals.itemAt(nals.size() - 1);
-            size_t nextScan = pos.nalOffset + pos.nalSize;
+                    dstOffset += pos.nalSize + 4;
+                }
+            }
 
-            memmove(mBuffer->data(),
-                    mBuffer->data() + nextScan,
-                    mBuffer->size() - nextScan);
+            const NALPosition &pos = mNALs.itemAt(mNALs.size() - 1);
+            size_t nextScan = pos.nalOffset + pos.nalSize;
 
-            mBuffer->setRange(0, mBuffer->size() - nextScan);
+            consume(nextScan);
 
             int64_t timeUs = fetchTimestamp(nextScan);
             CHECK_GE(timeUs, 0ll);
@@ -748,9 +730,13 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
         pos.nalOffset = nalStart - mBuffer->data();
         pos.nalSize = nalSize;
 
-        nals.push(pos);
+        mNALs.push(pos);
 
-        totalSize += nalSize;
+        mNALTotalSize += nalSize;
+
+        // The next nal unit's startcode follows this one's payload,
+        // possibly after some trailing zero bytes.
+        mNALScanOffset = pos.nalOffset + pos.nalSize;
     }
     CHECK_EQ(err, (status_t)-EAGAIN);
 
@@ -779,14 +765,8 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGAudio() {
 
     unsigned layer = 4 - ((header >> 17) & 3);
 
-    sp<ABuffer> accessUnit = new ABuffer(frameSize);
-    memcpy(accessUnit->data(), data, frameSize);
-
-    memmove(mBuffer->data(),
-            mBuffer->data() + frameSize,
-            mBuffer->size() - frameSize);
-
-    mBuffer->setRange(0, mBuffer->size() - frameSize);
+    sp<ABuffer> accessUnit = mBuffer->slice(0, frameSize);
+    consume(frameSize);
 
     int64_t timeUs = fetchTimestamp(frameSize);
     CHECK_GE(timeUs, 0ll);
@@ -871,21 +851,23 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGVideo() {
 
     size_t offset = 0;
     while (offset + 3 < size) {
-        if (memcmp(&data[offset], "\x00\x00\x01", 3)) {
-            ++offset;
-            continue;
+        // The startcode must be followed by at least one more byte.
+        ssize_t pos = FindStartCode(&data[offset], size - offset - 1);
+        if (pos < 0) {
+            break;
         }
+        offset += pos;
 
         pprevStartCode = prevStartCode;
         prevStartCode = currentStartCode;
         currentStartCode = data[offset + 3];
 
         if (currentStartCode == 0xb3 && mFormat == NULL) {
-            memmove(mBuffer->data(), mBuffer->data() + offset, size - offset);
+            consume(offset);
+            data = mBuffer->data();
             size -= offset;
             (void)fetchTimestamp(offset);
             offset = 0;
-            mBuffer->setRange(0, size);
         }
 
         if ((prevStartCode == 0xb3 && currentStartCode != 0xb5)
@@ -911,11 +893,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGVideo() {
                 sp<ABuffer> csd = new ABuffer(offset);
                 memcpy(csd->data(), data, offset);
 
-                memmove(mBuffer->data(),
-                        mBuffer->data() + offset,
-                        mBuffer->size() - offset);
-
-                mBuffer->setRange(0, mBuffer->size() - offset);
+                consume(offset);
                 size -= offset;
                 (void)fetchTimestamp(offset);
                 offset = 0;
@@ -936,14 +914,8 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGVideo() {
             if (!sawPictureStart) {
                 sawPictureStart = true;
             } else {
-                sp<ABuffer> accessUnit = new ABuffer(offset);
-                memcpy(accessUnit->data(), data, offset);
-
-                memmove(mBuffer->data(),
-                        mBuffer->data() + offset,
-                        mBuffer->size() - offset);
-
-                mBuffer->setRange(0, mBuffer->size() - offset);
+                sp<ABuffer> accessUnit = mBuffer->slice(0, offset);
+                consume(offset);
 
                 int64_t timeUs = fetchTimestamp(offset);
                 CHECK_GE(timeUs, 0ll);
@@ -979,16 +951,12 @@ static ssize_t getNextChunkSize(
         TRESPASS();
     }
 
-    size_t offset = 3;
-    while (offset + 2 < size) {
-        if (!memcmp(&data[offset], kStartCode, 3)) {
-            return offset;
-        }
-
-        ++offset;
+    ssize_t offset = FindStartCode(&data[3], size - 3);
+    if (offset < 0) {
+        return -EAGAIN;
     }
 
-    return -EAGAIN;
+    return offset + 3;
 }
 
 sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEG4Video() {
@@ -1097,12 +1065,8 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEG4Video() {
                 if (chunkType == 0xb6) {
                     offset += chunkSize;
 
-                    sp<ABuffer> accessUnit = new ABuffer(offset);
-                    memcpy(accessUnit->data(), data, offset);
-
-                    memmove(data, &data[offset], size - offset);
-                    size -= offset;
-                    mBuffer->setRange(0, size);
+                    sp<ABuffer> accessUnit = mBuffer->slice(0, offset);
+                    consume(offset);
 
                     int64_t timeUs = fetchTimestamp(offset);
                     CHECK_GE(timeUs, 0ll);
@@ -1131,10 +1095,10 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEG4Video() {
 
         if (discard) {
             (void)fetchTimestamp(offset);
-            memmove(data, &data[offset], size - offset);
+            consume(offset);
+            data = mBuffer->data();
             size -= offset;
             offset = 0;
-            mBuffer->setRange(0, size);
         } else {
             offset += chunkSize;
         }
@@ -22,6 +22,7 @@
 #include <utils/Errors.h>
 #include <utils/List.h>
 #include <utils/RefBase.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -58,12 +59,28 @@ private:
         size_t mLength;
     };
 
+    struct NALPosition {
+        size_t nalOffset;
+        size_t nalSize;
+    };
+
     Mode mMode;
     uint32_t mFlags;
 
+    // Consumed data is dropped from the front of the range, access units
+    // are handed out as slices of it. The buffer only ever copies the
+    // remaining bytes when it runs out of room.
     sp<ABuffer> mBuffer;
     List<RangeInfo> mRangeInfos;
 
+    // NAL units of the pending H.264 access unit found so far, and where to
+    // resume scanning once more data arrived. Offsets are relative to
+    // mBuffer->data().
+    Vector<NALPosition> mNALs;
+    size_t mNALScanOffset;
+    size_t mNALTotalSize;
+    bool mFoundSlice;
+
     sp<MetaData> mFormat;
 
     sp<ABuffer> dequeueAccessUnitH264();
@@ -74,6 +91,9 @@ private:
     sp<ABuffer> dequeueAccessUnitPCMAudio();
     sp<ABuffer> dequeueAccessUnitAC3();
 
+    // Drops "size" bytes from the front of mBuffer.
+    void consume(size_t size);
+
     // consume a logical (compressed) access unit of size "size",
     // returns its timestamp in us (or -1 if no time information).
     int64_t fetchTimestamp(size_t size);
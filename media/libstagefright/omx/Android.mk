@@ -7,6 +7,7 @@ LOCAL_SRC_FILES:=                     \
         OMXMaster.cpp                 \
         OMXNodeInstance.cpp           \
         SimpleSoftOMXComponent.cpp    \
+        SoftAudioBatch.cpp            \
         SoftOMXComponent.cpp          \
         SoftOMXPlugin.cpp             \
         SoftVideoDecoderOMXComponent.cpp \
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SoftAudioBatch"
+#include <utils/Log.h>
+
+#include "include/SoftAudioBatch.h"
+
+#include <string.h>
+
+namespace android {
+
+SoftAudioBatch::SoftAudioBatch()
+    : mData(NULL),
+      mSizes(NULL),
+      mNumUnits(0),
+      mNumConfigUnits(0),
+      mEndOfStream(false),
+      mChannelCount(0),
+      mIsADTS(false),
+      mPCM(NULL),
+      mPCMCapacity(0),
+      mPCMSize(0),
+      mSampleRate(0),
+      mNumChannels(0) {
+}
+
+void *SoftAudioBatch::outputBuffer(size_t size, void *scratch) {
+    if (mPCMSize + size <= mPCMCapacity) {
+        return mPCM + mPCMSize;
+    }
+
+    return scratch;
+}
+
+bool SoftAudioBatch::append(const void *data, size_t size, size_t skip) {
+    if (skip >= size) {
+        return !isFull();
+    }
+
+    size -= skip;
+
+    uint8_t *dst = mPCM + mPCMSize;
+    const uint8_t *src = (const uint8_t *)data + skip;
+
+    if (size > mPCMCapacity - mPCMSize) {
+        ALOGW("PCM buffer full, dropping %zu bytes",
+              size - (mPCMCapacity - mPCMSize));
+        size = mPCMCapacity - mPCMSize;
+    }
+
+    if (src != dst) {
+        // Decoded in place but with leading samples to skip, or decoded
+        // to scratch because it would not have fit.
+        memmove(dst, src, size);
+    }
+
+    mPCMSize += size;
+
+    return !isFull();
+}
+
+bool SoftAudioBatch::appendSilence(size_t size) {
+    if (size > mPCMCapacity - mPCMSize) {
+        size = mPCMCapacity - mPCMSize;
+    }
+
+    memset(mPCM + mPCMSize, 0, size);
+    mPCMSize += size;
+
+    return !isFull();
+}
+
+}  // namespace android
@@ -21,6 +21,7 @@
 #include "include/SoftOMXComponent.h"
 
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaErrors.h>
 
 namespace android {
 
@@ -81,6 +82,10 @@ OMX_ERRORTYPE SoftOMXComponent::initCheck() const {
     return OMX_ErrorNone;
 }
 
+status_t SoftOMXComponent::decodeBatch(SoftAudioBatch * /* batch */) {
+    return ERROR_UNSUPPORTED;
+}
+
 const char *SoftOMXComponent::name() const {
     return mName.c_str();
 }
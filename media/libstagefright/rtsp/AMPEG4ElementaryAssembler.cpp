@@ -344,8 +344,7 @@ ARTPAssembler::AssemblyStatus AMPEG4ElementaryAssembler::addPacket(
 
             CHECK_LE(offset + header.mSize, buffer->size());
 
-            sp<ABuffer> accessUnit = new ABuffer(header.mSize);
-            memcpy(accessUnit->data(), buffer->data() + offset, header.mSize);
+            sp<ABuffer> accessUnit = buffer->slice(offset, header.mSize);
 
             offset += header.mSize;
 
@@ -343,8 +343,13 @@ static bool ExtractDimensionsMPEG4Config(
     size_t offset = 0;
     bool foundVOL = false;
     while (offset + 3 < config->size()) {
-        if (memcmp("\x00\x00\x01", &ptr[offset], 3)
-                || (ptr[offset + 3] & 0xf0) != 0x20) {
+        ssize_t pos = FindStartCode(&ptr[offset], config->size() - offset - 1);
+        if (pos < 0) {
+            break;
+        }
+        offset += pos;
+
+        if ((ptr[offset + 3] & 0xf0) != 0x20) {
             ++offset;
             continue;
         }
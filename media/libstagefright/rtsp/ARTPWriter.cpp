@@ -20,6 +20,8 @@
 
 #include "ARTPWriter.h"
 
+#include "avc_utils.h"
+
 #include <fcntl.h>
 
 #include <media/stagefright/foundation/ABuffer.h>
@@ -524,21 +526,14 @@ void ARTPWriter::dumpSessionDesc() {
 }
 
 void ARTPWriter::makeH264SPropParamSets(MediaBuffer *buffer) {
-    static const char kStartCode[] = "\x00\x00\x00\x01";
-
     const uint8_t *data =
         (const uint8_t *)buffer->data() + buffer->range_offset();
     size_t size = buffer->range_length();
 
     CHECK_GE(size, 0u);
 
-    size_t startCodePos = 0;
-    while (startCodePos + 3 < size
-            && memcmp(kStartCode, &data[startCodePos], 4)) {
-        ++startCodePos;
-    }
-
-    CHECK_LT(startCodePos + 3, size);
+    ssize_t startCodePos = FindLongStartCode(data, size);
+    CHECK_GE(startCodePos, 0);
 
     CHECK_EQ((unsigned)data[0], 0x67u);
 
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ABitReader_test"
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABitReader.h>
+
+namespace android {
+
+static const uint8_t kData[] = {
+    0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0,
+    0x0f, 0xed, 0xcb, 0xa9, 0x87, 0x65, 0x43, 0x21,
+    0xa5, 0x5a, 0xff, 0x00, 0x81,
+};
+
+// Bit "index" of kData, counted from the most significant bit.
+static uint32_t referenceBits(size_t index, size_t n) {
+    uint32_t x = 0;
+    for (size_t i = index; i < index + n; ++i) {
+        x = (x << 1) | ((kData[i / 8] >> (7 - i % 8)) & 1);
+    }
+    return x;
+}
+
+TEST(ABitReaderTest, ReadsAcrossByteAndWordBoundaries) {
+    // Every width at every starting position, which puts reads across
+    // byte boundaries, the 64-bit reservoir refill and the short tail.
+    for (size_t n = 1; n <= 32; ++n) {
+        for (size_t start = 0; start + n <= 8 * sizeof(kData); ++start) {
+            ABitReader br(kData, sizeof(kData));
+            br.skipBits(start);
+
+            ASSERT_EQ(referenceBits(start, n), br.peekBits(n))
+                << "n " << n << " start " << start;
+            ASSERT_EQ(referenceBits(start, n), br.getBits(n))
+                << "n " << n << " start " << start;
+            ASSERT_EQ(8 * sizeof(kData) - start - n, br.numBitsLeft());
+        }
+    }
+}
+
+TEST(ABitReaderTest, ConsecutiveReadsMatch) {
+    static const size_t kWidths[] = { 3, 13, 1, 32, 7, 24, 5, 31, 17, 8, 2 };
+
+    ABitReader br(kData, sizeof(kData));
+    size_t index = 0;
+
+    for (size_t i = 0; i < sizeof(kWidths) / sizeof(kWidths[0]); ++i) {
+        size_t n = kWidths[i];
+        if (index + n > 8 * sizeof(kData)) {
+            break;
+        }
+
+        EXPECT_EQ(referenceBits(index, n), br.getBits(n));
+        index += n;
+    }
+
+    EXPECT_EQ(8 * sizeof(kData) - index, br.numBitsLeft());
+}
+
+TEST(ABitReaderTest, SkipBits) {
+    ABitReader br(kData, sizeof(kData));
+
+    br.skipBits(0);
+    EXPECT_EQ(referenceBits(0, 4), br.getBits(4));
+
+    // within the reservoir
+    br.skipBits(9);
+    EXPECT_EQ(referenceBits(13, 11), br.getBits(11));
+
+    // past the reservoir, whole bytes and a few bits
+    br.skipBits(75);
+    EXPECT_EQ(referenceBits(99, 20), br.getBits(20));
+    EXPECT_EQ(8 * sizeof(kData) - 119, br.numBitsLeft());
+
+    // to the very end
+    br.skipBits(br.numBitsLeft());
+    EXPECT_EQ(0u, br.numBitsLeft());
+}
+
+TEST(ABitReaderTest, PutBitsRewinds) {
+    ABitReader br(kData, sizeof(kData));
+
+    br.getBits(30);
+    br.skipBits(40);
+    uint32_t y = br.getBits(32);
+
+    br.putBits(y, 32);
+    EXPECT_EQ(y, br.getBits(32));
+
+    br.putBits(y, 32);
+    EXPECT_EQ(8 * sizeof(kData) - 70, br.numBitsLeft());
+    EXPECT_EQ(referenceBits(70, 32), br.getBits(32));
+}
+
+TEST(ABitReaderTest, ExpGolomb) {
+    // ue(v): 1, 010, 011, 00100, 00111, 0001000 = 0, 1, 2, 3, 6, 7,
+    // then se(v): 010 = 1, 011 = -1, 00101 = -2.
+    static const uint8_t kCodes[] = { 0xa6, 0x43, 0x88, 0x4c, 0xa0 };
+
+    ABitReader br(kCodes, sizeof(kCodes));
+    EXPECT_EQ(0u, br.getUE());
+    EXPECT_EQ(1u, br.getUE());
+    EXPECT_EQ(2u, br.getUE());
+    EXPECT_EQ(3u, br.getUE());
+    EXPECT_EQ(6u, br.getUE());
+    EXPECT_EQ(7u, br.getUE());
+    EXPECT_EQ(1, br.getSE());
+    EXPECT_EQ(-1, br.getSE());
+    EXPECT_EQ(-2, br.getSE());
+}
+
+TEST(ABitReaderTest, ReadingPastTheEndAborts) {
+    ABitReader br(kData, 3);
+    br.getBits(20);
+
+    EXPECT_EQ(4u, br.numBitsLeft());
+    EXPECT_DEATH(br.getBits(5), "");
+}
+
+TEST(ABitReaderTest, PeekingPastTheEndAborts) {
+    ABitReader br(kData, 2);
+
+    EXPECT_DEATH(br.peekBits(17), "");
+}
+
+TEST(ABitReaderTest, SkippingPastTheEndAborts) {
+    ABitReader br(kData, sizeof(kData));
+
+    EXPECT_DEATH(br.skipBits(8 * sizeof(kData) + 8), "");
+}
+
+}  // namespace android
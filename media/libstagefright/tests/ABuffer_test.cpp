@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ABuffer_test"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+
+namespace android {
+
+static sp<ABuffer> makeOwnedBuffer(size_t capacity, const char *contents) {
+    sp<ABuffer> buffer = new ABuffer(capacity);
+    memcpy(buffer->base(), contents, strlen(contents));
+    buffer->setRange(0, strlen(contents));
+    return buffer;
+}
+
+static bool contains(const sp<ABuffer> &buffer, const char *contents) {
+    return buffer->size() == strlen(contents)
+        && !memcmp(buffer->data(), contents, buffer->size());
+}
+
+TEST(ABufferTest, AppendUsesSpareCapacity) {
+    sp<ABuffer> buffer = makeOwnedBuffer(16, "abcd");
+    uint8_t *base = buffer->base();
+
+    buffer->append("efgh", 4);
+
+    EXPECT_TRUE(contains(buffer, "abcdefgh"));
+    EXPECT_EQ(base, buffer->base());
+}
+
+TEST(ABufferTest, AppendGrows) {
+    sp<ABuffer> buffer = makeOwnedBuffer(4, "abcd");
+
+    buffer->append("efgh", 4);
+    buffer->append("ijkl", 4);
+
+    EXPECT_TRUE(contains(buffer, "abcdefghijkl"));
+    EXPECT_GE(buffer->capacity(), 12u);
+}
+
+TEST(ABufferTest, AppendCompactsWhenUnshared) {
+    sp<ABuffer> buffer = makeOwnedBuffer(8, "abcdefgh");
+    buffer->setRange(6, 2);
+
+    buffer->append("ijkl", 4);
+
+    EXPECT_TRUE(contains(buffer, "ghijkl"));
+    EXPECT_EQ(0u, buffer->offset());
+    EXPECT_EQ(8u, buffer->capacity());
+}
+
+TEST(ABufferTest, SliceSharesBytes) {
+    sp<ABuffer> buffer = makeOwnedBuffer(8, "abcdefgh");
+
+    sp<ABuffer> slice = buffer->slice(2, 3);
+
+    EXPECT_TRUE(contains(slice, "cde"));
+    EXPECT_EQ(buffer->data() + 2, slice->data());
+}
+
+TEST(ABufferTest, SliceOutlivesOwnedBuffer) {
+    sp<ABuffer> slice;
+    {
+        sp<ABuffer> buffer = makeOwnedBuffer(8, "abcdefgh");
+        slice = buffer->slice(4, 4);
+    }
+
+    EXPECT_TRUE(contains(slice, "efgh"));
+}
+
+TEST(ABufferTest, AppendToOwnedBufferKeepsSlice) {
+    sp<ABuffer> buffer = makeOwnedBuffer(8, "abcdefgh");
+    sp<ABuffer> slice = buffer->slice(6, 2);
+
+    // Compacting would move "gh" over the sliced bytes.
+    buffer->setRange(6, 2);
+    buffer->append("ijkl", 4);
+
+    EXPECT_TRUE(contains(buffer, "ghijkl"));
+    EXPECT_TRUE(contains(slice, "gh"));
+}
+
+TEST(ABufferTest, AppendToExternalBufferKeepsSlice) {
+    char memory[8];
+    memcpy(memory, "abcdefgh", 8);
+
+    sp<ABuffer> buffer = new ABuffer(memory, sizeof(memory));
+    sp<ABuffer> slice = buffer->slice(0, 2);
+
+    buffer->setRange(6, 2);
+    buffer->append("ijkl", 4);
+
+    EXPECT_TRUE(contains(buffer, "ghijkl"));
+    EXPECT_TRUE(contains(slice, "ab"));
+    EXPECT_EQ(0, memcmp(memory, "abcdefgh", 8));
+}
+
+TEST(ABufferTest, AppendToExternalBufferAfterSliceIsGone) {
+    char memory[8];
+    memcpy(memory, "abcdefgh", 8);
+
+    sp<ABuffer> buffer = new ABuffer(memory, sizeof(memory));
+    buffer->slice(0, 2).clear();
+
+    buffer->setRange(6, 2);
+    buffer->append("ijkl", 4);
+
+    // No slice left, the external memory is reused in place.
+    EXPECT_TRUE(contains(buffer, "ghijkl"));
+    EXPECT_EQ((uint8_t *)memory, buffer->base());
+}
+
+TEST(ABufferTest, AppendToSliceOfExternalBufferKeepsParent) {
+    char memory[8];
+    memcpy(memory, "abcdefgh", 8);
+
+    sp<ABuffer> buffer = new ABuffer(memory, sizeof(memory));
+    sp<ABuffer> slice = buffer->slice(0, 2);
+    sp<ABuffer> subSlice = slice->slice(1, 1);
+
+    slice->append("xy", 2);
+
+    EXPECT_TRUE(contains(slice, "abxy"));
+    EXPECT_TRUE(contains(subSlice, "b"));
+    EXPECT_TRUE(contains(buffer, "abcdefgh"));
+}
+
+}  // namespace android
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AVCEncSimd_test"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "avcenc_lib.h"
+#include "sad_inline.h"
+
+// The motion search kernels of the AVC encoder, as built for the target,
+// against their generic C versions. Without SSE2 both are the same code.
+
+namespace android {
+
+static const int kNumIterations = 2000;
+
+// Random pixels, or one of the patterns that push the intermediate sums of
+// the kernels to their limits.
+static void fillPixels(uint8 *data, size_t size, int pattern) {
+    for (size_t i = 0; i < size; ++i) {
+        switch (pattern) {
+            case 0:
+                data[i] = 0;
+                break;
+            case 1:
+                data[i] = 255;
+                break;
+            case 2:
+                data[i] = (i & 1) ? 255 : 0;
+                break;
+            case 3:
+                data[i] = (rand() & 1) ? 255 : 0;
+                break;
+            default:
+                data[i] = rand() & 0xff;
+                break;
+        }
+    }
+}
+
+static int randomPattern() {
+    int pattern = rand() % 8;
+    return pattern < 4 ? pattern : 4;
+}
+
+TEST(AVCEncSimdTest, SadMacroblock) {
+    // blk is a macroblock copy, word aligned in the encoder
+    uint32 blkBuffer[64];
+    uint8 *blk = (uint8 *)blkBuffer;
+    uint8 ref[16 + 80 * 18];
+
+    srand(1);
+    for (int i = 0; i < kNumIterations; ++i) {
+        int lx = 16 + rand() % 65;
+        uint8 *mb = ref + 4 + rand() % (lx - 15);
+
+        fillPixels(ref, sizeof(ref), randomPattern());
+        fillPixels(blk, 256, randomPattern());
+
+        int dmin;
+        switch (rand() % 3) {
+            case 0:
+                dmin = 65535;
+                break;
+            case 1:
+                dmin = 0;
+                break;
+            default:
+                dmin = rand() % (256 * 255);
+                break;
+        }
+
+        ASSERT_EQ(simd_sad_mb_C(mb, blk, dmin, lx),
+                  simd_sad_mb(mb, blk, dmin, lx))
+            << "lx " << lx << " dmin " << dmin;
+    }
+}
+
+TEST(AVCEncSimdTest, HalfPelPrediction) {
+    static const int kMargin = 8;
+    uint32 expected[SUBPEL_PRED_BLK_SIZE];
+    uint32 actual[SUBPEL_PRED_BLK_SIZE];
+    uint8 ref[(16 + 2 * kMargin) * (112 + 2 * kMargin)];
+
+    srand(2);
+    for (int i = 0; i < kNumIterations; ++i) {
+        int lx = 32 + rand() % 81;
+        uint8 *ncand = ref + kMargin * lx + kMargin + rand() % (lx - 31);
+
+        fillPixels(ref, (16 + 2 * kMargin) * lx, randomPattern());
+        memset(expected, 0, sizeof(expected));
+        memset(actual, 0, sizeof(actual));
+
+        GenerateHalfPelPred_C((uint8 *)expected, ncand, lx);
+        GenerateHalfPelPred((uint8 *)actual, ncand, lx);
+
+        ASSERT_EQ(0, memcmp(expected, actual, sizeof(expected)))
+            << "lx " << lx;
+    }
+}
+
+static void *mallocWrapper(void * /* userData */, int32 size, int /* attrs */) {
+    return malloc(size);
+}
+
+static void freeWrapper(void * /* userData */, void *ptr) {
+    free(ptr);
+}
+
+TEST(AVCEncSimdTest, QuartPelPrediction) {
+    AVCEncObject *encvid = (AVCEncObject *)calloc(1, sizeof(AVCEncObject));
+    AVCRateControl rateCtrl;
+    AVCHandle handle;
+
+    ASSERT_TRUE(encvid != NULL);
+
+    // only for the positions of the bilinear interpolation bases
+    memset(&rateCtrl, 0, sizeof(rateCtrl));
+    rateCtrl.mvRange = 16;
+    memset(&handle, 0, sizeof(handle));
+    handle.AVCObject = encvid;
+    handle.CBAVC_Malloc = mallocWrapper;
+    handle.CBAVC_Free = freeWrapper;
+    encvid->rateCtrl = &rateCtrl;
+    encvid->avcHandle = &handle;
+    ASSERT_EQ(AVCENC_SUCCESS, InitMotionSearchModule(&handle));
+
+    uint8 expected[8][24 * 16];
+
+    srand(3);
+    for (int i = 0; i < kNumIterations; ++i) {
+        int hpel = rand() % 9;
+
+        fillPixels((uint8 *)encvid->subpel_pred, sizeof(encvid->subpel_pred),
+                   randomPattern());
+        memset(expected, 0, sizeof(expected));
+        memset(encvid->qpel_cand, 0, sizeof(encvid->qpel_cand));
+
+        GenerateQuartPelPred_C(encvid->bilin_base[hpel], &expected[0][0], hpel);
+        GenerateQuartPelPred(encvid->bilin_base[hpel], &encvid->qpel_cand[0][0], hpel);
+
+        ASSERT_EQ(0, memcmp(expected, encvid->qpel_cand, sizeof(expected)))
+            << "hpel " << hpel;
+    }
+
+    CleanMotionSearchModule(&handle);
+    free(encvid);
+}
+
+TEST(AVCEncSimdTest, CostIntra4x4) {
+    // rows of the original frame, word aligned in the encoder
+    uint32 orgBuffer[64];
+    uint8 *org = (uint8 *)orgBuffer;
+    uint8 pred[16];
+
+    srand(4);
+    for (int i = 0; i < kNumIterations; ++i) {
+        int pitch = 4 * (1 + rand() % 16);
+        uint16 base = rand() % 60000;
+        uint16 expected = base;
+        uint16 actual = base;
+
+        fillPixels(org, sizeof(orgBuffer), randomPattern());
+        fillPixels(pred, sizeof(pred), randomPattern());
+
+        cost_i4_C(org, pitch, pred, &expected);
+        cost_i4(org, pitch, pred, &actual);
+
+        ASSERT_EQ(expected, actual) << "pitch " << pitch;
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AvcUtils_test"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/avc_utils.h"
+
+namespace android {
+
+static ssize_t referenceFind(const uint8_t *data, size_t size, size_t length) {
+    for (size_t i = 0; i + length <= size; ++i) {
+        size_t j = 0;
+        while (j + 1 < length && data[i + j] == 0x00) {
+            ++j;
+        }
+        if (j + 1 == length && data[i + j] == 0x01) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+TEST(AvcUtilsTest, StartCodeAtOffsetZero) {
+    static const uint8_t kData[] = { 0x00, 0x00, 0x01, 0x65, 0x88, 0x84 };
+    EXPECT_EQ(0, FindStartCode(kData, sizeof(kData)));
+
+    static const uint8_t kLong[] = { 0x00, 0x00, 0x00, 0x01, 0x67, 0x42 };
+    EXPECT_EQ(0, FindLongStartCode(kLong, sizeof(kLong)));
+    EXPECT_EQ(1, FindStartCode(kLong, sizeof(kLong)));
+}
+
+TEST(AvcUtilsTest, StartCodeAtBufferEnd) {
+    uint8_t data[64];
+    for (size_t size = 3; size <= sizeof(data); ++size) {
+        memset(data, 0xaa, size);
+        data[size - 3] = 0x00;
+        data[size - 2] = 0x00;
+        data[size - 1] = 0x01;
+        EXPECT_EQ((ssize_t)(size - 3), FindStartCode(data, size)) << size;
+
+        // One byte short of the end, no startcode left.
+        EXPECT_EQ(-1, FindStartCode(data, size - 1)) << size;
+
+        if (size >= 4) {
+            data[size - 4] = 0x00;
+            EXPECT_EQ((ssize_t)(size - 4), FindLongStartCode(data, size)) << size;
+            EXPECT_EQ(-1, FindLongStartCode(data, size - 1)) << size;
+        }
+    }
+}
+
+// A startcode split across two buffers is found by resuming the search
+// 2 bytes (3 for the long one) before the end of the first buffer.
+TEST(AvcUtilsTest, SplitStartCode) {
+    static const uint8_t kStream[] = {
+        0x25, 0xb8, 0x40, 0x7f, 0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x02,
+    };
+
+    for (size_t split = 0; split <= sizeof(kStream); ++split) {
+        ssize_t pos = FindStartCode(kStream, split);
+        if (pos < 0) {
+            size_t resume = split < 2 ? 0 : split - 2;
+            pos = FindStartCode(&kStream[resume], sizeof(kStream) - resume);
+            ASSERT_GE(pos, 0) << split;
+            pos += resume;
+        }
+        EXPECT_EQ(5, pos) << split;
+
+        pos = FindLongStartCode(kStream, split);
+        if (pos < 0) {
+            size_t resume = split < 3 ? 0 : split - 3;
+            pos = FindLongStartCode(&kStream[resume], sizeof(kStream) - resume);
+            ASSERT_GE(pos, 0) << split;
+            pos += resume;
+        }
+        EXPECT_EQ(4, pos) << split;
+    }
+}
+
+TEST(AvcUtilsTest, TrailingZeros) {
+    uint8_t data[32];
+    memset(data, 0x00, sizeof(data));
+    for (size_t size = 0; size <= sizeof(data); ++size) {
+        EXPECT_EQ(-1, FindStartCode(data, size)) << size;
+        EXPECT_EQ(-1, FindLongStartCode(data, size)) << size;
+    }
+
+    // Zeros after the last startcode do not hide it or make up another.
+    static const uint8_t kData[] = {
+        0x00, 0x00, 0x01, 0x09, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    EXPECT_EQ(0, FindStartCode(kData, sizeof(kData)));
+    EXPECT_EQ(-1, FindStartCode(&kData[1], sizeof(kData) - 1));
+    EXPECT_EQ(-1, FindLongStartCode(kData, sizeof(kData)));
+}
+
+TEST(AvcUtilsTest, NoStartCode) {
+    static const uint8_t kData[] = {
+        0x00, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x01,
+        0x00, 0x10, 0x00, 0x00, 0xff, 0x01, 0x01, 0x00, 0x00,
+    };
+    EXPECT_EQ(-1, FindStartCode(kData, sizeof(kData)));
+    EXPECT_EQ(-1, FindLongStartCode(kData, sizeof(kData)));
+    EXPECT_EQ(-1, FindStartCode(kData, 0));
+    EXPECT_EQ(-1, FindLongStartCode(kData, 0));
+}
+
+// Random input, mostly 0x00 and 0x01 so that startcodes and near misses
+// are common, against a straightforward search.
+TEST(AvcUtilsTest, MatchesReference) {
+    static const uint8_t kAlphabet[] = { 0x00, 0x00, 0x00, 0x01, 0x02, 0x80 };
+
+    srand(1);
+    uint8_t data[40];
+    for (int i = 0; i < 20000; ++i) {
+        size_t size = rand() % (sizeof(data) + 1);
+        for (size_t j = 0; j < size; ++j) {
+            data[j] = kAlphabet[rand() % sizeof(kAlphabet)];
+        }
+
+        // Unaligned start, too.
+        size_t start = size > 0 ? rand() % 4 % (size + 1) : 0;
+
+        ASSERT_EQ(referenceFind(&data[start], size - start, 3),
+                  FindStartCode(&data[start], size - start));
+        ASSERT_EQ(referenceFind(&data[start], size - start, 4),
+                  FindLongStartCode(&data[start], size - start));
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MPEG4Writer_test"
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/MPEG4Writer.h>
+#include <utils/threads.h>
+
+namespace android {
+
+// Gives the tests access to the writer's sample table spilling.
+struct MPEG4WriterPeer {
+    MPEG4WriterPeer(const sp<MPEG4Writer> &writer)
+        : mWriter(writer) {
+    }
+
+    // Spill to "fd" from now on, the writer closes it.
+    void setSpillFd(int fd) {
+        Mutex::Autolock autoLock(mWriter->mSpillLock);
+        mWriter->mSpillFd = fd;
+        mWriter->mSpillOffset = 0;
+        mWriter->mSpillDisabled = false;
+    }
+
+    bool canSpill() {
+        return mWriter->canSpillSampleTables();
+    }
+
+    off64_t spill(const void *data, size_t size) {
+        return mWriter->spillSampleTableData(data, size);
+    }
+
+    void readSpilled(off64_t offset, void *data, size_t size) {
+        mWriter->readSpilledSampleTableData(offset, data, size);
+    }
+
+private:
+    sp<MPEG4Writer> mWriter;
+};
+
+// AMR-NB frames of 20ms, as fast as the writer takes them.
+struct AmrSource : public MediaSource {
+    AmrSource(size_t numFrames)
+        : mNumFrames(numFrames),
+          mFrameIndex(0) {
+    }
+
+    virtual status_t start(MetaData *params) {
+        mFrameIndex = 0;
+        return OK;
+    }
+
+    virtual status_t stop() {
+        return OK;
+    }
+
+    virtual sp<MetaData> getFormat() {
+        sp<MetaData> meta = new MetaData;
+        meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_AMR_NB);
+        meta->setInt32(kKeySampleRate, 8000);
+        meta->setInt32(kKeyChannelCount, 1);
+        return meta;
+    }
+
+    virtual status_t read(MediaBuffer **buffer, const ReadOptions *options) {
+        if (mFrameIndex == mNumFrames) {
+            return ERROR_END_OF_STREAM;
+        }
+
+        *buffer = new MediaBuffer(kFrameSize);
+        memset((*buffer)->data(), 0, kFrameSize);
+        ((uint8_t *)(*buffer)->data())[0] = 0x3c;   // 12.2 kbps, good frame
+        (*buffer)->meta_data()->setInt64(kKeyTime, mFrameIndex * 20000ll);
+
+        ++mFrameIndex;
+        return OK;
+    }
+
+protected:
+    virtual ~AmrSource() {}
+
+private:
+    enum {
+        kFrameSize = 32,
+    };
+
+    size_t mNumFrames;
+    size_t mFrameIndex;
+};
+
+// A video source that produces nothing until told to end.
+struct StalledSource : public MediaSource {
+    StalledSource()
+        : mEnded(false) {
+    }
+
+    void end() {
+        Mutex::Autolock autoLock(mLock);
+        mEnded = true;
+        mCondition.signal();
+    }
+
+    virtual status_t start(MetaData *params) {
+        return OK;
+    }
+
+    virtual status_t stop() {
+        end();
+        return OK;
+    }
+
+    virtual sp<MetaData> getFormat() {
+        sp<MetaData> meta = new MetaData;
+        meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_H263);
+        meta->setInt32(kKeyWidth, 176);
+        meta->setInt32(kKeyHeight, 144);
+        return meta;
+    }
+
+    virtual status_t read(MediaBuffer **buffer, const ReadOptions *options) {
+        Mutex::Autolock autoLock(mLock);
+        while (!mEnded) {
+            mCondition.wait(mLock);
+        }
+        return ERROR_END_OF_STREAM;
+    }
+
+protected:
+    virtual ~StalledSource() {}
+
+private:
+    Mutex mLock;
+    Condition mCondition;
+    bool mEnded;
+};
+
+// AVC access units as an encoder puts them out: the parameter sets first,
+// then pictures of two slices behind start codes, or of a single slice
+// without one.
+struct AvcSource : public MediaSource {
+    AvcSource(size_t numFrames)
+        : mNumFrames(numFrames),
+          mFrameIndex(0),
+          mSentConfig(false) {
+    }
+
+    virtual status_t start(MetaData *params) {
+        mFrameIndex = 0;
+        mSentConfig = false;
+        return OK;
+    }
+
+    virtual status_t stop() {
+        return OK;
+    }
+
+    virtual sp<MetaData> getFormat() {
+        sp<MetaData> meta = new MetaData;
+        meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_AVC);
+        meta->setInt32(kKeyWidth, 176);
+        meta->setInt32(kKeyHeight, 144);
+        return meta;
+    }
+
+    virtual status_t read(MediaBuffer **buffer, const ReadOptions *options) {
+        static const uint8_t kConfig[] = {
+            0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1e, 0xab,
+            0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x38, 0x80,
+        };
+        static const uint8_t kTwoSlices[] = {
+            0x00, 0x00, 0x00, 0x01, 0x65, 0x11, 0x22, 0x33,
+            0x00, 0x00, 0x01, 0x65, 0x44, 0x55,
+        };
+        static const uint8_t kOneSlice[] = {
+            0x41, 0x66, 0x77,
+        };
+
+        if (!mSentConfig) {
+            mSentConfig = true;
+            *buffer = new MediaBuffer(sizeof(kConfig));
+            memcpy((*buffer)->data(), kConfig, sizeof(kConfig));
+            (*buffer)->meta_data()->setInt32(kKeyIsCodecConfig, true);
+            (*buffer)->meta_data()->setInt64(kKeyTime, 0);
+            return OK;
+        }
+
+        if (mFrameIndex == mNumFrames) {
+            return ERROR_END_OF_STREAM;
+        }
+
+        if (mFrameIndex % 2 == 0) {
+            *buffer = new MediaBuffer(sizeof(kTwoSlices));
+            memcpy((*buffer)->data(), kTwoSlices, sizeof(kTwoSlices));
+            (*buffer)->meta_data()->setInt32(kKeyIsSyncFrame, true);
+        } else {
+            *buffer = new MediaBuffer(sizeof(kOneSlice));
+            memcpy((*buffer)->data(), kOneSlice, sizeof(kOneSlice));
+        }
+        // No B-frames, decoding order is presentation order.
+        (*buffer)->meta_data()->setInt64(kKeyTime, mFrameIndex * 33333ll);
+        (*buffer)->meta_data()->setInt64(
+                kKeyDecodingTime, mFrameIndex * 33333ll);
+
+        ++mFrameIndex;
+        return OK;
+    }
+
+protected:
+    virtual ~AvcSource() {}
+
+private:
+    size_t mNumFrames;
+    size_t mFrameIndex;
+    bool mSentConfig;
+};
+
+// The writer shares the file offset through its dup() of the descriptor,
+// only fstat() and pread() are used here.
+static size_t countBytes(int fd, const void *bytes, size_t size) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        return 0;
+    }
+
+    uint8_t *data = (uint8_t *)malloc(st.st_size);
+    ssize_t n = pread64(fd, data, st.st_size, 0);
+
+    size_t count = 0;
+    for (ssize_t i = 0; i + (ssize_t)size <= n; ++i) {
+        if (!memcmp(&data[i], bytes, size)) {
+            ++count;
+        }
+    }
+
+    free(data);
+    return count;
+}
+
+static size_t countBoxes(int fd, const char *fourcc) {
+    return countBytes(fd, fourcc, 4);
+}
+
+TEST(MPEG4WriterTest, FragmentsAreWrittenWhileATrackStalls) {
+    char path[] = "/data/local/tmp/MPEG4Writer_test_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    unlink(path);
+
+    sp<StalledSource> video = new StalledSource;
+    sp<MPEG4Writer> writer = new MPEG4Writer(fd);
+    ASSERT_EQ(OK, writer->addSource(new AmrSource(1500)));   // 30 seconds
+    ASSERT_EQ(OK, writer->addSource(video));
+
+    sp<MetaData> params = new MetaData;
+    params->setInt64(kKeyFragmentDurationUs, 1000000ll);
+    ASSERT_EQ(OK, writer->start(params.get()));
+
+    // The audio fragments go out once 20 seconds of them are held back,
+    // without waiting for the video track.
+    size_t numFragments = 0;
+    for (int i = 0; i < 100 && numFragments == 0; ++i) {
+        usleep(100000);
+        numFragments = countBoxes(fd, "moof");
+    }
+
+    video->end();
+    writer->stop();
+
+    EXPECT_GT(numFragments, 0u);
+
+    // Only the audio track made it into the init segment.
+    EXPECT_EQ(1u, countBoxes(fd, "trak"));
+    EXPECT_EQ(1u, countBoxes(fd, "trex"));
+
+    close(fd);
+}
+
+TEST(MPEG4WriterTest, AvcSlicesAreStoredLengthPrefixed) {
+    char path[] = "/data/local/tmp/MPEG4Writer_test_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    unlink(path);
+
+    sp<MPEG4Writer> writer = new MPEG4Writer(fd);
+    ASSERT_EQ(OK, writer->addSource(new AvcSource(10)));
+    ASSERT_EQ(OK, writer->start());
+
+    for (int i = 0; i < 100 && !writer->reachedEOS(); ++i) {
+        usleep(10000);
+    }
+    writer->stop();
+
+    // Each NAL unit behind its own 4 byte length, no start code left.
+    static const uint8_t kTwoSlices[] = {
+        0x00, 0x00, 0x00, 0x04, 0x65, 0x11, 0x22, 0x33,
+        0x00, 0x00, 0x00, 0x03, 0x65, 0x44, 0x55,
+    };
+    static const uint8_t kOneSlice[] = {
+        0x00, 0x00, 0x00, 0x03, 0x41, 0x66, 0x77,
+    };
+    EXPECT_EQ(5u, countBytes(fd, kTwoSlices, sizeof(kTwoSlices)));
+    EXPECT_EQ(5u, countBytes(fd, kOneSlice, sizeof(kOneSlice)));
+    EXPECT_EQ(0u, countBytes(fd, "\x00\x00\x01\x65", 4));
+
+    close(fd);
+}
+
+TEST(MPEG4WriterTest, SpilledRunsStayReadableAfterAWriteFails) {
+    char path[] = "/data/local/tmp/MPEG4Writer_test_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    unlink(path);
+
+    char spillPath[] = "/data/local/tmp/MPEG4Writer_spill_XXXXXX";
+    int spillFd = mkstemp(spillPath);
+    ASSERT_GE(spillFd, 0);
+    unlink(spillPath);
+
+    sp<MPEG4Writer> writer = new MPEG4Writer(fd);
+    MPEG4WriterPeer peer(writer);
+    peer.setSpillFd(spillFd);
+
+    uint8_t run[4096];
+    for (size_t i = 0; i < sizeof(run); ++i) {
+        run[i] = i * 7;
+    }
+
+    ASSERT_TRUE(peer.canSpill());
+    off64_t offset = peer.spill(run, sizeof(run));
+    ASSERT_EQ(0, offset);
+
+    // Files may not grow past the first run, the next write fails with
+    // EFBIG as it would once the disk is full.
+    struct rlimit oldLimit;
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &oldLimit));
+    struct rlimit limit = oldLimit;
+    limit.rlim_cur = sizeof(run);
+
+    void (*oldHandler)(int) = signal(SIGXFSZ, SIG_IGN);
+    EXPECT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+    off64_t failedOffset = peer.spill(run, sizeof(run));
+    EXPECT_EQ(0, setrlimit(RLIMIT_FSIZE, &oldLimit));
+    signal(SIGXFSZ, oldHandler);
+
+    EXPECT_LT(failedOffset, 0);
+
+    // No more spilling, but the first run can still be read back.
+    EXPECT_FALSE(peer.canSpill());
+    EXPECT_LT(peer.spill(run, sizeof(run)), 0);
+
+    uint8_t readBack[sizeof(run)];
+    memset(readBack, 0, sizeof(readBack));
+    peer.readSpilled(offset, readBack, sizeof(readBack));
+    EXPECT_EQ(0, memcmp(run, readBack, sizeof(run)));
+
+    writer.clear();
+    close(fd);
+}
+
+}  // namespace android
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MediaBufferGroup_test"
+
+#include <gtest/gtest.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaBufferGroup.h>
+#include <utils/threads.h>
+
+namespace android {
+
+// Releases a buffer after a delay, from a thread of its own.
+struct DelayedRelease {
+    DelayedRelease(MediaBuffer *buffer, useconds_t delayUs)
+        : mBuffer(buffer),
+          mDelayUs(delayUs) {
+        pthread_create(&mThread, NULL, ThreadWrapper, this);
+    }
+
+    ~DelayedRelease() {
+        void *dummy;
+        pthread_join(mThread, &dummy);
+    }
+
+private:
+    MediaBuffer *mBuffer;
+    useconds_t mDelayUs;
+    pthread_t mThread;
+
+    static void *ThreadWrapper(void *me) {
+        DelayedRelease *release = static_cast<DelayedRelease *>(me);
+        usleep(release->mDelayUs);
+        release->mBuffer->release();
+        return NULL;
+    }
+};
+
+TEST(MediaBufferGroupTest, AcquiresSmallestSuitableBuffer) {
+    MediaBufferGroup group;
+    group.add_buffer(new MediaBuffer(4096));
+    group.add_buffer(new MediaBuffer(256));
+
+    MediaBuffer *buffer;
+    ASSERT_EQ(OK, group.acquire_buffer(&buffer, true /* nonBlocking */, 100));
+    EXPECT_EQ(256u, buffer->size());
+    EXPECT_EQ(1, buffer->refcount());
+
+    MediaBuffer *other;
+    ASSERT_EQ(OK, group.acquire_buffer(&other, true /* nonBlocking */, 100));
+    EXPECT_EQ(4096u, other->size());
+
+    buffer->release();
+    other->release();
+}
+
+TEST(MediaBufferGroupTest, NonBlockingAcquireWouldBlock) {
+    MediaBufferGroup group;
+    group.add_buffer(new MediaBuffer(256));
+
+    MediaBuffer *buffer;
+    ASSERT_EQ(OK, group.acquire_buffer(&buffer, true /* nonBlocking */));
+
+    MediaBuffer *other;
+    EXPECT_EQ(WOULD_BLOCK, group.acquire_buffer(&other, true /* nonBlocking */));
+    EXPECT_EQ(BAD_VALUE, group.acquire_buffer(&other, true /* nonBlocking */, 512));
+
+    buffer->release();
+}
+
+TEST(MediaBufferGroupTest, BlockingAcquireWaitsForRelease) {
+    MediaBufferGroup group;
+    group.add_buffer(new MediaBuffer(256));
+
+    MediaBuffer *buffer;
+    ASSERT_EQ(OK, group.acquire_buffer(&buffer));
+
+    int64_t startUs = systemTime() / 1000;
+
+    MediaBuffer *other;
+    {
+        DelayedRelease release(buffer, 50000);
+        ASSERT_EQ(OK, group.acquire_buffer(&other));
+    }
+
+    EXPECT_GE(systemTime() / 1000 - startUs, 40000);
+    EXPECT_EQ(buffer, other);
+    EXPECT_EQ(1, other->refcount());
+
+    other->release();
+}
+
+struct AcquireReleaseLoop {
+    MediaBufferGroup *mGroup;
+    size_t mNumIterations;
+    bool mOk;
+
+    static void *ThreadWrapper(void *me) {
+        AcquireReleaseLoop *loop = static_cast<AcquireReleaseLoop *>(me);
+        loop->mOk = true;
+
+        for (size_t i = 0; i < loop->mNumIterations; ++i) {
+            MediaBuffer *buffer;
+            if (loop->mGroup->acquire_buffer(&buffer) != OK
+                    || buffer->refcount() != 1) {
+                loop->mOk = false;
+                break;
+            }
+
+            // Each buffer has one owner at a time.
+            uint8_t *data = (uint8_t *)buffer->data();
+            data[0] = (uint8_t)i;
+            sched_yield();
+            if (data[0] != (uint8_t)i) {
+                loop->mOk = false;
+            }
+
+            buffer->release();
+        }
+
+        return NULL;
+    }
+};
+
+TEST(MediaBufferGroupTest, ConcurrentAcquireRelease) {
+    static const size_t kNumThreads = 4;
+
+    MediaBufferGroup group;
+    group.add_buffer(new MediaBuffer(256));
+    group.add_buffer(new MediaBuffer(256));
+
+    AcquireReleaseLoop loops[kNumThreads];
+    pthread_t threads[kNumThreads];
+    for (size_t i = 0; i < kNumThreads; ++i) {
+        loops[i].mGroup = &group;
+        loops[i].mNumIterations = 10000;
+        pthread_create(&threads[i], NULL, AcquireReleaseLoop::ThreadWrapper, &loops[i]);
+    }
+
+    for (size_t i = 0; i < kNumThreads; ++i) {
+        void *dummy;
+        pthread_join(threads[i], &dummy);
+        EXPECT_TRUE(loops[i].mOk);
+    }
+}
+
+TEST(MediaBufferGroupTest, TeardownAfterOtherThreadReleased) {
+    MediaBufferGroup *group = new MediaBufferGroup;
+    group->add_buffer(new MediaBuffer(256));
+
+    MediaBuffer *buffer;
+    ASSERT_EQ(OK, group->acquire_buffer(&buffer));
+
+    {
+        DelayedRelease release(buffer, 10000);
+    }
+
+    // All buffers are back, the group frees them.
+    delete group;
+}
+
+TEST(MediaBufferGroupTest, TeardownWithOutstandingBufferAborts) {
+    MediaBufferGroup *group = new MediaBufferGroup;
+    group->add_buffer(new MediaBuffer(256));
+
+    MediaBuffer *buffer;
+    ASSERT_EQ(OK, group->acquire_buffer(&buffer));
+
+    // Buffers must be returned before their group goes away.
+    EXPECT_DEATH(delete group, "");
+
+    buffer->release();
+    delete group;
+}
+
+}  // namespace android
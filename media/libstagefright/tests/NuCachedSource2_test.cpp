@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "NuCachedSource2_test"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include "include/NuCachedSource2.h"
+
+namespace android {
+
+static const size_t kMB = 1024 * 1024;
+static const size_t kKB = 1024;
+static const size_t kDefaultHighwater = 20 * kMB;
+
+// Low watermark, high watermark and keep-alive, the retained ranges get
+// half of the 8 MB.
+static const char *kCacheConfig = "2048/8192/0";
+static const size_t kRetainedBudget = 4 * kMB;
+
+// Gives the tests access to the cache's private state.
+struct NuCachedSource2Peer {
+    NuCachedSource2Peer(const sp<NuCachedSource2> &cache)
+        : mCache(cache) {
+    }
+
+    static int64_t UpdateBandwidthEstimate(
+            int64_t estimateBps, size_t numBytes, int64_t delayUs) {
+        return NuCachedSource2::UpdateBandwidthEstimate(
+                estimateBps, numBytes, delayUs);
+    }
+
+    static void ComputeWatermarks(
+            int64_t bandwidthBps, size_t maxHighwater,
+            size_t *lowwater, size_t *highwater) {
+        NuCachedSource2::ComputeWatermarks(
+                bandwidthBps, maxHighwater, lowwater, highwater);
+    }
+
+    // Waits for the prefetcher to stop, at the end of what the source
+    // serves or at the high watermark.
+    void waitUntilIdle() {
+        for (;;) {
+            {
+                Mutex::Autolock autoLock(mCache->mLock);
+                if (!mCache->mFetching) {
+                    return;
+                }
+            }
+            usleep(10000);
+        }
+    }
+
+    size_t numRetainedRanges() {
+        Mutex::Autolock autoLock(mCache->mLock);
+        return mCache->mRetainedRanges.size();
+    }
+
+    size_t retainedBytes() {
+        Mutex::Autolock autoLock(mCache->mLock);
+        return mCache->mRetainedBytes;
+    }
+
+    bool isRetained(off64_t offset) {
+        Mutex::Autolock autoLock(mCache->mLock);
+        return mCache->findRetainedRange_l(offset)
+                != mCache->mRetainedRanges.end();
+    }
+
+private:
+    sp<NuCachedSource2> mCache;
+};
+
+// Serves a synthetic file, but only inside the intervals the test allows,
+// anywhere else it reports the end of the stream. This ends every range
+// the cache fetches at a known offset. Every read is logged.
+struct FakeDataSource : public DataSource {
+    FakeDataSource() {}
+
+    virtual status_t initCheck() const {
+        return OK;
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        Mutex::Autolock autoLock(mLock);
+
+        mReadOffsets.push(offset);
+
+        for (size_t i = 0; i < mIntervals.size(); ++i) {
+            const Interval &interval = mIntervals.itemAt(i);
+
+            if (offset >= interval.mStart && offset < interval.mEnd) {
+                if (offset + (off64_t)size > interval.mEnd) {
+                    size = interval.mEnd - offset;
+                }
+                FillPattern(offset, data, size);
+                return size;
+            }
+        }
+
+        return 0;
+    }
+
+    virtual status_t reconnectAtOffset(off64_t offset) {
+        return OK;
+    }
+
+    void allow(off64_t start, off64_t end) {
+        Mutex::Autolock autoLock(mLock);
+
+        Interval interval;
+        interval.mStart = start;
+        interval.mEnd = end;
+        mIntervals.push(interval);
+    }
+
+    void clearReadLog() {
+        Mutex::Autolock autoLock(mLock);
+        mReadOffsets.clear();
+    }
+
+    // Whether any read since the log was cleared started in [start, end).
+    bool readFrom(off64_t start, off64_t end) {
+        Mutex::Autolock autoLock(mLock);
+
+        for (size_t i = 0; i < mReadOffsets.size(); ++i) {
+            if (mReadOffsets.itemAt(i) >= start
+                    && mReadOffsets.itemAt(i) < end) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static uint8_t PatternAt(off64_t offset) {
+        return (uint8_t)((offset >> 16) * 31 + offset);
+    }
+
+    static void FillPattern(off64_t offset, void *data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            ((uint8_t *)data)[i] = PatternAt(offset + i);
+        }
+    }
+
+protected:
+    virtual ~FakeDataSource() {}
+
+private:
+    struct Interval {
+        off64_t mStart;
+        off64_t mEnd;
+    };
+
+    Mutex mLock;
+    Vector<Interval> mIntervals;
+    Vector<off64_t> mReadOffsets;
+
+    DISALLOW_EVIL_CONSTRUCTORS(FakeDataSource);
+};
+
+class NuCachedSource2RangeTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mSource = new FakeDataSource;
+    }
+
+    virtual void TearDown() {
+        mCache.clear();
+        mSource.clear();
+    }
+
+    void start() {
+        mCache = new NuCachedSource2(mSource, kCacheConfig);
+    }
+
+    // Reads from the cache, checks the data and waits for the prefetcher
+    // to settle.
+    void readAndWait(off64_t offset, size_t size = 4 * kKB) {
+        Vector<uint8_t> data;
+        data.resize(size);
+
+        ASSERT_EQ((ssize_t)size,
+                  mCache->readAt(offset, data.editArray(), size));
+
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_EQ(FakeDataSource::PatternAt(offset + i), data.itemAt(i))
+                << "at offset " << offset + i;
+        }
+
+        NuCachedSource2Peer(mCache).waitUntilIdle();
+    }
+
+    // Allows a range of "size" bytes around "offset", where a seek to
+    // "offset" starts fetching, and reads from it.
+    void seekTo(off64_t offset, size_t size) {
+        static const off64_t kSeekPadding = 256 * kKB;
+
+        mSource->allow(offset - kSeekPadding, offset - kSeekPadding + size);
+        readAndWait(offset);
+    }
+
+    sp<FakeDataSource> mSource;
+    sp<NuCachedSource2> mCache;
+};
+
+TEST(NuCachedSource2Test, FirstSampleSetsTheEstimate) {
+    EXPECT_EQ(1000000ll,
+              NuCachedSource2Peer::UpdateBandwidthEstimate(0, 500000, 500000));
+}
+
+TEST(NuCachedSource2Test, EstimateIsAMovingAverage) {
+    // one sample at 9 MB/s moves a 1 MB/s estimate an eighth of the way
+    EXPECT_EQ(2000000ll,
+              NuCachedSource2Peer::UpdateBandwidthEstimate(
+                  1000000ll, 9000000, 1000000));
+
+    int64_t bps = 1000000ll;
+    for (int i = 0; i < 100; ++i) {
+        bps = NuCachedSource2Peer::UpdateBandwidthEstimate(
+                bps, 100000, 1000000);
+    }
+    EXPECT_NEAR(100000, bps, 10);
+}
+
+TEST(NuCachedSource2Test, EstimateIgnoresEmptyDelay) {
+    EXPECT_EQ(1234ll,
+              NuCachedSource2Peer::UpdateBandwidthEstimate(1234, 65536, 0));
+}
+
+TEST(NuCachedSource2Test, WatermarksFollowBandwidth) {
+    size_t lowwater, highwater;
+
+    // 200 kB/s: 10s and 60s worth of data
+    NuCachedSource2Peer::ComputeWatermarks(
+            200 * 1024, kDefaultHighwater, &lowwater, &highwater);
+    EXPECT_EQ(2000 * 1024u, lowwater);
+    EXPECT_EQ(12000 * 1024u, highwater);
+}
+
+TEST(NuCachedSource2Test, WatermarksAreClampedToTheirBounds) {
+    size_t lowwater, highwater;
+
+    NuCachedSource2Peer::ComputeWatermarks(
+            1, kDefaultHighwater, &lowwater, &highwater);
+    EXPECT_EQ(kMB, lowwater);
+    EXPECT_EQ(4 * kMB, highwater);
+
+    NuCachedSource2Peer::ComputeWatermarks(
+            100 * kMB, kDefaultHighwater, &lowwater, &highwater);
+    EXPECT_EQ(8 * kMB, lowwater);
+    EXPECT_EQ(kDefaultHighwater, highwater);
+}
+
+TEST(NuCachedSource2Test, HighwaterNeverExceedsTheMaximum) {
+    static const size_t kMaxima[] = { 2 * kMB, 3 * kMB, 8 * kMB, 20 * kMB };
+    static const int64_t kBandwidths[] = { 1, 50000, 200000, 1000000, 1ll << 32 };
+
+    for (size_t i = 0; i < sizeof(kMaxima) / sizeof(kMaxima[0]); ++i) {
+        for (size_t j = 0; j < sizeof(kBandwidths) / sizeof(kBandwidths[0]); ++j) {
+            size_t lowwater, highwater;
+            NuCachedSource2Peer::ComputeWatermarks(
+                    kBandwidths[j], kMaxima[i], &lowwater, &highwater);
+
+            EXPECT_LE(highwater, kMaxima[i]);
+            EXPECT_LT(lowwater, highwater);
+        }
+    }
+}
+
+TEST_F(NuCachedSource2RangeTest, SeekingBackIntoARetainedRangeDoesNotRefetch) {
+    mSource->allow(0, kMB);
+    start();
+    readAndWait(0);
+
+    seekTo(16 * kMB, kMB);
+
+    NuCachedSource2Peer peer(mCache);
+    EXPECT_EQ(1u, peer.numRetainedRanges());
+    EXPECT_EQ(kMB, peer.retainedBytes());
+
+    mSource->clearReadLog();
+    readAndWait(512 * kKB);
+    readAndWait(kMB - 4 * kKB);
+    EXPECT_FALSE(mSource->readFrom(0, 16 * kMB));
+
+    // Resuming the retained range continues right after its end.
+    mSource->allow(kMB, 2 * kMB);
+    readAndWait(kMB - 2 * kKB);
+    EXPECT_FALSE(mSource->readFrom(0, kMB));
+    EXPECT_TRUE(mSource->readFrom(kMB, 2 * kMB));
+}
+
+TEST_F(NuCachedSource2RangeTest, EvictsTheLeastRecentlyUsedRangeAtTheLimit) {
+    // The first two ranges are pinned, 1 MB in total.
+    mSource->allow(0, 512 * kKB);
+    start();
+    readAndWait(0);
+    seekTo(8 * kMB, 512 * kKB);
+
+    seekTo(16 * kMB, 1536 * kKB);
+    seekTo(24 * kMB, 1536 * kKB);
+    seekTo(32 * kMB, 1536 * kKB);
+
+    NuCachedSource2Peer peer(mCache);
+    EXPECT_EQ(4u, peer.numRetainedRanges());
+    EXPECT_EQ(kRetainedBudget, peer.retainedBytes());
+
+    // Touching the range at 16 MB makes the one at 24 MB the oldest.
+    readAndWait(16 * kMB);
+
+    seekTo(40 * kMB, 1536 * kKB);
+
+    EXPECT_EQ(4u, peer.numRetainedRanges());
+    EXPECT_EQ(kRetainedBudget, peer.retainedBytes());
+    EXPECT_TRUE(peer.isRetained(0));
+    EXPECT_TRUE(peer.isRetained(8 * kMB));
+    EXPECT_TRUE(peer.isRetained(16 * kMB));
+    EXPECT_FALSE(peer.isRetained(24 * kMB));
+    EXPECT_TRUE(peer.isRetained(32 * kMB));
+
+    mSource->clearReadLog();
+    readAndWait(16 * kMB + kMB);
+    EXPECT_FALSE(mSource->readFrom(0, 48 * kMB));
+
+    readAndWait(24 * kMB);
+    EXPECT_TRUE(mSource->readFrom(24 * kMB - 256 * kKB, 24 * kMB + kMB));
+}
+
+TEST_F(NuCachedSource2RangeTest, FetchingIntoARetainedRangeCopiesIt) {
+    mSource->allow(0, 256 * kKB);
+    start();
+    readAndWait(0);
+    seekTo(32 * kMB, 512 * kKB);
+
+    // Unpinned, [3.75 MB, 4.75 MB).
+    seekTo(4 * kMB, kMB);
+
+    // A range starting at 2 MB runs into it at 3.75 MB.
+    mSource->allow(2 * kMB, 3840 * kKB);
+    mSource->clearReadLog();
+    readAndWait(2 * kMB + 256 * kKB);
+
+    EXPECT_FALSE(mSource->readFrom(3840 * kKB, 4864 * kKB));
+    EXPECT_EQ(4864 * kKB, mCache->cachedSize());
+
+    NuCachedSource2Peer peer(mCache);
+    EXPECT_FALSE(peer.isRetained(4 * kMB));
+    EXPECT_EQ(2u, peer.numRetainedRanges());
+    EXPECT_EQ(768 * kKB, peer.retainedBytes());
+
+    readAndWait(3840 * kKB - 2 * kKB);
+    readAndWait(4864 * kKB - 4 * kKB);
+}
+
+TEST_F(NuCachedSource2RangeTest, ReadsAcrossADetachedPinnedHead) {
+    // Fetching stops at the 8 MB high watermark.
+    mSource->allow(0, 64 * kMB);
+    start();
+    readAndWait(0);
+    EXPECT_EQ(8 * kMB, mCache->cachedSize());
+
+    // Getting close to the end of the cache restarts the prefetcher, which
+    // keeps the first 2 MB and drops the rest of what was read. It checks
+    // for that every 100 ms.
+    readAndWait(7 * kMB);
+    usleep(300000);
+
+    NuCachedSource2Peer peer(mCache);
+    peer.waitUntilIdle();
+    EXPECT_EQ(1u, peer.numRetainedRanges());
+    EXPECT_EQ(2 * kMB, peer.retainedBytes());
+    EXPECT_TRUE(peer.isRetained(0));
+    EXPECT_FALSE(peer.isRetained(2 * kMB));
+
+    mSource->clearReadLog();
+    readAndWait(kMB);
+    EXPECT_FALSE(mSource->readFrom(0, 64 * kMB));
+
+    // A read that straddles the end of the head resumes it, and the
+    // fetch continues where the head ends.
+    readAndWait(2 * kMB - 4 * kKB, 8 * kKB);
+    EXPECT_FALSE(mSource->readFrom(0, 2 * kMB));
+    EXPECT_TRUE(mSource->readFrom(2 * kMB, 2 * kMB + 64 * kKB));
+}
+
+}  // namespace android
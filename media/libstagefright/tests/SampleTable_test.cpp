@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SampleTable_test"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/Utils.h>
+#include <utils/Vector.h>
+
+#include "include/SampleTable.h"
+
+namespace android {
+
+static const uint32_t kNumSamples = 500;
+static const uint32_t kSyncInterval = 10;
+
+// Holds the payloads of a synthetic stbl and counts the reads made
+// against it.
+struct MemoryDataSource : public DataSource {
+    MemoryDataSource()
+        : mNumReads(0) {
+    }
+
+    virtual status_t initCheck() const {
+        return OK;
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        ++mNumReads;
+
+        if (offset < 0 || offset >= (off64_t)mData.size()) {
+            return 0;
+        }
+
+        if (offset + size > mData.size()) {
+            size = mData.size() - offset;
+        }
+
+        memcpy(data, mData.array() + offset, size);
+        return size;
+    }
+
+    // Starts a full box payload (version and flags 0), returns its offset.
+    off64_t beginBox() {
+        off64_t offset = mData.size();
+        appendU32(0);
+        return offset;
+    }
+
+    size_t boxSize(off64_t offset) const {
+        return mData.size() - offset;
+    }
+
+    void appendU32(uint32_t x) {
+        mData.push((x >> 24) & 0xff);
+        mData.push((x >> 16) & 0xff);
+        mData.push((x >> 8) & 0xff);
+        mData.push(x & 0xff);
+    }
+
+    size_t mNumReads;
+
+private:
+    Vector<uint8_t> mData;
+};
+
+static uint32_t SampleSize(uint32_t sampleIndex) {
+    return 1 + (sampleIndex * 37) % 1000;
+}
+
+struct SampleTableTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mSource = new MemoryDataSource;
+
+        // Three samples per chunk for the first 9 chunks, seven for the
+        // next 20 and a sample per chunk after that.
+        off64_t stsc = mSource->beginBox();
+        mSource->appendU32(3);
+        mSource->appendU32(1);   mSource->appendU32(3); mSource->appendU32(1);
+        mSource->appendU32(10);  mSource->appendU32(7); mSource->appendU32(1);
+        mSource->appendU32(30);  mSource->appendU32(1); mSource->appendU32(1);
+        mStsc = stsc;
+        mStscSize = mSource->boxSize(stsc);
+
+        const uint32_t kNumChunks = 9 + 20 + (kNumSamples - 9 * 3 - 20 * 7);
+        off64_t stco = mSource->beginBox();
+        mSource->appendU32(kNumChunks);
+        for (uint32_t i = 0; i < kNumChunks; ++i) {
+            mSource->appendU32(100000 + i * 10000);
+        }
+        mStco = stco;
+        mStcoSize = mSource->boxSize(stco);
+
+        off64_t stsz = mSource->beginBox();
+        mSource->appendU32(0);
+        mSource->appendU32(kNumSamples);
+        for (uint32_t i = 0; i < kNumSamples; ++i) {
+            mSource->appendU32(SampleSize(i));
+        }
+        mStsz = stsz;
+        mStszSize = mSource->boxSize(stsz);
+
+        off64_t stts = mSource->beginBox();
+        mSource->appendU32(3);
+        mSource->appendU32(100); mSource->appendU32(1000);
+        mSource->appendU32(200); mSource->appendU32(1001);
+        mSource->appendU32(200); mSource->appendU32(700);
+        mStts = stts;
+        mSttsSize = mSource->boxSize(stts);
+
+        // I, P, B reordering.
+        off64_t ctts = mSource->beginBox();
+        mSource->appendU32(kNumSamples);
+        for (uint32_t i = 0; i < kNumSamples; ++i) {
+            mSource->appendU32(1);
+            mSource->appendU32((i % 3 == 1) ? 2000 : ((i % 3 == 2) ? 0 : 1000));
+        }
+        mCtts = ctts;
+        mCttsSize = mSource->boxSize(ctts);
+
+        off64_t stss = mSource->beginBox();
+        mSource->appendU32(kNumSamples / kSyncInterval);
+        for (uint32_t i = 0; i < kNumSamples; i += kSyncInterval) {
+            mSource->appendU32(i + 1);
+        }
+        mStss = stss;
+        mStssSize = mSource->boxSize(stss);
+    }
+
+    sp<SampleTable> createTable() {
+        sp<SampleTable> table = new SampleTable(mSource);
+
+        EXPECT_EQ(OK, table->setSampleToChunkParams(mStsc, mStscSize));
+        EXPECT_EQ(OK, table->setChunkOffsetParams(
+                    FOURCC('s', 't', 'c', 'o'), mStco, mStcoSize));
+        EXPECT_EQ(OK, table->setSampleSizeParams(
+                    FOURCC('s', 't', 's', 'z'), mStsz, mStszSize));
+        EXPECT_EQ(OK, table->setTimeToSampleParams(mStts, mSttsSize));
+        EXPECT_EQ(OK, table->setCompositionTimeToSampleParams(
+                    mCtts, mCttsSize));
+        EXPECT_EQ(OK, table->setSyncSampleParams(mStss, mStssSize));
+        EXPECT_TRUE(table->isValid());
+
+        return table;
+    }
+
+    sp<MemoryDataSource> mSource;
+
+    off64_t mStsc, mStco, mStsz, mStts, mCtts, mStss;
+    size_t mStscSize, mStcoSize, mStszSize, mSttsSize, mCttsSize, mStssSize;
+};
+
+TEST_F(SampleTableTest, IndexMatchesSampleIterator) {
+    sp<SampleTable> onDemand = createTable();
+    sp<SampleTable> indexed = createTable();
+    ASSERT_EQ(OK, indexed->buildSampleIndex());
+
+    for (uint32_t i = 0; i < kNumSamples; ++i) {
+        off64_t offset1, offset2;
+        size_t size1, size2;
+        uint64_t time1, time2;
+        bool isSync1, isSync2;
+
+        ASSERT_EQ(OK, onDemand->getMetaDataForSample(
+                    i, &offset1, &size1, &time1, &isSync1));
+        ASSERT_EQ(OK, indexed->getMetaDataForSample(
+                    i, &offset2, &size2, &time2, &isSync2));
+
+        EXPECT_EQ(offset1, offset2) << "sample " << i;
+        EXPECT_EQ(size1, size2) << "sample " << i;
+        EXPECT_EQ(time1, time2) << "sample " << i;
+        EXPECT_EQ(isSync1, isSync2) << "sample " << i;
+
+        EXPECT_EQ(SampleSize(i), size2);
+        EXPECT_EQ(i % kSyncInterval == 0, isSync2) << "sample " << i;
+    }
+
+    size_t maxSize1, maxSize2;
+    ASSERT_EQ(OK, onDemand->getMaxSampleSize(&maxSize1));
+    ASSERT_EQ(OK, indexed->getMaxSampleSize(&maxSize2));
+    EXPECT_EQ(maxSize1, maxSize2);
+
+    static const uint32_t kFlags[] = {
+        SampleTable::kFlagBefore,
+        SampleTable::kFlagAfter,
+        SampleTable::kFlagClosest,
+    };
+
+    for (uint32_t i = 0; i < kNumSamples; i += 7) {
+        for (size_t j = 0; j < sizeof(kFlags) / sizeof(kFlags[0]); ++j) {
+            uint32_t sync1, sync2;
+            status_t err1 = onDemand->findSyncSampleNear(i, &sync1, kFlags[j]);
+            status_t err2 = indexed->findSyncSampleNear(i, &sync2, kFlags[j]);
+
+            EXPECT_EQ(err1, err2) << "sample " << i;
+            if (err1 == OK) {
+                EXPECT_EQ(sync1, sync2) << "sample " << i;
+            }
+        }
+    }
+
+    uint32_t thumbnail1, thumbnail2;
+    ASSERT_EQ(OK, onDemand->findThumbnailSample(&thumbnail1));
+    ASSERT_EQ(OK, indexed->findThumbnailSample(&thumbnail2));
+    EXPECT_EQ(thumbnail1, thumbnail2);
+
+    EXPECT_EQ(ERROR_END_OF_STREAM, indexed->getMetaDataForSample(
+                kNumSamples, NULL, NULL, NULL));
+}
+
+TEST_F(SampleTableTest, FirstSeekBuildsIndex) {
+    sp<SampleTable> table = createTable();
+
+    // Without a seek the samples are looked up on demand.
+    mSource->mNumReads = 0;
+    for (uint32_t i = 0; i < kNumSamples; ++i) {
+        ASSERT_EQ(OK, table->getMetaDataForSample(i, NULL, NULL, NULL));
+    }
+    EXPECT_GT(mSource->mNumReads, 0u);
+
+    uint32_t sampleIndex;
+    ASSERT_EQ(OK, table->findSampleAtTime(
+                250000, &sampleIndex, SampleTable::kFlagClosest));
+
+    // From then on nothing touches the source.
+    mSource->mNumReads = 0;
+    for (uint32_t i = kNumSamples; i-- > 0;) {
+        off64_t offset;
+        size_t size;
+        uint64_t time;
+        bool isSync;
+        ASSERT_EQ(OK, table->getMetaDataForSample(
+                    i, &offset, &size, &time, &isSync));
+    }
+    EXPECT_EQ(0u, mSource->mNumReads);
+}
+
+TEST_F(SampleTableTest, SeekFindsSampleByCompositionTime) {
+    sp<SampleTable> onDemand = createTable();
+    sp<SampleTable> seeking = createTable();
+
+    for (uint32_t i = 0; i < kNumSamples; i += 3) {
+        uint64_t time;
+        ASSERT_EQ(OK, onDemand->getMetaDataForSample(i, NULL, NULL, &time));
+
+        uint32_t sampleIndex;
+        ASSERT_EQ(OK, seeking->findSampleAtTime(
+                    time, &sampleIndex, SampleTable::kFlagClosest));
+        EXPECT_EQ(i, sampleIndex);
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SoftAudioBatch_test"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include "include/SoftAudioBatch.h"
+
+namespace android {
+
+static const size_t kFrameSize = 8;
+
+struct SoftAudioBatchTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        // A guard byte past the end catches writes beyond mPCMCapacity.
+        memset(mPCM, 0xee, sizeof(mPCM));
+        mBatch.mPCM = mPCM;
+        mBatch.mPCMCapacity = sizeof(mPCM) - 1;
+        mBatch.mPCMSize = 0;
+    }
+
+    // Decodes frame |index| the way the decoders do: to wherever
+    // outputBuffer() says, then appends it.
+    bool decodeFrame(uint8_t index, size_t skip = 0) {
+        uint8_t *out = (uint8_t *)mBatch.outputBuffer(kFrameSize, mScratch);
+        memset(out, index, kFrameSize);
+        return mBatch.append(out, kFrameSize, skip);
+    }
+
+    // 2.5 frames and a guard byte.
+    uint8_t mPCM[kFrameSize * 5 / 2 + 1];
+    uint8_t mScratch[kFrameSize];
+    SoftAudioBatch mBatch;
+};
+
+TEST_F(SoftAudioBatchTest, FramesThatFitAreDecodedInPlace) {
+    EXPECT_EQ(mPCM, mBatch.outputBuffer(kFrameSize, mScratch));
+    EXPECT_TRUE(decodeFrame(1));
+
+    EXPECT_EQ(mPCM + kFrameSize, mBatch.outputBuffer(kFrameSize, mScratch));
+    EXPECT_TRUE(decodeFrame(2));
+
+    EXPECT_EQ(2 * kFrameSize, mBatch.mPCMSize);
+    EXPECT_FALSE(mBatch.isFull());
+
+    for (size_t i = 0; i < 2 * kFrameSize; ++i) {
+        EXPECT_EQ(1 + i / kFrameSize, mPCM[i]) << "byte " << i;
+    }
+}
+
+TEST_F(SoftAudioBatchTest, PartialLastFrameFillsTheBuffer) {
+    EXPECT_TRUE(decodeFrame(1));
+    EXPECT_TRUE(decodeFrame(2));
+
+    // Only half of the third frame fits, it is decoded to scratch and
+    // the rest of it dropped.
+    EXPECT_EQ(mScratch, mBatch.outputBuffer(kFrameSize, mScratch));
+    EXPECT_FALSE(decodeFrame(3));
+
+    EXPECT_TRUE(mBatch.isFull());
+    EXPECT_EQ(mBatch.mPCMCapacity, mBatch.mPCMSize);
+
+    for (size_t i = 2 * kFrameSize; i < mBatch.mPCMCapacity; ++i) {
+        EXPECT_EQ(3, mPCM[i]) << "byte " << i;
+    }
+    EXPECT_EQ(0xee, mPCM[mBatch.mPCMCapacity]);
+
+    // Nothing more goes in once full.
+    EXPECT_FALSE(decodeFrame(4));
+    EXPECT_FALSE(mBatch.appendSilence(kFrameSize));
+    EXPECT_EQ(mBatch.mPCMCapacity, mBatch.mPCMSize);
+    EXPECT_EQ(0xee, mPCM[mBatch.mPCMCapacity]);
+}
+
+TEST_F(SoftAudioBatchTest, SkippedBytesAreLeftOut) {
+    // Skipping all of a frame appends nothing.
+    EXPECT_TRUE(decodeFrame(1, kFrameSize));
+    EXPECT_EQ(0u, mBatch.mPCMSize);
+
+    // Decoded in place, the kept bytes move to the front.
+    EXPECT_TRUE(decodeFrame(2, kFrameSize - 2));
+    EXPECT_EQ(2u, mBatch.mPCMSize);
+    EXPECT_EQ(2, mPCM[0]);
+    EXPECT_EQ(2, mPCM[1]);
+
+    EXPECT_TRUE(decodeFrame(3));
+    EXPECT_EQ(2 + kFrameSize, mBatch.mPCMSize);
+    EXPECT_EQ(3, mPCM[2]);
+}
+
+TEST_F(SoftAudioBatchTest, SilenceStopsAtTheLimit) {
+    EXPECT_TRUE(decodeFrame(1));
+    EXPECT_FALSE(mBatch.appendSilence(2 * kFrameSize));
+
+    EXPECT_EQ(mBatch.mPCMCapacity, mBatch.mPCMSize);
+    for (size_t i = kFrameSize; i < mBatch.mPCMCapacity; ++i) {
+        EXPECT_EQ(0, mPCM[i]) << "byte " << i;
+    }
+    EXPECT_EQ(0xee, mPCM[mBatch.mPCMCapacity]);
+}
+
+}  // namespace android